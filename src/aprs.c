@@ -33,8 +33,11 @@
 #include <math.h>
 
 #include "aprs.h"
+#include "aprs_track.h"
+#include "utils.h"
 #include "time_base.h"
 #include "wall_clock.h"
+#include "lora_toa.h"
 
 #ifdef RATE_LIMIT_MESSAGE_TEXT
 bool rate_limit_message_text = RATE_LIMIT_MESSAGE_TEXT ? true : false;
@@ -83,13 +86,31 @@ static float m_lon;
 static float m_alt_m;
 static time_t m_time;
 
+static float m_speed_m_s;
+static float m_course_deg;
+static bool  m_speed_course_valid;
+
+static aprs_mic_e_msg_t m_mic_e_msg;
+
 static char m_dest[16];
 static char m_src[16];
+static aprs_call_t m_src_call;
 
 static char    m_path[8][16];
 static uint8_t m_npath;
 
-static uint8_t m_info[APRS_MAX_INFO_LEN];
+/* Pre-encoded frame header "<\xFF\x01SRC>DEST,PATH:", rebuilt whenever source,
+ * destination or path change. WX frames use the part up to the destination
+ * followed by ':'. Maximum length: 3 + 15 + 1 + 15 + 8 * 16 + 1. */
+#define APRS_MAX_HEADER_LEN 168
+
+// Mic-E destination address: encoded latitude, message bits and flags
+#define APRS_MIC_E_DEST_LEN 6
+
+static uint8_t m_header[APRS_MAX_HEADER_LEN];
+static uint8_t m_header_len;       // complete header including path and ':'
+static uint8_t m_header_dest_len;  // header up to (including) the destination
+static uint8_t m_header_src_len;   // header up to (including) the '>' behind the source
 
 static char m_table;
 static char m_icon;
@@ -99,7 +120,120 @@ static char m_error_message[256];
 
 static uint32_t m_config_flags;
 
-static aprs_rx_history_t m_rx_history;
+#define FIELD_BIT(field) (1 << (field))
+
+// default priorities of the optional fields: position precision first
+static const uint8_t m_default_field_priority[APRS_NUM_FIELDS] = {
+	3, // APRS_FIELD_ALTITUDE
+	0, // APRS_FIELD_COMMENT
+	1, // APRS_FIELD_FRAME_COUNTER
+	2, // APRS_FIELD_VBAT
+	2, // APRS_FIELD_TELEMETRY
+	4, // APRS_FIELD_DAO
+};
+
+static uint32_t     m_airtime_budget_ms;   // 0 = unlimited
+static int16_t      m_max_frame_len;       // longest frame within the budget
+static uint8_t      m_field_priority[APRS_NUM_FIELDS];
+static aprs_field_t m_field_order[APRS_NUM_FIELDS]; // by descending priority
+
+// comment rate limit
+static uint8_t  m_comments_added;
+static uint64_t m_time_comment_added;
+
+// RX history: a table of fixed-size entries and an arena with the received
+// frames, see history_record_t.
+static aprs_rx_history_entry_t m_rx_history[APRS_RX_HISTORY_SIZE];
+static aprs_rx_history_stats_t m_rx_history_stats;
+
+// Index of the history. The hash table uses open addressing with linear
+// probing over a hash of the packed source call (or of the string for names
+// that cannot be packed) and stores entry index + 1 (0 marks an empty slot).
+// The entries are also linked in the order of their last update, so the least
+// recently updated one can be replaced without a search.
+#if APRS_RX_HISTORY_SIZE <= 32
+	#define RX_HISTORY_HASH_SIZE  64
+#elif APRS_RX_HISTORY_SIZE <= 64
+	#define RX_HISTORY_HASH_SIZE  128
+#elif APRS_RX_HISTORY_SIZE <= 128
+	#define RX_HISTORY_HASH_SIZE  256
+#elif APRS_RX_HISTORY_SIZE <= 256
+	#define RX_HISTORY_HASH_SIZE  512
+#elif APRS_RX_HISTORY_SIZE <= 512
+	#define RX_HISTORY_HASH_SIZE  1024
+#else
+	#define RX_HISTORY_HASH_SIZE  2048
+#endif
+
+#define RX_HISTORY_NONE  APRS_RX_HISTORY_SIZE
+
+static uint16_t m_rx_history_slot[RX_HISTORY_HASH_SIZE];
+static uint16_t m_rx_history_newer[APRS_RX_HISTORY_SIZE];
+static uint16_t m_rx_history_older[APRS_RX_HISTORY_SIZE];
+static uint16_t m_rx_history_newest;
+static uint16_t m_rx_history_oldest;
+
+// entries released for arena space, reused before the table grows
+static uint16_t m_rx_history_free_next[APRS_RX_HISTORY_SIZE];
+static uint16_t m_rx_history_free;
+
+// Entry indices of the stations sorted by distance and by RSSI. The first
+// num_stations elements are used. Stations are inserted at their position by
+// a binary search. The order by time is the update order above.
+static uint16_t m_rx_history_by_distance[APRS_RX_HISTORY_SIZE];
+static uint16_t m_rx_history_by_rssi[APRS_RX_HISTORY_SIZE];
+
+// position of the last distance calculation
+static bool  m_rx_history_has_reference;
+static float m_rx_history_ref_lat;
+static float m_rx_history_ref_lon;
+
+// Spatial index: the stations are linked into buckets by the grid cell of
+// their position. Cells are 1/RX_HISTORY_GRID_CELLS_PER_DEG degrees in both
+// directions, cells with the same hash share a bucket.
+#define RX_HISTORY_GRID_CELLS_PER_DEG  10
+#define RX_HISTORY_GRID_LAT_CELLS      (180 * RX_HISTORY_GRID_CELLS_PER_DEG)
+#define RX_HISTORY_GRID_LON_CELLS      (360 * RX_HISTORY_GRID_CELLS_PER_DEG)
+#define RX_HISTORY_GRID_BUCKETS        (RX_HISTORY_HASH_SIZE / 2)
+
+// length of a degree of latitude, as in great_circle_distance_m()
+#define RX_HISTORY_M_PER_DEG  (6371000.0f * 3.14159265f / 180.0f)
+
+static uint16_t m_rx_history_grid_head[RX_HISTORY_GRID_BUCKETS];
+static uint16_t m_rx_history_grid_next[APRS_RX_HISTORY_SIZE];
+
+/* Header of a frame record in the history arena. It is followed by the
+ * telemetry (if any) and the data area, which holds the received frame and
+ * those decoded strings that are not contained in the frame verbatim. Strings
+ * are referenced by their offset and length in the data area, so the source,
+ * destination and path usually take no extra space. */
+typedef struct {
+	uint16_t len;    // length of the record including this header, multiple of 4
+	uint16_t owner;  // entry index or RX_HISTORY_NONE if the record is unused
+	float    speed;
+	float    range;
+	uint16_t course;
+	uint8_t  data_len;
+	uint8_t  has_telemetry;
+	uint16_t str_offset[APRS_RX_HISTORY_NUM_STRINGS];
+	uint8_t  str_len[APRS_RX_HISTORY_NUM_STRINGS];
+} history_record_t;
+
+#define HISTORY_MAX_RECORD_LEN  ((sizeof(history_record_t) + sizeof(aprs_telemetry_t) + 255 \
+			+ sizeof(((aprs_frame_t*)0)->source) + sizeof(((aprs_frame_t*)0)->dest) \
+			+ sizeof(((aprs_frame_t*)0)->via) + sizeof(((aprs_frame_t*)0)->comment) + 3) & ~3)
+
+#define HISTORY_NO_RECORD  0xFFFF
+
+// The records are stored back to back from the start of the arena up to
+// m_rx_history_arena_head. Records of updated or replaced stations become
+// unused and are removed by compacting the arena once the head reaches the
+// end.
+static uint32_t m_rx_history_arena[APRS_RX_HISTORY_ARENA_SIZE / 4];
+static uint16_t m_rx_history_arena_head;
+
+// the record to write, built before the arena makes room for it
+static uint32_t m_rx_history_record_buf[HISTORY_MAX_RECORD_LEN / 4];
 
 
 static void append_address(uint8_t **frameptr, char *addr, uint8_t is_last)
@@ -114,6 +248,75 @@ static void append_address(uint8_t **frameptr, char *addr, uint8_t is_last)
 	}
 }
 
+/**@brief Render the frame header template from source, destination and path.
+ */
+static void update_header(void)
+{
+	uint8_t *frameptr = m_header;
+
+	*(frameptr++) = '<';
+	*(frameptr++) = 0xFF;
+	*(frameptr++) = 0x01;
+
+	append_address(&frameptr, m_src, 1);
+	*(frameptr++) = '>';
+
+	m_header_src_len = (uint8_t)(frameptr - m_header);
+
+	//append_address(&frameptr, m_dest, (m_npath == 0) ? 1 : 0);
+	append_address(&frameptr, m_dest, 1);
+
+	m_header_dest_len = (uint8_t)(frameptr - m_header);
+
+        // Add via path. SSID "1" or "2" means dest "call digipeating"
+        if (m_npath == 1 && isdigit((unsigned char)m_path[0][0])) {
+          int ssid = atoi(m_path[0]);
+          if (ssid < 1 || ssid > 2)
+            ssid = 1;
+	  *(frameptr++) = '-';
+	  *(frameptr++) = '0' + ssid;
+        } else {
+	  //for(uint8_t i = 0; i < m_npath; i++) {
+		//append_address(&frameptr, m_path[i], (m_npath == (i+1)) ? 1 : 0);
+	  //}
+	  for(uint8_t i = 0; i < m_npath; i++) {
+	    *(frameptr++) = ',';
+	    append_address(&frameptr, m_path[i], 1);
+          }
+        }
+	*(frameptr++) = ':';
+
+	m_header_len = (uint8_t)(frameptr - m_header);
+}
+
+/**@brief Calculate the DAO string ("!Wxy!") if enabled.
+ *
+ * @param lat_min_full_precision  Latitude arc minutes with 4 fractional digits.
+ * @param lon_min_full_precision  Longitude arc minutes with 4 fractional digits.
+ * @param dao                     Destination buffer with 6 bytes. Empty string if DAO is disabled.
+ */
+static void encode_dao_string(int lat_min_full_precision, int lon_min_full_precision, char *dao)
+{
+	if(m_config_flags & APRS_FLAG_ADD_DAO) {
+		dao[0] = dao[4] = '!'; // start and end markers
+		//dao[1] = 'w';          // WGS84 identifier
+		dao[1] = 'W';          // WGS84 identifier
+		dao[5] = '\0';         // String terminator
+
+		// extract extended precision part
+		int lat_min_fract_extended = lat_min_full_precision % 100;
+		int lon_min_fract_extended = lon_min_full_precision % 100;
+
+		// encode extended precision part as Base-91
+		//dao[2] = '!' + lat_min_fract_extended * 91 / 100; // note: integer division!
+		//dao[3] = '!' + lon_min_fract_extended * 91 / 100; // note: integer division!
+		dao[2] = '0' + lat_min_fract_extended/10; // note: integer division!
+		dao[3] = '0' + lon_min_fract_extended/10; // note: integer division!
+	} else {
+		dao[0] = '\0';
+	}
+}
+
 //static char* encode_position_readable(char *str, size_t max_len, char table, char symbol)
 static char* encode_position_readable(char *str, size_t max_len, char table, char symbol, char *dao)
 {
@@ -161,24 +364,7 @@ static char* encode_position_readable(char *str, size_t max_len, char table, cha
 	lon_min_fract = (lon_min_full_precision / 100) % 100;
 
 	// calculate the DAO string if requested
-	if(m_config_flags & APRS_FLAG_ADD_DAO) {
-		dao[0] = dao[4] = '!'; // start and end markers
-		//dao[1] = 'w';          // WGS84 identifier
-		dao[1] = 'W';          // WGS84 identifier
-		dao[5] = '\0';         // String terminator
-
-		// extract extended precision part
-		int lat_min_fract_extended = lat_min_full_precision % 100;
-		int lon_min_fract_extended = lon_min_full_precision % 100;
-
-		// encode extended precision part as Base-91
-		//dao[2] = '!' + lat_min_fract_extended * 91 / 100; // note: integer division!
-		//dao[3] = '!' + lon_min_fract_extended * 91 / 100; // note: integer division!
-		dao[2] = '0' + lat_min_fract_extended/10; // note: integer division!
-		dao[3] = '0' + lon_min_fract_extended/10; // note: integer division!
-	} else {
-		dao[0] = '\0';
-	}
+	encode_dao_string(lat_min_full_precision, lon_min_full_precision, dao);
 
 	int ret = snprintf(str, max_len, "%02i%02i.%02i%c%c%03i%02i.%02i%c%c%s",
 			lat_deg, lat_min, lat_min_fract, lat_ns, table,
@@ -207,7 +393,7 @@ static char* encode_position_compressed(char *str, size_t max_len, char table, c
 	 * YYYY = compressed latitude (base-91 encoded)
 	 * XXXX = compressed longitude (base-91 encoded)
 	 * $    = icon
-	 * cs   = compressed altitude (alternatives: course/speed, radio range)
+	 * cs   = compressed altitude or course/speed (alternative: radio range)
 	 * T    = compression type (bitmask, base-91 encoded)
 	 */
 
@@ -237,23 +423,56 @@ static char* encode_position_compressed(char *str, size_t max_len, char table, c
 		lon_compressed /= 91;
 	}
 
-	// compressed altitude calculation
-	// encoded value = log_1.002(altitude in feet)
+	uint8_t type;
 
-	float alt_ft = m_alt_m / 0.3048f;
-	if(alt_ft < 1) {
-		alt_ft = 1; // prevent exception in the logarithm
-	}
+	if(m_config_flags & APRS_FLAG_COMPRESSED_COURSE_SPEED) {
+		if(m_speed_course_valid) {
+			// course: degrees / 4 (0 = north)
+			// speed: encoded value = log_1.08(speed in knots + 1)
+
+			uint32_t course_encoded = ((uint32_t)(m_course_deg + 2.0f) / 4) % 90;
+
+			float speed_kt = m_speed_m_s / 0.514444f;
+			if(speed_kt < 0) {
+				speed_kt = 0;
+			}
+
+			uint32_t speed_encoded = (uint32_t)(logf(speed_kt + 1.0f) / 0.0769610411f + 0.5f); // the magic constant is ln(1.08)
+			if(speed_encoded > 89) {
+				speed_encoded = 89;
+			}
 
-	uint32_t alt_encoded = (uint32_t)(logf(alt_ft) / 0.00199800266f); // the magic constant is ln(1.002)
+			str[10] = '!' + course_encoded;
+			str[11] = '!' + speed_encoded;
+		} else {
+			// c = ' ' marks the csT bytes as unused
+			str[10] = ' ';
+			str[11] = ' ';
+		}
+
+		// Type byte
+		type = (1 << 5) /* current position */
+		     | (3 << 3) /* source = RMC (anything but GGA selects course/speed) */
+		     | (0 << 0) /* origin = compressed */;
+	} else {
+		// compressed altitude calculation
+		// encoded value = log_1.002(altitude in feet)
+
+		float alt_ft = m_alt_m / 0.3048f;
+		if(alt_ft < 1) {
+			alt_ft = 1; // prevent exception in the logarithm
+		}
+
+		uint32_t alt_encoded = (uint32_t)(logf(alt_ft) / 0.00199800266f); // the magic constant is ln(1.002)
 
-	str[10] = '!' + (alt_encoded / 91) % 91;
-	str[11] = '!' + alt_encoded % 91;
+		str[10] = '!' + (alt_encoded / 91) % 91;
+		str[11] = '!' + alt_encoded % 91;
 
-	// Type byte
-	uint8_t type = (1 << 5) /* current position */
-	             | (2 << 3) /* source = GGA (necessary for altitude encoding) */
-	             | (0 << 0) /* origin = compressed */;
+		// Type byte
+		type = (1 << 5) /* current position */
+		     | (2 << 3) /* source = GGA (necessary for altitude encoding) */
+		     | (0 << 0) /* origin = compressed */;
+	}
 
 	str[12] = '!' + type;
 
@@ -262,6 +481,164 @@ static char* encode_position_compressed(char *str, size_t max_len, char table, c
 	return str + 13;
 }
 
+/**@brief Select the position encoding. Mic-E takes precedence over the
+ * compressed format. */
+static bool use_mic_e(void)
+{
+	return (m_config_flags & APRS_FLAG_MIC_E) != 0;
+}
+
+static bool use_compressed(void)
+{
+	return !use_mic_e() && (m_config_flags & APRS_FLAG_COMPRESS_LOCATION);
+}
+
+/**@brief Check whether the altitude is encoded in the cs bytes of the
+ * compressed position. Otherwise, it is sent as an optional field. */
+static bool use_compressed_altitude(void)
+{
+	return use_compressed() && !(m_config_flags & APRS_FLAG_COMPRESSED_COURSE_SPEED);
+}
+
+/**@brief Calculate the arc minutes of an absolute coordinate with 4 fractional digits.
+ */
+static int min_full_precision(float deg_abs)
+{
+	return (deg_abs - (int)deg_abs) * 600000;
+}
+
+/**@brief Encode the latitude, the message and the flags into the Mic-E destination address.
+ * @details
+ * Each of the 6 characters carries one digit of the latitude (DDMM.hh). The
+ * first three also carry the message bits A/B/C, the others the N/S indicator,
+ * the longitude offset and the E/W indicator: '0'..'9' for 0, 'P'..'Y' for 1.
+ *
+ * @param dest   Destination for the 6 address characters (not NUL-terminated).
+ */
+static void encode_mic_e_dest(char *dest)
+{
+	float lat = fabsf(m_lat);
+	float lon = fabsf(m_lon);
+
+	int lat_deg = (int)lat;
+	int lat_min_full_precision = min_full_precision(lat);
+	int lat_min = lat_min_full_precision / 10000;
+	int lat_min_fract = (lat_min_full_precision / 100) % 100;
+	int lon_deg = (int)lon;
+
+	uint8_t msg_bits = 7 - (uint8_t)m_mic_e_msg; // M0 = 111 ... Emergency = 000
+
+	uint8_t digits[6] = {
+		lat_deg / 10, lat_deg % 10,
+		lat_min / 10, lat_min % 10,
+		lat_min_fract / 10, lat_min_fract % 10};
+
+	bool flags[6] = {
+		(msg_bits & 0x04) != 0,             // message bit A
+		(msg_bits & 0x02) != 0,             // message bit B
+		(msg_bits & 0x01) != 0,             // message bit C
+		m_lat >= 0,                         // north
+		(lon_deg < 10) || (lon_deg >= 100), // longitude offset +100
+		m_lon < 0};                         // west
+
+	for(uint8_t i = 0; i < 6; i++) {
+		dest[i] = (flags[i] ? 'P' : '0') + digits[i];
+	}
+}
+
+/**@brief Encode longitude, speed, course and symbol of a Mic-E position report.
+ * @details
+ * All values are offset by 28. Where the specification allows it, values that
+ * would result in control characters are moved to a printable range that
+ * decodes to the same value.
+ */
+static char* encode_position_mic_e(char *str, size_t max_len, char table, char symbol, char *dao)
+{
+	if(max_len < 9) {
+		*str = 0;
+		return NULL;
+	}
+
+	float lon = fabsf(m_lon);
+
+	int lon_deg = (int)lon;
+	int lon_min_full_precision = min_full_precision(lon);
+	int lon_min = lon_min_full_precision / 10000;
+	int lon_min_fract = (lon_min_full_precision / 100) % 100;
+
+	if(lon_deg < 10) {
+		str[0] = lon_deg + 118;       // 190..199 - 190, with offset
+	} else if(lon_deg < 100) {
+		str[0] = lon_deg + 28;
+	} else if(lon_deg < 110) {
+		str[0] = lon_deg - 100 + 108; // 180..189 - 80, with offset
+	} else {
+		str[0] = lon_deg - 100 + 28;  // with offset
+	}
+
+	str[1] = (lon_min < 10) ? (lon_min + 60 + 28) : (lon_min + 28);
+	str[2] = lon_min_fract + 28;
+
+	// speed in knots (0..799), course in degrees (1..360, 0 = unknown)
+	int speed_kt = 0;
+	int course = 0;
+
+	if(m_speed_course_valid) {
+		speed_kt = (int)(m_speed_m_s / 0.514444f + 0.5f);
+		if(speed_kt > 799) {
+			speed_kt = 799;
+		}
+
+		course = (int)(m_course_deg + 0.5f) % 360;
+		if(course <= 0) {
+			course += 360;
+		}
+	}
+
+	int sp = speed_kt / 10;
+	int dc = (speed_kt % 10) * 10 + course / 100;
+	int se = course % 100;
+
+	str[3] = (sp < 20) ? (sp + 80 + 28) : (sp + 28); // decodes to speed + 800
+	str[4] = (dc < 4) ? (dc + 4 + 28) : (dc + 28);   // decodes to course + 400
+	str[5] = se + 28;
+
+	str[6] = symbol;
+	str[7] = table;
+	str[8] = '\0';
+
+	float lat = fabsf(m_lat);
+	encode_dao_string(min_full_precision(lat), lon_min_full_precision, dao);
+
+	return str + 8;
+}
+
+/**@brief Encode the altitude in the Mic-E format: "xxx}", base-91 meters + 10000.
+ */
+static char* encode_altitude_mic_e(char *str, size_t max_len)
+{
+	if(max_len < 5) {
+		*str = 0;
+		return NULL;
+	}
+
+	int32_t alt = (int32_t)floorf(m_alt_m + 0.5f) + 10000;
+
+	if(alt < 0) {
+		alt = 0;
+	} else if(alt > 91*91*91 - 1) {
+		alt = 91*91*91 - 1;
+	}
+
+	str[0] = '!' + alt / (91*91);
+	str[1] = '!' + (alt / 91) % 91;
+	str[2] = '!' + alt % 91;
+	str[3] = '}';
+	str[4] = '\0';
+
+	return str + 4;
+}
+
 static char* encode_altitude_readable(bool first_entry, char *str, size_t max_len)
 {
 	float alt_ft = m_alt_m / 0.3048f;
@@ -348,6 +725,138 @@ static char *encode_weather(char *str, size_t max_len, const aprs_args_t *args)
 	}
 }
 
+/* Base-91 comment telemetry: "|" + sequence + analog channels + "|", each
+ * value encoded in two base-91 digits (0 to 8280). The channel layout and
+ * scaling are announced in the PARM/UNIT/EQNS messages. */
+#define TLM_MAX_VALUE          8280
+#define TLM_NUM_CHANNELS_VBAT  1 // A1 only
+#define TLM_NUM_CHANNELS_ENV   4 // A1 to A4
+
+typedef struct {
+	const char *parm; // channel name
+	const char *unit;
+	const char *eqns; // a,b,c of a * x^2 + b * x + c
+} tlm_channel_t;
+
+static const tlm_channel_t m_tlm_channels[TLM_NUM_CHANNELS_ENV] = {
+	{"Vbat",     "V",    "0,0.001,0"},  // A1: mV
+	{"Temp",     "degC", "0,0.1,-50"},  // A2: 0.1 °C, offset -50 °C
+	{"Humidity", "%",    "0,0.1,0"},    // A3: 0.1 %
+	{"Pressure", "hPa",  "0,0.1,300"},  // A4: 0.1 hPa, offset 300 hPa
+};
+
+static void encode_base91_value(char *str, int32_t value)
+{
+	if(value < 0) {
+		value = 0;
+	} else if(value > TLM_MAX_VALUE) {
+		value = TLM_MAX_VALUE;
+	}
+
+	str[0] = '!' + value / 91;
+	str[1] = '!' + value % 91;
+}
+
+/**@brief Check whether environmental data is sent in the telemetry.
+ */
+static bool tlm_has_env_data(const aprs_args_t *args)
+{
+	return (m_config_flags & APRS_FLAG_ADD_WEATHER) && args->transmit_env_data;
+}
+
+static char *encode_telemetry(bool first_entry, char *str, size_t max_len, const aprs_args_t *args)
+{
+	uint8_t n_channels = tlm_has_env_data(args) ? TLM_NUM_CHANNELS_ENV : TLM_NUM_CHANNELS_VBAT;
+	size_t len = (first_entry ? 0 : 1) + 2 + 2 * (1 + n_channels);
+
+	if(len + 1 > max_len) {
+		*str = 0;
+		return NULL; // a truncated telemetry block is not decodable
+	}
+
+	char *ptr = str;
+
+	if(!first_entry) {
+		*ptr++ = ' ';
+	}
+
+	*ptr++ = '|';
+
+	encode_base91_value(ptr, args->frame_id % (TLM_MAX_VALUE + 1));
+	ptr += 2;
+
+	// A1: battery voltage in mV
+	encode_base91_value(ptr, args->vbat_millivolt);
+	ptr += 2;
+
+	if(n_channels == TLM_NUM_CHANNELS_ENV) {
+		// A2: temperature in 0.1 °C, offset -50 °C
+		encode_base91_value(ptr, (int32_t)floorf((args->temperature_celsius + 50.0f) * 10.0f + 0.5f));
+		ptr += 2;
+
+		// A3: humidity in 0.1 %
+		encode_base91_value(ptr, (int32_t)floorf(args->humidity_rH * 10.0f + 0.5f));
+		ptr += 2;
+
+		// A4: pressure in 0.1 hPa, offset 300 hPa
+		encode_base91_value(ptr, (int32_t)floorf((args->pressure_hPa - 300.0f) * 10.0f + 0.5f));
+		ptr += 2;
+	}
+
+	*ptr++ = '|';
+	*ptr = '\0';
+
+	return ptr;
+}
+
+/**@brief Encode a telemetry definition message addressed to the source call.
+ * @details
+ * Only the channels that are actually sent are defined: A1 without and A1 to
+ * A4 with environmental data. Nothing is encoded if the source call does not
+ * fit into the 9 characters of the addressee field, as the definitions would
+ * then apply to another station.
+ */
+static char *encode_telemetry_definition(char *str, size_t max_len, uint8_t packet_type)
+{
+	const char *name;
+
+	switch(packet_type) {
+		case PACKET_TYPE_TLM_PARM: name = "PARM"; break;
+		case PACKET_TYPE_TLM_UNIT: name = "UNIT"; break;
+		case PACKET_TYPE_TLM_EQNS: name = "EQNS"; break;
+		default: return NULL;
+	}
+
+	if(strlen(m_src) > 9) {
+		*str = 0;
+		return NULL;
+	}
+
+	uint8_t n_channels = (m_config_flags & APRS_FLAG_ADD_WEATHER) ? TLM_NUM_CHANNELS_ENV : TLM_NUM_CHANNELS_VBAT;
+
+	int ret = snprintf(str, max_len, ":%-9s:%s.", m_src, name);
+
+	for(uint8_t i = 0; i < n_channels && ret >= 0 && ret < max_len; i++) {
+		const char *value;
+
+		switch(packet_type) {
+			case PACKET_TYPE_TLM_PARM: value = m_tlm_channels[i].parm; break;
+			case PACKET_TYPE_TLM_UNIT: value = m_tlm_channels[i].unit; break;
+			default:                   value = m_tlm_channels[i].eqns; break;
+		}
+
+		int n = snprintf(str + ret, max_len - ret, "%s%s", (i == 0) ? "" : ",", value);
+		ret = (n < 0) ? n : ret + n;
+	}
+
+	if(ret < 0 || ret >= max_len) {
+		*str = 0;
+		return NULL; // error
+	}
+
+	return str + ret;
+}
+
 static char *encode_dao(bool first_entry, char *str, size_t max_len, char *dao)
 {
         if (!*dao || max_len < 6)
@@ -367,15 +876,21 @@ static char *encode_dao(bool first_entry, char *str, size_t max_len, char *dao)
 	}
 }
 
-static int update_info_field(const aprs_args_t *args)
+/**@brief Encode the information field of a position report.
+ *
+ * @param info      Destination of the information field (usually directly
+ *                  behind the header in the frame). It is NUL-terminated.
+ * @param info_len  Space available at info, including the NUL byte.
+ * @param args      Additional data to encode.
+ * @param fields    Optional fields to encode (bitmask of FIELD_BIT(aprs_field_t)).
+ * @returns         0 on success, -1 if the position could not be encoded.
+ */
+static int update_info_field(char *info, size_t info_len, const aprs_args_t *args, uint8_t fields)
 {
-        static uint8_t comments_added = 0;
-        static uint64_t time_comment_added = 0L;
-        uint64_t now = time_base_get();
 	bool first_entry = true;
 
-	char *info_end = (char*)m_info + sizeof(m_info);
-	char *infoptr = (char*)m_info;
+	char *info_end = info + info_len;
+	char *infoptr = info;
 	char *retptr;
 
 	//bool is_weather_report = (m_config_flags & APRS_FLAG_ADD_WEATHER) && args->transmit_env_data;
@@ -391,13 +906,15 @@ static int update_info_field(const aprs_args_t *args)
 		symbol = '_';
 	}
 
-	/* packet type: position, no APRS messaging */
-	*infoptr = '!';
+	/* packet type: position, no APRS messaging; Mic-E with current GPS data */
+	*infoptr = use_mic_e() ? '`' : '!';
 	infoptr++;
 
 	/* encode position */
 
-	if(m_config_flags & APRS_FLAG_COMPRESS_LOCATION) {
+	if(use_mic_e()) {
+		retptr = encode_position_mic_e(infoptr, info_end - infoptr, table, symbol, dao);
+	} else if(use_compressed()) {
 		retptr = encode_position_compressed(infoptr, info_end - infoptr, table, symbol);
 	} else {
 		retptr = encode_position_readable(infoptr, info_end - infoptr, table, symbol, dao);
@@ -417,31 +934,28 @@ static int update_info_field(const aprs_args_t *args)
 		}
 	}
 
-	/* add altitude for uncompressed packets (already included in compressed format) */
-	if(!(m_config_flags & APRS_FLAG_COMPRESS_LOCATION)
-			&& (m_config_flags & APRS_FLAG_ADD_ALTITUDE)) {
-		retptr = encode_altitude_readable(first_entry, infoptr, info_end - infoptr);
-		if(retptr) {
-			infoptr = retptr;
-			first_entry = false;
+	/* add altitude unless it is already included in the compressed position.
+	 * In Mic-E, it must directly follow the position. */
+	if(!use_compressed_altitude()
+			&& (m_config_flags & APRS_FLAG_ADD_ALTITUDE)
+			&& (fields & FIELD_BIT(APRS_FIELD_ALTITUDE))) {
+		if(use_mic_e()) {
+			// fixed length, no separator needed
+			retptr = encode_altitude_mic_e(infoptr, info_end - infoptr);
+			if(retptr) {
+				infoptr = retptr;
+			}
+		} else {
+			retptr = encode_altitude_readable(first_entry, infoptr, info_end - infoptr);
+			if(retptr) {
+				infoptr = retptr;
+				first_entry = false;
+			}
 		}
 	}
 
 	/* add comment */
-        if (!rate_limit_message_text) {
-          comments_added = 0;
-        } else {
-          uint64_t t_offset = MAX_TX_INTERVAL_MS;
-          // send comment text not under 10min, and at least every hour
-          if (t_offset < 600000L)
-            t_offset = 600000L;
-          else if (t_offset > 3600000L)
-            t_offset = 3600000L;
-          if ((time_comment_added + t_offset) < now)
-            comments_added = 0;
-        }
-        if ((comments_added++ % 10) == 0) {
-          time_comment_added = now;
+	if (fields & FIELD_BIT(APRS_FIELD_COMMENT)) {
 	  size_t chars_to_copy_from_comment = strlen(m_comment);
           if (!first_entry && infoptr < info_end-1)
 		*infoptr++ = ' ';
@@ -457,7 +971,8 @@ static int update_info_field(const aprs_args_t *args)
         }
 
 	/* add frame counter */
-        if (m_config_flags & APRS_FLAG_ADD_FRAME_COUNTER) {
+        if ((m_config_flags & APRS_FLAG_ADD_FRAME_COUNTER)
+			&& (fields & FIELD_BIT(APRS_FIELD_FRAME_COUNTER))) {
 		retptr = encode_frame_id(first_entry, infoptr, info_end - infoptr, args->frame_id);
 		if(retptr) {
 			infoptr = retptr;
@@ -466,7 +981,8 @@ static int update_info_field(const aprs_args_t *args)
 	}
 
 	/* add Vbat */
-        if (m_config_flags & APRS_FLAG_ADD_VBAT) {
+        if ((m_config_flags & APRS_FLAG_ADD_VBAT)
+			&& (fields & FIELD_BIT(APRS_FIELD_VBAT))) {
 		retptr = encode_vbat(first_entry, infoptr, info_end - infoptr, args->vbat_millivolt);
 		if(retptr) {
 			infoptr = retptr;
@@ -474,8 +990,19 @@ static int update_info_field(const aprs_args_t *args)
 		}
 	}
 
+	/* add telemetry */
+	if ((m_config_flags & APRS_FLAG_TELEMETRY)
+			&& (fields & FIELD_BIT(APRS_FIELD_TELEMETRY))) {
+		retptr = encode_telemetry(first_entry, infoptr, info_end - infoptr, args);
+		if(retptr) {
+			infoptr = retptr;
+			first_entry = false;
+		}
+	}
+
         /* add DAO for uncompressed packets (already at high precision in compressed format) */
-	if (!(m_config_flags & APRS_FLAG_COMPRESS_LOCATION) && *dao) {
+	if (!use_compressed() && *dao
+			&& (fields & FIELD_BIT(APRS_FIELD_DAO))) {
         	retptr = encode_dao(first_entry, infoptr, info_end - infoptr, dao);
 		if(retptr) {
 			infoptr = retptr;
@@ -486,44 +1013,214 @@ static int update_info_field(const aprs_args_t *args)
 	return 0;
 }
 
-// PUBLIC FUNCTIONS
+/**@brief Check whether the comment should be sent in the next frame.
+ * @details
+ * The comment is sent with every 10th frame, but at least every
+ * MAX_TX_INTERVAL_MS (limited to 10 to 60 minutes) if rate limiting is enabled.
+ */
+static bool comment_due(uint64_t now)
+{
+        if (!rate_limit_message_text) {
+          m_comments_added = 0;
+        } else {
+          uint64_t t_offset = MAX_TX_INTERVAL_MS;
+          // send comment text not under 10min, and at least every hour
+          if (t_offset < 600000L)
+            t_offset = 600000L;
+          else if (t_offset > 3600000L)
+            t_offset = 3600000L;
+          if ((m_time_comment_added + t_offset) < now)
+            m_comments_added = 0;
+        }
 
-void aprs_init(void)
+	return (m_comments_added % 10) == 0;
+}
+
+/**@brief Determine the optional fields that are enabled for the next frame.
+ */
+static uint8_t enabled_fields(uint64_t now)
 {
-	m_dest[0] = '\0';
-	m_src[0] = '\0';
+	uint8_t fields = 0;
+	bool compressed = use_compressed();
 
-	for(uint8_t i = 0; i < 8; i++) {
-		m_path[i][0] = '\0';
+	if(!use_compressed_altitude() && (m_config_flags & APRS_FLAG_ADD_ALTITUDE)) {
+		fields |= FIELD_BIT(APRS_FIELD_ALTITUDE);
 	}
 
-	m_npath = 0;
+	if(m_comment[0] != '\0' && comment_due(now)) {
+		fields |= FIELD_BIT(APRS_FIELD_COMMENT);
+	}
 
-	m_table = '/'; // default table
-	m_icon = m_icon_map[AI_X];
+	if(m_config_flags & APRS_FLAG_TELEMETRY) {
+		// frame counter and Vbat are part of the telemetry
+		fields |= FIELD_BIT(APRS_FIELD_TELEMETRY);
+	} else {
+		if(m_config_flags & APRS_FLAG_ADD_FRAME_COUNTER) {
+			fields |= FIELD_BIT(APRS_FIELD_FRAME_COUNTER);
+		}
 
-	m_comment[0] = '\0';
-	m_comment[APRS_MAX_COMMENT_LEN] = '\0';
+		if(m_config_flags & APRS_FLAG_ADD_VBAT) {
+			fields |= FIELD_BIT(APRS_FIELD_VBAT);
+		}
+	}
 
-	m_rx_history.num_entries = 0;
+	if(!compressed && (m_config_flags & APRS_FLAG_ADD_DAO)) {
+		fields |= FIELD_BIT(APRS_FIELD_DAO);
+	}
 
-	// default flags (compatible with v0.3)
-	m_config_flags = APRS_FLAG_ADD_FRAME_COUNTER | APRS_FLAG_ADD_ALTITUDE;
+	return fields;
 }
 
-void aprs_set_dest(const char *dest)
+/**@brief Encode the information field of a position report within the airtime budget.
+ * @details
+ * If the frame with all enabled fields exceeds the budget, the fields are
+ * added by descending priority as long as the frame stays within the budget.
+ * Each candidate is checked by encoding the frame, so the length is exact.
+ *
+ * @param info        Destination of the information field.
+ * @param info_len    Space available at info, including the NUL byte.
+ * @param header_len  Length of the frame header in front of info.
+ * @param args        Additional data to encode.
+ * @returns           0 on success, -1 if the position could not be encoded.
+ */
+static int compose_info_field(char *info, size_t info_len, size_t header_len, const aprs_args_t *args)
 {
-	strncpy(m_dest, dest, sizeof(m_dest));
-}
+	uint64_t now = time_base_get();
+	uint8_t enabled = enabled_fields(now);
+	uint8_t fields = enabled;
 
-void aprs_get_dest(char *dest, size_t dest_len)
-{
-	strncpy(dest, m_dest, dest_len);
-}
+	if(update_info_field(info, info_len, args, fields) < 0) {
+		return -1;
+	}
+
+	if(m_airtime_budget_ms != 0 && (int)(header_len + strlen(info)) > m_max_frame_len) {
+		uint8_t encoded = fields;
+
+		fields = 0;
+
+		for(uint8_t i = 0; i < APRS_NUM_FIELDS; i++) {
+			uint8_t bit = FIELD_BIT(m_field_order[i]);
+
+			if(!(enabled & bit)) {
+				continue;
+			}
+
+			if(update_info_field(info, info_len, args, fields | bit) < 0) {
+				return -1;
+			}
+
+			encoded = fields | bit;
+
+			if((int)(header_len + strlen(info)) <= m_max_frame_len) {
+				fields |= bit;
+			}
+		}
+
+		if(encoded != fields && update_info_field(info, info_len, args, fields) < 0) {
+			return -1;
+		}
+	}
+
+	// a comment that did not fit is retried in the next frame
+	if(fields & FIELD_BIT(APRS_FIELD_COMMENT)) {
+		m_time_comment_added = now;
+		m_comments_added++;
+	} else if(!(enabled & FIELD_BIT(APRS_FIELD_COMMENT))) {
+		m_comments_added++;
+	}
+
+	return 0;
+}
+
+static void update_field_order(void)
+{
+	// insertion sort by descending priority, stable for equal priorities
+	for(uint8_t i = 0; i < APRS_NUM_FIELDS; i++) {
+		uint8_t j = i;
+
+		while(j > 0 && m_field_priority[m_field_order[j-1]] < m_field_priority[i]) {
+			m_field_order[j] = m_field_order[j-1];
+			j--;
+		}
+
+		m_field_order[j] = (aprs_field_t)i;
+	}
+}
+
+// PUBLIC FUNCTIONS
+
+void aprs_init(void)
+{
+	m_dest[0] = '\0';
+	m_src[0] = '\0';
+	m_src_call = APRS_CALL_INVALID;
+
+	for(uint8_t i = 0; i < 8; i++) {
+		m_path[i][0] = '\0';
+	}
+
+	m_npath = 0;
+
+	update_header();
+
+	m_speed_course_valid = false;
+	m_mic_e_msg = APRS_MIC_E_OFF_DUTY;
+
+	m_table = '/'; // default table
+	m_icon = m_icon_map[AI_X];
+
+	m_comment[0] = '\0';
+	m_comment[APRS_MAX_COMMENT_LEN] = '\0';
+
+	memset(&m_rx_history_stats, 0, sizeof(m_rx_history_stats));
+	memset(m_rx_history_slot, 0, sizeof(m_rx_history_slot));
+	m_rx_history_newest = RX_HISTORY_NONE;
+	m_rx_history_oldest = RX_HISTORY_NONE;
+	m_rx_history_free = RX_HISTORY_NONE;
+	m_rx_history_arena_head = 0;
+	m_rx_history_has_reference = false;
+
+	for(uint16_t i = 0; i < RX_HISTORY_GRID_BUCKETS; i++) {
+		m_rx_history_grid_head[i] = RX_HISTORY_NONE;
+	}
+
+	aprs_track_init();
+
+	for(uint16_t i = 0; i < APRS_RX_HISTORY_SIZE; i++) {
+		m_rx_history[i].rx_timestamp = 0;
+		m_rx_history[i].record = HISTORY_NO_RECORD;
+	}
+
+	// default flags (compatible with v0.3)
+	m_config_flags = APRS_FLAG_ADD_FRAME_COUNTER | APRS_FLAG_ADD_ALTITUDE;
+
+	aprs_set_airtime_budget(0);
+
+	memcpy(m_field_priority, m_default_field_priority, sizeof(m_field_priority));
+	update_field_order();
+}
+
+void aprs_set_dest(const char *dest)
+{
+	strncpy(m_dest, dest, sizeof(m_dest));
+	m_dest[sizeof(m_dest) - 1] = '\0';
+
+	update_header();
+}
+
+void aprs_get_dest(char *dest, size_t dest_len)
+{
+	strncpy(dest, m_dest, dest_len);
+}
 
 void aprs_set_source(const char *call)
 {
 	strncpy(m_src, call, sizeof(m_src));
+	m_src[sizeof(m_src) - 1] = '\0';
+
+	m_src_call = aprs_call_pack(m_src);
+
+	update_header();
 }
 
 const char *aprs_get_source(char *source, size_t source_len)
@@ -533,9 +1230,20 @@ const char *aprs_get_source(char *source, size_t source_len)
        return m_src;
 }
 
+bool aprs_is_own_source(const aprs_frame_t *frame)
+{
+	if(frame->source_call != APRS_CALL_INVALID) {
+		return frame->source_call == m_src_call;
+	}
+
+	return strcmp(frame->source, m_src) == 0;
+}
+
 void aprs_clear_path()
 {
 	m_npath = 0;
+
+	update_header();
 }
 
 uint8_t aprs_add_path(const char *call)
@@ -544,9 +1252,12 @@ uint8_t aprs_add_path(const char *call)
 		return 0;
 	} else {
 		strncpy(m_path[m_npath], call, sizeof(m_path[0]));
+		m_path[m_npath][sizeof(m_path[0]) - 1] = '\0';
 
 		m_npath++;
 
+		update_header();
+
 		return 1;
 	}
 }
@@ -559,6 +1270,18 @@ void aprs_update_pos_time(float lat, float lon, float alt_m, time_t t)
 	m_time = t;
 }
 
+void aprs_update_speed_course(float speed_m_s, float course_deg, bool valid)
+{
+	m_speed_m_s = speed_m_s;
+	m_course_deg = course_deg;
+	m_speed_course_valid = valid;
+}
+
+void aprs_set_mic_e_message(aprs_mic_e_msg_t msg)
+{
+	m_mic_e_msg = msg;
+}
+
 void aprs_set_icon(char table, char icon)
 {
 	m_table = table;
@@ -587,60 +1310,78 @@ bool aprs_can_build_frame(void)
 	return (m_src[0] != '\0') && (m_dest[0] != '\0');
 }
 
+/**@brief Space for the information field (including NUL) behind the header.
+ */
+static size_t info_space(const uint8_t *frame, const uint8_t *frameptr)
+{
+	size_t space = APRS_MAX_FRAME_LEN - (size_t)(frameptr - frame);
+
+	return (space < APRS_MAX_INFO_LEN) ? space : APRS_MAX_INFO_LEN;
+}
+
 size_t aprs_build_frame(uint8_t *frame, const aprs_args_t *args, uint8_t packet_type)
 {
 	uint8_t *frameptr = frame;
-	uint8_t *infoptr = m_info;
+	char *info;
 	//uint16_t fcs;
 
 	if (packet_type == PACKET_TYPE_WX) {
           if (!((m_config_flags & APRS_FLAG_ADD_WEATHER) && args->transmit_env_data)) {
             return 0;
           }
+          if (m_config_flags & APRS_FLAG_TELEMETRY) {
+            // weather data is part of the telemetry in the position reports
+            return 0;
+          }
         }
 
-	*(frameptr++) = '<';
-	*(frameptr++) = 0xFF;
-	*(frameptr++) = 0x01;
+        if (packet_type == PACKET_TYPE_TLM_PARM || packet_type == PACKET_TYPE_TLM_UNIT
+            || packet_type == PACKET_TYPE_TLM_EQNS) {
+	  // telemetry definitions are messages addressed to ourselves
+	  memcpy(frameptr, m_header, m_header_len);
+	  frameptr += m_header_len;
 
-	append_address(&frameptr, m_src, 1);
-	*(frameptr++) = '>';
-	//append_address(&frameptr, m_dest, (m_npath == 0) ? 1 : 0);
-	append_address(&frameptr, m_dest, 1);
+	  info = (char *) frameptr;
+	  if (!encode_telemetry_definition(info, info_space(frame, frameptr), packet_type))
+	    return 0;
 
-        // Add via path. SSID "1" or "2" means dest "call digipeating"
-        if (packet_type != PACKET_TYPE_WX) {
-          if (m_npath == 1 && isdigit(m_path[0][0])) {
-            int ssid = atoi(m_path[0]);
-            if (ssid < 1 || ssid > 2)
-              ssid = 1;
-	    *(frameptr++) = '-';
-	    *(frameptr++) = '0' + ssid;
-          } else {
-	    //for(uint8_t i = 0; i < m_npath; i++) {
-		  //append_address(&frameptr, m_path[i], (m_npath == (i+1)) ? 1 : 0);
-	    //}
-	    for(uint8_t i = 0; i < m_npath && m_path[i]; i++) {
-	      *(frameptr++) = ',';
-	      append_address(&frameptr, m_path[i], 1);
-            }
-          }
-	  *(frameptr++) = ':';
+        } else if (packet_type != PACKET_TYPE_WX && use_mic_e()) {
+	  // Mic-E: the latitude replaces the destination in the pre-encoded header
+	  memcpy(frameptr, m_header, m_header_src_len);
+	  frameptr += m_header_src_len;
+	  encode_mic_e_dest((char *) frameptr);
+	  frameptr += APRS_MIC_E_DEST_LEN;
+	  memcpy(frameptr, m_header + m_header_dest_len, m_header_len - m_header_dest_len);
+	  frameptr += m_header_len - m_header_dest_len;
+
+	  info = (char *) frameptr;
+	  if (compose_info_field(info, info_space(frame, frameptr), frameptr - frame, args) < 0)
+	    return 0;
 
-	  if (update_info_field(args) < 0)
+        } else if (packet_type != PACKET_TYPE_WX) {
+	  // pre-encoded header including the path, see update_header()
+	  memcpy(frameptr, m_header, m_header_len);
+	  frameptr += m_header_len;
+
+	  // the info field is encoded directly behind the header
+	  info = (char *) frameptr;
+	  if (compose_info_field(info, info_space(frame, frameptr), m_header_len, args) < 0)
 	    return 0;
 
         } else {
           // wx is only adressed to direct (don't mess up lora qrg)
-	  char *s_info_end = (char *) m_info + sizeof(m_info);
-	  char *s_infoptr = (char *) m_info;
+	  memcpy(frameptr, m_header, m_header_dest_len);
+	  frameptr += m_header_dest_len;
+	  *(frameptr++) = ':';
+	  info = (char *) frameptr;
+	  char *s_info_end = info + info_space(frame, frameptr);
+	  char *s_infoptr = info;
           struct tm utc;
           size_t len;
-	  *(frameptr++) = ':';
           // positionless weather report: starts with '_', followed by 8 bytes (mmddHHMM), followed by weather data
           wall_clock_get_utc(&utc);
           // add i.e. '_12312359'
-          if ((len = strftime(s_infoptr, sizeof(m_info), "_%m%d%H%M", &utc)) == 0)
+          if ((len = strftime(s_infoptr, s_info_end - s_infoptr, "_%m%d%H%M", &utc)) == 0)
             return 0;
           s_infoptr += len;
 	  // append weather data. c...s...g...t... are required, r, p, P, h, L, l, s, # are optional.
@@ -651,12 +1392,8 @@ size_t aprs_build_frame(uint8_t *frame, const aprs_args_t *args, uint8_t packet_
           // is not messed up with i.e. DAO !W..!, Vbatt, ..;
         }
 
-	while(*infoptr != '\0') {
-		*frameptr = *infoptr;
-
-		frameptr++;
-		infoptr++;
-	}
+	// the info field is already in place and NUL-terminated
+	frameptr += strlen(info);
 
 #if 0
 	fcs = calculate_fcs(frame, (frameptr-frame));
@@ -667,12 +1404,45 @@ size_t aprs_build_frame(uint8_t *frame, const aprs_args_t *args, uint8_t packet_
 	*(frameptr++) = fcs >> 8;
 #endif
 
-	*frameptr = '\0';
-
 	return (size_t)(frameptr - frame);
 }
 
 
+void aprs_set_airtime_budget(uint32_t budget_ms)
+{
+	m_airtime_budget_ms = budget_ms;
+
+	if(budget_ms != 0) {
+		m_max_frame_len = lora_toa_max_payload(&LORA_MODULATION_APRS, budget_ms);
+	} else {
+		m_max_frame_len = APRS_MAX_FRAME_LEN;
+	}
+}
+
+uint32_t aprs_get_airtime_budget(void)
+{
+	return m_airtime_budget_ms;
+}
+
+void aprs_set_field_priority(aprs_field_t field, uint8_t priority)
+{
+	if(field >= APRS_NUM_FIELDS) {
+		return;
+	}
+
+	m_field_priority[field] = priority;
+	update_field_order();
+}
+
+uint8_t aprs_get_field_priority(aprs_field_t field)
+{
+	if(field >= APRS_NUM_FIELDS) {
+		return 0;
+	}
+
+	return m_field_priority[field];
+}
+
 uint32_t aprs_get_config_flags(void)
 {
 	return m_config_flags;
@@ -701,141 +1471,166 @@ void aprs_toggle_config_flag(aprs_flag_t flag)
 
 /*** Parser functions ***/
 
-static int extract_text_until(const char *start, char marker, char *dest, size_t dest_len)
+/**@brief Copy a field of the frame into a NUL-terminated string.
+ *
+ * @returns  The field length (before truncation to dest_len - 1).
+ */
+static size_t copy_field(const char *start, const char *end, char *dest, size_t dest_len)
 {
-	const char *tmpptr = strchr(start, marker);
-	if(!tmpptr) {
-		return -1;
-	}
+	size_t size = end - start; // size of field
+	size_t copied = size;
 
-	size_t size = tmpptr - start; // size of field
-
-	if(size >= dest_len) {
-		size = dest_len - 1;
+	if(copied >= dest_len) {
+		copied = dest_len - 1;
 	}
 
-	memcpy(dest, start, size);
-	dest[size] = '\0';
+	memcpy(dest, start, copied);
+	dest[copied] = '\0';
 
 	return size;
 }
 
 
-static int parse_location_and_symbol_readable(const char *start, aprs_frame_t *result)
+/**@brief Parse a fixed-width decimal number.
+ * @details
+ * If ambiguity is allowed, spaces are accepted in place of digits and count
+ * as 0 (position ambiguity).
+ */
+static bool parse_fixed_digits(const char *start, uint8_t n, bool ambiguity, uint32_t *value)
 {
-	const char *orig_start = start;
-
-	char buf[8];
-
-	// parse degrees (integer)
-	memcpy(buf, start, 2);
-	buf[2] = '\0';
-
-	char *endptr;
-	unsigned long deg = strtoul(buf, &endptr, 10);
-	if(endptr == buf) {
-		snprintf(m_error_message, sizeof(m_error_message), "Location error: Lat. degrees is not an integer: '%s'.", buf);
-		return -1;
+	uint32_t v = 0;
+
+	for(uint8_t i = 0; i < n; i++) {
+		if(start[i] >= '0' && start[i] <= '9') {
+			v = v * 10 + (start[i] - '0');
+		} else if(ambiguity && start[i] == ' ') {
+			v = v * 10;
+		} else {
+			return false;
+		}
 	}
 
-	start += 2;
+	*value = v;
+	return true;
+}
 
-	// parse minutes (with two fractional digits)
-	memcpy(buf, start, 5);
-	buf[5] = '\0';
 
-	float minutes = strtof(buf, &endptr);
-	if(endptr == buf) {
-		snprintf(m_error_message, sizeof(m_error_message), "Location error: Lat. minutes is not a float: '%s'.", buf);
-		return -1;
-	}
+/**@brief Parse degrees and minutes ("DDMM.mm" or "DDDMM.mm").
+ *
+ * @returns  The absolute value in degrees or a negative value on error.
+ */
+static float parse_deg_min(const char *start, uint8_t deg_digits, const char *what)
+{
+	uint32_t deg, min, min_fract;
 
-	start += 5;
+	if(!parse_fixed_digits(start, deg_digits, false, &deg)) {
+		snprintf(m_error_message, sizeof(m_error_message), "Location error: %s degrees is not an integer: '%.*s'.", what, deg_digits, start);
+		return -1.0f;
+	}
 
-	result->lat = (float)deg + minutes / 60.0f;
+	start += deg_digits;
 
-	if(*start == 'S') {
-		result->lat = -result->lat;
-	} else if(*start != 'N') {
-		snprintf(m_error_message, sizeof(m_error_message), "Location error: Invalid latitude polarity: '%c'.", *start);
-		return -1;
+	if(!parse_fixed_digits(start, 2, true, &min) || start[2] != '.'
+			|| !parse_fixed_digits(start + 3, 2, true, &min_fract)) {
+		snprintf(m_error_message, sizeof(m_error_message), "Location error: %s minutes is not a float: '%.5s'.", what, start);
+		return -1.0f;
 	}
 
-	start++;
-
-	result->table = *start;
-	start++;
+	return (float)deg + ((float)min + min_fract / 100.0f) / 60.0f;
+}
 
-	// same as above for the longitude
 
-	// parse degrees (integer)
-	memcpy(buf, start, 3);
-	buf[3] = '\0';
+#define READABLE_LOCATION_LEN   19 // DDMM.mmN/DDDMM.mmE$
+#define COMPRESSED_LOCATION_LEN 13 // /YYYYXXXX$csT
 
-	deg = strtoul(buf, &endptr, 10);
-	if(endptr == buf) {
-		snprintf(m_error_message, sizeof(m_error_message), "Location error: Lon. degrees is not an integer: '%s'.", buf);
+static int parse_location_and_symbol_readable(const char *start, const char *end, aprs_frame_t *result)
+{
+	if(end - start < READABLE_LOCATION_LEN) {
+		strcpy(m_error_message, "Location error: too short.");
 		return -1;
 	}
 
-	start += 3;
-
-	// parse minutes (with two fractional digits)
-	memcpy(buf, start, 5);
-	buf[5] = '\0';
+	result->lat = parse_deg_min(start, 2, "Lat.");
+	if(result->lat < 0.0f) {
+		return -1;
+	}
 
-	minutes = strtof(buf, &endptr);
-	if(endptr == buf) {
-		snprintf(m_error_message, sizeof(m_error_message), "Location error: Lon. minutes is not a float: '%s'.", buf);
+	if(start[7] == 'S') {
+		result->lat = -result->lat;
+	} else if(start[7] != 'N') {
+		snprintf(m_error_message, sizeof(m_error_message), "Location error: Invalid latitude polarity: '%c'.", start[7]);
 		return -1;
 	}
 
-	start += 5;
+	result->table = start[8];
 
-	result->lon = (float)deg + minutes / 60.0f;
+	// same as above for the longitude
+	result->lon = parse_deg_min(start + 9, 3, "Lon.");
+	if(result->lon < 0.0f) {
+		return -1;
+	}
 
-	if(*start == 'W') {
+	if(start[17] == 'W') {
 		result->lon = -result->lon;
-	} else if(*start != 'E') {
-		snprintf(m_error_message, sizeof(m_error_message), "Location error: Invalid longitude polarity: '%c'.", *start);
+	} else if(start[17] != 'E') {
+		snprintf(m_error_message, sizeof(m_error_message), "Location error: Invalid longitude polarity: '%c'.", start[17]);
 		return -1;
 	}
 
-	start++;
-
-	result->symbol = *start;
-	start++;
+	result->symbol = start[18];
 
-	return start - orig_start; // number of parsed characters
+	return READABLE_LOCATION_LEN; // number of parsed characters
 }
 
 
-static int parse_location_and_symbol_compressed(const char *start, aprs_frame_t *result)
+static int parse_location_and_symbol_compressed(const char *start, const char *end, aprs_frame_t *result)
 {
+	if(end - start < COMPRESSED_LOCATION_LEN) {
+		strcpy(m_error_message, "Compressed location: too short.");
+		return -1;
+	}
+
 	// quick check: ensure that all 13 characters are printable ASCII characters
-	for(uint8_t i = 0; i < 13; i++) {
+	for(uint8_t i = 0; i < COMPRESSED_LOCATION_LEN; i++) {
 		if(!isprint((int)start[i])) {
 			snprintf(m_error_message, sizeof(m_error_message), "Compressed location: Non-printable character at index %d: 0x%02x.", i, start[i]);
 			return -1;
 		}
 	}
 
-	result->table = start[0];
+	// symbol table: primary, alternate or overlay (digits are encoded as a-j)
+	char table = start[0];
+	if(!(table == '/' || table == '\\' || (table >= 'A' && table <= 'Z') || (table >= 'a' && table <= 'j'))) {
+		snprintf(m_error_message, sizeof(m_error_message), "Compressed location: invalid symbol table: '%c'.", table);
+		return -1;
+	}
+
+	result->table = table;
 	result->symbol = start[9];
 
-	// check the compression type byte
-	uint8_t type = start[12] - '!';
-	bool has_altitude = ((type & 0x18) == 0x10);
+	// decode the cs bytes. If c is a space, the csT bytes are unused.
+	if(start[10] != ' ') {
+		uint8_t c = start[10] - '!';
+		uint8_t s = start[11] - '!';
+		uint8_t type = start[12] - '!';
 
-	if((type & 0xC0) != 0) {
-		snprintf(m_error_message, sizeof(m_error_message), "Compression type: unused bits are not 0: 0x%02x.", type);
-		return -1;
-	}
+		if((type & 0xC0) != 0) {
+			snprintf(m_error_message, sizeof(m_error_message), "Compression type: unused bits are not 0: 0x%02x.", type);
+			return -1;
+		}
 
-	// recover the altitude if available
-	if(has_altitude) {
-		uint32_t alt_encoded = (start[10] - '!') * 91 + (start[11] - '!');
-		result->alt = powf(1.002f, alt_encoded) * 0.3048f; // decode and convert to meters
+		if((type & 0x18) == 0x10) {
+			// altitude: encoded value = log_1.002(altitude in feet)
+			uint32_t alt_encoded = c * 91 + s;
+			result->alt = powf(1.002f, alt_encoded) * 0.3048f; // decode and convert to meters
+		} else if(c == '{' - '!') {
+			// radio range: encoded value = log_1.08(range in miles / 2)
+			result->range = 2.0f * powf(1.08f, s) * 1.609344f; // decode and convert to km
+		} else if(c <= 89) {
+			// course/speed: course in degrees / 4, encoded speed = log_1.08(speed in knots + 1)
+			result->course = (c == 0) ? 360 : c * 4;
+			result->speed = (powf(1.08f, s) - 1.0f) * 0.514444f; // decode and convert to m/s
+		}
 	}
 
 	// recover latitude and longitude
@@ -853,146 +1648,424 @@ static int parse_location_and_symbol_compressed(const char *start, aprs_frame_t
 	result->lat = 90.0f - lat_encoded / 380926.0f;
 	result->lon = -180.0f + lon_encoded / 190463.0f;
 
-	return 13;
+	return COMPRESSED_LOCATION_LEN;
 }
 
 
-static int parse_dao(const char *start, aprs_frame_t *result)
+/**@brief Apply a DAO extension ("!Wxy!" or "!wxy!") to the position.
+ *
+ * @param start  Start of a DAO candidate (5 characters, '!' at both ends).
+ */
+static void parse_dao(const char *start, aprs_frame_t *result)
 {
-	while(start[4] != '\0') {
-		if(start[0] == '!' && (start[4] == '!')) {
-			// this may be a DAO sequence. Only WGS84 is supported here.
-			float lat_enhance_deg_abs;
-			float lon_enhance_deg_abs;
-			bool pos_enhancement_set = false;
+	// Only WGS84 is supported here.
+	float lat_enhance_deg_abs;
+	float lon_enhance_deg_abs;
+
+	if(start[1] == 'w') {
+		// base91 notation
+		uint32_t lat_add_digits = (start[2] - '!') * 100L / 91L;
+		uint32_t lon_add_digits = (start[3] - '!') * 100L / 91L;
+
+		lat_enhance_deg_abs = lat_add_digits * 1.666667e-6; // / 60 / 10000
+		lon_enhance_deg_abs = lon_add_digits * 1.666667e-6; // / 60 / 10000
+	} else if(start[1] == 'W') {
+		lat_enhance_deg_abs = (start[2] - '0') * 1.666667e-5; // / 60 / 1000
+		lon_enhance_deg_abs = (start[3] - '0') * 1.666667e-5; // / 60 / 1000
+	} else {
+		return;
+	}
 
-			if(start[1] == 'w') {
-				// base91 notation
-				uint32_t lat_add_digits = (start[2] - '!') * 100L / 91L;
-				uint32_t lon_add_digits = (start[3] - '!') * 100L / 91L;
+	if(result->lat >= 0) {
+		result->lat += lat_enhance_deg_abs;
+	} else {
+		result->lat -= lat_enhance_deg_abs;
+	}
 
-				lat_enhance_deg_abs = lat_add_digits * 1.666667e-6; // / 60 / 10000
-				lon_enhance_deg_abs = lon_add_digits * 1.666667e-6; // / 60 / 10000
-				pos_enhancement_set = true;
-			} else if(start[1] == 'W') {
-				lat_enhance_deg_abs = (start[2] - '0') * 1.666667e-5; // / 60 / 1000
-				lon_enhance_deg_abs = (start[3] - '0') * 1.666667e-5; // / 60 / 1000
-				pos_enhancement_set = true;
-			}
+	if(result->lon >= 0) {
+		result->lon += lon_enhance_deg_abs;
+	} else {
+		result->lon -= lon_enhance_deg_abs;
+	}
+}
 
-			if(pos_enhancement_set) {
-				if(result->lat >= 0) {
-					result->lat += lat_enhance_deg_abs;
-				} else {
-					result->lat -= lat_enhance_deg_abs;
-				}
+/**@brief Parse the altitude behind "/A=" (6 characters, feet).
+ */
+static void parse_altitude(const char *start, aprs_frame_t *result)
+{
+	bool negative = (start[0] == '-');
+	int32_t alt_ft = 0;
+	uint8_t digits = 0;
 
-				if(result->lon >= 0) {
-					result->lon += lon_enhance_deg_abs;
-				} else {
-					result->lon -= lon_enhance_deg_abs;
-				}
-			}
+	for(uint8_t i = negative ? 1 : 0; i < 6 && start[i] >= '0' && start[i] <= '9'; i++) {
+		alt_ft = alt_ft * 10 + (start[i] - '0');
+		digits++;
+	}
 
-			break;
+	if(digits > 0) {
+		result->alt = (float)(negative ? -alt_ft : alt_ft) * 0.3048f; // convert to meters
+	}
+}
+
+/**@brief Extract base-91 comment telemetry ("|ss1122...|") from the comment.
+ * @details
+ * A valid telemetry block is removed from the comment, invalid blocks are
+ * kept as text.
+ */
+static void parse_telemetry(aprs_frame_t *result)
+{
+	char *start = strchr(result->comment, '|');
+
+	while(start) {
+		char *end = strchr(start + 1, '|');
+		if(!end) {
+			return;
 		}
 
-		start++;
-	}
+		// sequence, 1 to 5 analog channels and an optional digital channel
+		size_t len = end - start - 1;
+		bool valid = (len >= 4) && (len <= 2 * (2 + APRS_TLM_MAX_ANALOG)) && (len % 2 == 0);
 
-	return 0;
+		for(size_t i = 0; valid && i < len; i++) {
+			valid = (start[1 + i] >= '!') && (start[1 + i] <= '{');
+		}
+
+		if(!valid) {
+			start = end; // the closing bar may open the actual block
+			continue;
+		}
+
+		uint16_t values[2 + APRS_TLM_MAX_ANALOG];
+		uint8_t n_values = len / 2;
+
+		for(uint8_t i = 0; i < n_values; i++) {
+			values[i] = (start[1 + 2*i] - '!') * 91 + (start[2 + 2*i] - '!');
+		}
+
+		aprs_telemetry_t *tlm = &result->telemetry;
+
+		tlm->seq = values[0];
+		tlm->n_analog = n_values - 1;
+
+		if(tlm->n_analog > APRS_TLM_MAX_ANALOG) {
+			tlm->n_analog = APRS_TLM_MAX_ANALOG;
+			tlm->digital = values[n_values - 1] & 0xFF;
+			tlm->has_digital = true;
+		}
+
+		memcpy(tlm->analog, values + 1, tlm->n_analog * sizeof(tlm->analog[0]));
+
+		// remove the block and a separating space from the comment
+		if(start > result->comment && start[-1] == ' ') {
+			start--;
+		}
+
+		memmove(start, end + 1, strlen(end + 1) + 1);
+		return;
+	}
 }
 
-static int parse_location_and_symbol(const char *start, aprs_frame_t *result)
+
+static int parse_location_and_symbol(const char *start, const char *end, aprs_frame_t *result)
 {
 	// first try to parse human-readable APRS packets
-	int ret = parse_location_and_symbol_readable(start, result);
+	int ret = parse_location_and_symbol_readable(start, end, result);
 	if(ret >= 0) { // success!
-		// find DAO in remaining data
-		parse_dao(start+ret, result);
 		return ret;
 	}
 
-	// parsing as text failed => try again with compressed format. DAO parsing is
-	// not necessary in this case.
-	ret = parse_location_and_symbol_compressed(start, result);
+	// parsing as text failed => try again with compressed format
+	ret = parse_location_and_symbol_compressed(start, end, result);
 	return ret;
 }
 
 
-static bool aprs_parse_text_frame(const uint8_t *frame, size_t len, aprs_frame_t *result)
+/**@brief Decode a Mic-E destination character.
+ *
+ * @param c      The character.
+ * @param digit  The latitude digit (0 for position ambiguity).
+ * @param flag   The message bit or flag.
+ * @returns      false if the character is invalid.
+ */
+static bool decode_mic_e_dest_char(char c, uint8_t *digit, bool *flag)
 {
-	char buf[64];
-	size_t size;
-
-	// convert the input pointer to a string
-	const char *textframe = (const char*)frame;
-	const char *endptr = (const char*)frame + len;
-
-	// extract the source call
-	int ret = extract_text_until(textframe, '>', result->source, sizeof(result->source));
-	if(ret <= 0) {
-		strcpy(m_error_message, "End of source not found.");
+	if(c >= '0' && c <= '9') {
+		*digit = c - '0';
+		*flag = false;
+	} else if(c >= 'A' && c <= 'J') {
+		*digit = c - 'A'; // custom message bit
+		*flag = true;
+	} else if(c >= 'P' && c <= 'Y') {
+		*digit = c - 'P';
+		*flag = true;
+	} else if(c == 'K' || c == 'Z') {
+		*digit = 0; // position ambiguity
+		*flag = true;
+	} else if(c == 'L') {
+		*digit = 0; // position ambiguity
+		*flag = false;
+	} else {
 		return false;
 	}
 
-	textframe += ret + 1; // “remove” the processed text from the buffer
-	
-	// find end of path character
-	const char *end_of_path = strchr(textframe, ':');
-	if(!end_of_path) {
-		strcpy(m_error_message, "End of path not found.");
-		return false;
-	}
+	return true;
+}
 
-	// find end of destination
-	const char *end_of_dest = strchr(textframe, ',');
+static int parse_mic_e(const char *dest, const char *start, const char *end, aprs_frame_t *result)
+{
+	uint8_t digits[6];
+	bool flags[6];
 
-	if(!end_of_dest || (end_of_dest > end_of_path)) {
-		// There is no path in this message, only the destination
-		ret = extract_text_until(textframe, ':', result->dest, sizeof(result->dest));
-		if(ret <= 0) {
-			strcpy(m_error_message, "End of destination marker not found.");
-			return false;
-		}
-	} else {
-		// Message contains the destination as well as additional path entries
-		ret = extract_text_until(textframe, ',', result->dest, sizeof(result->dest));
-		if(ret <= 0) {
-			strcpy(m_error_message, "End of destination marker not found.");
-			return false;
+	if(strlen(dest) < 6) {
+		snprintf(m_error_message, sizeof(m_error_message), "Mic-E: destination too short: '%s'.", dest);
+		return -1;
+	}
+
+	for(uint8_t i = 0; i < 6; i++) {
+		if(!decode_mic_e_dest_char(dest[i], &digits[i], &flags[i])) {
+			snprintf(m_error_message, sizeof(m_error_message), "Mic-E: invalid destination character: '%c'.", dest[i]);
+			return -1;
 		}
+	}
+
+	if(end - start < 8) {
+		strcpy(m_error_message, "Mic-E: information field too short.");
+		return -1;
+	}
 
-		textframe += ret + 1; // “remove” the processed text from the buffer
+	for(uint8_t i = 0; i < 6; i++) {
+		uint8_t c = (uint8_t)start[i];
 
-		ret = extract_text_until(textframe, ':', result->via, sizeof(result->via));
-		if(ret <= 0) {
-			strcpy(m_error_message, "End of path not found.");
-			return false;
+		if(c < 28 || c > 127) {
+			snprintf(m_error_message, sizeof(m_error_message), "Mic-E: invalid data byte at index %d: 0x%02x.", i, c);
+			return -1;
 		}
 	}
 
-	textframe += ret + 1; // “remove” the processed text from the buffer
-	
-	char type = *textframe;
-	textframe++;
+	// latitude from the destination address
+	uint8_t lat_deg = digits[0] * 10 + digits[1];
+	uint8_t lat_min = digits[2] * 10 + digits[3];
+	uint8_t lat_min_fract = digits[4] * 10 + digits[5];
 
-	result->alt = 0.0f; // default if altitude is not available
+	// longitude from the information field
+	int lon_deg = start[0] - 28;
+	if(flags[4]) {
+		lon_deg += 100;
+	}
 
-	switch(type) {
-		case '!':
-		case '=':
-			// position without timestamp
-			ret = parse_location_and_symbol(textframe, result);
-			break;
+	if(lon_deg >= 180 && lon_deg <= 189) {
+		lon_deg -= 80;
+	} else if(lon_deg >= 190 && lon_deg <= 199) {
+		lon_deg -= 190;
+	}
 
-		case '/':
-		case '@':
-			// position with timestamp
-			textframe += 7; // skip the timestamp for now
+	int lon_min = start[1] - 28;
+	if(lon_min >= 60) {
+		lon_min -= 60;
+	}
 
-			ret = parse_location_and_symbol(textframe, result);
-			break;
+	int lon_min_fract = start[2] - 28;
+
+	if(lat_deg > 90 || lat_min >= 60 || lon_deg > 180 || lon_min >= 60 || lon_min_fract >= 100) {
+		strcpy(m_error_message, "Mic-E: position out of range.");
+		return -1;
+	}
+
+	result->lat = lat_deg + (lat_min + lat_min_fract / 100.0f) / 60.0f;
+	if(!flags[3]) {
+		result->lat = -result->lat; // south
+	}
+
+	result->lon = lon_deg + (lon_min + lon_min_fract / 100.0f) / 60.0f;
+	if(flags[5]) {
+		result->lon = -result->lon; // west
+	}
+
+	// speed and course
+	int sp = start[3] - 28;
+	int dc = start[4] - 28;
+	int se = start[5] - 28;
+
+	int speed_kt = sp * 10 + dc / 10;
+	int course = (dc % 10) * 100 + se;
+
+	if(speed_kt >= 800) {
+		speed_kt -= 800;
+	}
+
+	if(course >= 400) {
+		course -= 400;
+	}
+
+	result->speed = speed_kt * 0.514444f;
+	result->course = (course <= 360) ? course : 0;
+
+	result->symbol = start[6];
+	result->table = start[7];
+
+	// The status text may start with the altitude "xxx}", optionally behind a
+	// one-byte radio type indicator.
+	for(uint8_t offset = 8; offset <= 9; offset++) {
+		const char *alt = start + offset;
+
+		if(end - alt < 4 || alt[3] != '}') {
+			continue;
+		}
+
+		if(alt[0] < '!' || alt[0] > '{' || alt[1] < '!' || alt[1] > '{' || alt[2] < '!' || alt[2] > '{') {
+			break;
+		}
+
+		int32_t alt_m = ((alt[0] - '!') * 91 + (alt[1] - '!')) * 91 + (alt[2] - '!') - 10000;
+		result->alt = alt_m;
+
+		return offset + 4;
+	}
+
+	return 8;
+}
+
+
+/**@brief Fill the comment and decode the extensions it contains.
+ * @details
+ * Altitude ("/A="), DAO and telemetry are recognized in the same pass that
+ * copies the comment. Only the first occurrence of each is used.
+ */
+static void parse_comment(const char *start, const char *end, bool dao_allowed, aprs_frame_t *result)
+{
+	bool altitude_found = false;
+	bool dao_found = !dao_allowed;
+	size_t size = 0;
+
+	for(const char *p = start; p < end; p++) {
+		if(*p == '/' && !altitude_found && (end - p) >= 9 && p[1] == 'A' && p[2] == '=') {
+			parse_altitude(p + 3, result);
+			altitude_found = true;
+		} else if(*p == '!' && !dao_found && (end - p) >= 5 && p[4] == '!') {
+			// this may be a DAO sequence
+			parse_dao(p, result);
+			dao_found = true;
+		}
+
+		if(size < sizeof(result->comment) - 1) {
+			result->comment[size++] = *p;
+		}
+	}
+
+	result->comment[size] = '\0';
+
+	parse_telemetry(result);
+}
+
+
+/**@brief Parse a text frame ("SRC>DEST,PATH:info").
+ * @details
+ * The frame is tokenized in a single forward pass and no byte at or behind
+ * frame + len is read, so the frame does not need to be NUL-terminated.
+ */
+static bool aprs_parse_text_frame(const uint8_t *frame, size_t len, aprs_frame_t *result)
+{
+	const char *p = (const char*)frame;
+	const char *end = p + len;
+
+	// header: source up to '>', destination up to ',' or ':', path up to ':'
+	const char *field = p;
+	const char *info = NULL;
+
+	enum {HEADER_SOURCE, HEADER_DEST, HEADER_PATH} part = HEADER_SOURCE;
+
+	result->via[0] = '\0';
+
+	for(; p < end && !info; p++) {
+		switch(part) {
+			case HEADER_SOURCE:
+				if(*p == '>') {
+					if(copy_field(field, p, result->source, sizeof(result->source)) == 0) {
+						strcpy(m_error_message, "End of source not found.");
+						return false;
+					}
+
+					result->source_call = aprs_call_pack_n(field, p - field);
+
+					part = HEADER_DEST;
+					field = p + 1;
+				}
+				break;
+
+			case HEADER_DEST:
+				if(*p == ',' || *p == ':') {
+					if(copy_field(field, p, result->dest, sizeof(result->dest)) == 0) {
+						strcpy(m_error_message, "End of destination marker not found.");
+						return false;
+					}
+
+					if(*p == ':') {
+						info = p + 1;
+					}
+
+					part = HEADER_PATH;
+					field = p + 1;
+				}
+				break;
+
+			case HEADER_PATH:
+				if(*p == ':') {
+					if(copy_field(field, p, result->via, sizeof(result->via)) == 0) {
+						strcpy(m_error_message, "End of path not found.");
+						return false;
+					}
+
+					info = p + 1;
+				}
+				break;
+		}
+	}
+
+	if(!info) {
+		strcpy(m_error_message, (part == HEADER_SOURCE) ? "End of source not found." : "End of path not found.");
+		return false;
+	}
+
+	if(info >= end) {
+		strcpy(m_error_message, "Information field is empty.");
+		return false;
+	}
+
+	char type = *info;
+	info++;
+
+	result->lat = 0.0f; // 0.0N 0.0E: the frame carries no position
+	result->lon = 0.0f;
+	result->alt = 0.0f; // default if altitude is not available
+	result->speed = 0.0f;
+	result->course = 0;
+	result->range = 0.0f;
+	memset(&result->telemetry, 0, sizeof(result->telemetry));
+
+	int ret;
+	bool dao_allowed = false;
+
+	switch(type) {
+		case '!':
+		case '=':
+			// position without timestamp
+			ret = parse_location_and_symbol(info, end, result);
+			dao_allowed = (ret == READABLE_LOCATION_LEN);
+			break;
+
+		case '/':
+		case '@':
+			// position with timestamp
+			if(end - info < 7) {
+				strcpy(m_error_message, "Timestamp too short.");
+				return false;
+			}
+
+			info += 7; // skip the timestamp for now
+
+			ret = parse_location_and_symbol(info, end, result);
+			dao_allowed = (ret == READABLE_LOCATION_LEN);
+			break;
 
 		case ';':
 			// APRS object
@@ -1046,10 +2119,15 @@ static bool aprs_parse_text_frame(const uint8_t *frame, size_t len, aprs_frame_t
                         ret = 0;
 			break;
 
-		case '%':
 		case '\'':
-		case ',':
 		case '`':
+			// Mic-E: latitude in the destination, the rest in the info field
+			ret = parse_mic_e(result->dest, info, end, result);
+			dao_allowed = true;
+			break;
+
+		case '%':
+		case ',':
 		case '[':
 		case '{':
 		case '&':
@@ -1069,33 +2147,12 @@ static bool aprs_parse_text_frame(const uint8_t *frame, size_t len, aprs_frame_t
 		return false;
 	}
 
-	textframe += ret; // “remove” the processed text from the buffer
-        if (*textframe == ' ')
-			textframe++;
-
-
-	// check if altitude is in remaining data
-	char *ptr = strstr(textframe, "/A=");
-	if(ptr) {
-		memcpy(buf, ptr + 3, 6);
-
-		char *endptr;
-		long alt = strtol(buf, &endptr, 10);
-		result->alt = (float)alt * 0.3048f; // convert to meters
+	info += ret; // “remove” the processed text from the buffer
+	if(info < end && *info == ' ') {
+		info++;
 	}
 
-	// fill comment
-	if(textframe < endptr) {
-		size = endptr - textframe;
-		if(size > sizeof(result->comment)) {
-			size = sizeof(result->comment);
-		}
-
-		memcpy(result->comment, textframe, size);
-		result->comment[size] = '\0';
-	} else {
-		result->comment[0] = '\0';
-	}
+	parse_comment(info, end, dao_allowed, result);
 
 	return true;
 }
@@ -1118,95 +2175,1019 @@ const char* aprs_get_parser_error(void)
 }
 
 
-uint8_t aprs_rx_history_insert(
-		const aprs_frame_t *frame,
-		const aprs_rx_raw_data_t *raw,
-		uint64_t rx_timestamp,
-		uint8_t protected_index)
+/**@brief Hash of a callsign for the history index.
+ * @details
+ * Packed callsigns are scrambled by a multiplication (Fibonacci hashing),
+ * names that cannot be packed are hashed as strings.
+ */
+static uint32_t history_hash(aprs_call_t call, const char *source, size_t len)
 {
-	aprs_rx_history_entry_t *insert_pos = NULL;
-        bool found_existing_entry_for_call = false;
+	if(call != APRS_CALL_INVALID) {
+		return (uint32_t)((call * 0x9E3779B97F4A7C15ULL) >> 32);
+	}
 
-	// first try: check if the source call sign already exists
-	if(insert_pos == NULL) {
-		const char *newsrc = frame->source;
-		for(uint8_t i = 0; i < m_rx_history.num_entries; i++) {
-			const char *oldsrc = m_rx_history.history[i].decoded.source;
-
-			if(strcmp(newsrc, oldsrc) == 0) {
-				insert_pos = &m_rx_history.history[i];
-                                found_existing_entry_for_call = true;
-				break;
-			}
-		}
+	uint32_t hash = 2166136261UL; // FNV-1a
+
+	for(size_t i = 0; i < len; i++) {
+		hash ^= (uint8_t)source[i];
+		hash *= 16777619UL;
 	}
 
-        // aprs frame without location. Call not already heard? Discard packet
-        if (!found_existing_entry_for_call &&
-		!((frame->lat > 0.0001f && frame->lon > 0.0001f) ||
-		  (frame->lat < -0.0001f && frame->lon < -0.0001f)))
-		return m_rx_history.num_entries;
+	return hash;
+}
+
+
+static history_record_t* history_record(uint16_t offset)
+{
+	return (history_record_t*)((uint8_t*)m_rx_history_arena + offset);
+}
+
+
+static const uint8_t* history_record_data(const history_record_t *rec)
+{
+	return (const uint8_t*)(rec + 1) + (rec->has_telemetry ? sizeof(aprs_telemetry_t) : 0);
+}
+
+
+static const char* history_string(uint16_t idx, aprs_rx_history_string_t field, size_t *len)
+{
+	const history_record_t *rec = history_record(m_rx_history[idx].record);
+
+	*len = rec->str_len[field];
+	return (const char*)history_record_data(rec) + rec->str_offset[field];
+}
+
 
-	// second try: append at the end
-	//if(m_rx_history.num_entries < APRS_RX_HISTORY_SIZE) {
-	if(insert_pos == NULL && m_rx_history.num_entries < APRS_RX_HISTORY_SIZE) {
-		insert_pos = &m_rx_history.history[m_rx_history.num_entries];
-		m_rx_history.num_entries++;
+static size_t history_home_slot(uint16_t idx)
+{
+	const char *source = NULL;
+	size_t len = 0;
+
+	if(m_rx_history[idx].source_call == APRS_CALL_INVALID) {
+		source = history_string(idx, APRS_RX_HISTORY_SOURCE, &len);
 	}
 
-	// third try: replace the oldest entry, but never the protected one (which
-	// is likely currently being viewed)
-	if(insert_pos == NULL) {
-		uint64_t oldest_timestamp = UINT64_MAX;
+	return history_hash(m_rx_history[idx].source_call, source, len) & (RX_HISTORY_HASH_SIZE - 1);
+}
 
-		for(uint8_t i = 0; i < m_rx_history.num_entries; i++) {
-			if(i == protected_index) {
-				continue;
+
+/**@brief Find the history entry of the given call.
+ *
+ * @returns  The entry index or RX_HISTORY_NONE.
+ */
+static uint16_t history_find(aprs_call_t call, const char *source)
+{
+	size_t source_len = (call == APRS_CALL_INVALID) ? strlen(source) : 0;
+	size_t slot = history_hash(call, source, source_len) & (RX_HISTORY_HASH_SIZE - 1);
+
+	while(m_rx_history_slot[slot] != 0) {
+		uint16_t idx = m_rx_history_slot[slot] - 1;
+
+		if(m_rx_history[idx].source_call == call) {
+			if(call != APRS_CALL_INVALID) {
+				return idx;
 			}
 
-			uint64_t timestamp = m_rx_history.history[i].rx_timestamp;
-			if(timestamp < oldest_timestamp) {
-				oldest_timestamp = timestamp;
-				insert_pos = &m_rx_history.history[i];
+			size_t len;
+			const char *stored = history_string(idx, APRS_RX_HISTORY_SOURCE, &len);
+
+			if(len == source_len && memcmp(stored, source, len) == 0) {
+				return idx;
 			}
 		}
+
+		slot = (slot + 1) & (RX_HISTORY_HASH_SIZE - 1);
 	}
 
-	assert(insert_pos != NULL);
+	return RX_HISTORY_NONE;
+}
 
-	// on positionless frames, don't overwrite existent position with 0.0N 0.0E
-	if (found_existing_entry_for_call &&
-		!((frame->lat > 0.0001f && frame->lon > 0.0001f) ||
-		  (frame->lat < -0.0001f && frame->lon < -0.0001f))) {
-                // remember existing position
-		float lat = insert_pos->decoded.lat;
-		float lon = insert_pos->decoded.lon;
-                // if alt, table, symbol of the new "frame" is 0, rememver current history entry
-		// of this user for re-assigning it later (after "insert_pos->decoded = *frame")
-                float alt = (frame->alt ? frame->alt : insert_pos->decoded.alt);
-                char  table = (frame->table ? frame->table : insert_pos->decoded.table);
-                char  symbol = (frame->symbol ? frame->symbol : insert_pos->decoded.symbol);
-
-		// copy type aprs_frame_t struct frame to aprs_history_entry_t[thisPosition].decoded
-		insert_pos->decoded = *frame;
-
-		// re-assign stored values
-		insert_pos->decoded.lat = lat;
-		insert_pos->decoded.lon = lon;
-		insert_pos->decoded.alt = alt;
-		insert_pos->decoded.table = table;
-		insert_pos->decoded.symbol = symbol;
+
+static void history_index_add(uint16_t idx)
+{
+	size_t slot = history_home_slot(idx);
+
+	while(m_rx_history_slot[slot] != 0) {
+		slot = (slot + 1) & (RX_HISTORY_HASH_SIZE - 1);
+	}
+
+	m_rx_history_slot[slot] = idx + 1;
+}
+
+
+/**@brief Remove an entry from the hash table.
+ * @details
+ * The following entries of the probe sequence are moved back into the gap, so
+ * no deleted markers are needed and lookups stay short.
+ */
+static void history_index_remove(uint16_t idx)
+{
+	const size_t mask = RX_HISTORY_HASH_SIZE - 1;
+	size_t gap = history_home_slot(idx);
+
+	while(m_rx_history_slot[gap] != idx + 1) {
+		gap = (gap + 1) & mask;
+	}
+
+	for(size_t slot = (gap + 1) & mask; m_rx_history_slot[slot] != 0; slot = (slot + 1) & mask) {
+		size_t home = history_home_slot(m_rx_history_slot[slot] - 1);
+
+		// move the entry if its home slot is not between the gap and its slot
+		if(((slot - home) & mask) >= ((slot - gap) & mask)) {
+			m_rx_history_slot[gap] = m_rx_history_slot[slot];
+			gap = slot;
+		}
+	}
+
+	m_rx_history_slot[gap] = 0;
+}
+
+
+static void history_lru_unlink(uint16_t idx)
+{
+	uint16_t newer = m_rx_history_newer[idx];
+	uint16_t older = m_rx_history_older[idx];
+
+	if(newer != RX_HISTORY_NONE) {
+		m_rx_history_older[newer] = older;
 	} else {
-		insert_pos->decoded = *frame;
+		m_rx_history_newest = older;
 	}
-	insert_pos->rx_timestamp = rx_timestamp;
-	insert_pos->raw = *raw;
 
-	return (insert_pos - m_rx_history.history);
+	if(older != RX_HISTORY_NONE) {
+		m_rx_history_newer[older] = newer;
+	} else {
+		m_rx_history_oldest = newer;
+	}
+}
+
+
+/**@brief Link an entry into the LRU list, ordered by reception time.
+ * @details
+ * Received frames always go to the newest end. Older timestamps only occur
+ * when the history is restored from flash.
+ */
+static void history_lru_push(uint16_t idx, uint64_t rx_timestamp)
+{
+	uint16_t newer = RX_HISTORY_NONE;
+	uint16_t older = m_rx_history_newest;
+
+	while(older != RX_HISTORY_NONE && m_rx_history[older].rx_timestamp > rx_timestamp) {
+		newer = older;
+		older = m_rx_history_older[older];
+	}
+
+	m_rx_history_newer[idx] = newer;
+	m_rx_history_older[idx] = older;
+
+	if(newer != RX_HISTORY_NONE) {
+		m_rx_history_older[newer] = idx;
+	} else {
+		m_rx_history_newest = idx;
+	}
+
+	if(older != RX_HISTORY_NONE) {
+		m_rx_history_newer[older] = idx;
+	} else {
+		m_rx_history_oldest = idx;
+	}
+}
+
+
+/**@brief Get the sort key of an entry in a sorted view, ascending.
+ */
+static float history_view_key(aprs_rx_history_order_t order, uint16_t idx)
+{
+	const aprs_rx_history_entry_t *entry = &m_rx_history[idx];
+
+	if(order == APRS_RX_HISTORY_BY_DISTANCE) {
+		return (entry->distance < 0.0f) ? INFINITY : entry->distance;
+	} else {
+		return -entry->rssi;
+	}
+}
+
+
+static uint16_t* history_view(aprs_rx_history_order_t order)
+{
+	return (order == APRS_RX_HISTORY_BY_DISTANCE) ? m_rx_history_by_distance : m_rx_history_by_rssi;
+}
+
+
+/**@brief Find the first position in a sorted view with a key not less than key.
+ */
+static uint16_t history_view_lower_bound(aprs_rx_history_order_t order, float key)
+{
+	const uint16_t *view = history_view(order);
+	uint16_t lo = 0;
+	uint16_t hi = m_rx_history_stats.num_stations;
+
+	while(lo < hi) {
+		uint16_t mid = (lo + hi) / 2;
+
+		if(history_view_key(order, view[mid]) < key) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+
+/**@brief Find the position of an entry in a sorted view.
+ * @details
+ * The key of the entry must not have changed since it was added.
+ */
+static uint16_t history_view_find(aprs_rx_history_order_t order, uint16_t idx)
+{
+	const uint16_t *view = history_view(order);
+	uint16_t pos = history_view_lower_bound(order, history_view_key(order, idx));
+
+	// skip stations with an equal key
+	while(pos < m_rx_history_stats.num_stations && view[pos] != idx) {
+		pos++;
+	}
+
+	return pos;
+}
+
+
+/**@brief Add a station to the sorted views, after those with an equal key.
+ */
+static void history_views_add(uint16_t idx)
+{
+	for(aprs_rx_history_order_t order = APRS_RX_HISTORY_BY_DISTANCE; order <= APRS_RX_HISTORY_BY_RSSI; order++) {
+		uint16_t *view = history_view(order);
+		float key = history_view_key(order, idx);
+		uint16_t pos = history_view_lower_bound(order, key);
+
+		while(pos < m_rx_history_stats.num_stations && history_view_key(order, view[pos]) == key) {
+			pos++;
+		}
+
+		memmove(view + pos + 1, view + pos, (m_rx_history_stats.num_stations - pos) * sizeof(view[0]));
+		view[pos] = idx;
+	}
+
+	m_rx_history_stats.num_stations++;
+}
+
+
+static void history_views_remove(uint16_t idx)
+{
+	for(aprs_rx_history_order_t order = APRS_RX_HISTORY_BY_DISTANCE; order <= APRS_RX_HISTORY_BY_RSSI; order++) {
+		uint16_t *view = history_view(order);
+		uint16_t pos = history_view_find(order, idx);
+
+		assert(pos < m_rx_history_stats.num_stations);
+
+		memmove(view + pos, view + pos + 1, (m_rx_history_stats.num_stations - pos - 1) * sizeof(view[0]));
+	}
+
+	m_rx_history_stats.num_stations--;
+}
+
+
+/**@brief Calculate the distance and direction of a station from the reference.
+ */
+static void history_update_distance(aprs_rx_history_entry_t *entry)
+{
+	if(!m_rx_history_has_reference) {
+		entry->distance = -1.0f;
+		entry->direction = 0.0f;
+		return;
+	}
+
+	entry->distance = great_circle_distance_m(
+			m_rx_history_ref_lat, m_rx_history_ref_lon, entry->lat, entry->lon);
+	entry->direction = direction_angle(
+			m_rx_history_ref_lat, m_rx_history_ref_lon, entry->lat, entry->lon);
+
+	// rounding errors for antipodal points
+	if(!(entry->distance >= 0.0f)) {
+		entry->distance = -1.0f;
+	}
+}
+
+
+/**@brief Get the grid cell of a position.
+ * @details
+ * Longitude cells wrap around at 180 degrees.
+ */
+static void history_grid_cell(float lat, float lon, int16_t *cell_lat, int16_t *cell_lon)
+{
+	int32_t y = (int32_t)floorf((lat + 90.0f) * RX_HISTORY_GRID_CELLS_PER_DEG);
+	int32_t x = (int32_t)floorf((lon + 180.0f) * RX_HISTORY_GRID_CELLS_PER_DEG);
+
+	*cell_lat = (y < 0) ? 0 : (y >= RX_HISTORY_GRID_LAT_CELLS) ? RX_HISTORY_GRID_LAT_CELLS - 1 : y;
+	*cell_lon = ((x % RX_HISTORY_GRID_LON_CELLS) + RX_HISTORY_GRID_LON_CELLS) % RX_HISTORY_GRID_LON_CELLS;
+}
+
+
+static uint16_t history_grid_bucket(int16_t cell_lat, int16_t cell_lon)
+{
+	uint32_t hash = (uint32_t)cell_lat * 73856093UL ^ (uint32_t)cell_lon * 19349663UL;
+
+	return (hash ^ (hash >> 16)) & (RX_HISTORY_GRID_BUCKETS - 1);
+}
+
+
+static void history_grid_add(uint16_t idx)
+{
+	int16_t cell_lat, cell_lon;
+
+	history_grid_cell(m_rx_history[idx].lat, m_rx_history[idx].lon, &cell_lat, &cell_lon);
+
+	uint16_t bucket = history_grid_bucket(cell_lat, cell_lon);
+
+	m_rx_history_grid_next[idx] = m_rx_history_grid_head[bucket];
+	m_rx_history_grid_head[bucket] = idx;
+}
+
+
+/**@brief Remove an entry from the spatial index.
+ * @details
+ * The position of the entry must not have changed since it was added.
+ */
+static void history_grid_remove(uint16_t idx)
+{
+	int16_t cell_lat, cell_lon;
+
+	history_grid_cell(m_rx_history[idx].lat, m_rx_history[idx].lon, &cell_lat, &cell_lon);
+
+	uint16_t *link = &m_rx_history_grid_head[history_grid_bucket(cell_lat, cell_lon)];
+
+	while(*link != idx) {
+		assert(*link != RX_HISTORY_NONE);
+		link = &m_rx_history_grid_next[*link];
+	}
+
+	*link = m_rx_history_grid_next[idx];
+}
+
+
+/**@brief Find the least recently updated entry, except the protected one.
+ */
+static uint16_t history_lru_oldest(uint16_t protected_index)
+{
+	uint16_t idx = m_rx_history_oldest;
+
+	if(idx == protected_index) {
+		idx = m_rx_history_newer[idx];
+	}
+
+	assert(idx != RX_HISTORY_NONE);
+
+	return idx;
+}
+
+
+/**@brief Mark the record of an entry as unused.
+ * @details
+ * The space is reclaimed by the next compaction of the arena.
+ */
+static void history_record_free(uint16_t idx)
+{
+	history_record_t *rec = history_record(m_rx_history[idx].record);
+
+	rec->owner = RX_HISTORY_NONE;
+	m_rx_history_stats.arena_used -= rec->len;
+}
+
+
+/**@brief Remove an entry completely.
+ */
+static void history_remove(uint16_t idx)
+{
+	history_lru_unlink(idx);
+	history_views_remove(idx);
+	history_grid_remove(idx);
+	history_index_remove(idx);
+	history_record_free(idx);
+	aprs_track_remove(idx);
+
+	m_rx_history[idx].rx_timestamp = 0;
+	m_rx_history[idx].record = HISTORY_NO_RECORD;
+}
+
+
+/**@brief Move all used records to the start of the arena.
+ * @details
+ * The records keep their order, so this is a single pass over the arena.
+ */
+static void arena_compact(void)
+{
+	uint16_t src = 0;
+	uint16_t dst = 0;
+
+	while(src < m_rx_history_arena_head) {
+		uint16_t len = history_record(src)->len;
+
+		if(history_record(src)->owner != RX_HISTORY_NONE) {
+			if(dst != src) {
+				memmove(history_record(dst), history_record(src), len);
+				m_rx_history[history_record(dst)->owner].record = dst;
+			}
+
+			dst += len;
+		}
+
+		src += len;
+	}
+
+	m_rx_history_arena_head = dst;
+	m_rx_history_stats.arena_compactions++;
+}
+
+
+/**@brief Write a record to the arena.
+ * @details
+ * Least recently updated stations are removed until the record fits, their
+ * entries are released for reuse. The protected station is never removed. If
+ * the free space is fragmented, the arena is compacted.
+ *
+ * The entry must not be linked into the update order while this is called.
+ *
+ * @param idx   Owner of the record.
+ * @param rec   The complete record, not located in the arena.
+ * @returns     The offset of the record.
+ */
+static uint16_t history_write(uint16_t idx, const history_record_t *rec, uint16_t protected_index)
+{
+	uint16_t offset;
+
+	// cannot fail: the arena holds at least two records of maximum length
+	while(APRS_RX_HISTORY_ARENA_SIZE - m_rx_history_stats.arena_used < rec->len) {
+		uint16_t oldest = history_lru_oldest(protected_index);
+
+		history_remove(oldest);
+
+		m_rx_history_free_next[oldest] = m_rx_history_free;
+		m_rx_history_free = oldest;
+		m_rx_history_stats.arena_evictions++;
+	}
+
+	if(APRS_RX_HISTORY_ARENA_SIZE - m_rx_history_arena_head < rec->len) {
+		arena_compact();
+	}
+
+	offset = m_rx_history_arena_head;
+	m_rx_history_arena_head += rec->len;
+
+	memcpy(history_record(offset), rec, rec->len);
+	history_record(offset)->owner = idx;
+	m_rx_history_stats.arena_used += rec->len;
+
+	return offset;
+}
+
+
+/**@brief Find a string in the received frame, so it does not need to be stored.
+ *
+ * @returns  The offset in the frame or -1 if it is not contained.
+ */
+static int history_find_in_data(const uint8_t *data, size_t data_len, const char *str, size_t len)
+{
+	if(len == 0) {
+		return 0;
+	}
+
+	for(size_t i = 0; i + len <= data_len; i++) {
+		if(data[i] == (uint8_t)str[0] && memcmp(data + i, str, len) == 0) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+
+/**@brief Build the arena record of a frame in m_rx_history_record_buf.
+ */
+static void history_build_record(const aprs_frame_t *frame, const aprs_rx_raw_data_t *raw)
+{
+	history_record_t *rec = (history_record_t*)m_rx_history_record_buf;
+	uint8_t *data = (uint8_t*)(rec + 1);
+	const char *strings[APRS_RX_HISTORY_NUM_STRINGS] = {
+		frame->source, frame->dest, frame->via, frame->comment};
+	uint16_t data_end = raw->data_len;
+
+	rec->speed = frame->speed;
+	rec->range = frame->range;
+	rec->course = frame->course;
+	rec->data_len = raw->data_len;
+	rec->has_telemetry = (frame->telemetry.n_analog > 0 || frame->telemetry.has_digital);
+
+	if(rec->has_telemetry) {
+		memcpy(data, &frame->telemetry, sizeof(aprs_telemetry_t));
+		data += sizeof(aprs_telemetry_t);
+	}
+
+	memcpy(data, raw->data, raw->data_len);
+
+	// strings that are not found in the frame are appended after it
+	for(int i = 0; i < APRS_RX_HISTORY_NUM_STRINGS; i++) {
+		size_t len = strlen(strings[i]);
+		int offset = history_find_in_data(raw->data, raw->data_len, strings[i], len);
+
+		if(offset < 0) {
+			offset = data_end;
+			memcpy(data + data_end, strings[i], len);
+			data_end += len;
+		}
+
+		rec->str_offset[i] = offset;
+		rec->str_len[i] = len;
+	}
+
+	rec->len = (data + data_end - (uint8_t*)rec + 3) & ~3;
+}
+
+
+uint16_t aprs_rx_history_insert(
+		const aprs_frame_t *frame,
+		const aprs_rx_raw_data_t *raw,
+		uint64_t rx_timestamp,
+		uint16_t protected_index)
+{
+	aprs_rx_history_entry_t *insert_pos = NULL;
+	aprs_call_t call = aprs_call_pack(frame->source);
+
+	// first try: check if the source call sign already exists
+	uint16_t idx = history_find(call, frame->source);
+	bool found_existing_entry_for_call = (idx != RX_HISTORY_NONE);
+	// 0.0N 0.0E marks a frame without position, all other positions are valid
+	bool has_position = (fabsf(frame->lat) > 0.0001f || fabsf(frame->lon) > 0.0001f);
+
+	// aprs frame without location. Call not already heard? Discard packet
+	if (!found_existing_entry_for_call && !has_position)
+		return m_rx_history_stats.num_entries;
+
+	if(found_existing_entry_for_call) {
+		// The old record is released first, its space may be needed. The
+		// source call does not change, so the index stays valid.
+		history_lru_unlink(idx);
+		history_views_remove(idx);
+		history_grid_remove(idx);
+		history_record_free(idx);
+	} else if(m_rx_history_free != RX_HISTORY_NONE) {
+		// second try: reuse an entry released for arena space
+		idx = m_rx_history_free;
+		m_rx_history_free = m_rx_history_free_next[idx];
+	} else if(m_rx_history_stats.num_entries < APRS_RX_HISTORY_SIZE) {
+		// third try: append at the end
+		idx = m_rx_history_stats.num_entries;
+		m_rx_history_stats.num_entries++;
+	} else {
+		// fourth try: replace the least recently updated entry, but never the
+		// protected one (which is likely currently being viewed)
+		idx = history_lru_oldest(protected_index);
+		history_remove(idx);
+	}
+
+	history_build_record(frame, raw);
+
+	insert_pos = &m_rx_history[idx];
+	insert_pos->record = history_write(idx, (history_record_t*)m_rx_history_record_buf, protected_index);
+
+	history_lru_push(idx, rx_timestamp);
+
+	// on positionless frames, don't overwrite existent position with 0.0N 0.0E
+	if (found_existing_entry_for_call && !has_position) {
+		// if alt, table, symbol of the new "frame" is 0, keep the values of the
+		// current history entry of this user
+		if(frame->alt) {
+			insert_pos->alt = frame->alt;
+		}
+
+		if(frame->table) {
+			insert_pos->table = frame->table;
+		}
+
+		if(frame->symbol) {
+			insert_pos->symbol = frame->symbol;
+		}
+	} else {
+		insert_pos->lat = frame->lat;
+		insert_pos->lon = frame->lon;
+		insert_pos->alt = frame->alt;
+		insert_pos->table = frame->table;
+		insert_pos->symbol = frame->symbol;
+
+		aprs_track_add(idx, frame->lat, frame->lon, rx_timestamp);
+	}
+	insert_pos->source_call = call;
+	insert_pos->rx_timestamp = rx_timestamp;
+	insert_pos->rssi = raw->rssi;
+	insert_pos->snr = raw->snr;
+	insert_pos->signalRssi = raw->signalRssi;
+
+	history_update_distance(insert_pos);
+	history_views_add(idx);
+	history_grid_add(idx);
+
+	if(!found_existing_entry_for_call) {
+		history_index_add(idx);
+	}
+
+	return idx;
+}
+
+
+uint16_t aprs_rx_history_update_signal(
+		const char *source,
+		const aprs_rx_raw_data_t *raw,
+		uint64_t rx_timestamp)
+{
+	uint16_t idx = history_find(aprs_call_pack(source), source);
+
+	if(idx == RX_HISTORY_NONE) {
+		return APRS_RX_HISTORY_SIZE;
+	}
+
+	aprs_rx_history_entry_t *entry = &m_rx_history[idx];
+
+	history_views_remove(idx);
+
+	entry->rssi         = raw->rssi;
+	entry->snr          = raw->snr;
+	entry->signalRssi   = raw->signalRssi;
+	entry->rx_timestamp = rx_timestamp;
+
+	history_lru_unlink(idx);
+	history_lru_push(idx, rx_timestamp);
+	history_views_add(idx);
+
+	return idx;
+}
+
+
+void aprs_rx_history_set_reference(float lat, float lon)
+{
+	if(m_rx_history_has_reference
+			&& great_circle_distance_m(m_rx_history_ref_lat, m_rx_history_ref_lon, lat, lon)
+			   < APRS_RX_HISTORY_REFERENCE_UPDATE_M) {
+		return;
+	}
+
+	m_rx_history_has_reference = true;
+	m_rx_history_ref_lat = lat;
+	m_rx_history_ref_lon = lon;
+
+	// The order changes little for small movements, so an insertion sort
+	// takes few steps.
+	uint16_t *view = m_rx_history_by_distance;
+
+	for(uint16_t i = 0; i < m_rx_history_stats.num_stations; i++) {
+		uint16_t idx = view[i];
+		uint16_t pos = i;
+
+		history_update_distance(&m_rx_history[idx]);
+
+		float key = history_view_key(APRS_RX_HISTORY_BY_DISTANCE, idx);
+
+		while(pos > 0 && history_view_key(APRS_RX_HISTORY_BY_DISTANCE, view[pos - 1]) > key) {
+			view[pos] = view[pos - 1];
+			pos--;
+		}
+
+		view[pos] = idx;
+	}
+}
+
+
+uint16_t aprs_rx_history_get_sorted(aprs_rx_history_order_t order, uint16_t first,
+		uint16_t *idx, uint16_t count)
+{
+	uint16_t n = 0;
+
+	if(first >= m_rx_history_stats.num_stations) {
+		return 0;
+	}
+
+	if(order == APRS_RX_HISTORY_BY_TIME) {
+		uint16_t cur = m_rx_history_newest;
+
+		for(uint16_t i = 0; i < first; i++) {
+			cur = m_rx_history_older[cur];
+		}
+
+		while(n < count && cur != RX_HISTORY_NONE) {
+			idx[n++] = cur;
+			cur = m_rx_history_older[cur];
+		}
+	} else {
+		const uint16_t *view = history_view(order);
+
+		n = m_rx_history_stats.num_stations - first;
+		n = (n < count) ? n : count;
+
+		memcpy(idx, view + first, n * sizeof(idx[0]));
+	}
+
+	return n;
+}
+
+
+uint16_t aprs_rx_history_get_position(aprs_rx_history_order_t order, uint16_t idx)
+{
+	if(idx >= APRS_RX_HISTORY_SIZE || m_rx_history[idx].rx_timestamp == 0) {
+		return m_rx_history_stats.num_stations;
+	}
+
+	if(order == APRS_RX_HISTORY_BY_TIME) {
+		uint16_t pos = 0;
+
+		for(uint16_t cur = m_rx_history_newest; cur != idx; cur = m_rx_history_older[cur]) {
+			pos++;
+		}
+
+		return pos;
+	}
+
+	return history_view_find(order, idx);
+}
+
+
+/* State of a spatial query. In nearest mode, the results are kept sorted by
+ * distance and only the closest max stations are kept. */
+typedef struct {
+	float     lat;
+	float     lon;
+	float     radius;    // for radius queries
+	bool      nearest;
+	uint16_t *idx;
+	float    *distance;  // may be NULL for radius queries
+	uint16_t  max;
+	uint16_t  count;     // for radius queries, also those that did not fit
+	uint16_t  visited;
+} history_query_t;
+
+
+static void history_query_offer(history_query_t *q, uint16_t idx)
+{
+	const aprs_rx_history_entry_t *entry = &m_rx_history[idx];
+	float distance = great_circle_distance_m(q->lat, q->lon, entry->lat, entry->lon);
+
+	q->visited++;
+
+	if(!q->nearest) {
+		if(distance <= q->radius) {
+			if(q->count < q->max) {
+				q->idx[q->count] = idx;
+
+				if(q->distance) {
+					q->distance[q->count] = distance;
+				}
+			}
+
+			q->count++;
+		}
+		return;
+	}
+
+	if(q->count == q->max && !(distance < q->distance[q->max - 1])) {
+		return;
+	}
+
+	uint16_t pos = (q->count < q->max) ? q->count++ : q->max - 1;
+
+	// insert after stations with an equal distance
+	while(pos > 0 && q->distance[pos - 1] > distance) {
+		q->idx[pos] = q->idx[pos - 1];
+		q->distance[pos] = q->distance[pos - 1];
+		pos--;
+	}
+
+	q->idx[pos] = idx;
+	q->distance[pos] = distance;
+}
+
+
+/**@brief Offer the stations in a grid cell to a query.
+ * @details
+ * Other cells may share the bucket, their stations are skipped.
+ */
+static void history_query_cell(history_query_t *q, int16_t cell_lat, int16_t cell_lon)
+{
+	uint16_t idx = m_rx_history_grid_head[history_grid_bucket(cell_lat, cell_lon)];
+
+	for(; idx != RX_HISTORY_NONE; idx = m_rx_history_grid_next[idx]) {
+		int16_t entry_lat, entry_lon;
+
+		history_grid_cell(m_rx_history[idx].lat, m_rx_history[idx].lon, &entry_lat, &entry_lon);
+
+		if(entry_lat == cell_lat && entry_lon == cell_lon) {
+			history_query_offer(q, idx);
+		}
+	}
+}
+
+
+/**@brief Offer all stations to a query, for areas with more cells than buckets.
+ */
+static void history_query_all(history_query_t *q)
+{
+	for(uint16_t idx = m_rx_history_newest; idx != RX_HISTORY_NONE; idx = m_rx_history_older[idx]) {
+		history_query_offer(q, idx);
+	}
+}
+
+
+uint16_t aprs_rx_history_find_within(float lat, float lon, float radius_m,
+		uint16_t *idx, float *distance, uint16_t max)
+{
+	history_query_t q = {lat, lon, radius_m, false, idx, distance, max, 0, 0};
+
+	// Range of the cells, slightly enlarged for rounding errors. The longitude
+	// range is that of the spherical cap around the position.
+	float angle = radius_m * 1.01f / RX_HISTORY_M_PER_DEG;
+	float sin_dlon = sinf(angle * (3.14159265f / 180.0f)) / cosf(lat * (3.14159265f / 180.0f));
+	int16_t y0, y1, x0, x1, unused;
+	int32_t num_lon;
+
+	history_grid_cell(lat - angle, lon, &y0, &unused);
+	history_grid_cell(lat + angle, lon, &y1, &unused);
+
+	if(angle >= 90.0f || lat + angle >= 90.0f || lat - angle <= -90.0f || !(sin_dlon < 1.0f)) {
+		// the cap contains a pole, all longitudes
+		x0 = 0;
+		num_lon = RX_HISTORY_GRID_LON_CELLS;
+	} else {
+		float dlon = asinf(sin_dlon) * (180.0f / 3.14159265f);
+
+		history_grid_cell(lat, lon - dlon, &unused, &x0);
+		history_grid_cell(lat, lon + dlon, &unused, &x1);
+
+		num_lon = ((x1 - x0 + RX_HISTORY_GRID_LON_CELLS) % RX_HISTORY_GRID_LON_CELLS) + 1;
+	}
+
+	if((int32_t)(y1 - y0 + 1) * num_lon > RX_HISTORY_GRID_BUCKETS) {
+		history_query_all(&q);
+		return q.count;
+	}
+
+	for(int16_t y = y0; y <= y1; y++) {
+		for(int32_t i = 0; i < num_lon; i++) {
+			history_query_cell(&q, y, (x0 + i) % RX_HISTORY_GRID_LON_CELLS);
+		}
+	}
+
+	return q.count;
+}
+
+
+uint16_t aprs_rx_history_find_nearest(float lat, float lon,
+		uint16_t *idx, float *distance, uint16_t count)
+{
+	history_query_t q = {lat, lon, 0.0f, true, idx, distance, count, 0, 0};
+	int16_t qy, qx;
+
+	if(count == 0) {
+		return 0;
+	}
+
+	history_grid_cell(lat, lon, &qy, &qx);
+
+	// Search rings of cells around the cell of the position. All stations
+	// not visited yet are outside the rings, at least as far away as the
+	// closest border of the searched area.
+	for(int16_t r = 0; ; r++) {
+		if((2 * r + 1) * (2 * r + 1) > RX_HISTORY_GRID_BUCKETS) {
+			q.count = 0;
+			history_query_all(&q);
+			return q.count;
+		}
+
+		for(int16_t dy = -r; dy <= r; dy++) {
+			int16_t y = qy + dy;
+
+			if(y < 0 || y >= RX_HISTORY_GRID_LAT_CELLS) {
+				continue;
+			}
+
+			int16_t step = (dy == -r || dy == r) ? 1 : 2 * r;
+
+			for(int16_t dx = -r; dx <= r; dx += step) {
+				history_query_cell(&q, y, (qx + dx + RX_HISTORY_GRID_LON_CELLS) % RX_HISTORY_GRID_LON_CELLS);
+			}
+		}
+
+		if(q.visited == m_rx_history_stats.num_stations) {
+			return q.count;
+		}
+
+		if(q.count < count) {
+			continue;
+		}
+
+		// distance to the borders: along the meridian to the south and
+		// north, and to the great circles of the meridians to the west and
+		// east
+		float south = lat + 90.0f - (float)(qy - r) / RX_HISTORY_GRID_CELLS_PER_DEG;
+		float north = (float)(qy + r + 1) / RX_HISTORY_GRID_CELLS_PER_DEG - (lat + 90.0f);
+		float west = lon + 180.0f - (float)(qx - r) / RX_HISTORY_GRID_CELLS_PER_DEG;
+		float east = (float)(qx + r + 1) / RX_HISTORY_GRID_CELLS_PER_DEG - (lon + 180.0f);
+		float cos_lat = cosf(lat * (3.14159265f / 180.0f));
+		float bound = (south < north) ? south : north;
+		float lon_angle = (west < east) ? west : east;
+
+		if(qy - r <= 0) {
+			bound = north;
+		}
+
+		if(qy + r + 1 >= RX_HISTORY_GRID_LAT_CELLS) {
+			bound = (qy - r <= 0) ? INFINITY : south;
+		}
+
+		lon_angle = asinf(cos_lat * sinf(lon_angle * (3.14159265f / 180.0f))) * (180.0f / 3.14159265f);
+		bound = (lon_angle < bound) ? lon_angle : bound;
+
+		if(q.distance[count - 1] <= bound * RX_HISTORY_M_PER_DEG) {
+			return q.count;
+		}
+	}
+}
+
+
+const aprs_rx_history_entry_t* aprs_rx_history_get(uint16_t idx)
+{
+	if(idx >= APRS_RX_HISTORY_SIZE) {
+		return NULL;
+	}
+
+	return &m_rx_history[idx];
+}
+
+
+size_t aprs_rx_history_get_string(const aprs_rx_history_entry_t *entry,
+		aprs_rx_history_string_t field, char *buf, size_t buf_len)
+{
+	const char *str = "";
+	size_t len = 0;
+
+	if(entry->record != HISTORY_NO_RECORD) {
+		str = history_string(entry - m_rx_history, field, &len);
+	}
+
+	if(buf_len > 0) {
+		size_t copy_len = (len < buf_len) ? len : buf_len - 1;
+
+		memcpy(buf, str, copy_len);
+		buf[copy_len] = '\0';
+	}
+
+	return len;
+}
+
+
+const uint8_t* aprs_rx_history_get_data(const aprs_rx_history_entry_t *entry, size_t *len)
+{
+	if(entry->record == HISTORY_NO_RECORD) {
+		*len = 0;
+		return (const uint8_t*)"";
+	}
+
+	const history_record_t *rec = history_record(entry->record);
+
+	*len = rec->data_len;
+	return history_record_data(rec);
+}
+
+
+void aprs_rx_history_get_frame(const aprs_rx_history_entry_t *entry, aprs_frame_t *frame)
+{
+	memset(frame, 0, sizeof(*frame));
+
+	aprs_rx_history_get_string(entry, APRS_RX_HISTORY_SOURCE, frame->source, sizeof(frame->source));
+	aprs_rx_history_get_string(entry, APRS_RX_HISTORY_DEST, frame->dest, sizeof(frame->dest));
+	aprs_rx_history_get_string(entry, APRS_RX_HISTORY_VIA, frame->via, sizeof(frame->via));
+	aprs_rx_history_get_string(entry, APRS_RX_HISTORY_COMMENT, frame->comment, sizeof(frame->comment));
+
+	frame->source_call = entry->source_call;
+	frame->lat = entry->lat;
+	frame->lon = entry->lon;
+	frame->alt = entry->alt;
+	frame->table = entry->table;
+	frame->symbol = entry->symbol;
+
+	if(entry->record != HISTORY_NO_RECORD) {
+		const history_record_t *rec = history_record(entry->record);
+
+		frame->speed = rec->speed;
+		frame->course = rec->course;
+		frame->range = rec->range;
+
+		if(rec->has_telemetry) {
+			memcpy(&frame->telemetry, rec + 1, sizeof(aprs_telemetry_t));
+		}
+	}
 }
 
 
-const aprs_rx_history_t* aprs_get_rx_history(void)
+const aprs_rx_history_stats_t* aprs_rx_history_get_stats(void)
 {
-	return &m_rx_history;
+	return &m_rx_history_stats;
 }
@@ -29,6 +29,8 @@
 #include <stdbool.h>
 #include <time.h>
 
+#include "aprs_call.h"
+
 // normal AX.25 frame length, not applicable for LoRa APRS
 //#define APRS_MAX_FRAME_LEN (1+7+7+8*7+1+1+256+2+1)
 #define APRS_MAX_FRAME_LEN 256
@@ -37,19 +39,19 @@
 
 #define PACKET_TYPE_POSITION 0
 #define PACKET_TYPE_WX 1
+#define PACKET_TYPE_TLM_PARM 2 // telemetry channel names
+#define PACKET_TYPE_TLM_UNIT 3 // telemetry units
+#define PACKET_TYPE_TLM_EQNS 4 // telemetry scaling equations
 
-#define HEADING_CHECK_MIN_SPEED   1.0f // m/s
-#define MAX_HEADING_DELTA_DEG    30.0f
-
-//#define MIN_TX_INTERVAL_MS      15000
-#define MIN_TX_INTERVAL_MS      30000
+// base of the comment rate limit, the position reports are scheduled by
+// SmartBeaconing (see tracker.h)
 //#define MAX_TX_INTERVAL_MS     900000
 #define MAX_TX_INTERVAL_MS     1800000
 
-#define MAX_DISTANCE_M           2000
-
 #define WX_INTERVAL_MS         900000
 
+#define TLM_DEFS_INTERVAL_MS  7200000
+
 #define RATE_LIMIT_MESSAGE_TEXT	1
 
 
@@ -82,8 +84,37 @@ typedef enum {
 	APRS_FLAG_ADD_ALTITUDE      = (1 << 3),
 	APRS_FLAG_ADD_VBAT          = (1 << 4),
 	APRS_FLAG_ADD_WEATHER       = (1 << 5),
+	APRS_FLAG_MIC_E             = (1 << 6),
+	APRS_FLAG_COMPRESSED_COURSE_SPEED = (1 << 7), // course/speed instead of altitude in the compressed format
+	APRS_FLAG_TELEMETRY         = (1 << 8), // frame counter, Vbat and weather as base-91 telemetry
 } aprs_flag_t;
 
+/* Mic-E position messages (encoded in the destination address). */
+typedef enum {
+	APRS_MIC_E_OFF_DUTY = 0, // M0
+	APRS_MIC_E_EN_ROUTE,     // M1
+	APRS_MIC_E_IN_SERVICE,   // M2
+	APRS_MIC_E_RETURNING,    // M3
+	APRS_MIC_E_COMMITTED,    // M4
+	APRS_MIC_E_SPECIAL,      // M5
+	APRS_MIC_E_PRIORITY,     // M6
+	APRS_MIC_E_EMERGENCY,
+} aprs_mic_e_msg_t;
+
+/* Optional fields of a position report, in the order they are encoded. Each
+ * field is only sent if enabled by the corresponding aprs_flag_t bit (the
+ * comment is sent whenever the rate limit allows it). */
+typedef enum {
+	APRS_FIELD_ALTITUDE,      // APRS_FLAG_ADD_ALTITUDE, not if the compressed position contains it
+	APRS_FIELD_COMMENT,
+	APRS_FIELD_FRAME_COUNTER, // APRS_FLAG_ADD_FRAME_COUNTER
+	APRS_FIELD_VBAT,          // APRS_FLAG_ADD_VBAT
+	APRS_FIELD_TELEMETRY,     // APRS_FLAG_TELEMETRY, replaces frame counter and Vbat
+	APRS_FIELD_DAO,           // APRS_FLAG_ADD_DAO, uncompressed or Mic-E only
+
+	APRS_NUM_FIELDS
+} aprs_field_t;
+
 typedef struct {
 	uint32_t frame_id;
 	uint16_t vbat_millivolt;
@@ -95,23 +126,75 @@ typedef struct {
 } aprs_args_t;
 
 
+#define APRS_TLM_MAX_ANALOG 5
+
+/* Raw values of the base-91 comment telemetry. The scaling is defined by the
+ * sender's EQNS message and is unknown to the receiver. */
+typedef struct {
+	uint16_t seq;
+	uint16_t analog[APRS_TLM_MAX_ANALOG]; // 0 to 8280
+	uint8_t  n_analog;                    // 0 if no telemetry was received
+	uint8_t  digital;
+	bool     has_digital;
+} aprs_telemetry_t;
+
 typedef struct {
 	char source[16];
 	char dest[16];
 	char via[32];
 
+	aprs_call_t source_call; // packed source; APRS_CALL_INVALID if it cannot be packed
+
 	float lat; // in degrees
 	float lon; // in degrees
 	float alt; // in meters
 
+	float    speed;  // in m/s
+	uint16_t course; // in degrees, 1 to 360; 0 if unknown
+	float    range;  // pre-calculated radio range in km; 0 if unknown
+
 	char comment[64];
 
 	char table;
 	char symbol;
+
+	aprs_telemetry_t telemetry;
 } aprs_frame_t;
 
 //#define APRS_RX_HISTORY_SIZE 3
-#define APRS_RX_HISTORY_SIZE 64
+// Number of entries of the history. The default is sized together with
+// APRS_RX_HISTORY_ARENA_SIZE: the arena holds a few more typical frames than
+// there are entries, and table, index and arena take less RAM than the
+// previous history of 64 complete frames (29704 bytes).
+#ifndef APRS_RX_HISTORY_SIZE
+#define APRS_RX_HISTORY_SIZE 160
+#endif
+
+#if APRS_RX_HISTORY_SIZE > 1024
+#error "The history index is sized for at most 1024 entries."
+#endif
+
+// Size of the arena holding the received frames of the history in bytes. A
+// typical LoRa APRS position report of 60 to 100 bytes takes about 96 bytes in
+// the arena including the decoded fields, so the default holds about 170 of
+// them. Longer frames make the arena the limit before APRS_RX_HISTORY_SIZE.
+#ifndef APRS_RX_HISTORY_ARENA_SIZE
+#define APRS_RX_HISTORY_ARENA_SIZE 16384
+#endif
+
+#if APRS_RX_HISTORY_ARENA_SIZE > 65532 || (APRS_RX_HISTORY_ARENA_SIZE % 4) != 0
+#error "Arena offsets are uint16_t and records are 4-byte aligned."
+#endif
+
+#if APRS_RX_HISTORY_ARENA_SIZE < 1024
+#error "The arena must hold at least two frames of maximum length."
+#endif
+
+// Distance in meters the reference position must move before the distances of
+// all stations are recalculated, see aprs_rx_history_set_reference().
+#ifndef APRS_RX_HISTORY_REFERENCE_UPDATE_M
+#define APRS_RX_HISTORY_REFERENCE_UPDATE_M 100.0f
+#endif
 
 typedef struct {
 	uint8_t      data[256];
@@ -122,16 +205,55 @@ typedef struct {
 	float signalRssi;
 } aprs_rx_raw_data_t;
 
+/* Station in the RX history. Only the fields needed to list and locate the
+ * stations are kept here. The received frame and the other decoded fields are
+ * stored at their actual length in the history arena and are read with
+ * aprs_rx_history_get_string(), aprs_rx_history_get_data() and
+ * aprs_rx_history_get_frame(). */
 typedef struct {
-	aprs_rx_raw_data_t raw;
-	aprs_frame_t       decoded;
-	uint64_t           rx_timestamp;
+	uint64_t    rx_timestamp;
+	aprs_call_t source_call; // see aprs_frame_t
+
+	float lat; // in degrees
+	float lon; // in degrees
+	float alt; // in meters
+
+	float rssi;
+	float snr;
+	float signalRssi;
+
+	float distance;  // from the reference position in meters, negative if unknown
+	float direction; // from the reference position in degrees
+
+	uint16_t record; // offset of the frame record in the arena
+	char     table;
+	char     symbol;
 } aprs_rx_history_entry_t;
 
+typedef enum {
+	APRS_RX_HISTORY_SOURCE,
+	APRS_RX_HISTORY_DEST,
+	APRS_RX_HISTORY_VIA,
+	APRS_RX_HISTORY_COMMENT,
+
+	APRS_RX_HISTORY_NUM_STRINGS
+} aprs_rx_history_string_t;
+
+typedef enum {
+	APRS_RX_HISTORY_BY_TIME,     // most recently heard first
+	APRS_RX_HISTORY_BY_DISTANCE, // closest first, unknown distances last
+	APRS_RX_HISTORY_BY_RSSI,     // strongest first
+
+	APRS_RX_HISTORY_NUM_ORDERS
+} aprs_rx_history_order_t;
+
 typedef struct {
-	aprs_rx_history_entry_t history[APRS_RX_HISTORY_SIZE];
-	uint8_t                 num_entries;
-} aprs_rx_history_t;
+	uint16_t num_entries;      // entries of the table in use so far
+	uint16_t num_stations;     // entries holding a station
+	uint16_t arena_used;       // bytes of the arena used by current frames
+	uint32_t arena_evictions;  // stations replaced to make room in the arena
+	uint32_t arena_compactions;
+} aprs_rx_history_stats_t;
 
 
 void aprs_init(void);
@@ -140,16 +262,58 @@ void aprs_get_dest(char *dest, size_t dest_len);
 void aprs_set_source(const char *call);
 //void aprs_get_source(char *source, size_t source_len);
 const char *aprs_get_source(char *source, size_t source_len);
+/**@brief Check whether the frame was sent with our own source call.
+ */
+bool aprs_is_own_source(const aprs_frame_t *frame);
 void aprs_clear_path();
 uint8_t aprs_add_path(const char *call);
 void aprs_update_pos_time(float lat, float lon, float alt_m, time_t t);
+/**@brief Set the speed and course for the next position report.
+ * @details
+ * Used in the Mic-E format and in the compressed format if
+ * APRS_FLAG_COMPRESSED_COURSE_SPEED is set.
+ */
+void aprs_update_speed_course(float speed_m_s, float course_deg, bool valid);
+void aprs_set_mic_e_message(aprs_mic_e_msg_t msg);
 void aprs_get_icon(char *table, char *icon);
 void aprs_set_icon(char table, char icon);
 void aprs_set_icon_default(aprs_icon_t icon);
 void aprs_set_comment(const char *comment);
 bool aprs_can_build_frame(void);
+/**@brief Build a frame of the given type.
+ * @details
+ * Header and information field are encoded directly into the given buffer,
+ * which can be the LoRa TX buffer (see lora_tx_reserve()). The frame is
+ * NUL-terminated.
+ *
+ * @param frame        Buffer of at least APRS_MAX_FRAME_LEN bytes.
+ * @param args         Additional data for the frame.
+ * @param packet_type  PACKET_TYPE_POSITION, PACKET_TYPE_WX or one of the
+ *                     telemetry definitions PACKET_TYPE_TLM_*.
+ * @returns            The frame length (without NUL) or 0 if no frame was built.
+ */
 size_t aprs_build_frame(uint8_t *frame, const aprs_args_t *args, uint8_t packet_type);
 
+/**@brief Set the maximum time on air of a position report.
+ * @details
+ * If the frame with all enabled optional fields would exceed the budget, the
+ * fields are added in the order of their priority (see
+ * aprs_set_field_priority()) as long as the frame still fits. The position
+ * itself is always sent, even if it does not fit into the budget alone.
+ *
+ * @param budget_ms   Airtime budget in milliseconds. 0 disables the limit.
+ */
+void aprs_set_airtime_budget(uint32_t budget_ms);
+uint32_t aprs_get_airtime_budget(void);
+
+/**@brief Set the priority of an optional field for the airtime budget.
+ * @details
+ * Fields with higher values are preferred. Fields with equal priority are
+ * added in encoding order.
+ */
+void aprs_set_field_priority(aprs_field_t field, uint8_t priority);
+uint8_t aprs_get_field_priority(aprs_field_t field);
+
 uint32_t aprs_get_config_flags(void);
 void aprs_set_config_flags(uint32_t new_flags);
 void aprs_enable_config_flag(aprs_flag_t flag);
@@ -163,19 +327,135 @@ const char* aprs_get_parser_error(void);
  * @details
  * If a frame with the received call already exists in the history, that frame
  * is replaced by the new frame. If it does not exist and the history is full
- * before the new frame is inserted, the oldest frame in the history is
- * replaced.
+ * before the new frame is inserted, the least recently updated frame in the
+ * history is replaced. Frames are also replaced in that order while the new
+ * frame does not fit into the arena.
+ *
+ * The position of the frame is added to the track of the station, see
+ * aprs_track.h.
+ *
+ * Stations are found through a hash index and the entries are kept in a list
+ * ordered by the time of the last update, so this takes constant time, except
+ * for an occasional compaction of the arena and for keeping the orders of
+ * aprs_rx_history_get_sorted(), which takes a binary search and a move of the
+ * following indices.
  *
  * You can specify the index of an entry to protect. That entry will never be
  * replaced, except if the callsign matches. Set protected_index to
  * APRS_RX_HISTORY_SIZE or greater to disable the protection.
  */
-uint8_t aprs_rx_history_insert(
+uint16_t aprs_rx_history_insert(
 		const aprs_frame_t *frame,
 		const aprs_rx_raw_data_t *raw,
 		uint64_t rx_timestamp,
-		uint8_t protected_index);
+		uint16_t protected_index);
+
+/**@brief Update the signal data and reception time of a station in the history.
+ * @details
+ * Used for duplicate frames (see aprs_dedup.h), which are not decoded again.
+ * The stored frame is not changed.
+ *
+ * @param source        Source call of the received frame.
+ * @param raw           Signal data of the received frame. The frame data in it
+ *                      is ignored.
+ * @param rx_timestamp  Reception time.
+ * @returns             The index of the updated entry or APRS_RX_HISTORY_SIZE
+ *                      if the station is not in the history.
+ */
+uint16_t aprs_rx_history_update_signal(
+		const char *source,
+		const aprs_rx_raw_data_t *raw,
+		uint64_t rx_timestamp);
+
+/**@brief Get a history entry.
+ * @details
+ * Entries that are not in use have rx_timestamp 0. The entry and the data
+ * returned by the other accessors are valid until the next insert.
+ *
+ * @returns  The entry or NULL if idx >= APRS_RX_HISTORY_SIZE.
+ */
+const aprs_rx_history_entry_t* aprs_rx_history_get(uint16_t idx);
+
+/**@brief Copy a decoded string field of a history entry.
+ * @details
+ * The string is truncated to the buffer size and always NUL-terminated.
+ *
+ * @returns  The length of the field (which may be longer than the copy).
+ */
+size_t aprs_rx_history_get_string(const aprs_rx_history_entry_t *entry,
+		aprs_rx_history_string_t field, char *buf, size_t buf_len);
+
+/**@brief Get the received frame of a history entry.
+ *
+ * @param[out] len  Receives the frame length.
+ * @returns         The frame data in the arena (not NUL-terminated).
+ */
+const uint8_t* aprs_rx_history_get_data(const aprs_rx_history_entry_t *entry, size_t *len);
+
+/**@brief Reconstruct the complete decoded frame of a history entry.
+ */
+void aprs_rx_history_get_frame(const aprs_rx_history_entry_t *entry, aprs_frame_t *frame);
+
+/**@brief Set the position the distances and directions of the stations refer to.
+ * @details
+ * The distances are only recalculated and the stations sorted again when the
+ * position moved by more than APRS_RX_HISTORY_REFERENCE_UPDATE_M since the
+ * last recalculation, so this can be called on every GNSS fix.
+ */
+void aprs_rx_history_set_reference(float lat, float lon);
+
+/**@brief Get a range of stations of the history in the given order.
+ * @details
+ * The orders are maintained when stations are inserted, so this does not sort.
+ * For APRS_RX_HISTORY_BY_TIME, it takes time linear in first.
+ *
+ * @param order     The sort order.
+ * @param first     Position of the first station to return.
+ * @param[out] idx  Receives the entry indices.
+ * @param count     Maximum number of indices to return.
+ * @returns         The number of indices returned.
+ */
+uint16_t aprs_rx_history_get_sorted(aprs_rx_history_order_t order, uint16_t first,
+		uint16_t *idx, uint16_t count);
+
+/**@brief Get the position of a station in the given order.
+ *
+ * @returns  The position or num_stations (see aprs_rx_history_get_stats()) if
+ *           the entry is not in use.
+ */
+uint16_t aprs_rx_history_get_position(aprs_rx_history_order_t order, uint16_t idx);
+
+/**@brief Find the stations within a distance of a position.
+ * @details
+ * Only the grid cells that overlap the circle are searched. The stations are
+ * not sorted.
+ *
+ * @param lat, lon       The position in degrees.
+ * @param radius_m       The distance in meters.
+ * @param[out] idx       Receives up to max entry indices.
+ * @param[out] distance  Receives the distances in meters. May be NULL.
+ * @param max            Size of the arrays.
+ * @returns              The number of stations found, which may be greater
+ *                       than max.
+ */
+uint16_t aprs_rx_history_find_within(float lat, float lon, float radius_m,
+		uint16_t *idx, float *distance, uint16_t max);
+
+/**@brief Find the stations closest to a position.
+ * @details
+ * The grid cells are searched in rings around the position until no station
+ * outside can be closer.
+ *
+ * @param lat, lon       The position in degrees.
+ * @param[out] idx       Receives the entry indices, closest first.
+ * @param[out] distance  Receives the distances in meters.
+ * @param count          Number of stations to find.
+ * @returns              The number of stations found, less than count only if
+ *                       the history holds fewer stations.
+ */
+uint16_t aprs_rx_history_find_nearest(float lat, float lon,
+		uint16_t *idx, float *distance, uint16_t count);
 
-const aprs_rx_history_t* aprs_get_rx_history(void);
+const aprs_rx_history_stats_t* aprs_rx_history_get_stats(void);
 
 #endif // APRS_H
@@ -0,0 +1,127 @@
+/*
+ * vim: noexpandtab
+ *
+ * Copyright (c) 2021-2022 Thomas Kolb <cfr34k-git@tkolb.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#include "aprs_call.h"
+
+#define CALL_BASE  40
+
+// digit 0 marks the end of the callsign
+static const char m_alphabet[CALL_BASE] =
+	"\0ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-/.";
+
+static uint8_t char_to_digit(char c)
+{
+	if(c >= 'A' && c <= 'Z') {
+		return 1 + (c - 'A');
+	} else if(c >= '0' && c <= '9') {
+		return 27 + (c - '0');
+	} else if(c == '-') {
+		return 37;
+	} else if(c == '/') {
+		return 38;
+	} else if(c == '.') {
+		return 39;
+	}
+
+	return 0;
+}
+
+aprs_call_t aprs_call_pack_n(const char *call, size_t len)
+{
+	// 40^n: the padding after the end of the callsign
+	static const aprs_call_t padding[APRS_CALL_MAX_LEN] = {
+		1ULL, 40ULL, 1600ULL, 64000ULL, 2560000ULL, 102400000ULL,
+		4096000000ULL, 163840000000ULL, 6553600000000ULL,
+		262144000000000ULL, 10485760000000000ULL, 419430400000000000ULL,
+	};
+
+	aprs_call_t result = 0;
+
+	if(len == 0 || len > APRS_CALL_MAX_LEN) {
+		return APRS_CALL_INVALID;
+	}
+
+	for(size_t i = 0; i < len; i++) {
+		uint8_t digit = char_to_digit(call[i]);
+
+		if(digit == 0) {
+			return APRS_CALL_INVALID;
+		}
+
+		result = result * CALL_BASE + digit;
+	}
+
+	return result * padding[APRS_CALL_MAX_LEN - len];
+}
+
+aprs_call_t aprs_call_pack(const char *call)
+{
+	size_t len = 0;
+
+	while(call[len] != '\0') {
+		if(++len > APRS_CALL_MAX_LEN) {
+			return APRS_CALL_INVALID;
+		}
+	}
+
+	return aprs_call_pack_n(call, len);
+}
+
+size_t aprs_call_unpack(aprs_call_t call, char *buf, size_t buf_len)
+{
+	char digits[APRS_CALL_MAX_LEN];
+	size_t len = 0;
+
+	if(buf_len == 0) {
+		return 0;
+	}
+
+	buf[0] = '\0';
+
+	if(call == APRS_CALL_INVALID) {
+		return 0;
+	}
+
+	for(size_t i = APRS_CALL_MAX_LEN; i > 0; i--) {
+		digits[i - 1] = m_alphabet[call % CALL_BASE];
+		call /= CALL_BASE;
+	}
+
+	while(len < APRS_CALL_MAX_LEN && digits[len] != '\0') {
+		len++;
+	}
+
+	if(len + 1 > buf_len) {
+		return 0;
+	}
+
+	for(size_t i = 0; i < len; i++) {
+		buf[i] = digits[i];
+	}
+
+	buf[len] = '\0';
+	return len;
+}
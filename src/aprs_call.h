@@ -0,0 +1,77 @@
+/*
+ * vim: noexpandtab
+ *
+ * Copyright (c) 2021-2022 Thomas Kolb <cfr34k-git@tkolb.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef APRS_CALL_H
+#define APRS_CALL_H
+
+/**@file
+ *
+ * @brief Callsigns packed into 64 bit integers.
+ *
+ * @details
+ * A callsign with SSID, e.g. "DL9SAU-12", is stored as a base-40 number of up
+ * to APRS_CALL_MAX_LEN characters, the first character being the most
+ * significant digit. The alphabet consists of the letters A-Z, the digits and
+ * '-', '/' and '.', which covers all AX.25 callsigns with SSID as well as most
+ * other station names used in LoRa-APRS. Comparing two callsigns is a single
+ * integer compare, and packed callsigns sort like the strings.
+ *
+ * Names that cannot be packed (too long, lowercase letters or other
+ * characters) result in APRS_CALL_INVALID. Users must fall back to string
+ * compares in that case.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef uint64_t aprs_call_t;
+
+#define APRS_CALL_INVALID  0
+#define APRS_CALL_MAX_LEN  12  // 40^12 < 2^64
+
+/**@brief Pack a callsign of the given length.
+ *
+ * @returns  The packed callsign or APRS_CALL_INVALID if it cannot be packed or
+ *           is empty.
+ */
+aprs_call_t aprs_call_pack_n(const char *call, size_t len);
+
+/**@brief Pack a NUL-terminated callsign.
+ */
+aprs_call_t aprs_call_pack(const char *call);
+
+/**@brief Unpack a callsign into a NUL-terminated string.
+ *
+ * @param call      The packed callsign.
+ * @param buf       Buffer for the callsign, APRS_CALL_MAX_LEN + 1 bytes are
+ *                  always sufficient.
+ * @param buf_len   Size of the buffer.
+ * @returns         The length of the callsign, or 0 if it is invalid or does
+ *                  not fit into the buffer.
+ */
+size_t aprs_call_unpack(aprs_call_t call, char *buf, size_t buf_len);
+
+#endif // APRS_CALL_H
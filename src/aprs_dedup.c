@@ -0,0 +1,171 @@
+/*
+ * vim: noexpandtab
+ *
+ * Copyright (c) 2021-2022 Thomas Kolb <cfr34k-git@tkolb.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#include <string.h>
+
+#include "aprs_dedup.h"
+
+#define FNV_OFFSET_BASIS  2166136261UL
+#define FNV_PRIME         16777619UL
+
+typedef struct {
+	uint32_t hash;
+	uint16_t len;          // length of the hashed data, as a cheap second check
+	bool     used;
+	uint64_t first_seen;
+} dedup_entry_t;
+
+static dedup_entry_t      m_cache[APRS_DEDUP_SIZE];
+static aprs_dedup_stats_t m_stats;
+
+static uint32_t fnv1a(uint32_t hash, const uint8_t *data, size_t len)
+{
+	for(size_t i = 0; i < len; i++) {
+		hash ^= data[i];
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
+
+/**@brief Hash source, destination and information field of the frame.
+ * @details
+ * Frames without a recognizable header are hashed completely.
+ *
+ * @param[in]  frame       The received frame.
+ * @param[in]  len         Length of the frame.
+ * @param[out] hashed_len  Number of bytes that went into the hash.
+ * @param[out] source      Receives the source call. May be NULL.
+ * @param[in]  source_len  Size of the source buffer.
+ */
+static uint32_t hash_frame(const uint8_t *frame, size_t len, uint16_t *hashed_len,
+		char *source, size_t source_len)
+{
+	const uint8_t *end = frame + len;
+	const uint8_t *src_start = frame;
+	const uint8_t *src_end = NULL;
+	const uint8_t *dest_end = NULL;
+	const uint8_t *info = NULL;
+
+	if(source && source_len) {
+		source[0] = '\0';
+	}
+
+	if(len >= 3 && frame[0] == '<' && frame[1] == 0xFF && frame[2] == 0x01) {
+		src_start += 3;
+	}
+
+	for(const uint8_t *p = src_start; p < end; p++) {
+		if(!src_end) {
+			if(*p == '>') {
+				src_end = p;
+			}
+		} else if(*p == ':') {
+			if(!dest_end) {
+				dest_end = p;
+			}
+			info = p + 1;
+			break;
+		} else if(*p == ',' && !dest_end) {
+			dest_end = p;
+		}
+	}
+
+	if(!info) {
+		*hashed_len = len;
+		return fnv1a(FNV_OFFSET_BASIS, frame, len);
+	}
+
+	size_t src_len = src_end - src_start;
+	size_t dest_len = dest_end - (src_end + 1);
+	size_t info_len = end - info;
+
+	if(source && source_len) {
+		size_t n = (src_len < source_len - 1) ? src_len : source_len - 1;
+
+		memcpy(source, src_start, n);
+		source[n] = '\0';
+	}
+
+	// the header up to the end of the destination is contiguous
+	uint32_t hash = fnv1a(FNV_OFFSET_BASIS, src_start, src_len + 1 + dest_len);
+	hash = fnv1a(hash, info, info_len);
+
+	*hashed_len = src_len + 1 + dest_len + info_len;
+	return hash;
+}
+
+void aprs_dedup_init(void)
+{
+	memset(m_cache, 0, sizeof(m_cache));
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+bool aprs_dedup_check(const uint8_t *frame, size_t len, uint64_t now,
+		char *source, size_t source_len)
+{
+	uint16_t hashed_len;
+	uint32_t hash = hash_frame(frame, len, &hashed_len, source, source_len);
+	dedup_entry_t *replace = &m_cache[0];
+
+	for(size_t i = 0; i < APRS_DEDUP_SIZE; i++) {
+		dedup_entry_t *entry = &m_cache[i];
+
+		if(!entry->used) {
+			replace = entry;
+			continue;
+		}
+
+		if((now - entry->first_seen) >= APRS_DEDUP_WINDOW_MS) {
+			// expired
+			entry->used = false;
+			replace = entry;
+			continue;
+		}
+
+		if(entry->hash == hash && entry->len == hashed_len) {
+			m_stats.hits++;
+			return true;
+		}
+
+		if(replace->used && entry->first_seen < replace->first_seen) {
+			replace = entry;
+		}
+	}
+
+	replace->hash = hash;
+	replace->len = hashed_len;
+	replace->used = true;
+	replace->first_seen = now;
+
+	m_stats.misses++;
+	return false;
+}
+
+const aprs_dedup_stats_t* aprs_dedup_get_stats(void)
+{
+	return &m_stats;
+}
@@ -0,0 +1,80 @@
+/*
+ * vim: noexpandtab
+ *
+ * Copyright (c) 2021-2022 Thomas Kolb <cfr34k-git@tkolb.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef APRS_DEDUP_H
+#define APRS_DEDUP_H
+
+/**@file
+ *
+ * @brief Suppression of duplicate received frames.
+ *
+ * @details
+ * In areas with several digipeaters, the same frame is received multiple
+ * times within a few seconds. Each copy differs only in the path. This cache
+ * remembers a hash of source, destination and information field (but not the
+ * path) of the recently received frames, so copies can be detected before they
+ * are decoded.
+ *
+ * The destination is part of the key because Mic-E frames encode the latitude
+ * in it. Digipeaters never change it.
+ *
+ * A frame is a duplicate if the same key was first seen less than
+ * APRS_DEDUP_WINDOW_MS ago. Duplicates do not extend the window, so a station
+ * repeating the same beacon at regular intervals is still reported.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define APRS_DEDUP_SIZE        16
+#define APRS_DEDUP_WINDOW_MS   30000
+
+typedef struct {
+	uint32_t hits;     // frames detected as duplicates
+	uint32_t misses;   // frames seen for the first time (within the window)
+} aprs_dedup_stats_t;
+
+/**@brief Clear the cache and the statistics.
+ */
+void aprs_dedup_init(void);
+
+/**@brief Check whether the frame was received recently and remember it.
+ *
+ * @param[in]  frame        The received frame, as passed to aprs_parse_frame().
+ * @param[in]  len          Length of the frame.
+ * @param[in]  now          Current time in milliseconds (see time_base_get()).
+ * @param[out] source       Receives the source call of the frame. May be NULL.
+ * @param[in]  source_len   Size of the source buffer.
+ * @returns                 true if the frame is a duplicate.
+ */
+bool aprs_dedup_check(const uint8_t *frame, size_t len, uint64_t now,
+		char *source, size_t source_len);
+
+/**@brief Get the hit/miss counters since aprs_dedup_init().
+ */
+const aprs_dedup_stats_t* aprs_dedup_get_stats(void);
+
+#endif // APRS_DEDUP_H
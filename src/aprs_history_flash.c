@@ -0,0 +1,88 @@
+/*
+ * vim: noexpandtab
+ *
+ * Copyright (c) 2021-2022 Thomas Kolb <cfr34k-git@tkolb.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <nrf_fstorage.h>
+#include <nrf_fstorage_sd.h>
+#include <nrf_log.h>
+
+#include "aprs_history_flash.h"
+
+// The pages are located directly below the pages erased by settings_init() for
+// the FDS (0xF0000 to 0xF3FFF), which are followed by the bootloader.
+// The FLASH region of t-echo.ld ends at APRS_HISTORY_FLASH_START, so the
+// application cannot grow into them.
+#define APRS_HISTORY_FLASH_END    0xF0000
+#define APRS_HISTORY_FLASH_START  (APRS_HISTORY_FLASH_END - APRS_HISTORY_FLASH_PAGES * APRS_HISTORY_FLASH_PAGE_SIZE)
+
+static void cb_fstorage(nrf_fstorage_evt_t *p_evt);
+
+NRF_FSTORAGE_DEF(nrf_fstorage_t m_fstorage) =
+{
+	.evt_handler = cb_fstorage,
+	.start_addr  = APRS_HISTORY_FLASH_START,
+	.end_addr    = APRS_HISTORY_FLASH_END - 1,
+};
+
+
+static void cb_fstorage(nrf_fstorage_evt_t *p_evt)
+{
+	if(p_evt->result != NRF_SUCCESS) {
+		NRF_LOG_ERROR("history flash: operation %d at 0x%08x failed: %d",
+				p_evt->id, p_evt->addr, p_evt->result);
+	}
+}
+
+
+ret_code_t aprs_history_flash_init(void)
+{
+	return nrf_fstorage_init(&m_fstorage, &nrf_fstorage_sd, NULL);
+}
+
+
+const uint8_t* aprs_history_flash_page(uint8_t page)
+{
+	return (const uint8_t*)(APRS_HISTORY_FLASH_START + page * APRS_HISTORY_FLASH_PAGE_SIZE);
+}
+
+
+ret_code_t aprs_history_flash_write(uint8_t page, uint16_t offset, const void *data, size_t len)
+{
+	return nrf_fstorage_write(&m_fstorage,
+			APRS_HISTORY_FLASH_START + page * APRS_HISTORY_FLASH_PAGE_SIZE + offset,
+			data, len, NULL);
+}
+
+
+ret_code_t aprs_history_flash_erase(uint8_t page)
+{
+	return nrf_fstorage_erase(&m_fstorage,
+			APRS_HISTORY_FLASH_START + page * APRS_HISTORY_FLASH_PAGE_SIZE,
+			1, NULL);
+}
+
+
+bool aprs_history_flash_is_busy(void)
+{
+	return nrf_fstorage_is_busy(&m_fstorage);
+}
@@ -0,0 +1,80 @@
+/*
+ * vim: noexpandtab
+ *
+ * Copyright (c) 2021-2022 Thomas Kolb <cfr34k-git@tkolb.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef APRS_HISTORY_FLASH_H
+#define APRS_HISTORY_FLASH_H
+
+/**@file
+ *
+ * @brief Flash pages of the persistent RX history.
+ *
+ * @details
+ * Minimal flash access for aprs_history_store.c: the pages are read directly
+ * (they are memory-mapped), written and erased asynchronously. Only one
+ * operation may be in progress at a time and the written data must stay valid
+ * until aprs_history_flash_is_busy() returns false.
+ *
+ * On the target, this uses nrf_fstorage, so it works while the SoftDevice is
+ * enabled. The host tests link a fake implementation instead.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <sdk_errors.h>
+
+#define APRS_HISTORY_FLASH_PAGE_SIZE  4096
+
+#ifndef APRS_HISTORY_FLASH_PAGES
+#define APRS_HISTORY_FLASH_PAGES  12
+#endif
+
+/**@brief Initialize the flash access.
+ */
+ret_code_t aprs_history_flash_init(void);
+
+/**@brief Get a pointer to the contents of a page.
+ */
+const uint8_t* aprs_history_flash_page(uint8_t page);
+
+/**@brief Start writing to a page.
+ *
+ * @param page    The page to write.
+ * @param offset  Offset in the page, multiple of 4.
+ * @param data    The data to write. Must stay valid until the write is done.
+ * @param len     Number of bytes to write, multiple of 4.
+ */
+ret_code_t aprs_history_flash_write(uint8_t page, uint16_t offset, const void *data, size_t len);
+
+/**@brief Start erasing a page.
+ */
+ret_code_t aprs_history_flash_erase(uint8_t page);
+
+/**@brief Check if a write or erase operation is in progress.
+ */
+bool aprs_history_flash_is_busy(void);
+
+#endif // APRS_HISTORY_FLASH_H
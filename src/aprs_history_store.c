@@ -0,0 +1,724 @@
+/*
+ * vim: noexpandtab
+ *
+ * Copyright (c) 2021-2022 Thomas Kolb <cfr34k-git@tkolb.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+
+#include <crc16.h>
+#include <sdk_macros.h>
+#include <nrf_log.h>
+
+#include "aprs.h"
+#include "time_base.h"
+
+#include "aprs_history_store.h"
+
+#define PAGE_MAGIC  0x31534841UL // "AHS1"
+
+// The sequence number is written first, so a valid magic implies a valid
+// sequence number.
+typedef struct {
+	uint32_t seq;
+	uint32_t magic;
+} page_header_t;
+
+/* A record, followed by data_len bytes of frame data and padding to a multiple
+ * of 4 bytes. */
+typedef struct {
+	uint16_t len;           // of the record including this header, multiple of 4
+	uint16_t crc;           // CRC-16 of the record after this field
+	uint32_t rx_timestamp;
+	float    lat;
+	float    lon;
+	float    alt;
+	int16_t  rssi;          // signal values in units of 0.25 dB
+	int16_t  snr;
+	int16_t  signal_rssi;
+	char     table;
+	char     symbol;
+	uint8_t  data_len;
+	uint8_t  reserved[3];
+} store_record_t;
+
+#define BATCH_MAX_RECORDS   (APRS_HISTORY_STORE_BATCH_SIZE / sizeof(store_record_t))
+
+#if APRS_HISTORY_FLASH_PAGES > 250
+#error "Page numbers are uint8_t and the highest values are reserved."
+#endif
+
+#define PAGE_NONE     0xFF
+#define PAGE_PENDING  0xFE  // the record is in the batch
+#define PAGE_DEFERRED 0xFD  // the batch was full, the record is added later
+
+typedef enum {
+	PAGE_FREE,   // erased
+	PAGE_USED,   // valid header
+	PAGE_DIRTY,  // neither, e.g. after an interrupted erase
+} page_state_t;
+
+typedef enum {
+	OP_NONE,
+	OP_WRITE_HEADER,
+	OP_WRITE_RECORDS,
+	OP_ERASE,
+} store_op_t;
+
+static uint8_t  m_page_state[APRS_HISTORY_FLASH_PAGES];
+static uint32_t m_page_seq[APRS_HISTORY_FLASH_PAGES];
+static uint32_t m_next_seq;
+
+static uint8_t  m_head_page;   // page records are appended to, or PAGE_NONE
+static uint16_t m_head_offset;
+static uint8_t  m_last_page;   // page opened last, pages are opened in turn after it
+static uint8_t  m_gc_page;     // page being collected, or PAGE_NONE
+
+// page with the latest record of each history entry
+static uint8_t  m_entry_page[APRS_RX_HISTORY_SIZE];
+
+static uint32_t m_batch[APRS_HISTORY_STORE_BATCH_SIZE / 4];
+static uint16_t m_batch_len;
+static uint16_t m_batch_owner[BATCH_MAX_RECORDS];
+static uint8_t  m_batch_count;
+static uint16_t m_deferred_count;
+static uint64_t m_batch_time;  // when the oldest pending record was added
+static bool     m_flush_requested;
+
+static page_header_t m_header;
+static store_op_t    m_op;
+static uint8_t       m_op_page;
+static uint16_t      m_op_len;
+static uint8_t       m_op_count;
+
+static aprs_history_store_stats_t m_stats;
+
+
+static int16_t to_quarter_db(float value)
+{
+	return (int16_t)(value * 4.0f + (value < 0.0f ? -0.5f : 0.5f));
+}
+
+
+static bool is_blank(const uint8_t *data, size_t len)
+{
+	const uint32_t *words = (const uint32_t*)data;
+
+	for(size_t i = 0; i < len / 4; i++) {
+		if(words[i] != 0xFFFFFFFFUL) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/**@brief Check the record at the given offset of a page.
+ *
+ * @returns  The record length, 0 at the end of the records or -1 if the record
+ *           is invalid.
+ */
+static int record_check(const uint8_t *page, uint16_t offset)
+{
+	const store_record_t *rec = (const store_record_t*)(page + offset);
+
+	if(offset == APRS_HISTORY_FLASH_PAGE_SIZE || rec->len == 0xFFFF) {
+		return 0;
+	}
+
+	if(rec->len < sizeof(store_record_t)
+			|| (rec->len % 4) != 0
+			|| rec->len > APRS_HISTORY_FLASH_PAGE_SIZE - offset
+			|| rec->data_len > rec->len - sizeof(store_record_t)) {
+		return -1;
+	}
+
+	if(crc16_compute((const uint8_t*)rec + 4, rec->len - 4, NULL) != rec->crc) {
+		return -1;
+	}
+
+	return rec->len;
+}
+
+
+static void replay_record(uint8_t page, const store_record_t *rec)
+{
+	aprs_frame_t frame;
+	aprs_rx_raw_data_t raw;
+
+	memcpy(raw.data, rec + 1, rec->data_len);
+	raw.data_len   = rec->data_len;
+	raw.rssi       = rec->rssi / 4.0f;
+	raw.snr        = rec->snr / 4.0f;
+	raw.signalRssi = rec->signal_rssi / 4.0f;
+
+	if(!aprs_parse_frame(raw.data, raw.data_len, &frame)) {
+		m_stats.records_corrupt++;
+		return;
+	}
+
+	// the position may come from an earlier frame
+	frame.lat    = rec->lat;
+	frame.lon    = rec->lon;
+	frame.alt    = rec->alt;
+	frame.table  = rec->table;
+	frame.symbol = rec->symbol;
+
+	uint16_t idx = aprs_rx_history_insert(&frame, &raw, rec->rx_timestamp, APRS_RX_HISTORY_SIZE);
+
+	if(idx < APRS_RX_HISTORY_SIZE) {
+		m_entry_page[idx] = page;
+	}
+
+	m_stats.records_restored++;
+}
+
+
+/**@brief Replay all valid records of a page.
+ *
+ * @returns  The offset after the last valid record if the rest of the page is
+ *           erased, 0 otherwise.
+ */
+static uint16_t replay_page(uint8_t page)
+{
+	const uint8_t *data = aprs_history_flash_page(page);
+	uint16_t offset = sizeof(page_header_t);
+	int len;
+
+	while((len = record_check(data, offset)) > 0) {
+		replay_record(page, (const store_record_t*)(data + offset));
+		offset += len;
+	}
+
+	if(len < 0) {
+		m_stats.records_corrupt++;
+		return 0;
+	}
+
+	return is_blank(data + offset, APRS_HISTORY_FLASH_PAGE_SIZE - offset) ? offset : 0;
+}
+
+
+static uint8_t count_free_pages(void)
+{
+	uint8_t count = 0;
+
+	for(uint8_t page = 0; page < APRS_HISTORY_FLASH_PAGES; page++) {
+		if(m_page_state[page] == PAGE_FREE) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+
+/**@brief Find the used page with the lowest sequence number, except the head.
+ */
+static uint8_t oldest_page(void)
+{
+	uint8_t oldest = PAGE_NONE;
+
+	for(uint8_t page = 0; page < APRS_HISTORY_FLASH_PAGES; page++) {
+		if(m_page_state[page] == PAGE_USED && page != m_head_page
+				&& (oldest == PAGE_NONE || m_page_seq[page] < m_page_seq[oldest])) {
+			oldest = page;
+		}
+	}
+
+	return oldest;
+}
+
+
+/**@brief Start collecting the oldest page if the spare pages are in use.
+ */
+static void check_spare_pages(void)
+{
+	if(m_gc_page == PAGE_NONE && count_free_pages() < APRS_HISTORY_STORE_SPARE_PAGES) {
+		m_gc_page = oldest_page();
+	}
+}
+
+
+ret_code_t aprs_history_store_init(void)
+{
+	uint8_t order[APRS_HISTORY_FLASH_PAGES];
+	uint8_t num_used = 0;
+
+	VERIFY_SUCCESS(aprs_history_flash_init());
+
+	memset(&m_stats, 0, sizeof(m_stats));
+	memset(m_entry_page, PAGE_NONE, sizeof(m_entry_page));
+
+	m_batch_len = 0;
+	m_batch_count = 0;
+	m_deferred_count = 0;
+	m_flush_requested = false;
+	m_op = OP_NONE;
+	m_head_page = PAGE_NONE;
+	m_gc_page = PAGE_NONE;
+	m_last_page = APRS_HISTORY_FLASH_PAGES - 1;
+	m_next_seq = 1;
+
+	for(uint8_t page = 0; page < APRS_HISTORY_FLASH_PAGES; page++) {
+		const page_header_t *header = (const page_header_t*)aprs_history_flash_page(page);
+
+		if(header->magic == PAGE_MAGIC) {
+			// insert sorted by sequence number
+			uint8_t i = num_used++;
+
+			while(i > 0 && m_page_seq[order[i - 1]] > header->seq) {
+				order[i] = order[i - 1];
+				i--;
+			}
+
+			order[i] = page;
+			m_page_seq[page] = header->seq;
+			m_page_state[page] = PAGE_USED;
+		} else if(is_blank(aprs_history_flash_page(page), APRS_HISTORY_FLASH_PAGE_SIZE)) {
+			m_page_state[page] = PAGE_FREE;
+		} else {
+			m_page_state[page] = PAGE_DIRTY;
+		}
+	}
+
+	for(uint8_t i = 0; i < num_used; i++) {
+		uint16_t end = replay_page(order[i]);
+
+		if(i == num_used - 1) {
+			// continue the newest page, unless a write was interrupted there
+			m_last_page = order[i];
+			m_next_seq = m_page_seq[order[i]] + 1;
+
+			if(end != 0) {
+				m_head_page = order[i];
+				m_head_offset = end;
+			}
+		}
+	}
+
+	check_spare_pages();
+
+	NRF_LOG_INFO("history store: %u records restored, %u corrupt, %u pages used",
+			m_stats.records_restored, m_stats.records_corrupt, num_used);
+
+	return NRF_SUCCESS;
+}
+
+
+/**@brief Remove the pending record of an entry from the batch.
+ * @details
+ * Only the latest state of a station is needed, so a record that was not
+ * written yet is replaced instead of writing both. Records of a write in
+ * progress are kept.
+ */
+static void batch_remove(uint16_t idx)
+{
+	uint8_t first = (m_op == OP_WRITE_RECORDS) ? m_op_count : 0;
+	uint16_t offset = 0;
+
+	for(uint8_t i = 0; i < m_batch_count; i++) {
+		uint16_t len = ((const store_record_t*)((const uint8_t*)m_batch + offset))->len;
+
+		if(i >= first && m_batch_owner[i] == idx) {
+			uint8_t *rec = (uint8_t*)m_batch + offset;
+
+			memmove(rec, rec + len, m_batch_len - offset - len);
+			memmove(m_batch_owner + i, m_batch_owner + i + 1,
+					(m_batch_count - i - 1) * sizeof(m_batch_owner[0]));
+
+			m_batch_len -= len;
+			m_batch_count--;
+			return;
+		}
+
+		offset += len;
+	}
+}
+
+
+/**@brief Append a record of the current state of an entry to the batch.
+ */
+static bool batch_append(uint16_t idx)
+{
+	const aprs_rx_history_entry_t *entry = aprs_rx_history_get(idx);
+	store_record_t *rec = (store_record_t*)((uint8_t*)m_batch + m_batch_len);
+	const uint8_t *data;
+	size_t data_len;
+
+	if(m_entry_page[idx] == PAGE_PENDING) {
+		batch_remove(idx);
+		rec = (store_record_t*)((uint8_t*)m_batch + m_batch_len);
+	}
+
+	data = aprs_rx_history_get_data(entry, &data_len);
+
+	uint16_t len = (sizeof(store_record_t) + data_len + 3) & ~3;
+
+	if(len > APRS_HISTORY_STORE_BATCH_SIZE - m_batch_len || m_batch_count == BATCH_MAX_RECORDS) {
+		return false;
+	}
+
+	rec->len          = len;
+	rec->rx_timestamp = entry->rx_timestamp;
+	rec->lat          = entry->lat;
+	rec->lon          = entry->lon;
+	rec->alt          = entry->alt;
+	rec->rssi         = to_quarter_db(entry->rssi);
+	rec->snr          = to_quarter_db(entry->snr);
+	rec->signal_rssi  = to_quarter_db(entry->signalRssi);
+	rec->table        = entry->table;
+	rec->symbol       = entry->symbol;
+	rec->data_len     = data_len;
+	memset(rec->reserved, 0, sizeof(rec->reserved));
+
+	memcpy(rec + 1, data, data_len);
+	memset((uint8_t*)(rec + 1) + data_len, 0, len - sizeof(store_record_t) - data_len);
+
+	rec->crc = crc16_compute((const uint8_t*)rec + 4, len - 4, NULL);
+
+	if(m_batch_len == 0) {
+		m_batch_time = time_base_get();
+	}
+
+	if(m_entry_page[idx] == PAGE_DEFERRED) {
+		m_deferred_count--;
+	}
+
+	m_batch_len += len;
+	m_batch_owner[m_batch_count++] = idx;
+	m_entry_page[idx] = PAGE_PENDING;
+
+	return true;
+}
+
+
+void aprs_history_store_add(uint16_t idx)
+{
+	const aprs_rx_history_entry_t *entry = aprs_rx_history_get(idx);
+
+	if(!entry || entry->rx_timestamp == 0) {
+		return;
+	}
+
+	if(!batch_append(idx) && m_entry_page[idx] != PAGE_DEFERRED) {
+		m_entry_page[idx] = PAGE_DEFERRED;
+		m_deferred_count++;
+		m_stats.records_deferred++;
+	}
+}
+
+
+/**@brief Add the records of entries that did not fit into the batch before.
+ */
+static void append_deferred(void)
+{
+	for(uint16_t idx = 0; idx < APRS_RX_HISTORY_SIZE && m_deferred_count > 0; idx++) {
+		if(m_entry_page[idx] != PAGE_DEFERRED) {
+			continue;
+		}
+
+		if(aprs_rx_history_get(idx)->rx_timestamp == 0) {
+			m_entry_page[idx] = PAGE_NONE;
+			m_deferred_count--;
+		} else if(!batch_append(idx)) {
+			return;
+		}
+	}
+}
+
+
+void aprs_history_store_flush(void)
+{
+	m_flush_requested = true;
+}
+
+
+/**@brief Copy the latest records of the entries in the page being collected.
+ * @details
+ * Relocated records take at most half of the batch, the rest is left for
+ * received frames.
+ *
+ * @returns  true if all records are in the batch or were written before.
+ */
+static bool gc_relocate(void)
+{
+	for(uint16_t idx = 0; idx < APRS_RX_HISTORY_SIZE; idx++) {
+		if(m_entry_page[idx] != m_gc_page) {
+			continue;
+		}
+
+		if(aprs_rx_history_get(idx)->rx_timestamp == 0) {
+			// replaced in the history since
+			m_entry_page[idx] = PAGE_NONE;
+		} else if(m_batch_len < APRS_HISTORY_STORE_BATCH_SIZE / 2 && batch_append(idx)) {
+			m_stats.records_relocated++;
+		} else {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+static void start_erase(uint8_t page)
+{
+	if(aprs_history_flash_erase(page) == NRF_SUCCESS) {
+		m_op = OP_ERASE;
+		m_op_page = page;
+	}
+}
+
+
+/**@brief Write the header of the next free page.
+ * @details
+ * If all pages are in use, the oldest one is erased without relocating its
+ * records first.
+ */
+static void open_page(void)
+{
+	uint8_t page = PAGE_NONE;
+
+	for(uint8_t i = 1; i <= APRS_HISTORY_FLASH_PAGES; i++) {
+		uint8_t candidate = (m_last_page + i) % APRS_HISTORY_FLASH_PAGES;
+
+		if(m_page_state[candidate] == PAGE_FREE) {
+			page = candidate;
+			break;
+		}
+	}
+
+	if(page == PAGE_NONE) {
+		page = oldest_page();
+
+		if(page == PAGE_NONE) {
+			return;
+		}
+
+		for(uint16_t idx = 0; idx < APRS_RX_HISTORY_SIZE; idx++) {
+			if(m_entry_page[idx] == page) {
+				m_entry_page[idx] = PAGE_NONE;
+				m_stats.records_dropped++;
+			}
+		}
+
+		if(m_gc_page == page) {
+			m_gc_page = PAGE_NONE;
+		}
+
+		NRF_LOG_WARNING("history store: log full, dropping page %u", page);
+		start_erase(page);
+		return;
+	}
+
+	m_header.seq = m_next_seq;
+	m_header.magic = PAGE_MAGIC;
+
+	if(aprs_history_flash_write(page, 0, &m_header, sizeof(m_header)) == NRF_SUCCESS) {
+		m_op = OP_WRITE_HEADER;
+		m_op_page = page;
+	}
+}
+
+
+/**@brief Write as many records of the batch as fit into the head page.
+ */
+static void start_write(void)
+{
+	uint16_t len = 0;
+	uint8_t count = 0;
+
+	if(m_head_page != PAGE_NONE) {
+		while(len < m_batch_len) {
+			uint16_t rec_len = ((const store_record_t*)((const uint8_t*)m_batch + len))->len;
+
+			if(rec_len > APRS_HISTORY_FLASH_PAGE_SIZE - m_head_offset - len) {
+				break;
+			}
+
+			len += rec_len;
+			count++;
+		}
+	}
+
+	if(count == 0) {
+		m_head_page = PAGE_NONE;
+		open_page();
+		return;
+	}
+
+	if(aprs_history_flash_write(m_head_page, m_head_offset, m_batch, len) == NRF_SUCCESS) {
+		m_op = OP_WRITE_RECORDS;
+		m_op_page = m_head_page;
+		m_op_len = len;
+		m_op_count = count;
+	}
+}
+
+
+static void write_records_done(void)
+{
+	const uint8_t *written = aprs_history_flash_page(m_op_page) + m_head_offset;
+
+	m_stats.flash_writes++;
+
+	if(memcmp(written, m_batch, m_op_len) != 0) {
+		// keep the records and continue on a new page
+		NRF_LOG_ERROR("history store: verification failed on page %u", m_op_page);
+		m_head_page = PAGE_NONE;
+		return;
+	}
+
+	for(uint8_t i = 0; i < m_op_count; i++) {
+		uint16_t owner = m_batch_owner[i];
+		bool superseded = false;
+
+		for(uint8_t j = i + 1; j < m_batch_count; j++) {
+			if(m_batch_owner[j] == owner) {
+				superseded = true;
+				break;
+			}
+		}
+
+		// a deferred entry has a newer state than this record
+		if(!superseded && m_entry_page[owner] == PAGE_PENDING) {
+			m_entry_page[owner] = m_op_page;
+		}
+	}
+
+	m_head_offset += m_op_len;
+	m_batch_len -= m_op_len;
+	m_batch_count -= m_op_count;
+
+	memmove(m_batch, (const uint8_t*)m_batch + m_op_len, m_batch_len);
+	memmove(m_batch_owner, m_batch_owner + m_op_count, m_batch_count * sizeof(m_batch_owner[0]));
+
+	m_stats.records_written += m_op_count;
+	m_stats.bytes_written += m_op_len;
+
+	if(APRS_HISTORY_FLASH_PAGE_SIZE - m_head_offset < sizeof(store_record_t)) {
+		m_head_page = PAGE_NONE;
+	}
+}
+
+
+static void op_done(void)
+{
+	switch(m_op) {
+		case OP_WRITE_HEADER:
+			m_stats.flash_writes++;
+			m_stats.bytes_written += sizeof(page_header_t);
+
+			m_page_state[m_op_page] = PAGE_USED;
+			m_page_seq[m_op_page] = m_header.seq;
+			m_next_seq++;
+
+			m_head_page = m_op_page;
+			m_head_offset = sizeof(page_header_t);
+			m_last_page = m_op_page;
+
+			check_spare_pages();
+			break;
+
+		case OP_WRITE_RECORDS:
+			write_records_done();
+			break;
+
+		case OP_ERASE:
+			m_stats.pages_erased++;
+			m_page_state[m_op_page] = PAGE_FREE;
+			break;
+
+		case OP_NONE:
+			break;
+	}
+
+	m_op = OP_NONE;
+}
+
+
+void aprs_history_store_loop(void)
+{
+	if(m_op != OP_NONE) {
+		if(aprs_history_flash_is_busy()) {
+			return;
+		}
+
+		op_done();
+	}
+
+	// pages found after an interrupted erase
+	for(uint8_t page = 0; page < APRS_HISTORY_FLASH_PAGES; page++) {
+		if(m_page_state[page] == PAGE_DIRTY) {
+			start_erase(page);
+			return;
+		}
+	}
+
+	if(m_gc_page != PAGE_NONE) {
+		// the page is erased only after the relocated records were written
+		if(gc_relocate() && m_batch_len == 0) {
+			uint8_t page = m_gc_page;
+
+			m_gc_page = PAGE_NONE;
+			start_erase(page);
+			return;
+		}
+	}
+
+	if(m_deferred_count > 0) {
+		append_deferred();
+	}
+
+	if(m_batch_len == 0) {
+		m_flush_requested = false;
+	} else if(m_flush_requested
+			|| m_gc_page != PAGE_NONE
+			|| m_deferred_count > 0
+			|| m_batch_len >= APRS_HISTORY_STORE_WRITE_THRESHOLD
+			|| time_base_get() - m_batch_time >= APRS_HISTORY_STORE_MAX_DELAY_MS) {
+		start_write();
+	}
+}
+
+
+bool aprs_history_store_is_busy(void)
+{
+	if(m_op != OP_NONE || m_batch_len > 0 || m_gc_page != PAGE_NONE || m_deferred_count > 0) {
+		return true;
+	}
+
+	for(uint8_t page = 0; page < APRS_HISTORY_FLASH_PAGES; page++) {
+		if(m_page_state[page] == PAGE_DIRTY) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+const aprs_history_store_stats_t* aprs_history_store_get_stats(void)
+{
+	return &m_stats;
+}
@@ -0,0 +1,119 @@
+/*
+ * vim: noexpandtab
+ *
+ * Copyright (c) 2021-2022 Thomas Kolb <cfr34k-git@tkolb.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef APRS_HISTORY_STORE_H
+#define APRS_HISTORY_STORE_H
+
+/**@file
+ *
+ * @brief Persistent RX history.
+ *
+ * @details
+ * The state of the stations in the RX history is appended to a log in flash
+ * (see aprs_history_flash.h), so the history survives a reset. Each record
+ * holds the received frame, its signal data and the position and symbol of the
+ * station (which may come from an earlier frame), protected by a CRC.
+ *
+ * Records are collected in RAM and written in batches: when
+ * APRS_HISTORY_STORE_WRITE_THRESHOLD bytes are pending, when the oldest
+ * pending record is APRS_HISTORY_STORE_MAX_DELAY_MS old or when a flush is
+ * requested. Signal updates of duplicate frames are not recorded.
+ *
+ * Each page starts with a header containing a sequence number. Pages are
+ * filled in turn. When fewer than APRS_HISTORY_STORE_SPARE_PAGES erased pages
+ * are left, the latest records of the stations still in the history are
+ * copied from the oldest page to the newest one and the oldest page is erased.
+ * So all pages wear evenly, and the log holds at least the latest state of
+ * every station in the history as long as that fits into the pages that are
+ * not spare.
+ *
+ * On boot, the pages are replayed in the order of their sequence numbers in a
+ * single pass. Since later records replace earlier ones in the history, this
+ * restores the latest state of each station. A record that was not written
+ * completely (because of a reset during the write) fails the CRC check and
+ * ends the page. Pages with an interrupted erase are erased again.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "aprs_history_flash.h"
+
+#define APRS_HISTORY_STORE_BATCH_SIZE       1024
+#define APRS_HISTORY_STORE_WRITE_THRESHOLD  512
+#define APRS_HISTORY_STORE_MAX_DELAY_MS     (15 * 60 * 1000)
+#define APRS_HISTORY_STORE_SPARE_PAGES      2
+
+#if APRS_HISTORY_FLASH_PAGES < APRS_HISTORY_STORE_SPARE_PAGES + 2
+#error "The history store needs at least two pages in addition to the spare pages."
+#endif
+
+typedef struct {
+	uint32_t records_restored;
+	uint32_t records_corrupt;    // records that failed the check at restore
+	uint32_t records_written;
+	uint32_t records_relocated;  // copied from the oldest page before its erase
+	uint32_t records_deferred;   // added later because the batch was full
+	uint32_t records_dropped;    // lost because the log was full
+	uint32_t flash_writes;       // write operations, including page headers
+	uint32_t bytes_written;
+	uint32_t pages_erased;
+} aprs_history_store_stats_t;
+
+/**@brief Initialize the store and restore the RX history from it.
+ * @details
+ * Must be called after aprs_init(). The restored entries are inserted with
+ * aprs_rx_history_insert(), so stations already in the history are updated.
+ *
+ * @returns  The result of the flash initialization.
+ */
+ret_code_t aprs_history_store_init(void);
+
+/**@brief Record the current state of a history entry.
+ * @details
+ * Call this after aprs_rx_history_insert(). Unused entries are ignored.
+ *
+ * @param idx  The index returned by aprs_rx_history_insert().
+ */
+void aprs_history_store_add(uint16_t idx);
+
+/**@brief Write all pending records as soon as possible.
+ */
+void aprs_history_store_flush(void);
+
+/**@brief Start the next flash operation if one is due.
+ * @details
+ * Call this regularly from the main loop.
+ */
+void aprs_history_store_loop(void);
+
+/**@brief Check if records are pending or a flash operation is in progress.
+ */
+bool aprs_history_store_is_busy(void);
+
+const aprs_history_store_stats_t* aprs_history_store_get_stats(void);
+
+#endif // APRS_HISTORY_STORE_H
@@ -59,6 +59,10 @@ static void on_write(aprs_service_t * p_srv, ble_evt_t const * p_ble_evt)
 	{
 		p_srv->callback(APRS_SERVICE_EVT_SYMBOL_CHANGED);
 	}
+	else if (p_evt_write->handle == p_srv->smartbeacon_char_handles.value_handle)
+	{
+		p_srv->callback(APRS_SERVICE_EVT_SMARTBEACON_CHANGED);
+	}
 }
 
 /**@brief Handle BLE events.
@@ -203,6 +207,26 @@ uint32_t aprs_service_init(aprs_service_t * p_srv, const aprs_service_init_t * p
 	err_code = characteristic_add(p_srv->service_handle, &add_char_params, &p_srv->rx_message_char_handles);
 	VERIFY_SUCCESS(err_code);
 
+	/* Add SmartBeaconing characteristic. */
+	memset(&add_char_params, 0, sizeof(add_char_params));
+	add_char_params.uuid              = APRS_SERVICE_UUID_SMARTBEACON;
+	add_char_params.uuid_type         = p_srv->uuid_type;
+	add_char_params.init_len          = sizeof(tracker_smartbeacon_t);
+	add_char_params.max_len           = sizeof(tracker_smartbeacon_t);
+	add_char_params.is_var_len        = 0;
+	add_char_params.p_init_value      = (uint8_t*)tracker_get_smartbeacon();
+	add_char_params.char_props.read   = 1;
+	add_char_params.char_props.write  = 1;
+
+	add_char_params.read_access       = SEC_OPEN;
+	add_char_params.write_access      = SEC_MITM;
+
+	fill_user_desc(&add_user_desc, "SmartBeaconing");
+	add_char_params.p_user_descr = &add_user_desc;
+
+	err_code = characteristic_add(p_srv->service_handle, &add_char_params, &p_srv->smartbeacon_char_handles);
+	VERIFY_SUCCESS(err_code);
+
 	return err_code;
 }
 
@@ -276,6 +300,22 @@ ret_code_t aprs_service_get_symbol(aprs_service_t * p_srv, char *p_table, char *
 }
 
 
+ret_code_t aprs_service_set_smartbeacon(aprs_service_t * p_srv, const tracker_smartbeacon_t *p_params)
+{
+	ble_gatts_value_t value = {sizeof(tracker_smartbeacon_t), 0, (uint8_t*)p_params};
+
+	return sd_ble_gatts_value_set(BLE_CONN_HANDLE_INVALID, p_srv->smartbeacon_char_handles.value_handle, &value);
+}
+
+
+ret_code_t aprs_service_get_smartbeacon(aprs_service_t * p_srv, tracker_smartbeacon_t *p_params)
+{
+	ble_gatts_value_t value = {sizeof(tracker_smartbeacon_t), 0, (uint8_t*)p_params};
+
+	return sd_ble_gatts_value_get(BLE_CONN_HANDLE_INVALID, p_srv->smartbeacon_char_handles.value_handle, &value);
+}
+
+
 ret_code_t aprs_service_notify_rx_message(aprs_service_t * p_srv, uint16_t conn_handle, uint8_t *p_message, uint8_t message_len)
 {
 
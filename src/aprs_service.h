@@ -45,6 +45,8 @@
 #include "nrf_sdh_ble.h"
 #include "nrf_saadc.h"
 
+#include "tracker.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -67,6 +69,7 @@ NRF_SDH_BLE_OBSERVER(_name ## _obs,
 #define APRS_SERVICE_UUID_COMMENT            0x0102      // Comment
 #define APRS_SERVICE_UUID_SYMBOL             0x0103      // Symbol code
 #define APRS_SERVICE_UUID_RX_MESSAGE         0x0104      // The last received message
+#define APRS_SERVICE_UUID_SMARTBEACON        0x0105      // SmartBeaconing parameters (tracker_smartbeacon_t)
 
 // Forward declaration of the aprs_service_t type.
 typedef struct aprs_service_s aprs_service_t;
@@ -75,6 +78,7 @@ typedef enum {
 	APRS_SERVICE_EVT_MYCALL_CHANGED,
 	APRS_SERVICE_EVT_COMMENT_CHANGED,
 	APRS_SERVICE_EVT_SYMBOL_CHANGED,
+	APRS_SERVICE_EVT_SMARTBEACON_CHANGED,
 } aprs_service_evt_t;
 
 /**@brief Callback function type.
@@ -98,6 +102,7 @@ struct aprs_service_s
 	ble_gatts_char_handles_t    comment_char_handles;         /**< Handles related to the Comment Characteristic. */
 	ble_gatts_char_handles_t    symbol_char_handles;          /**< Handles related to the Symbol Characteristic. */
 	ble_gatts_char_handles_t    rx_message_char_handles;      /**< Handles related to the RX Message Characteristic. */
+	ble_gatts_char_handles_t    smartbeacon_char_handles;     /**< Handles related to the SmartBeaconing Characteristic. */
 	uint8_t                     uuid_type;                    /**< UUID type for the APRS Service. */
 	aprs_service_callback_t     callback;                     /**< Pointer to the callback function. */
 };
@@ -193,6 +198,26 @@ ret_code_t aprs_service_set_symbol(aprs_service_t * p_srv, char table, char symb
 ret_code_t aprs_service_get_symbol(aprs_service_t * p_srv, char *p_table, char *p_symbol);
 
 
+/**@brief Set the current SmartBeaconing parameters.
+ *
+ * @param[in]  p_srv       Service structure (as returned by aprs_service_init()).
+ * @param[in]  p_params    The parameters.
+ * @returns                The result code from the BLE stack.
+ */
+ret_code_t aprs_service_set_smartbeacon(aprs_service_t * p_srv, const tracker_smartbeacon_t *p_params);
+
+
+/**@brief Get the SmartBeaconing parameters written by the client.
+ *
+ * The parameters are not checked, see tracker_set_smartbeacon().
+ *
+ * @param[in]  p_srv       Service structure (as returned by aprs_service_init()).
+ * @param[out] p_params    Receives the parameters.
+ * @returns                The result code from the BLE stack.
+ */
+ret_code_t aprs_service_get_smartbeacon(aprs_service_t * p_srv, tracker_smartbeacon_t *p_params);
+
+
 /**@brief Set the received message and send a notification.
  *
  * @param[in]  p_srv       Service structure (as returned by aprs_service_init()).
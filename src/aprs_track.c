@@ -0,0 +1,416 @@
+/*
+ * vim: noexpandtab
+ *
+ * Copyright (c) 2021-2022 Thomas Kolb <cfr34k-git@tkolb.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+#include <math.h>
+
+#include "aprs.h"
+#include "aprs_track.h"
+#include "utils.h"
+
+#define TRACK_NONE           0xFFFF
+#define TRACK_UNITS_PER_DEG  100000
+
+// maximum length of a delta: 5 bytes of time, 4 bytes each of latitude and
+// longitude (differences of less than 2^27 units after zig-zag encoding)
+#define TRACK_MAX_DELTA_LEN  13
+
+#if (APRS_TRACK_MAX_POINTS - 1) * TRACK_MAX_DELTA_LEN > 255
+#error "The deltas of a track must fit into 255 bytes, reduce APRS_TRACK_MAX_POINTS."
+#endif
+
+/* A track in the pool. The deltas to the older points follow the header,
+ * newest first. */
+typedef struct {
+	uint16_t owner;       // history index or TRACK_NONE if unused
+	uint16_t len;         // including the header, multiple of 4
+	int32_t  lat;         // newest point in 1e-5 degrees
+	int32_t  lon;         // newest point in 1e-5 degrees, -180° to below 180°
+	uint32_t time_lo;     // newest point, split to keep the 4-byte alignment
+	uint32_t time_hi;
+	float    speed;       // in m/s, negative if unknown
+	float    course;      // in degrees, negative if unknown
+	uint8_t  num_points;
+	uint8_t  deltas_len;
+} track_t;
+
+static uint32_t m_track_pool[APRS_TRACK_POOL_SIZE / 4];
+static uint16_t m_track_pool_head;  // end of the written part of the pool
+static uint16_t m_track_pool_tail;  // all tracks before this one are unused
+
+static uint16_t m_track_offset[APRS_RX_HISTORY_SIZE];
+
+// a track is built here before it is written to the pool
+static uint32_t m_track_buf[(sizeof(track_t) + 255 + 3) / 4];
+
+static aprs_track_stats_t m_stats;
+
+
+static track_t* track_at(uint16_t offset)
+{
+	return (track_t*)((uint8_t*)m_track_pool + offset);
+}
+
+
+static uint8_t* track_deltas(track_t *track)
+{
+	return (uint8_t*)(track + 1);
+}
+
+
+static uint64_t track_time(const track_t *track)
+{
+	return ((uint64_t)track->time_hi << 32) | track->time_lo;
+}
+
+
+static uint32_t zigzag_encode(int32_t v)
+{
+	return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+
+static int32_t zigzag_decode(uint32_t v)
+{
+	return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+
+static uint8_t* varint_put(uint8_t *p, uint32_t v)
+{
+	while(v >= 0x80) {
+		*p++ = (uint8_t)v | 0x80;
+		v >>= 7;
+	}
+
+	*p++ = (uint8_t)v;
+	return p;
+}
+
+
+static const uint8_t* varint_get(const uint8_t *p, uint32_t *v)
+{
+	uint32_t result = 0;
+	uint8_t shift = 0;
+
+	do {
+		result |= (uint32_t)(*p & 0x7F) << shift;
+		shift += 7;
+	} while(*p++ & 0x80);
+
+	*v = result;
+	return p;
+}
+
+
+/**@brief Convert degrees to track units, in double precision since a float
+ * cannot hold 1e-5° resolution at 180°.
+ */
+static int32_t track_quantize(float deg)
+{
+	return (int32_t)lround((double)deg * TRACK_UNITS_PER_DEG);
+}
+
+
+static float track_degrees(int32_t units)
+{
+	return (float)((double)units / TRACK_UNITS_PER_DEG);
+}
+
+
+/**@brief Wrap a longitude or a difference of longitudes to -180° to below 180°.
+ */
+static int32_t track_wrap_lon(int32_t lon)
+{
+	if(lon >= 180 * TRACK_UNITS_PER_DEG) {
+		lon -= 360 * TRACK_UNITS_PER_DEG;
+	} else if(lon < -180 * TRACK_UNITS_PER_DEG) {
+		lon += 360 * TRACK_UNITS_PER_DEG;
+	}
+
+	return lon;
+}
+
+
+/**@brief Skip the given number of deltas.
+ */
+static const uint8_t* track_skip_deltas(const uint8_t *p, uint8_t count)
+{
+	for(uint8_t i = 0; i < count * 3; i++) {
+		while(*p++ & 0x80) {
+		}
+	}
+
+	return p;
+}
+
+
+/**@brief Derive speed and course of a new track from its two newest points.
+ */
+static void track_motion(track_t *track, const track_t *prev, uint32_t dt)
+{
+	if(dt == 0) {
+		// same reception time, keep what is known
+		track->speed = prev->speed;
+		track->course = prev->course;
+		return;
+	}
+
+	if(dt > APRS_TRACK_MAX_INTERVAL_S) {
+		return;
+	}
+
+	float lat1 = track_degrees(prev->lat);
+	float lon1 = track_degrees(prev->lon);
+	float lat2 = track_degrees(track->lat);
+	float lon2 = track_degrees(track->lon);
+	float distance = great_circle_distance_m(lat1, lon1, lat2, lon2);
+
+	track->speed = distance / (float)dt;
+
+	if(distance >= APRS_TRACK_MIN_MOVE_M) {
+		track->course = direction_angle(lat1, lon1, lat2, lon2);
+	}
+}
+
+
+/**@brief Mark a track as unused.
+ * @details
+ * The space is reclaimed by the next compaction of the pool.
+ */
+static void track_free(uint16_t offset)
+{
+	track_t *track = track_at(offset);
+
+	m_track_offset[track->owner] = TRACK_NONE;
+	m_stats.num_tracks--;
+	m_stats.num_points -= track->num_points;
+	m_stats.pool_used -= track->len;
+
+	track->owner = TRACK_NONE;
+}
+
+
+/**@brief Move all used tracks to the start of the pool.
+ * @details
+ * The tracks keep their order, so this is a single pass over the pool.
+ */
+static void track_pool_compact(void)
+{
+	uint16_t src = 0;
+	uint16_t dst = 0;
+
+	while(src < m_track_pool_head) {
+		uint16_t len = track_at(src)->len;
+
+		if(track_at(src)->owner != TRACK_NONE) {
+			if(dst != src) {
+				memmove(track_at(dst), track_at(src), len);
+				m_track_offset[track_at(dst)->owner] = dst;
+			}
+
+			dst += len;
+		}
+
+		src += len;
+	}
+
+	m_track_pool_head = dst;
+	m_track_pool_tail = 0;
+	m_stats.compactions++;
+}
+
+
+/**@brief Write a track to the pool.
+ * @details
+ * The least recently updated tracks are dropped until the track fits. If the
+ * free space is fragmented, the pool is compacted.
+ */
+static uint16_t track_write(uint16_t idx, const track_t *track)
+{
+	uint16_t offset;
+
+	// cannot fail: the pool holds at least two tracks of maximum length
+	while(APRS_TRACK_POOL_SIZE - m_stats.pool_used < track->len) {
+		while(track_at(m_track_pool_tail)->owner == TRACK_NONE) {
+			m_track_pool_tail += track_at(m_track_pool_tail)->len;
+		}
+
+		track_free(m_track_pool_tail);
+		m_stats.evictions++;
+	}
+
+	if(APRS_TRACK_POOL_SIZE - m_track_pool_head < track->len) {
+		track_pool_compact();
+	}
+
+	offset = m_track_pool_head;
+	m_track_pool_head += track->len;
+
+	memcpy(track_at(offset), track, track->len);
+	track_at(offset)->owner = idx;
+
+	m_track_offset[idx] = offset;
+	m_stats.num_tracks++;
+	m_stats.num_points += track->num_points;
+	m_stats.pool_used += track->len;
+
+	return offset;
+}
+
+
+void aprs_track_init(void)
+{
+	memset(m_track_offset, 0xFF, sizeof(m_track_offset));
+	memset(&m_stats, 0, sizeof(m_stats));
+
+	m_track_pool_head = 0;
+	m_track_pool_tail = 0;
+}
+
+
+void aprs_track_add(uint16_t idx, float lat, float lon, uint64_t timestamp)
+{
+	track_t *track = (track_t*)m_track_buf;
+	uint8_t *deltas = track_deltas(track);
+
+	if(idx >= APRS_RX_HISTORY_SIZE) {
+		return;
+	}
+
+	track->lat = track_quantize(lat);
+	track->lon = track_wrap_lon(track_quantize(lon));
+	track->time_lo = (uint32_t)timestamp;
+	track->time_hi = (uint32_t)(timestamp >> 32);
+	track->speed = -1.0f;
+	track->course = -1.0f;
+	track->num_points = 1;
+	track->deltas_len = 0;
+
+	if(m_track_offset[idx] != TRACK_NONE) {
+		track_t *prev = track_at(m_track_offset[idx]);
+		uint64_t prev_time = track_time(prev);
+
+		if(timestamp >= prev_time && timestamp - prev_time <= UINT32_MAX) {
+			uint32_t dt = timestamp - prev_time;
+			uint8_t *p = deltas;
+			uint8_t num_points = prev->num_points;
+			uint8_t keep_len = prev->deltas_len;
+
+			p = varint_put(p, dt);
+			p = varint_put(p, zigzag_encode(prev->lat - track->lat));
+			p = varint_put(p, zigzag_encode(track_wrap_lon(prev->lon - track->lon)));
+
+			// the older deltas stay valid, the oldest point is dropped if
+			// the track is full
+			if(num_points == APRS_TRACK_MAX_POINTS) {
+				num_points--;
+				keep_len = track_skip_deltas(track_deltas(prev), num_points - 1) - track_deltas(prev);
+			}
+
+			memcpy(p, track_deltas(prev), keep_len);
+
+			track->num_points = num_points + 1;
+			track->deltas_len = (p - deltas) + keep_len;
+
+			track_motion(track, prev, dt);
+		}
+
+		track_free(m_track_offset[idx]);
+	}
+
+	track->len = (sizeof(track_t) + track->deltas_len + 3) & ~3;
+
+	track_write(idx, track);
+}
+
+
+void aprs_track_remove(uint16_t idx)
+{
+	if(idx < APRS_RX_HISTORY_SIZE && m_track_offset[idx] != TRACK_NONE) {
+		track_free(m_track_offset[idx]);
+	}
+}
+
+
+uint16_t aprs_track_get(uint16_t idx, aprs_track_point_t *points, uint16_t max)
+{
+	if(idx >= APRS_RX_HISTORY_SIZE || m_track_offset[idx] == TRACK_NONE || max == 0) {
+		return 0;
+	}
+
+	track_t *track = track_at(m_track_offset[idx]);
+	const uint8_t *p = track_deltas(track);
+	uint64_t timestamp = track_time(track);
+	int32_t lat = track->lat;
+	int32_t lon = track->lon;
+	uint16_t n = 0;
+
+	while(true) {
+		points[n].timestamp = timestamp;
+		points[n].lat = track_degrees(lat);
+		points[n].lon = track_degrees(lon);
+		n++;
+
+		if(n == track->num_points || n == max) {
+			break;
+		}
+
+		uint32_t dt, dlat, dlon;
+
+		p = varint_get(p, &dt);
+		p = varint_get(p, &dlat);
+		p = varint_get(p, &dlon);
+
+		timestamp -= dt;
+		lat += zigzag_decode(dlat);
+		lon = track_wrap_lon(lon + zigzag_decode(dlon));
+	}
+
+	return n;
+}
+
+
+bool aprs_track_get_motion(uint16_t idx, float *speed, float *course)
+{
+	if(idx >= APRS_RX_HISTORY_SIZE || m_track_offset[idx] == TRACK_NONE) {
+		return false;
+	}
+
+	track_t *track = track_at(m_track_offset[idx]);
+
+	if(track->speed < 0.0f) {
+		return false;
+	}
+
+	*speed = track->speed;
+	*course = track->course;
+	return true;
+}
+
+
+const aprs_track_stats_t* aprs_track_get_stats(void)
+{
+	return &m_stats;
+}
@@ -0,0 +1,142 @@
+/*
+ * vim: noexpandtab
+ *
+ * Copyright (c) 2021-2022 Thomas Kolb <cfr34k-git@tkolb.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef APRS_TRACK_H
+#define APRS_TRACK_H
+
+/**@file
+ *
+ * @brief Recent positions of the stations in the RX history.
+ *
+ * @details
+ * For each station, the last APRS_TRACK_MAX_POINTS positions and their
+ * reception times are kept. The newest point is stored as is, each older one
+ * as the difference to the next newer point: time in seconds, latitude and
+ * longitude in units of 1e-5° (about 1.1 m), encoded as zig-zag varints. A
+ * point of a moving station usually takes 4 to 6 bytes.
+ *
+ * The tracks of all stations share a pool of APRS_TRACK_POOL_SIZE bytes. A
+ * track is rewritten at the end of the pool on every update, so the pool is
+ * ordered by the time of the last update. If a track does not fit, the least
+ * recently updated tracks are dropped.
+ *
+ * Speed and course are derived from the two newest points when a point is
+ * added, so they are known for stations that do not send them.
+ *
+ * Stations are identified by their index in the RX history. The history adds
+ * the points and removes the tracks of stations it drops (see aprs.h).
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef APRS_TRACK_MAX_POINTS
+#define APRS_TRACK_MAX_POINTS 16
+#endif
+
+#ifndef APRS_TRACK_POOL_SIZE
+#define APRS_TRACK_POOL_SIZE 4096
+#endif
+
+// The course is only derived from points at least this far apart.
+#define APRS_TRACK_MIN_MOVE_M 20.0f
+
+// Speed and course are not derived from points further apart in time.
+#define APRS_TRACK_MAX_INTERVAL_S (30 * 60)
+
+#if APRS_TRACK_MAX_POINTS < 2
+#error "A track holds at least two points."
+#endif
+
+#if APRS_TRACK_POOL_SIZE > 65532 || (APRS_TRACK_POOL_SIZE % 4) != 0
+#error "Pool offsets are uint16_t and tracks are 4-byte aligned."
+#endif
+
+#if APRS_TRACK_POOL_SIZE < 1024
+#error "The pool must hold at least two tracks of maximum length."
+#endif
+
+typedef struct {
+	uint64_t timestamp; // reception time, see aprs_rx_history_entry_t
+	float    lat;       // in degrees
+	float    lon;       // in degrees
+} aprs_track_point_t;
+
+typedef struct {
+	uint16_t num_tracks;
+	uint16_t pool_used;    // bytes of the pool used by current tracks
+	uint32_t num_points;   // points in all current tracks
+	uint32_t evictions;    // tracks dropped to make room in the pool
+	uint32_t compactions;
+} aprs_track_stats_t;
+
+/**@brief Remove all tracks and clear the statistics.
+ */
+void aprs_track_init(void);
+
+/**@brief Add a position to the track of a station.
+ * @details
+ * Starts a new track if the station has none. The oldest point is dropped if
+ * the track is full. If the time goes backwards, the track is restarted.
+ *
+ * @param idx        Index of the station in the RX history.
+ * @param lat, lon   The position in degrees.
+ * @param timestamp  Reception time in seconds.
+ */
+void aprs_track_add(uint16_t idx, float lat, float lon, uint64_t timestamp);
+
+/**@brief Remove the track of a station.
+ */
+void aprs_track_remove(uint16_t idx);
+
+/**@brief Get the points of a track, newest first.
+ * @details
+ * The positions are rounded to 1e-5°. Longitudes of 180° may be returned
+ * as -180°.
+ *
+ * @param idx          Index of the station in the RX history.
+ * @param[out] points  Receives up to max points.
+ * @param max          Size of the array.
+ * @returns            The number of points returned.
+ */
+uint16_t aprs_track_get(uint16_t idx, aprs_track_point_t *points, uint16_t max);
+
+/**@brief Get the speed and course derived from the two newest points.
+ *
+ * @param idx          Index of the station in the RX history.
+ * @param[out] speed   Receives the speed in m/s.
+ * @param[out] course  Receives the course in degrees from north, or a negative
+ *                     value if the station moved less than
+ *                     APRS_TRACK_MIN_MOVE_M.
+ * @returns            false if the track has only one point or its two
+ *                     newest points are more than APRS_TRACK_MAX_INTERVAL_S
+ *                     apart.
+ */
+bool aprs_track_get_motion(uint16_t idx, float *speed, float *course);
+
+const aprs_track_stats_t* aprs_track_get_stats(void);
+
+#endif // APRS_TRACK_H
@@ -0,0 +1,485 @@
+/*
+ * vim: noexpandtab
+ *
+ * Copyright (c) 2021-2022 Thomas Kolb <cfr34k-git@tkolb.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdint.h>
+#include <string.h>
+
+#include <nrf_log.h>
+#include <sdk_macros.h>
+
+#include "casic.h"
+
+// payload lengths of the supported messages
+#define NAV_PV_LEN         80
+#define NAV_DOP_LEN        28
+#define NAV_TIMEUTC_LEN    24
+#define NAV_SATINFO_LEN     8   // header only, 12 bytes per satellite follow
+#define NAV_SATINFO_SV_LEN 12
+
+// fields of a satellite block in NAV-GPSINFO/BDSINFO/GLNINFO: chn, svid, flags,
+// quI, cn0, elev (S1), azim (S2), prRes (R4)
+#define NAV_SATINFO_SV_ID   1
+#define NAV_SATINFO_SV_CN0  4
+
+// values of the posValid and velValid fields in NAV-PV
+#define PV_VALID_2D         6
+#define PV_VALID_3D         7
+#define PV_VALID_GNSS_DR    8
+
+
+static uint16_t get_u16(const uint8_t *p)
+{
+	return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8)
+		| ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static float get_f32(const uint8_t *p)
+{
+	uint32_t raw = get_u32(p);
+	float f;
+
+	memcpy(&f, &raw, sizeof(f));
+	return f;
+}
+
+static double get_f64(const uint8_t *p)
+{
+	uint64_t raw = (uint64_t)get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+	double d;
+
+	memcpy(&d, &raw, sizeof(d));
+	return d;
+}
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+	p[0] = v & 0xFF;
+	p[1] = (v >> 8) & 0xFF;
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+	p[0] = v & 0xFF;
+	p[1] = (v >> 8) & 0xFF;
+	p[2] = (v >> 16) & 0xFF;
+	p[3] = (v >> 24) & 0xFF;
+}
+
+/**@brief Calculate the frame checksum.
+ * @details
+ * len is the payload length of the frame. The words of the first payload_len
+ * bytes are added, the caller adds the rest if the payload is not complete.
+ * Both lengths must be multiples of 4.
+ */
+static uint32_t calc_checksum(uint8_t cls, uint8_t id, uint16_t len,
+		const uint8_t *payload, uint16_t payload_len)
+{
+	uint32_t checksum = ((uint32_t)id << 24) + ((uint32_t)cls << 16) + len;
+
+	for(uint16_t i = 0; i < payload_len; i += 4) {
+		checksum += get_u32(payload + i);
+	}
+
+	return checksum;
+}
+
+/**@brief Number of payload bytes stored in the frame.
+ */
+static uint16_t stored_len(const casic_frame_t *frame)
+{
+	return (frame->len < CASIC_MAX_PAYLOAD_LEN) ? frame->len : CASIC_MAX_PAYLOAD_LEN;
+}
+
+/**@brief Convert degrees to 1e-7 degrees with rounding.
+ */
+static int32_t deg_to_e7(double deg)
+{
+	double scaled = deg * 1e7;
+
+	return (int32_t)(scaled >= 0 ? scaled + 0.5 : scaled - 0.5);
+}
+
+
+void casic_frame_init(casic_frame_t *frame)
+{
+	frame->received = 0;
+	frame->valid    = false;
+}
+
+
+casic_frame_status_t casic_frame_append(casic_frame_t *frame,
+		const uint8_t *data, size_t len, size_t *consumed)
+{
+	size_t i = 0;
+
+	while(i < len) {
+		uint16_t pos = frame->received;
+
+		if(pos >= 6 && pos < 6 + stored_len(frame)) {
+			// payload: copy as much as possible at once
+			size_t chunk = (6 + stored_len(frame)) - pos;
+			if(chunk > len - i) {
+				chunk = len - i;
+			}
+
+			memcpy(frame->payload + (pos - 6), data + i, chunk);
+
+			i += chunk;
+			frame->received += chunk;
+			continue;
+		}
+
+		if(pos >= 6 && pos < 6 + frame->len) {
+			// payload that does not fit: only added to the checksum
+			frame->checksum_skipped += (uint32_t)data[i] << (8 * ((pos - 6) & 0x03));
+			frame->received++;
+			i++;
+			continue;
+		}
+
+		uint8_t c = data[i];
+
+		switch(pos) {
+			case 0:
+				if(c != CASIC_SYNC1) {
+					*consumed = i;
+					return CASIC_FRAME_NO_SYNC;
+				}
+				break;
+
+			case 1:
+				if(c != CASIC_SYNC2) {
+					*consumed = i;
+					return CASIC_FRAME_NO_SYNC;
+				}
+				break;
+
+			case 2:
+				frame->len = c;
+				break;
+
+			case 3:
+				frame->len |= (uint16_t)c << 8;
+
+				if(frame->len > CASIC_MAX_FRAME_PAYLOAD_LEN || (frame->len & 0x03) != 0) {
+					*consumed = i + 1;
+					return CASIC_FRAME_OVERFLOW;
+				}
+
+				frame->checksum_skipped = 0;
+				break;
+
+			case 4:
+				frame->cls = c;
+				break;
+
+			case 5:
+				frame->id = c;
+				break;
+
+			default:
+				// checksum bytes after the payload
+				{
+					uint8_t ck_idx = pos - 6 - frame->len;
+
+					if(ck_idx == 0) {
+						frame->checksum_rx = 0;
+					}
+
+					frame->checksum_rx |= (uint32_t)c << (8 * ck_idx);
+
+					if(ck_idx == 3) {
+						*consumed = i + 1;
+
+						frame->received++;
+						frame->checksum_calc = calc_checksum(frame->cls, frame->id, frame->len,
+								frame->payload, stored_len(frame)) + frame->checksum_skipped;
+						frame->valid = (frame->checksum_calc == frame->checksum_rx);
+						return CASIC_FRAME_COMPLETE;
+					}
+				}
+				break;
+		}
+
+		frame->received++;
+		i++;
+	}
+
+	*consumed = i;
+	return CASIC_FRAME_INCOMPLETE;
+}
+
+
+bool casic_frame_get_run_time(const casic_frame_t *frame, uint32_t *run_time)
+{
+	if(!frame->valid || frame->cls != CASIC_CLASS_NAV || frame->len < 4) {
+		return false;
+	}
+
+	*run_time = get_u32(frame->payload);
+	return true;
+}
+
+
+static void parse_nav_pv(const uint8_t *p, bool *position_updated, nmea_data_t *data)
+{
+	uint8_t pos_valid = p[4];
+	uint8_t vel_valid = p[5];
+
+	// number of satellites used in the solution per system
+	static const uint8_t sys_ids[NMEA_NUM_FIX_INFO] = {
+		NMEA_SYS_ID_GPS, NMEA_SYS_ID_BEIDOU, NMEA_SYS_ID_GLONASS};
+	const uint8_t *sats_used = &p[8]; // numSVGPS, numSVBDS, numSVGLN
+
+	uint8_t fix_type;
+
+	switch(pos_valid) {
+		case PV_VALID_2D:
+			fix_type = NMEA_FIX_TYPE_2D;
+			break;
+
+		case PV_VALID_3D:
+		case PV_VALID_GNSS_DR:
+			fix_type = NMEA_FIX_TYPE_3D;
+			break;
+
+		default:
+			fix_type = NMEA_FIX_TYPE_NONE;
+			break;
+	}
+
+	if(fix_type != NMEA_FIX_TYPE_NONE) {
+		data->lat_e7 = deg_to_e7(get_f64(&p[24]));
+		data->lon_e7 = deg_to_e7(get_f64(&p[16]));
+		data->lat = (float)data->lat_e7 * 1e-7f;
+		data->lon = (float)data->lon_e7 * 1e-7f;
+
+		// height is given above the ellipsoid, convert to mean sea level
+		data->altitude = get_f32(&p[32]) - get_f32(&p[36]);
+		data->pos_valid = true;
+
+		if(position_updated) {
+			*position_updated = true;
+		}
+	} else {
+		data->pos_valid = false;
+	}
+
+	if(vel_valid == PV_VALID_2D || vel_valid == PV_VALID_3D || vel_valid == PV_VALID_GNSS_DR) {
+		data->speed = get_f32(&p[64]);
+		data->heading = get_f32(&p[68]);
+		data->speed_heading_valid = true;
+	} else {
+		data->speed_heading_valid = false;
+	}
+
+	data->pdop = get_f32(&p[12]);
+
+	// one fix info entry per system that contributes to the solution
+	uint8_t n = 0;
+
+	for(uint8_t i = 0; i < NMEA_NUM_FIX_INFO; i++) {
+		if(sats_used[i] == 0) {
+			continue;
+		}
+
+		data->fix_info[n].sys_id    = sys_ids[i];
+		data->fix_info[n].fix_type  = fix_type;
+		data->fix_info[n].auto_mode = true;
+		data->fix_info[n].sats_used = sats_used[i];
+		n++;
+	}
+
+	for(; n < NMEA_NUM_FIX_INFO; n++) {
+		data->fix_info[n].sys_id = NMEA_SYS_ID_INVALID;
+	}
+}
+
+static void parse_nav_dop(const uint8_t *p, nmea_data_t *data)
+{
+	data->pdop = get_f32(&p[4]);
+	data->hdop = get_f32(&p[8]);
+	data->vdop = get_f32(&p[12]);
+}
+
+static void parse_nav_timeutc(const uint8_t *p, nmea_data_t *data)
+{
+	uint8_t valid      = p[21];
+	uint8_t date_valid = p[23];
+
+	if(valid == 0 || date_valid == 0) {
+		data->datetime_valid = false;
+		return;
+	}
+
+	data->datetime.date_y = get_u16(&p[14]);
+	data->datetime.date_m = p[16];
+	data->datetime.date_d = p[17];
+	data->datetime.time_h = p[18];
+	data->datetime.time_m = p[19];
+	data->datetime.time_s = p[20];
+	data->datetime_valid = true;
+}
+
+static void parse_nav_satinfo(const uint8_t *p, uint16_t len, uint8_t id, nmea_data_t *data)
+{
+	nmea_sat_info_t *sat_list;
+	uint8_t         *sat_count;
+	uint8_t          sat_list_size = NMEA_NUM_SAT_INFO;
+
+	switch(id) {
+		case CASIC_ID_NAV_GPSINFO:
+			sat_list  = data->sat_info_gps;
+			sat_count = &(data->sat_info_count_gps);
+			break;
+
+		case CASIC_ID_NAV_BDSINFO:
+			sat_list      = data->sat_info_beidou;
+			sat_count     = &(data->sat_info_count_beidou);
+			sat_list_size = NMEA_NUM_SAT_INFO_BEIDOU;
+			break;
+
+		case CASIC_ID_NAV_GLNINFO:
+			sat_list  = data->sat_info_glonass;
+			sat_count = &(data->sat_info_count_glonass);
+			break;
+
+		default:
+			return;
+	}
+
+	uint8_t num_sv = p[4];
+	uint16_t max_sv = (len - NAV_SATINFO_LEN) / NAV_SATINFO_SV_LEN;
+
+	if(num_sv > max_sv) {
+		num_sv = max_sv;
+	}
+
+	if(num_sv > sat_list_size) {
+		num_sv = sat_list_size;
+	}
+
+	for(uint8_t i = 0; i < num_sv; i++) {
+		const uint8_t *sv = p + NAV_SATINFO_LEN + i * NAV_SATINFO_SV_LEN;
+
+		sat_list[i].sat_id = sv[NAV_SATINFO_SV_ID];
+		sat_list[i].snr = (sv[NAV_SATINFO_SV_CN0] == 0) ? -1 : (int8_t)sv[NAV_SATINFO_SV_CN0]; // 0 if not tracked
+	}
+
+	*sat_count = num_sv;
+}
+
+
+ret_code_t casic_parse_frame(const casic_frame_t *frame, bool *position_updated, nmea_data_t *data)
+{
+	if(position_updated != NULL) {
+		*position_updated = false;
+	}
+
+	if(!frame->valid) {
+		NRF_LOG_ERROR("casic: frame incomplete or checksum invalid.");
+		return NRF_ERROR_INVALID_DATA;
+	}
+
+	if(frame->cls != CASIC_CLASS_NAV) {
+		// ACK/NAK and others are not needed
+		return NRF_SUCCESS;
+	}
+
+	const uint8_t *p = frame->payload;
+	uint16_t len = stored_len(frame); // longer satellite lists are truncated
+
+	switch(frame->id) {
+		case CASIC_ID_NAV_PV:
+			VERIFY_TRUE(len >= NAV_PV_LEN, NRF_ERROR_INVALID_DATA);
+			parse_nav_pv(p, position_updated, data);
+			break;
+
+		case CASIC_ID_NAV_DOP:
+			VERIFY_TRUE(len >= NAV_DOP_LEN, NRF_ERROR_INVALID_DATA);
+			parse_nav_dop(p, data);
+			break;
+
+		case CASIC_ID_NAV_TIMEUTC:
+			VERIFY_TRUE(len >= NAV_TIMEUTC_LEN, NRF_ERROR_INVALID_DATA);
+			parse_nav_timeutc(p, data);
+			break;
+
+		case CASIC_ID_NAV_GPSINFO:
+		case CASIC_ID_NAV_BDSINFO:
+		case CASIC_ID_NAV_GLNINFO:
+			VERIFY_TRUE(len >= NAV_SATINFO_LEN, NRF_ERROR_INVALID_DATA);
+			parse_nav_satinfo(p, len, frame->id, data);
+			break;
+
+		default:
+			// unsupported message
+			break;
+	}
+
+	return NRF_SUCCESS;
+}
+
+
+size_t casic_build_frame(uint8_t *buf, size_t buf_len, uint8_t cls, uint8_t id,
+		const uint8_t *payload, uint16_t payload_len)
+{
+	size_t frame_len = CASIC_FRAME_OVERHEAD + payload_len;
+
+	if(frame_len > buf_len || (payload_len & 0x03) != 0) {
+		return 0;
+	}
+
+	buf[0] = CASIC_SYNC1;
+	buf[1] = CASIC_SYNC2;
+	put_u16(&buf[2], payload_len);
+	buf[4] = cls;
+	buf[5] = id;
+
+	if(payload_len > 0) {
+		memcpy(&buf[6], payload, payload_len);
+	}
+
+	put_u32(&buf[6 + payload_len], calc_checksum(cls, id, payload_len, &buf[6], payload_len));
+
+	return frame_len;
+}
+
+
+size_t casic_build_cfg_msg(uint8_t *buf, size_t buf_len, uint8_t cls, uint8_t id, uint16_t rate)
+{
+	uint8_t payload[4];
+
+	payload[0] = cls;
+	payload[1] = id;
+	put_u16(&payload[2], rate);
+
+	return casic_build_frame(buf, buf_len, CASIC_CLASS_CFG, CASIC_ID_CFG_MSG, payload, sizeof(payload));
+}
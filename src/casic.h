@@ -0,0 +1,186 @@
+/*
+ * vim: noexpandtab
+ *
+ * Copyright (c) 2021-2022 Thomas Kolb <cfr34k-git@tkolb.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef CASIC_H
+#define CASIC_H
+
+/**@file
+ *
+ * @brief Decoder for the CASIC binary protocol of the GNSS module.
+ *
+ * @details
+ * As an alternative to NMEA, the module can output its navigation data in
+ * binary frames, which are much shorter and need no number parsing. A frame
+ * looks like this (all values little-endian):
+ *
+ *   0xBA 0xCE | length (U2) | class (U1) | id (U1) | payload | checksum (U4)
+ *
+ * The payload length is always a multiple of 4. The checksum is calculated as
+ * (id << 24) + (class << 16) + length plus the sum of all payload words.
+ *
+ * The decoded data is stored in the same nmea_data_t structure as the NMEA
+ * data, so the rest of the firmware does not need to know which protocol is
+ * in use.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <sdk_errors.h>
+
+#include "nmea.h"
+
+#define CASIC_SYNC1            0xBA
+#define CASIC_SYNC2            0xCE
+
+// sync word, length, class, id and checksum
+#define CASIC_FRAME_OVERHEAD   10
+
+// Number of satellites kept per satellite information message, as many as
+// nmea_data_t holds per system. Longer messages (e.g. BeiDou in Asia) are
+// received completely, but only the leading satellites are stored.
+#define CASIC_MAX_SAT_INFO     32
+
+// the satellite information messages are the longest supported messages
+#define CASIC_MAX_PAYLOAD_LEN  (8 + 12 * CASIC_MAX_SAT_INFO)
+
+// Longest accepted frame: a satellite information message with 255 satellites
+// (numViewSv is U1). Longer length fields are taken as corrupted data.
+#define CASIC_MAX_FRAME_PAYLOAD_LEN  (8 + 12 * 255)
+
+#define CASIC_CLASS_NAV        0x01
+#define CASIC_CLASS_ACK        0x05
+#define CASIC_CLASS_CFG        0x06
+
+#define CASIC_ID_NAV_DOP       0x01
+#define CASIC_ID_NAV_PV        0x03
+#define CASIC_ID_NAV_TIMEUTC   0x10
+#define CASIC_ID_NAV_GPSINFO   0x20
+#define CASIC_ID_NAV_BDSINFO   0x21
+#define CASIC_ID_NAV_GLNINFO   0x22
+
+#define CASIC_ID_CFG_MSG       0x01
+
+/**@brief Received CASIC frame.
+ * @details
+ * The header fields are decoded while the frame is received. The checksum is
+ * verified once the frame is complete.
+ */
+typedef struct
+{
+	uint8_t  cls;                               // message class
+	uint8_t  id;                                // message ID
+	uint16_t len;                               // payload length
+	uint8_t  payload[CASIC_MAX_PAYLOAD_LEN];    // the first CASIC_MAX_PAYLOAD_LEN bytes of the payload
+
+	uint16_t received;                          // number of frame bytes received so far
+	uint32_t checksum_calc;                     // checksum calculated over the frame
+	uint32_t checksum_skipped;                  // sum of the payload words that were not stored
+	uint32_t checksum_rx;                       // checksum from the frame
+	bool     valid;                             // frame is complete and the checksum matches
+} casic_frame_t;
+
+typedef enum
+{
+	CASIC_FRAME_INCOMPLETE,                     // all data was consumed, more is needed
+	CASIC_FRAME_COMPLETE,                       // the frame was received completely
+	CASIC_FRAME_NO_SYNC,                        // the data does not start with the sync word
+	CASIC_FRAME_OVERFLOW,                       // the frame is too long or has an invalid length
+} casic_frame_status_t;
+
+/**@brief Prepare the frame for reception of new data.
+ */
+void casic_frame_init(casic_frame_t *frame);
+
+/**@brief Append received bytes to the frame.
+ * @details
+ * The first byte must be CASIC_SYNC1. Processing stops after the last byte of
+ * the frame, so the remaining data can be passed to the next frame. If
+ * CASIC_FRAME_NO_SYNC is returned, the byte that did not match is not
+ * consumed.
+ *
+ * @param[inout] frame     The frame to append to.
+ * @param[in]    data      Received bytes.
+ * @param[in]    len       Number of received bytes.
+ * @param[out]   consumed  Number of bytes that were processed.
+ * @returns                The state of the frame after processing.
+ */
+casic_frame_status_t casic_frame_append(casic_frame_t *frame,
+		const uint8_t *data, size_t len, size_t *consumed);
+
+/**@brief Retrieve the receiver run time from navigation messages.
+ * @details
+ * All messages of one navigation epoch carry the same run time, so it can be
+ * used to detect the beginning of a new epoch.
+ *
+ * @param[in]  frame     The received frame.
+ * @param[out] run_time  The run time in milliseconds.
+ * @returns              true if the frame is a valid navigation message.
+ */
+bool casic_frame_get_run_time(const casic_frame_t *frame, uint32_t *run_time);
+
+/**@brief Parse the given frame.
+ * @details
+ * Supported messages are NAV-PV, NAV-DOP, NAV-TIMEUTC and the satellite
+ * information messages for GPS, BeiDou and GLONASS. Other messages are
+ * ignored.
+ *
+ * @param[in]  frame              The frame to parse.
+ * @param[out] position_updated   Indicates whether the position was updated by this frame.
+ *                                May be NULL if not needed.
+ * @param[inout] data             The data struct to fill/update.
+ * @retval NRF_ERROR_INVALID_DATA     The frame is incomplete, its checksum is wrong or the
+ *                                    payload is too short for the message.
+ * @retval NRF_SUCCESS                If the frame was parsed successfully.
+ */
+ret_code_t casic_parse_frame(const casic_frame_t *frame, bool *position_updated, nmea_data_t *data);
+
+/**@brief Build a frame with the given payload.
+ *
+ * @param[out] buf          Buffer for the frame.
+ * @param[in]  buf_len      Size of the buffer.
+ * @param[in]  cls          Message class.
+ * @param[in]  id           Message ID.
+ * @param[in]  payload      Payload data. May be NULL if payload_len is 0.
+ * @param[in]  payload_len  Payload length. Must be a multiple of 4.
+ * @returns                 Length of the frame, or 0 if the buffer is too small or
+ *                          the payload length is invalid.
+ */
+size_t casic_build_frame(uint8_t *buf, size_t buf_len, uint8_t cls, uint8_t id,
+		const uint8_t *payload, uint16_t payload_len);
+
+/**@brief Build a CFG-MSG frame which sets the output rate of a message.
+ *
+ * @param[out] buf      Buffer for the frame.
+ * @param[in]  buf_len  Size of the buffer.
+ * @param[in]  cls      Class of the configured message.
+ * @param[in]  id       ID of the configured message.
+ * @param[in]  rate     Output the message every rate-th fix; 0 disables it.
+ * @returns             Length of the frame, or 0 if the buffer is too small.
+ */
+size_t casic_build_cfg_msg(uint8_t *buf, size_t buf_len, uint8_t cls, uint8_t id, uint16_t rate);
+
+#endif // CASIC_H
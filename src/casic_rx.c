@@ -0,0 +1,173 @@
+/*
+ * vim: noexpandtab
+ *
+ * Copyright (c) 2021-2022 Thomas Kolb <cfr34k-git@tkolb.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <string.h>
+
+#include "casic_rx.h"
+
+/* Prevent the compiler from moving memory accesses across this point. This is
+ * sufficient for the queue as producer and consumer run on the same core. */
+#define COMPILER_BARRIER() __asm__ volatile("" ::: "memory")
+
+void casic_rx_init(casic_rx_t *rx, casic_rx_frame_callback_t callback)
+{
+	memset(rx, 0, sizeof(*rx));
+
+	rx->callback = callback;
+}
+
+
+void casic_rx_reset(casic_rx_t *rx)
+{
+	if(rx->in_frame && rx->frame.received > 2) {
+		rx->frames_dropped++;
+	}
+
+	rx->in_frame = false;
+}
+
+
+void casic_rx_feed(casic_rx_t *rx, const uint8_t *data, size_t len)
+{
+	const uint8_t *end = data + len;
+
+	rx->rx_bytes += len;
+
+	while(data < end) {
+		if(!rx->in_frame) {
+			// skip everything up to the next sync byte
+			const uint8_t *start = memchr(data, CASIC_SYNC1, end - data);
+			if(!start) {
+				return;
+			}
+
+			data = start;
+			rx->in_frame = true;
+			casic_frame_init(&rx->frame);
+		}
+
+		size_t consumed;
+		casic_frame_status_t status =
+			casic_frame_append(&rx->frame, data, end - data, &consumed);
+
+		data += consumed;
+
+		switch(status) {
+			case CASIC_FRAME_INCOMPLETE:
+				// wait for more data
+				break;
+
+			case CASIC_FRAME_COMPLETE:
+				rx->rx_frames++;
+				rx->in_frame = false;
+
+				rx->callback(&rx->frame);
+				break;
+
+			case CASIC_FRAME_NO_SYNC:
+				// the first sync byte was random data. Search again, starting
+				// at the byte that did not match.
+				rx->in_frame = false;
+				break;
+
+			case CASIC_FRAME_OVERFLOW:
+				// invalid length, probably a corrupted header => discard it
+				rx->frames_dropped++;
+				rx->in_frame = false;
+				break;
+		}
+	}
+}
+
+
+void casic_rx_queue_init(casic_rx_queue_t *q, casic_frame_t *slots, uint8_t num_slots)
+{
+	memset(q, 0, sizeof(*q));
+
+	q->slots = slots;
+	q->mask  = num_slots - 1;
+}
+
+
+void casic_rx_queue_flush(casic_rx_queue_t *q)
+{
+	q->tail = q->head;
+}
+
+
+uint8_t casic_rx_queue_count(const casic_rx_queue_t *q)
+{
+	return (uint8_t)(q->head - q->tail);
+}
+
+
+bool casic_rx_queue_push(casic_rx_queue_t *q, const casic_frame_t *frame)
+{
+	uint8_t head = q->head;
+	uint8_t pending = (uint8_t)(head - q->tail);
+
+	if(pending > q->mask) {
+		q->frames_overrun++;
+		return false;
+	}
+
+	q->slots[head & q->mask] = *frame;
+
+	// the slot must be completely written before it is published
+	COMPILER_BARRIER();
+
+	q->head = head + 1;
+
+	pending++;
+	if(pending > q->high_water_mark) {
+		q->high_water_mark = pending;
+	}
+
+	return true;
+}
+
+
+casic_frame_t* casic_rx_queue_peek(casic_rx_queue_t *q)
+{
+	uint8_t tail = q->tail;
+
+	if(q->head == tail) {
+		return NULL;
+	}
+
+	// do not read the slot before the head index
+	COMPILER_BARRIER();
+
+	return &q->slots[tail & q->mask];
+}
+
+
+void casic_rx_queue_pop(casic_rx_queue_t *q)
+{
+	// finish all accesses to the slot before it is released to the producer
+	COMPILER_BARRIER();
+
+	q->tail++;
+}
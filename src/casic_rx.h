@@ -0,0 +1,132 @@
+/*
+ * vim: noexpandtab
+ *
+ * Copyright (c) 2021-2022 Thomas Kolb <cfr34k-git@tkolb.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef CASIC_RX_H
+#define CASIC_RX_H
+
+/**@file
+ *
+ * @brief Frame assembly for the GNSS UART receive path (CASIC binary protocol).
+ *
+ * @details
+ * This is the binary counterpart of nmea_rx: it splits the received chunks
+ * into CASIC frames and hands them over to the main loop via a lock-free
+ * single-producer, single-consumer queue. Any data between frames (e.g. NMEA
+ * sentences that are still output by the module) is skipped.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "casic.h"
+
+/**@brief Callback for completed frames.
+ *
+ * @param frame   The received frame. Check frame->valid for the checksum status.
+ */
+typedef void (*casic_rx_frame_callback_t)(const casic_frame_t *frame);
+
+typedef struct {
+	casic_frame_t frame;
+	bool          in_frame;      // a sync byte was seen and the frame is being collected
+
+	casic_rx_frame_callback_t callback;
+
+	uint32_t rx_bytes;       // total number of bytes fed into the splitter
+	uint32_t rx_frames;      // number of complete frames passed to the callback
+	uint32_t frames_dropped; // frames discarded due to an invalid length
+} casic_rx_t;
+
+/**@brief Initialize the frame splitter.
+ *
+ * @param rx        The splitter state to initialize.
+ * @param callback  Function that is called for every complete frame.
+ */
+void casic_rx_init(casic_rx_t *rx, casic_rx_frame_callback_t callback);
+
+/**@brief Discard the partially received frame (e.g. after a UART error).
+ */
+void casic_rx_reset(casic_rx_t *rx);
+
+/**@brief Process a chunk of received bytes.
+ * @details
+ * Every frame that is completed by this chunk is passed to the callback
+ * before this function returns.
+ *
+ * @param rx    The splitter state.
+ * @param data  Pointer to the received bytes.
+ * @param len   Number of received bytes.
+ */
+void casic_rx_feed(casic_rx_t *rx, const uint8_t *data, size_t len);
+
+typedef struct {
+	casic_frame_t   *slots;
+	uint8_t          mask;            // number of slots - 1
+
+	volatile uint8_t head;            // next slot to write; only modified by the producer
+	volatile uint8_t tail;            // next slot to read; only modified by the consumer
+
+	uint8_t  high_water_mark;         // maximum number of frames pending at the same time
+	uint32_t frames_overrun;          // frames dropped because the queue was full
+} casic_rx_queue_t;
+
+/**@brief Initialize a frame queue.
+ *
+ * @param q          The queue to initialize.
+ * @param slots      Storage for the queued frames.
+ * @param num_slots  Number of entries in slots. Must be a power of two and at most 128.
+ */
+void casic_rx_queue_init(casic_rx_queue_t *q, casic_frame_t *slots, uint8_t num_slots);
+
+/**@brief Discard all pending frames. Must not be called while the producer is active.
+ */
+void casic_rx_queue_flush(casic_rx_queue_t *q);
+
+/**@brief Append a frame to the queue (producer side).
+ *
+ * @returns  true if the frame was queued, false if the queue is full. In that
+ *           case the frame is dropped and counted in frames_overrun.
+ */
+bool casic_rx_queue_push(casic_rx_queue_t *q, const casic_frame_t *frame);
+
+/**@brief Access the oldest pending frame (consumer side).
+ * @details
+ * The returned frame stays valid until casic_rx_queue_pop() is called.
+ *
+ * @param q    The queue.
+ * @returns    Pointer to the frame or NULL if the queue is empty.
+ */
+casic_frame_t* casic_rx_queue_peek(casic_rx_queue_t *q);
+
+/**@brief Release the frame returned by casic_rx_queue_peek() (consumer side).
+ */
+void casic_rx_queue_pop(casic_rx_queue_t *q);
+
+/**@brief Number of frames currently pending in the queue.
+ */
+uint8_t casic_rx_queue_count(const casic_rx_queue_t *q);
+
+#endif // CASIC_RX_H
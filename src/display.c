@@ -61,7 +61,8 @@ extern uint16_t m_bat_millivolt;
 extern aprs_rx_raw_data_t m_last_undecodable_data;
 extern uint64_t m_last_undecodable_timestamp;
 
-extern uint8_t m_display_rx_index;
+extern uint16_t m_display_rx_index;
+extern aprs_rx_history_order_t m_display_rx_order;
 
 extern char m_passkey[6];
 
@@ -79,6 +80,20 @@ static int format_timedelta(char *buf, size_t buf_len, uint32_t timedelta)
 }
 
 
+static uint8_t count_tracked_sats(const nmea_sat_info_t *sat_info, uint8_t count)
+{
+	uint8_t tracked = 0;
+
+	for(uint8_t i = 0; i < count; i++) {
+		if(sat_info[i].snr >= 0) {
+			tracked++;
+		}
+	}
+
+	return tracked;
+}
+
+
 int compute_maidenhead_grid_fields_squares_subsquares(char *locator, int locator_size, float deg, int pos_start) {
   char *p = locator;
   int div = 24;
@@ -167,35 +182,35 @@ void redraw_display(bool full_update)
 	char s[64];
 	char tmp1[16], tmp2[16], tmp3[16];
 
-	const aprs_rx_history_t *aprs_history = aprs_get_rx_history();
-
 	uint8_t line_height = epaper_fb_get_line_height();
 	uint8_t yoffset = line_height;
 
 	uint64_t unix_now = wall_clock_get_unix();
 
 	// calculate GNSS satellite count
-	uint8_t gps_sats_tracked = 0;
-	uint8_t glonass_sats_tracked = 0;
+	uint8_t gps_sats_tracked     = count_tracked_sats(m_nmea_data.sat_info_gps, m_nmea_data.sat_info_count_gps);
+	uint8_t glonass_sats_tracked = count_tracked_sats(m_nmea_data.sat_info_glonass, m_nmea_data.sat_info_count_glonass);
+	uint8_t galileo_sats_tracked = count_tracked_sats(m_nmea_data.sat_info_galileo, m_nmea_data.sat_info_count_galileo);
+	uint8_t beidou_sats_tracked  = count_tracked_sats(m_nmea_data.sat_info_beidou, m_nmea_data.sat_info_count_beidou);
+	uint8_t qzss_sats_tracked    = count_tracked_sats(m_nmea_data.sat_info_qzss, m_nmea_data.sat_info_count_qzss);
 
 	uint8_t gnss_total_sats_used;
 	uint8_t gnss_total_sats_tracked;
 	uint8_t gnss_total_sats_in_view;
 
-	for(uint8_t i = 0; i < m_nmea_data.sat_info_count_gps; i++) {
-		if(m_nmea_data.sat_info_gps[i].snr >= 0) {
-			gps_sats_tracked++;
-		}
-	}
-
-	for(uint8_t i = 0; i < m_nmea_data.sat_info_count_glonass; i++) {
-		if(m_nmea_data.sat_info_glonass[i].snr >= 0) {
-			glonass_sats_tracked++;
-		}
-	}
+	gnss_total_sats_in_view =
+		m_nmea_data.sat_info_count_gps
+		+ m_nmea_data.sat_info_count_glonass
+		+ m_nmea_data.sat_info_count_galileo
+		+ m_nmea_data.sat_info_count_beidou
+		+ m_nmea_data.sat_info_count_qzss;
 
-	gnss_total_sats_in_view = m_nmea_data.sat_info_count_gps + m_nmea_data.sat_info_count_glonass;
-	gnss_total_sats_tracked = gps_sats_tracked + glonass_sats_tracked;
+	gnss_total_sats_tracked =
+		gps_sats_tracked
+		+ glonass_sats_tracked
+		+ galileo_sats_tracked
+		+ beidou_sats_tracked
+		+ qzss_sats_tracked;
 
 	gnss_total_sats_used = 0;
 	for(uint8_t i = 0; i < NMEA_NUM_FIX_INFO; i++) {
@@ -520,6 +535,20 @@ void redraw_display(bool full_update)
 
 				yoffset += line_height;
 				epaper_fb_move_to(0, yoffset);
+
+				if(m_nmea_data.sat_info_count_galileo
+						|| m_nmea_data.sat_info_count_beidou
+						|| m_nmea_data.sat_info_count_qzss) {
+					snprintf(s, sizeof(s), "GA: %d/%d, BD: %d/%d, QZ: %d/%d",
+							galileo_sats_tracked, m_nmea_data.sat_info_count_galileo,
+							beidou_sats_tracked, m_nmea_data.sat_info_count_beidou,
+							qzss_sats_tracked, m_nmea_data.sat_info_count_qzss);
+
+					epaper_fb_draw_string(s, EPAPER_COLOR_BLACK);
+
+					yoffset += line_height;
+					epaper_fb_move_to(0, yoffset);
+				}
 				break;
 
 			case DISP_STATE_TRACKER:
@@ -659,13 +688,29 @@ void redraw_display(bool full_update)
 			case DISP_STATE_LORA_RX_OVERVIEW:
 				yoffset -= line_height;
 
-				//for(uint8_t i = 0; i < APRS_RX_HISTORY_SIZE+1; i++) {
-				for(uint8_t i = 0; i < (APRS_RX_HISTORY_SIZE > 3 ? 3 : APRS_RX_HISTORY_SIZE) +1; i++) {
+#define HISTORY_TEXT_BASE_OFFSET 6
+#define HISTORY_PAGE_SIZE 3
+
+				// Show the page of the selected station in the selected
+				// order. The error line follows the last page.
+				uint16_t num_stations = aprs_rx_history_get_stats()->num_stations;
+				uint16_t selected = aprs_rx_history_get_position(m_display_rx_order, m_display_rx_index);
+				uint16_t page_start = (selected < num_stations) ? selected :
+				                      (num_stations > 0) ? num_stations - 1 : 0;
+				uint16_t page[HISTORY_PAGE_SIZE];
+				uint16_t page_len;
+
+				page_start -= page_start % HISTORY_PAGE_SIZE;
+				page_len = aprs_rx_history_get_sorted(m_display_rx_order, page_start, page, HISTORY_PAGE_SIZE);
+
+				for(uint8_t i = 0; i < HISTORY_PAGE_SIZE + 1; i++) {
 					yoffset += 2*line_height;
 
 					uint8_t fg_color, bg_color;
+					bool is_selected = (i < page_len) ? (page[i] == m_display_rx_index) :
+					                   (i == HISTORY_PAGE_SIZE && m_display_rx_index >= APRS_RX_HISTORY_SIZE);
 
-					if(i == m_display_rx_index) {
+					if(is_selected) {
 						fg_color = EPAPER_COLOR_WHITE;
 						bg_color = EPAPER_COLOR_BLACK;
 					} else {
@@ -675,22 +720,19 @@ void redraw_display(bool full_update)
 
 					epaper_fb_fill_rect(0, yoffset - 2*line_height, EPAPER_WIDTH, yoffset, bg_color);
 
-#define HISTORY_TEXT_BASE_OFFSET 6
-
-					//if(i < APRS_RX_HISTORY_SIZE) {
-					if(i < (APRS_RX_HISTORY_SIZE > 3 ? 3 : APRS_RX_HISTORY_SIZE)) {
+					if(i < HISTORY_PAGE_SIZE) {
 						// decoded entries
-						const aprs_rx_history_entry_t *entry = &aprs_history->history[i];
-
-						// skip entries that have reception time 0, i.e. are not set.
-						if(entry->rx_timestamp == 0) {
+						if(i >= page_len) {
 							continue;
 						}
 
+						const aprs_rx_history_entry_t *entry = aprs_rx_history_get(page[i]);
+
 						// source call
 						epaper_fb_move_to(0, yoffset - line_height - HISTORY_TEXT_BASE_OFFSET);
 						//epaper_fb_draw_string(entry->decoded.source, fg_color);
-                                                const char *p = entry->decoded.source;
+						aprs_rx_history_get_string(entry, APRS_RX_HISTORY_SOURCE, tmp2, sizeof(tmp2));
+                                                const char *p = tmp2;
                                                 if (!p || !*p) p = "nobody";
 						epaper_fb_draw_string(p, fg_color);
 
@@ -704,15 +746,11 @@ void redraw_display(bool full_update)
 						epaper_fb_move_to(0, yoffset - HISTORY_TEXT_BASE_OFFSET);
 						epaper_fb_draw_string(s, fg_color);
 
-						// calculate distance and course if we know our own position
-						if(m_nmea_has_position) {
-							float distance = great_circle_distance_m(
-									m_nmea_data.lat, m_nmea_data.lon,
-									entry->decoded.lat, entry->decoded.lon);
-
-							float direction = direction_angle(
-									m_nmea_data.lat, m_nmea_data.lon,
-									entry->decoded.lat, entry->decoded.lon);
+						// distance and course are kept up to date by the
+						// history if we know our own position
+						if(entry->distance >= 0.0f) {
+							float distance = entry->distance;
+							float direction = entry->direction;
 
 							if(distance < 1000.0f) {
 								snprintf(s, sizeof(s), "d: %dm", (int)(distance + 0.5f));
@@ -800,18 +838,34 @@ void redraw_display(bool full_update)
 						} else {
 							epaper_fb_draw_string("Last error: never", fg_color);
 						}
+
+						// sort order and page
+						static const char *const order_names[APRS_RX_HISTORY_NUM_ORDERS] = {
+							"time", "distance", "RSSI"
+						};
+
+						if(page_len > 0) {
+							snprintf(s, sizeof(s), "By %s: %u-%u of %u", order_names[m_display_rx_order],
+									page_start + 1, page_start + page_len, num_stations);
+						} else {
+							snprintf(s, sizeof(s), "By %s: no stations", order_names[m_display_rx_order]);
+						}
+
+						epaper_fb_move_to(0, yoffset - HISTORY_TEXT_BASE_OFFSET);
+						epaper_fb_draw_string(s, fg_color);
 					}
 				}
 				break;
 
 			case DISP_STATE_LORA_PACKET_DETAIL:
 				if(m_display_rx_index < APRS_RX_HISTORY_SIZE) {
-					const aprs_rx_history_entry_t *entry = &aprs_history->history[m_display_rx_index];
+					const aprs_rx_history_entry_t *entry = aprs_rx_history_get(m_display_rx_index);
 					static uint8_t position_maidenhead_toggle = 4;
 
 					// time since reception
 					uint32_t timedelta = unix_now - entry->rx_timestamp;
-                                        const char *p = entry->decoded.source;
+					aprs_rx_history_get_string(entry, APRS_RX_HISTORY_SOURCE, tmp2, sizeof(tmp2));
+                                        const char *p = tmp2;
 
 					//epaper_fb_draw_string(entry->decoded.source, EPAPER_COLOR_BLACK);
 					format_timedelta(tmp1, sizeof(tmp1), entry->rx_timestamp ? timedelta : 0);
@@ -824,9 +878,9 @@ void redraw_display(bool full_update)
 					epaper_fb_move_to(0, yoffset);
 
 					if (((((position_maidenhead_toggle++) / 4)) % 4) > 0) {
-						//format_float(tmp1, sizeof(tmp1), entry->decoded.lat, 6);
+						//format_float(tmp1, sizeof(tmp1), entry->lat, 6);
 						//snprintf(s, sizeof(s), "Lat: %s", tmp1);
-						format_position_nautical(tmp1, sizeof(tmp1), entry->decoded.lat, 3, 1);
+						format_position_nautical(tmp1, sizeof(tmp1), entry->lat, 3, 1);
 						//snprintf(s, sizeof(s), "%s", tmp1);
 						//epaper_fb_move_to(EPAPER_WIDTH/2+5 - epaper_fb_calc_text_width(s), yoffset);
 						//epaper_fb_draw_string(s, EPAPER_COLOR_BLACK);
@@ -836,8 +890,8 @@ void redraw_display(bool full_update)
 						yoffset += line_height;
 						epaper_fb_move_to(0, yoffset);
 
-						//format_float(tmp1, sizeof(tmp1), entry->decoded.lon, 6);
-						format_position_nautical(tmp1, sizeof(tmp1), entry->decoded.lon, 3, 0);
+						//format_float(tmp1, sizeof(tmp1), entry->lon, 6);
+						format_position_nautical(tmp1, sizeof(tmp1), entry->lon, 3, 0);
 						//snprintf(s, sizeof(s), "Lon: %s", tmp1);
 						//snprintf(s, sizeof(s), "%s", tmp1);
 						//epaper_fb_move_to(EPAPER_WIDTH/2+5 - epaper_fb_calc_text_width(s), yoffset);
@@ -846,9 +900,9 @@ void redraw_display(bool full_update)
 						epaper_fb_draw_string(tmp1, EPAPER_COLOR_BLACK);
 					} else {
 						epaper_fb_draw_string("he:  ", EPAPER_COLOR_BLACK);
-						//snprintf(s, sizeof(s), "%s", compute_maidenhead_grid_locator(entry->decoded.lat, entry->decoded.lon, 1));
+						//snprintf(s, sizeof(s), "%s", compute_maidenhead_grid_locator(entry->lat, entry->lon, 1));
 						//epaper_fb_draw_string(s, EPAPER_COLOR_BLACK);
-						char *p = compute_maidenhead_grid_locator(entry->decoded.lat, entry->decoded.lon, 1);
+						char *p = compute_maidenhead_grid_locator(entry->lat, entry->lon, 1);
 						epaper_fb_draw_string(p, EPAPER_COLOR_BLACK);
 
 						yoffset += line_height;
@@ -866,7 +920,7 @@ void redraw_display(bool full_update)
 
 					//format_float(tmp1, sizeof(tmp1), entry->decoded.alt, 1);
 					//snprintf(s, sizeof(s), "Alt: %s m", tmp1);
-					snprintf(s, sizeof(s), "Alt: %dm", (int ) entry->decoded.alt);
+					snprintf(s, sizeof(s), "Alt: %dm", (int ) entry->alt);
 					epaper_fb_draw_string(s, EPAPER_COLOR_BLACK);
 
 					uint8_t altitude_yoffset = yoffset; // store it for later use
@@ -874,7 +928,7 @@ void redraw_display(bool full_update)
 					yoffset += 5 * line_height / 4;
 					epaper_fb_move_to(0, yoffset);
 
-					strncpy(s, entry->decoded.comment, sizeof(s));
+					aprs_rx_history_get_string(entry, APRS_RX_HISTORY_COMMENT, s, sizeof(s));
 					if(strlen(s) > 40) {
 						s[38] = '\0';
 						strcat(s, "...");
@@ -883,14 +937,14 @@ void redraw_display(bool full_update)
 
 					yoffset = epaper_fb_get_cursor_pos_y();
 
-					if(m_nmea_has_position && entry->decoded.source[0]) {
+					if(m_nmea_has_position && tmp2[0]) {
 						float distance = great_circle_distance_m(
 								m_nmea_data.lat, m_nmea_data.lon,
-								entry->decoded.lat, entry->decoded.lon);
+								entry->lat, entry->lon);
 
 						float direction = direction_angle(
 								m_nmea_data.lat, m_nmea_data.lon,
-								entry->decoded.lat, entry->decoded.lon);
+								entry->lat, entry->lon);
 
 						//format_float(tmp1, sizeof(tmp1), distance / 1000.0f, 3);
 						//snprintf(s, sizeof(s), "%s km", tmp1);
@@ -950,15 +1004,15 @@ void redraw_display(bool full_update)
 
 					epaper_fb_draw_string("R: ", EPAPER_COLOR_BLACK);
 
-					format_float(tmp1, sizeof(tmp1), entry->raw.rssi, 1);
+					format_float(tmp1, sizeof(tmp1), entry->rssi, 1);
 					epaper_fb_draw_string(tmp1, EPAPER_COLOR_BLACK);
 					epaper_fb_draw_string(" / ", EPAPER_COLOR_BLACK);
 
-					format_float(tmp1, sizeof(tmp1), entry->raw.snr, 2);
+					format_float(tmp1, sizeof(tmp1), entry->snr, 2);
 					epaper_fb_draw_string(tmp1, EPAPER_COLOR_BLACK);
 					epaper_fb_draw_string(" / ", EPAPER_COLOR_BLACK);
 
-					format_float(tmp1, sizeof(tmp1), entry->raw.signalRssi, 1);
+					format_float(tmp1, sizeof(tmp1), entry->signalRssi, 1);
 					epaper_fb_draw_string(tmp1, EPAPER_COLOR_BLACK);
 				} else {
 					/* show error message */
@@ -1114,6 +1168,16 @@ void redraw_display(bool full_update)
 				//epaper_fb_draw_string(tmp1, EPAPER_COLOR_BLACK);
 				epaper_fb_draw_string(aprs_get_source(NULL, 0), EPAPER_COLOR_BLACK);
 
+				if(m_nmea_data.pos_valid) {
+					// stations heard within 10 km
+					yoffset = 2 * line_height;
+					epaper_fb_move_to(0, yoffset);
+
+					snprintf(s, sizeof(s), "10km: %u",
+							aprs_rx_history_find_within(m_nmea_data.lat, m_nmea_data.lon, 10000.0f, NULL, NULL, 0));
+					epaper_fb_draw_string(s, EPAPER_COLOR_BLACK);
+				}
+
 				if(bme280_is_present()) {
 						yoffset = 3 * line_height;
 						epaper_fb_move_to(0, yoffset);
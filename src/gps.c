@@ -22,8 +22,12 @@
  * SOFTWARE.
  */
 
+#include <string.h>
+
 #include <nrfx_uarte.h>
+#include <nrfx_ppi.h>
 #include <nrf_gpio.h>
+#include <nrfx_timer.h>
 
 #include <sdk_macros.h>
 #include <nrf_log.h>
@@ -33,6 +37,12 @@
 #include "pinout.h"
 #include "periph_pwr.h"
 #include "nmea.h"
+#include "nmea_rx.h"
+#include "casic.h"
+#include "casic_rx.h"
+#include "gps_epoch.h"
+#include "gps_profile.h"
+#include "gps_rx_idle.h"
 
 #include "gps.h"
 
@@ -49,71 +59,269 @@ typedef enum {
 #define GPS_RESET_MS_WAIT2    3000  // boot time after reset
 #define GPS_RESET_MS_WAIT3    1000  // time between configuration and power-off
 
+/* Data is received via EasyDMA in chunks of RX_DMA_CHUNK_SIZE bytes using
+ * two alternating buffers, so the CPU is only woken up once per chunk instead
+ * of once per byte. If the line goes idle before a chunk is full (i.e. at the
+ * end of every NMEA burst), the transfer is aborted to flush the partially
+ * filled buffer. The received bytes are counted by m_rx_byte_counter (RXDRDY
+ * events via PPI), so the idle timer can tell whether the line is really idle,
+ * and the counter interrupts once on the first byte of a burst to start the
+ * idle timer, see gps_rx_idle.h. */
+#define RX_DMA_CHUNK_SIZE       GPS_RX_CHUNK_SIZE
+
 
+/* Peripherals owned by the GNSS driver: UARTE0, TIMER4 (byte counter) and one
+ * PPI channel. TIMER0 is used by the SoftDevice and TIMER3 by the PWM of the
+ * LEDs and the e-paper backlight (leds.c). */
 static nrfx_uarte_t m_uarte = NRFX_UARTE_INSTANCE(0);
+static const nrfx_timer_t m_rx_byte_counter = NRFX_TIMER_INSTANCE(4);
 
 APP_TIMER_DEF(m_gps_reset_timer);
+APP_TIMER_DEF(m_rx_idle_timer);
 
 static gps_callback_t m_callback;
 
-#define RX_BUF_SIZE 85   // NMEA sentence length is max. 82 bytes; + "\r\n\0"
+static uint8_t m_rx_dma_buffer[2][RX_DMA_CHUNK_SIZE];
+
+static nrf_ppi_channel_t m_rx_byte_ppi_channel;
+static gps_rx_idle_t     m_rx_idle;
+
+#if GPS_PROTOCOL_CASIC_BINARY
+/* Number of frames that can be buffered between the interrupt and gps_loop().
+ * One epoch consists of up to 6 frames. */
+#define RX_QUEUE_SLOTS           8
+
+static casic_rx_t m_casic_rx;
+
+static casic_frame_t m_rx_queue_slots[RX_QUEUE_SLOTS];
+static casic_rx_queue_t m_rx_queue;
+#else
+/* Number of lines that can be buffered between the interrupt and gps_loop().
+ * One epoch consists of about 10-15 lines, so this covers a main loop that is
+ * blocked for about a second (e.g. by an e-paper update). */
+#define RX_QUEUE_SLOTS          16
 
-static uint8_t m_rx_buffer[2][RX_BUF_SIZE];
-static uint8_t m_rx_buffer_used[2];
+static nmea_rx_t m_nmea_rx;
 
-static uint8_t m_rx_buffer_idx;
+static nmea_sentence_t m_rx_queue_slots[RX_QUEUE_SLOTS];
+static nmea_rx_queue_t m_rx_queue;
+#endif
 
-static uint8_t m_rx_buffer_complete_idx;
-static bool    m_rx_buffer_complete;
+static uint32_t m_isr_wakeups;
+static uint32_t m_checksum_errors;
 
 static nmea_data_t m_nmea_data;
+static gps_epoch_t m_epoch;
 
 static gps_reset_state_t m_reset_state;
 
+static gps_profile_fsm_t m_profile_fsm;
+static uint8_t m_profile_cmd[GPS_PROFILE_CMD_MAX_LEN];
+
+// events from interrupt context, processed in gps_loop()
+static volatile bool m_tx_done;
+static volatile bool m_send_config;
+
 static bool m_is_powered;
 
+
+#if GPS_PROTOCOL_CASIC_BINARY
+/**@brief Called by the frame splitter (in interrupt context) for every complete frame.
+ */
+static void cb_casic_rx_frame(const casic_frame_t *frame)
+{
+	if(!frame->valid) {
+		// checksum error, no need to pass this to the parser
+		m_checksum_errors++;
+		return;
+	}
+
+	casic_rx_queue_push(&m_rx_queue, frame);
+}
+#else
+/**@brief Called by the line splitter (in interrupt context) for every complete sentence.
+ */
+static void cb_nmea_rx_sentence(const nmea_sentence_t *sentence)
+{
+	if(!sentence->valid) {
+		// checksum error, no need to pass this to the parser
+		m_checksum_errors++;
+		return;
+	}
+
+	nmea_rx_queue_push(&m_rx_queue, sentence);
+}
+#endif
+
+
+/**@brief Pass received data to the splitter of the configured protocol.
+ */
+static void rx_feed(const uint8_t *data, size_t len)
+{
+#if GPS_PROTOCOL_CASIC_BINARY
+	casic_rx_feed(&m_casic_rx, data, len);
+#else
+	nmea_rx_feed(&m_nmea_rx, data, len);
+#endif
+}
+
+
+/**@brief Discard partially received data and, optionally, all queued data.
+ */
+static void rx_reset(bool flush_queue)
+{
+#if GPS_PROTOCOL_CASIC_BINARY
+	casic_rx_reset(&m_casic_rx);
+
+	if(flush_queue) {
+		casic_rx_queue_flush(&m_rx_queue);
+	}
+#else
+	nmea_rx_reset(&m_nmea_rx);
+
+	if(flush_queue) {
+		nmea_rx_queue_flush(&m_rx_queue);
+	}
+#endif
+}
+
+
+/**@brief Current value of the hardware byte counter.
+ */
+static uint32_t rx_byte_count(void)
+{
+	return nrfx_timer_capture(&m_rx_byte_counter, NRF_TIMER_CC_CHANNEL0);
+}
+
+
+/**@brief A burst started: flush it after the line went idle.
+ */
+static void rx_activity(void)
+{
+	nrfx_timer_compare_int_disable(&m_rx_byte_counter, NRF_TIMER_CC_CHANNEL1);
+
+	APP_ERROR_CHECK(app_timer_stop(m_rx_idle_timer));
+	APP_ERROR_CHECK(app_timer_start(m_rx_idle_timer, APP_TIMER_TICKS(GPS_RX_CHUNK_TIMEOUT_MS), NULL));
+}
+
+
+/**@brief All received bytes were delivered: wait for the next burst.
+ * @details
+ * The byte counter interrupts on the first byte of the next burst, so bursts
+ * shorter than a buffer are flushed as well.
+ */
+static void rx_wait_for_activity(void)
+{
+	nrfx_timer_compare(&m_rx_byte_counter, NRF_TIMER_CC_CHANNEL1,
+			gps_rx_idle_wake_count(&m_rx_idle), true);
+
+	// the first byte may have arrived before the compare value was set
+	if(gps_rx_idle_pending(&m_rx_idle, rx_byte_count())) {
+		rx_activity();
+	}
+}
+
+
+static void cb_rx_byte_counter(nrf_timer_event_t event_type, void *p_context)
+{
+	m_isr_wakeups++;
+
+	if(event_type == NRF_TIMER_EVENT_COMPARE1 && m_is_powered) {
+		rx_activity();
+	}
+}
+
+
+/**@brief Start reception into both DMA buffers.
+ * @details
+ * The second call queues the secondary buffer, which the UARTE switches to
+ * automatically once the first one is full.
+ */
+static ret_code_t start_rx(void)
+{
+	VERIFY_SUCCESS(nrfx_uarte_rx(&m_uarte, m_rx_dma_buffer[0], RX_DMA_CHUNK_SIZE));
+	return nrfx_uarte_rx(&m_uarte, m_rx_dma_buffer[1], RX_DMA_CHUNK_SIZE);
+}
+
+
 static void cb_uarte(nrfx_uarte_event_t const * p_event, void *p_context)
 {
 	ret_code_t err_code;
 
-	uint8_t rx_byte;
+	uint8_t *rx_data;
+	size_t   rx_bytes;
+
+	m_isr_wakeups++;
 
 	switch(p_event->type)
 	{
 		case NRFX_UARTE_EVT_RX_DONE:
-			rx_byte = m_rx_buffer[m_rx_buffer_idx][ m_rx_buffer_used[m_rx_buffer_idx] ];
+			rx_data  = p_event->data.rxtx.p_data;
+			rx_bytes = p_event->data.rxtx.bytes;
 
-			m_rx_buffer_used[m_rx_buffer_idx]++;
+			rx_feed(rx_data, rx_bytes);
 
-			if((rx_byte == '\n') || (m_rx_buffer_used[m_rx_buffer_idx] >= RX_BUF_SIZE)) {
-				m_rx_buffer_complete_idx = m_rx_buffer_idx;
-				m_rx_buffer_complete = true;
+			bool start_idle_timer = gps_rx_idle_transfer_done(&m_rx_idle, rx_bytes, rx_byte_count());
 
-				m_rx_buffer_idx = (m_rx_buffer_idx + 1) % 2;
-				m_rx_buffer_used[m_rx_buffer_idx] = 0;
+			if(rx_bytes == RX_DMA_CHUNK_SIZE) {
+				// buffer is full and the driver has already switched to the
+				// secondary buffer. Queue this one again as the next secondary.
+				err_code = nrfx_uarte_rx(&m_uarte, rx_data, RX_DMA_CHUNK_SIZE);
+				APP_ERROR_CHECK(err_code);
+			} else {
+				// transfer was aborted by the idle timer, both buffers are
+				// released now.
+				err_code = start_rx();
+				APP_ERROR_CHECK(err_code);
 			}
 
-			err_code = nrfx_uarte_rx(
-					&m_uarte,
-					&m_rx_buffer[m_rx_buffer_idx][ m_rx_buffer_used[m_rx_buffer_idx] ],
-					1);
-			APP_ERROR_CHECK(err_code);
+			if(start_idle_timer) {
+				// more data may follow: (re-)arm the idle timeout. It is
+				// longer than a chunk, so it only expires after the burst.
+				APP_ERROR_CHECK(app_timer_stop(m_rx_idle_timer));
+				APP_ERROR_CHECK(app_timer_start(m_rx_idle_timer, APP_TIMER_TICKS(GPS_RX_CHUNK_TIMEOUT_MS), NULL));
+			} else if(m_is_powered) {
+				rx_wait_for_activity();
+			}
 			break;
 
 		case NRFX_UARTE_EVT_ERROR:
 			NRF_LOG_ERROR("gps: UART error! Trying to restart.");
 
+			// an abort results in an RX_DONE event which restarts the reception.
+			rx_reset(false);
 			nrfx_uarte_rx_abort(&m_uarte);
-
-			err_code = nrfx_uarte_rx(
-					&m_uarte,
-					&m_rx_buffer[m_rx_buffer_idx][ m_rx_buffer_used[m_rx_buffer_idx] ],
-					1);
-			APP_ERROR_CHECK(err_code);
 			break;
 
 		case NRFX_UARTE_EVT_TX_DONE:
-			NRF_LOG_WARNING("gps: TX completed, but should never have started.");
+			m_tx_done = true;
+			break;
+	}
+}
+
+
+/**@brief Flush the partially filled DMA buffer after the line went idle.
+ */
+static void cb_rx_idle_timer(void *p_context)
+{
+	m_isr_wakeups++;
+
+	if(!m_is_powered) {
+		return;
+	}
+
+	switch(gps_rx_idle_timeout(&m_rx_idle, rx_byte_count())) {
+		case GPS_RX_IDLE_WAIT:
+			rx_wait_for_activity();
+			break;
+
+		case GPS_RX_IDLE_RECHECK:
+			APP_ERROR_CHECK(app_timer_start(m_rx_idle_timer, APP_TIMER_TICKS(GPS_RX_IDLE_TIMEOUT_MS), NULL));
+			break;
+
+		case GPS_RX_IDLE_ABORT:
+			// results in an RX_DONE event with the received bytes
+			nrfx_uarte_rx_abort(&m_uarte);
 			break;
 	}
 }
@@ -145,18 +353,14 @@ void cb_gps_reset_timer(void *p_context)
 			break;
 
 		case GPS_RESET_SEND_CONFIG:
-			{
-				//static uint8_t cmd[] = "\r\n$PMTK103*30\r\n"; // cold boot (MTK version)
-				//static uint8_t cmd[] = "$PMTK314,0,1,0,1,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0*28\r\n"; // set sentence interval config (MTK version)
-				static uint8_t cmd[] = "$PCAS03,1,0,1,1,1,0,0,0,0,0,,,0,0,,,,0*32\r\n"; // set sentence interval config (CASIC version)
-
-				APP_ERROR_CHECK(nrfx_uarte_tx(&m_uarte, cmd, strlen((const char*)cmd)));
+			// the module has booted after the reset: (re-)send the output
+			// profile from gps_loop().
+			m_send_config = true;
 
-				m_reset_state = GPS_RESET_WAIT3;
+			m_reset_state = GPS_RESET_WAIT3;
 
-				err_code = app_timer_start(m_gps_reset_timer, APP_TIMER_TICKS(GPS_RESET_MS_WAIT3), NULL);
-				APP_ERROR_CHECK(err_code);
-			}
+			err_code = app_timer_start(m_gps_reset_timer, APP_TIMER_TICKS(GPS_RESET_MS_WAIT3), NULL);
+			APP_ERROR_CHECK(err_code);
 			break;
 
 		case GPS_RESET_WAIT3:
@@ -183,6 +387,36 @@ ret_code_t gps_init(gps_callback_t callback)
 	err_code = app_timer_create(&m_gps_reset_timer, APP_TIMER_MODE_SINGLE_SHOT, cb_gps_reset_timer);
 	VERIFY_SUCCESS(err_code);
 
+	err_code = app_timer_create(&m_rx_idle_timer, APP_TIMER_MODE_SINGLE_SHOT, cb_rx_idle_timer);
+	VERIFY_SUCCESS(err_code);
+
+	// the byte counter counts RXDRDY events of the UARTE
+	nrfx_timer_config_t timer_config = NRFX_TIMER_DEFAULT_CONFIG;
+
+	timer_config.mode      = NRF_TIMER_MODE_COUNTER;
+	timer_config.bit_width = NRF_TIMER_BIT_WIDTH_32;
+
+	err_code = nrfx_timer_init(&m_rx_byte_counter, &timer_config, cb_rx_byte_counter);
+	VERIFY_SUCCESS(err_code);
+
+	err_code = nrfx_ppi_channel_alloc(&m_rx_byte_ppi_channel);
+	VERIFY_SUCCESS(err_code);
+
+	err_code = nrfx_ppi_channel_assign(m_rx_byte_ppi_channel,
+			nrf_uarte_event_address_get(m_uarte.p_reg, NRF_UARTE_EVENT_RXDRDY),
+			nrfx_timer_task_address_get(&m_rx_byte_counter, NRF_TIMER_TASK_COUNT));
+	VERIFY_SUCCESS(err_code);
+
+#if GPS_PROTOCOL_CASIC_BINARY
+	casic_rx_init(&m_casic_rx, cb_casic_rx_frame);
+	casic_rx_queue_init(&m_rx_queue, m_rx_queue_slots, RX_QUEUE_SLOTS);
+#else
+	nmea_rx_init(&m_nmea_rx, cb_nmea_rx_sentence);
+	nmea_rx_queue_init(&m_rx_queue, m_rx_queue_slots, RX_QUEUE_SLOTS);
+#endif
+
+	gps_profile_fsm_init(&m_profile_fsm, GPS_PROFILE_TRACKER);
+
 	m_is_powered = false;
 
 	return NRF_SUCCESS;
@@ -218,8 +452,13 @@ ret_code_t gps_power_on(void)
 	}
 
 	// prepare buffers
-	m_rx_buffer_used[0] = 0;
-	m_rx_buffer_idx = 0;
+	rx_reset(true);
+	gps_epoch_init(&m_epoch);
+
+	// the output profile is sent as soon as the module is ready
+	gps_profile_fsm_power_on(&m_profile_fsm);
+	m_tx_done = false;
+	m_send_config = false;
 
 	// power on
 	err_code = periph_pwr_start_activity(PERIPH_PWR_FLAG_GPS);
@@ -235,16 +474,22 @@ ret_code_t gps_power_on(void)
 	err_code = nrfx_uarte_init(&m_uarte, &uart_config, cb_uarte);
 	VERIFY_SUCCESS(err_code);
 
-	/* Start a 1-byte transfer. When a byte is received, cb_uarte() will be
-	 * called, which will start another 1-byte transfer. */
-	err_code = nrfx_uarte_rx(
-			&m_uarte,
-			&m_rx_buffer[m_rx_buffer_idx][ m_rx_buffer_used[m_rx_buffer_idx] ],
-			1);
+	nrfx_timer_clear(&m_rx_byte_counter);
+	nrfx_timer_enable(&m_rx_byte_counter);
+	gps_rx_idle_init(&m_rx_idle);
+
+	err_code = nrfx_ppi_channel_enable(m_rx_byte_ppi_channel);
+	VERIFY_SUCCESS(err_code);
+
+	/* Start the chunked reception. Whenever a buffer is full, cb_uarte() is
+	 * called, which processes the data and queues the buffer again. */
+	err_code = start_rx();
 	VERIFY_SUCCESS(err_code);
 
 	m_is_powered = true;
 
+	rx_wait_for_activity();
+
 	return NRF_SUCCESS;
 }
 
@@ -255,40 +500,159 @@ ret_code_t gps_power_off(void)
 
 	m_is_powered = false;
 
+	app_timer_stop(m_rx_idle_timer);
+
 	nrfx_uarte_rx_abort(&m_uarte);
 	nrfx_uarte_uninit(&m_uarte);
 
+	nrfx_ppi_channel_disable(m_rx_byte_ppi_channel);
+	nrfx_timer_compare_int_disable(&m_rx_byte_counter, NRF_TIMER_CC_CHANNEL1);
+	nrfx_timer_disable(&m_rx_byte_counter);
+
 	err_code = periph_pwr_stop_activity(PERIPH_PWR_FLAG_GPS);
 	VERIFY_SUCCESS(err_code);
 	return NRF_SUCCESS;
 }
 
 
-void gps_loop(void)
+/**@brief Clear satellite information that is no longer updated in the active profile.
+ * @details
+ * Otherwise the display would show stale data until the status profile is
+ * active again.
+ */
+static void clear_sat_info(void)
+{
+	memset(m_nmea_data.fix_info, 0, sizeof(m_nmea_data.fix_info));
+
+	m_nmea_data.sat_info_count_gps     = 0;
+	m_nmea_data.sat_info_count_glonass = 0;
+	m_nmea_data.sat_info_count_galileo = 0;
+	m_nmea_data.sat_info_count_beidou  = 0;
+	m_nmea_data.sat_info_count_qzss    = 0;
+}
+
+
+/**@brief Send a requested cold restart or the output profile if it changed.
+ */
+static void update_profile(void)
+{
+	gps_profile_t profile;
+
+	if(m_tx_done) {
+		m_tx_done = false;
+		gps_profile_fsm_tx_done(&m_profile_fsm);
+	}
+
+	if(m_send_config) {
+		m_send_config = false;
+		gps_profile_fsm_power_on(&m_profile_fsm);
+		gps_profile_fsm_module_ready(&m_profile_fsm);
+	}
+
+	if(!m_is_powered) {
+		return;
+	}
+
+	if(gps_profile_fsm_poll_restart(&m_profile_fsm)) {
+		// cold restart (forget everything except configuration)
+		static uint8_t cmd[] = "$PCAS10,2*1E\r\n";
+
+		if(nrfx_uarte_tx(&m_uarte, cmd, strlen((const char*)cmd)) != NRF_SUCCESS) {
+			NRF_LOG_ERROR("gps: could not send cold restart command.");
+			gps_profile_fsm_tx_done(&m_profile_fsm);
+		}
+
+		// the profile (if any) is sent after this command
+		return;
+	}
+
+	if(!gps_profile_fsm_poll(&m_profile_fsm, &profile)) {
+		return;
+	}
+
+#if GPS_PROTOCOL_CASIC_BINARY
+	size_t len = gps_profile_build_command_casic(profile, m_profile_cmd, sizeof(m_profile_cmd));
+#else
+	size_t len = gps_profile_build_command(profile, (char*)m_profile_cmd, sizeof(m_profile_cmd));
+#endif
+
+	if(len == 0 || nrfx_uarte_tx(&m_uarte, m_profile_cmd, len) != NRF_SUCCESS) {
+		NRF_LOG_ERROR("gps: could not send profile '%s'.", gps_profile_to_string(profile));
+		gps_profile_fsm_tx_failed(&m_profile_fsm);
+		return;
+	}
+
+	NRF_LOG_INFO("gps: switched to profile '%s'.", gps_profile_to_string(profile));
+
+	if(!gps_profile_reports_satellites(profile)) {
+		clear_sat_info();
+	}
+}
+
+
+#if GPS_PROTOCOL_CASIC_BINARY
+static void process_rx_queue(void)
 {
-	if(m_rx_buffer_complete) {
-		m_rx_buffer_complete = false;
+	casic_frame_t *frame;
 
-		uint8_t len = m_rx_buffer_used[m_rx_buffer_complete_idx];
-		uint8_t *buf = m_rx_buffer[m_rx_buffer_complete_idx];
+	if(m_casic_rx.rx_bytes != 0) {
+		// the module is talking (maybe still in NMEA), so it can be
+		// configured now.
+		gps_profile_fsm_module_ready(&m_profile_fsm);
+	}
 
-		// ensure that the buffer is safe to print
-		if(len >= RX_BUF_SIZE) {
-			len = RX_BUF_SIZE - 1;
+	// process all frames that were received since the last call
+	while((frame = casic_rx_queue_peek(&m_rx_queue)) != NULL) {
+		if(gps_epoch_begin_frame(&m_epoch, frame)) {
+			// this frame starts a new epoch, so the data of the previous
+			// epoch is complete and consistent now.
+			m_callback(GPS_EVT_EPOCH_COMPLETE, &m_nmea_data);
 		}
 
-		buf[len] = '\0';
+		if(casic_parse_frame(frame, NULL, &m_nmea_data) == NRF_SUCCESS) {
+			gps_epoch_end_sentence(&m_epoch);
+		}
 
-		//NRF_LOG_INFO("gps: received sentence: %s", NRF_LOG_PUSH((char*)buf));
+		casic_rx_queue_pop(&m_rx_queue);
+	}
+}
+#else
+static void process_rx_queue(void)
+{
+	nmea_sentence_t *sentence;
 
-		bool pos_updated = false;
-		nmea_parse((char*)buf, &pos_updated, &m_nmea_data);
+	// process all sentences that were received since the last call
+	while((sentence = nmea_rx_queue_peek(&m_rx_queue)) != NULL) {
+		// the module is obviously able to communicate now
+		gps_profile_fsm_module_ready(&m_profile_fsm);
+
+		if(gps_epoch_begin_sentence(&m_epoch, sentence)) {
+			// this sentence starts a new epoch, so the data of the previous
+			// epoch is complete and consistent now.
+			m_callback(GPS_EVT_EPOCH_COMPLETE, &m_nmea_data);
+		}
 
-		if(pos_updated) {
-			m_callback(GPS_EVT_DATA_RECEIVED, &m_nmea_data);
+		if(nmea_parse_sentence(sentence, NULL, &m_nmea_data) == NRF_SUCCESS) {
+			gps_epoch_end_sentence(&m_epoch);
 		}
+
+		nmea_rx_queue_pop(&m_rx_queue);
 	}
 }
+#endif
+
+
+void gps_loop(void)
+{
+	process_rx_queue();
+	update_profile();
+}
+
+
+void gps_set_profile(gps_profile_t profile)
+{
+	gps_profile_fsm_request(&m_profile_fsm, profile);
+}
 
 
 ret_code_t gps_cold_restart(void)
@@ -297,6 +661,27 @@ ret_code_t gps_cold_restart(void)
 		return NRF_ERROR_INVALID_STATE;
 	}
 
-	static uint8_t cmd[] = "$PCAS10,2*1E\r\n"; // cold restart (forget everything except configuration)
-	return nrfx_uarte_tx(&m_uarte, cmd, strlen((const char*)cmd));
+	// sent from gps_loop() as soon as no profile command is being transmitted
+	gps_profile_fsm_request_restart(&m_profile_fsm);
+	return NRF_SUCCESS;
+}
+
+
+void gps_get_rx_stats(gps_rx_stats_t *stats)
+{
+#if GPS_PROTOCOL_CASIC_BINARY
+	stats->rx_bytes        = m_casic_rx.rx_bytes;
+	stats->rx_lines        = m_casic_rx.rx_frames;
+	stats->lines_dropped   = m_casic_rx.frames_dropped;
+	stats->lines_overrun   = m_rx_queue.frames_overrun;
+#else
+	stats->rx_bytes        = m_nmea_rx.rx_bytes;
+	stats->rx_lines        = m_nmea_rx.rx_lines;
+	stats->lines_dropped   = m_nmea_rx.lines_dropped;
+	stats->lines_overrun   = m_rx_queue.lines_overrun;
+#endif
+	stats->checksum_errors = m_checksum_errors;
+	stats->isr_wakeups     = m_isr_wakeups;
+
+	stats->queue_high_water_mark = m_rx_queue.high_water_mark;
 }
@@ -30,14 +30,33 @@
 #include <sdk_errors.h>
 
 #include "nmea.h"
+#include "gps_profile.h"
+
+/* Protocol used to receive the navigation data. Set this to 1 (e.g. by
+ * building with "make GPS_PROTOCOL=casic") to use the CASIC binary protocol
+ * instead of NMEA. */
+#ifndef GPS_PROTOCOL_CASIC_BINARY
+#define GPS_PROTOCOL_CASIC_BINARY 0
+#endif
 
 typedef enum {
 	GPS_EVT_RESET_COMPLETE,
-	GPS_EVT_DATA_RECEIVED
+	GPS_EVT_EPOCH_COMPLETE    // all sentences of one fix were received and parsed
 } gps_evt_t;
 
 typedef void (* gps_callback_t)(gps_evt_t evt, const nmea_data_t *data);
 
+typedef struct {
+	uint32_t rx_bytes;         // bytes received from the GNSS module
+	uint32_t rx_lines;         // complete NMEA lines (or CASIC frames) assembled from these bytes
+	uint32_t lines_dropped;    // incomplete or overlong lines (or frames) discarded by the splitter
+	uint32_t checksum_errors;  // complete lines discarded due to a wrong checksum
+	uint32_t lines_overrun;    // complete lines lost because gps_loop() was too slow
+	uint32_t isr_wakeups;      // number of UART and idle timer interrupts
+
+	uint8_t  queue_high_water_mark;  // maximum number of lines pending in the queue
+} gps_rx_stats_t;
+
 ret_code_t gps_init(gps_callback_t callback);
 
 void gps_loop(void);
@@ -49,6 +68,22 @@ ret_code_t gps_reset(void);
 ret_code_t gps_power_on(void);
 ret_code_t gps_power_off(void);
 
+/**@brief Cold restart the GNSS module.
+ * @details
+ * The command is sent from gps_loop(), after a profile command that is being
+ * transmitted.
+ */
 ret_code_t gps_cold_restart(void);
 
+/**@brief Select the output profile of the GNSS module.
+ * @details
+ * The profile is sent from gps_loop() when the module is powered and ready.
+ * It is sent again automatically after every power-on or reset.
+ */
+void gps_set_profile(gps_profile_t profile);
+
+/**@brief Retrieve the statistics of the UART receive path.
+ */
+void gps_get_rx_stats(gps_rx_stats_t *stats);
+
 #endif // GPS_H
@@ -0,0 +1,165 @@
+/*
+ * vim: noexpandtab
+ *
+ * Copyright (c) 2021-2022 Thomas Kolb <cfr34k-git@tkolb.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "gps_epoch.h"
+
+/**@brief Extract the UTC time field from sentences that carry one.
+ *
+ * @param sentence   The indexed NMEA sentence.
+ * @param time       Buffer of at least GPS_EPOCH_TIME_LEN+1 bytes for the time field.
+ * @returns          The GPS_EPOCH_HAS_* flag of the sentence type or 0 if the
+ *                   sentence has no (valid) time.
+ */
+static uint8_t extract_time(const nmea_sentence_t *sentence, char *time)
+{
+	uint8_t type;
+
+	if(!sentence->valid || sentence->num_fields < 2) {
+		return 0;
+	}
+
+	// the address field looks like "GNGGA" with any talker ID
+	const char *address = sentence->text + sentence->field[0];
+
+	if(strlen(address) != 5) {
+		return 0;
+	}
+
+	if(strcmp(address + 2, "GGA") == 0) {
+		type = GPS_EPOCH_HAS_GGA;
+	} else if(strcmp(address + 2, "RMC") == 0) {
+		type = GPS_EPOCH_HAS_RMC;
+	} else if(strcmp(address + 2, "ZDA") == 0) {
+		type = GPS_EPOCH_HAS_ZDA;
+	} else {
+		return 0;
+	}
+
+	// the time is always the first data field
+	const char *field = sentence->text + sentence->field[1];
+	size_t len = strlen(field);
+
+	if(len < 6 || len > GPS_EPOCH_TIME_LEN) {
+		// no time available yet (module just started)
+		return 0;
+	}
+
+	for(size_t i = 0; i < len; i++) {
+		char c = field[i];
+
+		// reject garbage, which would otherwise cause a spurious epoch change
+		if((c < '0' || c > '9') && c != '.') {
+			return 0;
+		}
+	}
+
+	memcpy(time, field, len + 1);
+	return type;
+}
+
+
+/**@brief Extract the run time from CASIC navigation frames.
+ * @details
+ * The run time is stored as hexadecimal string, so it can be handled like the
+ * NMEA time field.
+ *
+ * @param frame      The received frame.
+ * @param time       Buffer of at least GPS_EPOCH_TIME_LEN+1 bytes for the time.
+ * @returns          The GPS_EPOCH_HAS_* flag of the message type or 0 if the
+ *                   frame has no run time.
+ */
+static uint8_t extract_run_time(const casic_frame_t *frame, char *time)
+{
+	static const char hexdigits[] = "0123456789abcdef";
+
+	uint32_t run_time;
+	uint8_t type;
+
+	if(!casic_frame_get_run_time(frame, &run_time)) {
+		return 0;
+	}
+
+	type = (frame->id == CASIC_ID_NAV_PV) ? GPS_EPOCH_HAS_PV : GPS_EPOCH_HAS_NAV;
+
+	for(uint8_t i = 0; i < 8; i++) {
+		time[i] = hexdigits[(run_time >> (28 - 4 * i)) & 0x0F];
+	}
+
+	time[8] = '\0';
+	return type;
+}
+
+/**@brief Start a new epoch if the pending time differs from the current one.
+ */
+static bool begin_epoch(gps_epoch_t *epoch)
+{
+	if(epoch->pending_sentence == 0
+			|| strcmp(epoch->pending_time, epoch->time) == 0) {
+		// sentence belongs to the current epoch
+		return false;
+	}
+
+	bool complete = (epoch->sentences & (GPS_EPOCH_HAS_GGA | GPS_EPOCH_HAS_RMC | GPS_EPOCH_HAS_PV)) != 0;
+
+	// start the new epoch
+	strcpy(epoch->time, epoch->pending_time);
+	epoch->sentences = 0;
+
+	if(complete) {
+		epoch->epochs_completed++;
+	}
+
+	return complete;
+}
+
+
+void gps_epoch_init(gps_epoch_t *epoch)
+{
+	memset(epoch, 0, sizeof(*epoch));
+}
+
+
+bool gps_epoch_begin_sentence(gps_epoch_t *epoch, const nmea_sentence_t *sentence)
+{
+	epoch->pending_sentence = extract_time(sentence, epoch->pending_time);
+
+	return begin_epoch(epoch);
+}
+
+
+bool gps_epoch_begin_frame(gps_epoch_t *epoch, const casic_frame_t *frame)
+{
+	epoch->pending_sentence = extract_run_time(frame, epoch->pending_time);
+
+	return begin_epoch(epoch);
+}
+
+
+void gps_epoch_end_sentence(gps_epoch_t *epoch)
+{
+	epoch->sentences |= epoch->pending_sentence;
+	epoch->pending_sentence = 0;
+}
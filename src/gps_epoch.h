@@ -0,0 +1,104 @@
+/*
+ * vim: noexpandtab
+ *
+ * Copyright (c) 2021-2022 Thomas Kolb <cfr34k-git@tkolb.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GPS_EPOCH_H
+#define GPS_EPOCH_H
+
+/**@file
+ *
+ * @brief Grouping of NMEA sentences into epochs.
+ *
+ * @details
+ * The GNSS module outputs a burst of sentences for each fix (GGA, GSA, GSV,
+ * RMC, ...). Some of these sentences carry the UTC time of the fix, which is
+ * used here to detect where one epoch ends and the next one begins. This
+ * allows to report the data of a fix once and consistently, instead of after
+ * each individual sentence.
+ *
+ * An epoch is considered complete when the first time-carrying sentence of the
+ * next epoch arrives. Therefore, gps_epoch_begin_sentence() must be called
+ * before the sentence is parsed, so the data of the previous epoch can be
+ * reported before it is modified.
+ *
+ * For the CASIC binary protocol, the receiver run time that is contained in
+ * every navigation message is used instead of the UTC time.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "nmea.h"
+#include "casic.h"
+
+#define GPS_EPOCH_TIME_LEN  10   // "hhmmss.sss"
+
+#define GPS_EPOCH_HAS_GGA   (1 << 0)
+#define GPS_EPOCH_HAS_RMC   (1 << 1)
+#define GPS_EPOCH_HAS_ZDA   (1 << 2)
+#define GPS_EPOCH_HAS_PV    (1 << 3)   // CASIC NAV-PV
+#define GPS_EPOCH_HAS_NAV   (1 << 4)   // other CASIC navigation messages
+
+typedef struct {
+	char     time[GPS_EPOCH_TIME_LEN + 1];   // UTC time field of the current epoch
+	uint8_t  sentences;                      // GPS_EPOCH_HAS_* flags of the current epoch
+
+	char     pending_time[GPS_EPOCH_TIME_LEN + 1];
+	uint8_t  pending_sentence;
+
+	uint32_t epochs_completed;
+} gps_epoch_t;
+
+/**@brief Reset the epoch tracking, e.g. after the module was powered on.
+ */
+void gps_epoch_init(gps_epoch_t *epoch);
+
+/**@brief Check the given sentence before it is parsed.
+ *
+ * @param epoch     The epoch tracking state.
+ * @param sentence  The received sentence.
+ * @returns         true if the sentence starts a new epoch and the previous one
+ *                  contained position or velocity data. The caller should report
+ *                  the previous epoch now.
+ */
+bool gps_epoch_begin_sentence(gps_epoch_t *epoch, const nmea_sentence_t *sentence);
+
+/**@brief Check the given CASIC frame before it is parsed.
+ * @details
+ * Equivalent to gps_epoch_begin_sentence() for the binary protocol.
+ *
+ * @param epoch     The epoch tracking state.
+ * @param frame     The received frame.
+ * @returns         true if the frame starts a new epoch and the previous one
+ *                  contained position data. The caller should report the
+ *                  previous epoch now.
+ */
+bool gps_epoch_begin_frame(gps_epoch_t *epoch, const casic_frame_t *frame);
+
+/**@brief Notify that the sentence or frame passed to gps_epoch_begin_sentence()
+ * or gps_epoch_begin_frame() was parsed successfully and is part of the
+ * current epoch.
+ */
+void gps_epoch_end_sentence(gps_epoch_t *epoch);
+
+#endif // GPS_EPOCH_H
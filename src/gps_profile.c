@@ -0,0 +1,245 @@
+/*
+ * vim: noexpandtab
+ *
+ * Copyright (c) 2021-2022 Thomas Kolb <cfr34k-git@tkolb.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "nmea.h"
+#include "casic.h"
+
+#include "gps_profile.h"
+
+typedef struct {
+	const char *name;
+	uint16_t    fix_interval_ms;
+
+	// output rate of each sentence: every n-th fix, 0 = disabled
+	uint8_t     gga, gsa, gsv, rmc;
+} gps_profile_config_t;
+
+static const gps_profile_config_t m_profiles[GPS_NUM_PROFILES] = {
+	[GPS_PROFILE_TRACKER] = {"tracker", 1000, 1, 0, 0, 1},
+	[GPS_PROFILE_STATUS]  = {"status",  1000, 1, 1, 1, 1},
+	[GPS_PROFILE_WARMUP]  = {"warmup",  1000, 5, 0, 0, 5},
+};
+
+
+gps_profile_t gps_profile_select(bool status_screen, bool tracker_active)
+{
+	if(status_screen) {
+		return GPS_PROFILE_STATUS;
+	} else if(tracker_active) {
+		return GPS_PROFILE_TRACKER;
+	} else {
+		return GPS_PROFILE_WARMUP;
+	}
+}
+
+
+bool gps_profile_reports_satellites(gps_profile_t profile)
+{
+	if(profile >= GPS_NUM_PROFILES) {
+		return false;
+	}
+
+	return (m_profiles[profile].gsa != 0) && (m_profiles[profile].gsv != 0);
+}
+
+
+const char* gps_profile_to_string(gps_profile_t profile)
+{
+	if(profile >= GPS_NUM_PROFILES) {
+		return "none";
+	}
+
+	return m_profiles[profile].name;
+}
+
+
+size_t gps_profile_build_command(gps_profile_t profile, char *buf, size_t buf_len)
+{
+	char body[64];
+	size_t len, total;
+
+	if(profile >= GPS_NUM_PROFILES) {
+		return 0;
+	}
+
+	const gps_profile_config_t *cfg = &m_profiles[profile];
+
+	// fix interval in milliseconds
+	snprintf(body, sizeof(body), "PCAS02,%u", cfg->fix_interval_ms);
+
+	total = nmea_build_sentence(buf, buf_len, body);
+	if(total == 0) {
+		return 0;
+	}
+
+	// output rates: GGA, GLL, GSA, GSV, RMC, VTG, ZDA, ANT, DHV, LPS, res,
+	// res, UTC, GST, res, res, res, TIM
+	snprintf(body, sizeof(body), "PCAS03,%u,0,%u,%u,%u,0,0,0,0,0,,,0,0,,,,0",
+			cfg->gga, cfg->gsa, cfg->gsv, cfg->rmc);
+
+	len = nmea_build_sentence(buf + total, buf_len - total, body);
+	if(len == 0) {
+		return 0;
+	}
+
+	return total + len;
+}
+
+
+size_t gps_profile_build_command_casic(gps_profile_t profile, uint8_t *buf, size_t buf_len)
+{
+	char body[64];
+	size_t len, total;
+
+	if(profile >= GPS_NUM_PROFILES) {
+		return 0;
+	}
+
+	const gps_profile_config_t *cfg = &m_profiles[profile];
+
+	// binary messages replacing the NMEA sentences
+	const struct {
+		uint8_t id;
+		uint8_t rate;
+	} msgs[] = {
+		{CASIC_ID_NAV_PV,      cfg->gga},
+		{CASIC_ID_NAV_TIMEUTC, cfg->rmc},
+		{CASIC_ID_NAV_DOP,     cfg->gsa},
+		{CASIC_ID_NAV_GPSINFO, cfg->gsv},
+		{CASIC_ID_NAV_BDSINFO, cfg->gsv},
+		{CASIC_ID_NAV_GLNINFO, cfg->gsv},
+	};
+
+	snprintf(body, sizeof(body), "PCAS02,%u", cfg->fix_interval_ms);
+
+	total = nmea_build_sentence((char*)buf, buf_len, body);
+	if(total == 0) {
+		return 0;
+	}
+
+	// disable all NMEA sentences
+	len = nmea_build_sentence((char*)buf + total, buf_len - total,
+			"PCAS03,0,0,0,0,0,0,0,0,0,0,,,0,0,,,,0");
+	if(len == 0) {
+		return 0;
+	}
+
+	total += len;
+
+	for(size_t i = 0; i < sizeof(msgs) / sizeof(msgs[0]); i++) {
+		len = casic_build_cfg_msg(buf + total, buf_len - total,
+				CASIC_CLASS_NAV, msgs[i].id, msgs[i].rate);
+		if(len == 0) {
+			return 0;
+		}
+
+		total += len;
+	}
+
+	return total;
+}
+
+
+void gps_profile_fsm_init(gps_profile_fsm_t *fsm, gps_profile_t initial)
+{
+	fsm->requested    = initial;
+	fsm->active       = GPS_PROFILE_NONE;
+	fsm->module_ready = false;
+	fsm->tx_busy      = false;
+	fsm->restart_pending = false;
+	fsm->switches     = 0;
+}
+
+
+void gps_profile_fsm_power_on(gps_profile_fsm_t *fsm)
+{
+	fsm->active       = GPS_PROFILE_NONE;
+	fsm->module_ready = false;
+	fsm->tx_busy      = false;
+	fsm->restart_pending = false; // the module starts from scratch anyway
+}
+
+
+void gps_profile_fsm_module_ready(gps_profile_fsm_t *fsm)
+{
+	fsm->module_ready = true;
+}
+
+
+void gps_profile_fsm_request(gps_profile_fsm_t *fsm, gps_profile_t profile)
+{
+	if(profile < GPS_NUM_PROFILES) {
+		fsm->requested = profile;
+	}
+}
+
+
+void gps_profile_fsm_tx_done(gps_profile_fsm_t *fsm)
+{
+	fsm->tx_busy = false;
+}
+
+
+void gps_profile_fsm_tx_failed(gps_profile_fsm_t *fsm)
+{
+	fsm->tx_busy = false;
+	fsm->active  = GPS_PROFILE_NONE;
+}
+
+
+void gps_profile_fsm_request_restart(gps_profile_fsm_t *fsm)
+{
+	fsm->restart_pending = true;
+}
+
+
+bool gps_profile_fsm_poll_restart(gps_profile_fsm_t *fsm)
+{
+	if(!fsm->restart_pending || fsm->tx_busy) {
+		return false;
+	}
+
+	fsm->restart_pending = false;
+	fsm->tx_busy = true;
+	return true;
+}
+
+
+bool gps_profile_fsm_poll(gps_profile_fsm_t *fsm, gps_profile_t *profile)
+{
+	if(!fsm->module_ready || fsm->tx_busy || (fsm->requested == fsm->active)) {
+		return false;
+	}
+
+	fsm->active  = fsm->requested;
+	fsm->tx_busy = true;
+	fsm->switches++;
+
+	*profile = fsm->active;
+	return true;
+}
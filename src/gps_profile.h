@@ -0,0 +1,160 @@
+/*
+ * vim: noexpandtab
+ *
+ * Copyright (c) 2021-2022 Thomas Kolb <cfr34k-git@tkolb.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef GPS_PROFILE_H
+#define GPS_PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/* Output configuration profiles for the CASIC GNSS module. Each profile is
+ * applied by sending a $PCAS02 (fix interval) and a $PCAS03 (sentence output
+ * rates) command. Only the sentences needed in the current operating mode are
+ * enabled to reduce the UART traffic and parsing load. */
+typedef enum {
+	GPS_PROFILE_TRACKER,       // RMC + GGA only: position, speed and time
+	GPS_PROFILE_STATUS,        // RMC + GGA + GSA + GSV for the GNSS status screen
+	GPS_PROFILE_WARMUP,        // RMC + GGA every 5th fix: keep the receiver in sync
+
+	GPS_NUM_PROFILES,
+	GPS_PROFILE_NONE = GPS_NUM_PROFILES
+} gps_profile_t;
+
+// enough for one $PCAS02 and one $PCAS03 sentence including line ends, plus
+// six CFG-MSG frames for the CASIC binary protocol
+#define GPS_PROFILE_CMD_MAX_LEN  160
+
+/**@brief State of the profile configuration.
+ * @details
+ * Keeps track of the requested profile and the profile that is configured in
+ * the module. The state is updated from the main loop only.
+ */
+typedef struct {
+	gps_profile_t requested;   // profile that should be active
+	gps_profile_t active;      // profile last sent to the module; GPS_PROFILE_NONE if unknown
+	bool          module_ready; // the module has booted and accepts commands
+	bool          tx_busy;     // a command is currently being transmitted
+	bool          restart_pending; // a cold restart command is waiting to be sent
+	uint32_t      switches;    // number of profile commands sent
+} gps_profile_fsm_t;
+
+/**@brief Select the profile for the given operating state.
+ *
+ * @param[in] status_screen   The GNSS status screen is shown.
+ * @param[in] tracker_active  The tracker is running.
+ * @returns                   The profile to use.
+ */
+gps_profile_t gps_profile_select(bool status_screen, bool tracker_active);
+
+/**@brief Check whether satellite information (GSA/GSV) is output in the given profile.
+ */
+bool gps_profile_reports_satellites(gps_profile_t profile);
+
+/**@brief Retrieve a short name of the given profile for logging.
+ */
+const char* gps_profile_to_string(gps_profile_t profile);
+
+/**@brief Build the configuration commands for the given profile.
+ *
+ * @param[in]  profile  The profile to build the commands for.
+ * @param[out] buf      Buffer for the commands (including line ends).
+ * @param[in]  buf_len  Size of the buffer.
+ * @returns             The length of the commands, or 0 if the profile is
+ *                      invalid or the buffer is too small.
+ */
+size_t gps_profile_build_command(gps_profile_t profile, char *buf, size_t buf_len);
+
+/**@brief Build the configuration commands for the given profile (CASIC binary protocol).
+ * @details
+ * All NMEA output is disabled and the binary navigation messages that
+ * correspond to the sentences of the profile are enabled.
+ *
+ * @param[in]  profile  The profile to build the commands for.
+ * @param[out] buf      Buffer for the commands.
+ * @param[in]  buf_len  Size of the buffer.
+ * @returns             The length of the commands, or 0 if the profile is
+ *                      invalid or the buffer is too small.
+ */
+size_t gps_profile_build_command_casic(gps_profile_t profile, uint8_t *buf, size_t buf_len);
+
+/**@brief Initialize the profile state.
+ */
+void gps_profile_fsm_init(gps_profile_fsm_t *fsm, gps_profile_t initial);
+
+/**@brief Forget the module configuration after the module was powered on or reset.
+ * @details
+ * The profile is sent again once the module is ready.
+ */
+void gps_profile_fsm_power_on(gps_profile_fsm_t *fsm);
+
+/**@brief Indicate that the module has booted (e.g. because it sent a sentence).
+ */
+void gps_profile_fsm_module_ready(gps_profile_fsm_t *fsm);
+
+/**@brief Request a profile. It is sent on the next call to gps_profile_fsm_poll().
+ */
+void gps_profile_fsm_request(gps_profile_fsm_t *fsm, gps_profile_t profile);
+
+/**@brief Indicate that the transmission of the last command has finished.
+ */
+void gps_profile_fsm_tx_done(gps_profile_fsm_t *fsm);
+
+/**@brief Indicate that the last command could not be sent.
+ * @details
+ * The profile is sent again on the next call to gps_profile_fsm_poll().
+ */
+void gps_profile_fsm_tx_failed(gps_profile_fsm_t *fsm);
+
+/**@brief Request a cold restart of the module.
+ * @details
+ * The restart command is sent on the next call to gps_profile_fsm_poll_restart()
+ * once no other command is being transmitted.
+ */
+void gps_profile_fsm_request_restart(gps_profile_fsm_t *fsm);
+
+/**@brief Check whether the cold restart command must be sent now.
+ * @details
+ * If true is returned, the state is busy until gps_profile_fsm_tx_done() is
+ * called, so no profile command is sent while the restart command is
+ * transmitted. Call this before gps_profile_fsm_poll().
+ *
+ * @param[inout] fsm  The profile state.
+ * @returns           true if the cold restart command must be sent now.
+ */
+bool gps_profile_fsm_poll_restart(gps_profile_fsm_t *fsm);
+
+/**@brief Check whether a profile command must be sent now.
+ * @details
+ * If true is returned, the profile is considered active and the state is busy
+ * until gps_profile_fsm_tx_done() or gps_profile_fsm_tx_failed() is called.
+ *
+ * @param[inout] fsm      The profile state.
+ * @param[out]   profile  The profile to send.
+ * @returns               true if the commands for profile must be sent now.
+ */
+bool gps_profile_fsm_poll(gps_profile_fsm_t *fsm, gps_profile_t *profile);
+
+#endif // GPS_PROFILE_H
@@ -0,0 +1,76 @@
+/*
+ * vim: noexpandtab
+ *
+ * Copyright (c) 2021-2022 Thomas Kolb <cfr34k-git@tkolb.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gps_rx_idle.h"
+
+void gps_rx_idle_init(gps_rx_idle_t *idle)
+{
+	idle->delivered = 0;
+	idle->seen      = 0;
+}
+
+
+bool gps_rx_idle_transfer_done(gps_rx_idle_t *idle, size_t bytes, uint32_t byte_count)
+{
+	if(bytes < GPS_RX_CHUNK_SIZE) {
+		// aborted: all bytes received so far were delivered now (or lost in
+		// case of an error), so the count is taken over from the counter
+		idle->delivered = byte_count;
+		idle->seen      = byte_count;
+		return false;
+	}
+
+	idle->delivered += bytes;
+	idle->seen       = idle->delivered;
+	return true;
+}
+
+
+gps_rx_idle_action_t gps_rx_idle_timeout(gps_rx_idle_t *idle, uint32_t byte_count)
+{
+	if(byte_count == idle->delivered) {
+		// the burst ended exactly at the end of a buffer
+		return GPS_RX_IDLE_WAIT;
+	}
+
+	if(byte_count != idle->seen) {
+		// bytes arrived since the last check, the line may still be active
+		idle->seen = byte_count;
+		return GPS_RX_IDLE_RECHECK;
+	}
+
+	return GPS_RX_IDLE_ABORT;
+}
+
+
+uint32_t gps_rx_idle_wake_count(const gps_rx_idle_t *idle)
+{
+	return idle->delivered + 1;
+}
+
+
+bool gps_rx_idle_pending(const gps_rx_idle_t *idle, uint32_t byte_count)
+{
+	return byte_count != idle->delivered;
+}
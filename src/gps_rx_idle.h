@@ -0,0 +1,120 @@
+/*
+ * vim: noexpandtab
+ *
+ * Copyright (c) 2021-2022 Thomas Kolb <cfr34k-git@tkolb.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GPS_RX_IDLE_H
+#define GPS_RX_IDLE_H
+
+/**@file
+ *
+ * @brief Detection of the end of a GNSS data burst for the DMA reception.
+ *
+ * @details
+ * The UART receives into DMA buffers of GPS_RX_CHUNK_SIZE bytes, so the CPU
+ * is only woken up when a buffer is full. At the end of a burst, the
+ * partially filled buffer has to be flushed by aborting the transfer. This
+ * must only happen when the line is really idle: an abort while bytes arrive
+ * costs two extra wakeups and may lose bytes while the reception restarts.
+ *
+ * The received bytes are counted in hardware (RXDRDY events counted by a
+ * TIMER through PPI). This module decides from the counter and the
+ * completed transfers when the idle timer is started and when the transfer is
+ * aborted:
+ *
+ * - While all received bytes are delivered, the counter interrupts on the next
+ *   byte (compare value from gps_rx_idle_wake_count()). This starts the timer
+ *   with GPS_RX_CHUNK_TIMEOUT_MS at the beginning of each burst.
+ * - Every full buffer restarts the timer with GPS_RX_CHUNK_TIMEOUT_MS,
+ *   which is longer than one buffer takes to fill. During a burst it never
+ *   expires.
+ * - When it expires with bytes in the buffer, the counter is checked again
+ *   after GPS_RX_IDLE_TIMEOUT_MS. The transfer is aborted only if no byte
+ *   arrived in between.
+ *
+ * So a burst of n bytes causes one counter wakeup, n / GPS_RX_CHUNK_SIZE
+ * buffer wakeups, at most two timer wakeups and the aborted transfer. This
+ * also holds for bursts shorter than one buffer.
+ *
+ * It has no hardware dependencies, so the timing can be simulated on the host.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define GPS_RX_CHUNK_SIZE          32
+
+// longer than one chunk takes at 9600 baud (32 * 1.04 ms)
+#define GPS_RX_CHUNK_TIMEOUT_MS    40
+
+// the byte counter must not change for this long (about 3 byte times at 9600
+// baud) before the transfer is aborted
+#define GPS_RX_IDLE_TIMEOUT_MS      3
+
+typedef enum {
+	GPS_RX_IDLE_WAIT,     // nothing to flush: wait for the next byte
+	GPS_RX_IDLE_RECHECK,  // start the timer with GPS_RX_IDLE_TIMEOUT_MS
+	GPS_RX_IDLE_ABORT,    // the line is idle: abort the transfer to flush the buffer
+} gps_rx_idle_action_t;
+
+typedef struct {
+	uint32_t delivered;  // byte count up to the end of the last completed transfer
+	uint32_t seen;       // byte count at the last check
+} gps_rx_idle_t;
+
+/**@brief Initialize the state when the byte counter is reset.
+ */
+void gps_rx_idle_init(gps_rx_idle_t *idle);
+
+/**@brief Process a completed DMA transfer.
+ *
+ * @param idle        The detector state.
+ * @param bytes       Number of bytes in the buffer. A buffer that is not full
+ *                    was flushed by an abort.
+ * @param byte_count  Current value of the byte counter.
+ * @returns           true if the timer must be (re-)started with
+ *                    GPS_RX_CHUNK_TIMEOUT_MS, false if all bytes are
+ *                    delivered and the next byte must be waited for.
+ */
+bool gps_rx_idle_transfer_done(gps_rx_idle_t *idle, size_t bytes, uint32_t byte_count);
+
+/**@brief Process an expired idle timer.
+ *
+ * @param idle        The detector state.
+ * @param byte_count  Current value of the byte counter.
+ * @returns           What to do next.
+ */
+gps_rx_idle_action_t gps_rx_idle_timeout(gps_rx_idle_t *idle, uint32_t byte_count);
+
+/**@brief Byte count that marks the first byte after the delivered ones.
+ * @details
+ * Used as the compare value of the byte counter while waiting for the next
+ * burst.
+ */
+uint32_t gps_rx_idle_wake_count(const gps_rx_idle_t *idle);
+
+/**@brief Check whether bytes were received after the last completed transfer.
+ */
+bool gps_rx_idle_pending(const gps_rx_idle_t *idle, uint32_t byte_count);
+
+#endif // GPS_RX_IDLE_H
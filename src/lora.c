@@ -31,8 +31,6 @@
  * - Bandwidth: 125 kHz (0x04)
  */
 
-#include <math.h>
-
 #include <nrfx_spim.h>
 #include <nrf_log.h>
 #include <app_timer.h>
@@ -43,6 +41,7 @@
 #include "leds.h"
 
 #include "lora.h"
+#include "lora_toa.h"
 
 /*** OpCodes ***/
 #define SX1262_OPCODE_SET_SLEEP              0x84
@@ -302,8 +301,11 @@ static uint32_t m_busy_check_counter = 0;
 
 static sx1262_status_t m_status;
 
-static uint8_t  m_buffer_write_command[2 + 256];
+/* The TX buffer is lent to the caller via lora_tx_reserve(), so packets are
+ * encoded directly behind the SPI command header and sent without copying. */
+static uint8_t  m_buffer_write_command[2 + LORA_TX_BUFFER_SIZE];
 static uint8_t *m_buffer = m_buffer_write_command + 2;
+static bool     m_tx_reserved;
 
 #define RX_BUF_SIZE 256
 static uint8_t  m_buffer_rx[RX_BUF_SIZE];
@@ -366,28 +368,19 @@ static ret_code_t handle_state_entry(void);
 static ret_code_t handle_state_exit(void);
 
 
-static float calc_toa(
-		uint8_t sf,
-		uint8_t cr,
-		float bw_khz,
-		uint8_t n_symb_pre,
-		uint8_t n_bytes_payload,
-		bool explicit_header,
-		bool use_crc)
+static uint8_t sx1262_bandwidth(uint32_t bw_hz)
 {
-	uint8_t n_symb_header = explicit_header ? 20 : 0;
-	uint8_t n_bit_crc     = use_crc ? 16 : 0;
-
-	float arg = 8*n_bytes_payload + n_bit_crc - 4*sf + n_symb_header;
-
-	if(arg < 0) {
-		arg = 0;
+	switch(bw_hz) {
+		case   7810: return SX1262_LORA_BW_7;
+		case  10420: return SX1262_LORA_BW_10;
+		case  15630: return SX1262_LORA_BW_15;
+		case  20830: return SX1262_LORA_BW_20;
+		case  31250: return SX1262_LORA_BW_31;
+		case  41670: return SX1262_LORA_BW_41;
+		case  62500: return SX1262_LORA_BW_62;
+		case 250000: return SX1262_LORA_BW_250;
+		default:     return SX1262_LORA_BW_125;
 	}
-
-	float n_symb = n_symb_pre + 4.25 + 8
-		+ (int)(1.0f + arg / (4*sf)) * (cr+4);
-
-	return pow(2, sf) / bw_khz * n_symb;
 }
 
 
@@ -461,9 +454,8 @@ static ret_code_t handle_state_exit(void)
 
 		case LORA_STATE_READ_PACKET_DATA:
 			// the first three bytes contain the status byte and must be
-			// removed to get the payload alone.
-			m_buffer_rx[m_rx_packet_len+3] = '\0';
-
+			// removed to get the payload alone. The payload is not
+			// NUL-terminated; aprs_parse_frame() is length-bounded.
 			m_evt_data.rx_packet_data.data     = m_buffer_rx + 3;
 			m_evt_data.rx_packet_data.data_len = m_rx_packet_len;
 
@@ -598,11 +590,12 @@ static ret_code_t handle_state_entry(void)
 			//command[3] = SX1262_LORA_CR_4_5;
 			//command[4] = SX1262_LORA_LDRO_OFF;
 
-			// Settings used by LoRa-APRS
-			command[1] = SX1262_LORA_SF_12;
-			command[2] = SX1262_LORA_BW_125;
-			command[3] = SX1262_LORA_CR_4_5;
-			command[4] = SX1262_LORA_LDRO_ON;
+			// Settings used by LoRa-APRS. The time on air calculation uses the
+			// same parameters.
+			command[1] = LORA_MODULATION_APRS.sf; // SF5..SF12 = 0x05..0x0C
+			command[2] = sx1262_bandwidth(LORA_MODULATION_APRS.bw_hz);
+			command[3] = LORA_MODULATION_APRS.cr; // CR 4/5..4/8 = 0x01..0x04
+			command[4] = LORA_MODULATION_APRS.ldro ? SX1262_LORA_LDRO_ON : SX1262_LORA_LDRO_OFF;
 
 			APP_ERROR_CHECK(send_command(command, 5, &m_status));
 			break;
@@ -640,11 +633,12 @@ static ret_code_t handle_state_entry(void)
 
 			// IMPORTANT! The preamble *must* be exactly 8 symbols long to make the
 			// ESP32/SX127x devices receive the message correctly.
-			command[1] = 0x00; // 8 preamble symbols: MSB
-			command[2] = 0x08; // 8 preamble symbols: LSB
-			command[3] = SX1262_LORA_HEADER_TYPE_EXPLICIT;
+			command[1] = LORA_MODULATION_APRS.n_preamble >> 8;   // preamble symbols: MSB
+			command[2] = LORA_MODULATION_APRS.n_preamble & 0xFF; // preamble symbols: LSB
+			command[3] = LORA_MODULATION_APRS.explicit_header
+				? SX1262_LORA_HEADER_TYPE_EXPLICIT : SX1262_LORA_HEADER_TYPE_IMPLICIT;
 			command[4] = m_payload_length;
-			command[5] = SX1262_LORA_CRC_TYPE_ON;
+			command[5] = LORA_MODULATION_APRS.crc ? SX1262_LORA_CRC_TYPE_ON : SX1262_LORA_CRC_TYPE_OFF;
 			command[6] = SX1262_LORA_INVERT_IQ_OFF;
 
 			APP_ERROR_CHECK(send_command(command, 7, &m_status));
@@ -688,18 +682,12 @@ static ret_code_t handle_state_entry(void)
 
 		case LORA_STATE_START_TX:
 			{
-				float toa = calc_toa(
-						12,     // SF
-						1,      // CR=4/5
-						125.0f, // BW
-						16,     // preamble symbols
-						m_payload_length,
-						true,   // explicit header
-						true);  // use CRC
-
-				m_tx_timeout = 1.50f * toa * 1000.0f / TX_DONE_POLL_INTERVAL_MS;
-
-				NRF_LOG_INFO("lora: expected time on air: %d ms", (int)(toa));
+				uint32_t toa_ms = lora_toa_ms(&LORA_MODULATION_APRS, m_payload_length);
+
+				// 50 % margin, rounded up to the next poll
+				m_tx_timeout = (3 * toa_ms / 2) / TX_DONE_POLL_INTERVAL_MS + 1;
+
+				NRF_LOG_INFO("lora: expected time on air: %d ms", toa_ms);
 			}
 
 			command[0] = SX1262_OPCODE_SET_TX;
@@ -729,11 +717,12 @@ static ret_code_t handle_state_entry(void)
 
 			// IMPORTANT! For best compatibility with the ESP32/SX127x devices we
 			// also use 8 preamble symbols here.
-			command[1] = 0x00; // 8 preamble symbols: MSB
-			command[2] = 0x08; // 8 preamble symbols: LSB
-			command[3] = SX1262_LORA_HEADER_TYPE_EXPLICIT;
+			command[1] = LORA_MODULATION_APRS.n_preamble >> 8;   // preamble symbols: MSB
+			command[2] = LORA_MODULATION_APRS.n_preamble & 0xFF; // preamble symbols: LSB
+			command[3] = LORA_MODULATION_APRS.explicit_header
+				? SX1262_LORA_HEADER_TYPE_EXPLICIT : SX1262_LORA_HEADER_TYPE_IMPLICIT;
 			command[4] = 0xFF; // expect up to 255 bytes
-			command[5] = SX1262_LORA_CRC_TYPE_ON;
+			command[5] = LORA_MODULATION_APRS.crc ? SX1262_LORA_CRC_TYPE_ON : SX1262_LORA_CRC_TYPE_OFF;
 			command[6] = SX1262_LORA_INVERT_IQ_OFF;
 
 			APP_ERROR_CHECK(send_command(command, 7, &m_status));
@@ -1114,11 +1103,62 @@ void lora_power_off(void)
 }
 
 
-ret_code_t lora_send_packet(const uint8_t *data, uint8_t length)
+/**@brief Check whether a new packet can be accepted in the current state.
+ */
+static bool tx_possible(void)
+{
+	if(m_payload_length != 0) {
+		// previous packet not sent yet
+		return false;
+	}
+
+	switch(m_state) {
+		case LORA_STATE_OFF:
+		case LORA_STATE_CONFIGURED_IDLE:
+		case LORA_STATE_WAIT_PACKET_RECEIVED:
+		case LORA_STATE_READ_PACKET_DATA:
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+
+uint8_t* lora_tx_reserve(void)
 {
-	// copy the data to send
+	if(m_tx_reserved || !tx_possible()) {
+		return NULL;
+	}
+
+	m_tx_reserved = true;
+	return m_buffer;
+}
+
+
+void lora_tx_cancel(void)
+{
+	m_tx_reserved = false;
+}
+
+
+ret_code_t lora_tx_commit(uint8_t length)
+{
+	if(!m_tx_reserved) {
+		return NRF_ERROR_INVALID_STATE;
+	}
+
+	m_tx_reserved = false;
+
+	if(length == 0) {
+		return NRF_ERROR_INVALID_LENGTH;
+	}
+
+	if(!tx_possible()) {
+		return NRF_ERROR_BUSY;
+	}
+
 	m_payload_length = length;
-	memcpy(m_buffer, data, length);
 
 	switch(m_state) {
 		case LORA_STATE_OFF:
@@ -1140,6 +1180,8 @@ ret_code_t lora_send_packet(const uint8_t *data, uint8_t length)
 			break;
 
 		default:
+			// cannot happen, see tx_possible()
+			m_payload_length = 0;
 			return NRF_ERROR_BUSY;
 	}
 
@@ -1147,6 +1189,20 @@ ret_code_t lora_send_packet(const uint8_t *data, uint8_t length)
 }
 
 
+ret_code_t lora_send_packet(const uint8_t *data, uint8_t length)
+{
+	uint8_t *buffer = lora_tx_reserve();
+
+	if(!buffer) {
+		return NRF_ERROR_BUSY;
+	}
+
+	memcpy(buffer, data, length);
+
+	return lora_tx_commit(length);
+}
+
+
 ret_code_t lora_start_rx(void)
 {
 	switch(m_state) {
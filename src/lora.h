@@ -35,6 +35,11 @@
 	#include <sdk_errors.h>
 #endif
 
+// size of the buffer returned by lora_tx_reserve(). The maximum packet length
+// is one byte less, so a frame can always be NUL-terminated in the buffer.
+#define LORA_TX_BUFFER_SIZE  256
+#define LORA_MAX_PACKET_LEN  255
+
 typedef enum
 {
 	LORA_EVT_CONFIGURED_IDLE,
@@ -79,6 +84,29 @@ ret_code_t lora_init(lora_callback_t callback);
 ret_code_t lora_power_on(void);
 void lora_power_off(void);
 ret_code_t lora_send_packet(const uint8_t *data, uint8_t length);
+
+/**@brief Borrow the TX buffer to build a packet in place.
+ * @details
+ * The buffer has LORA_TX_BUFFER_SIZE bytes and stays reserved until
+ * lora_tx_commit() or lora_tx_cancel() is called.
+ *
+ * @returns  Pointer to the TX buffer, or NULL if a packet is already reserved
+ *           or pending, or the module is busy.
+ */
+uint8_t* lora_tx_reserve(void);
+
+/**@brief Send the packet that was built in the reserved TX buffer.
+ *
+ * @param length   Length of the packet (1 to LORA_MAX_PACKET_LEN).
+ * @retval NRF_ERROR_INVALID_STATE   The buffer was not reserved.
+ * @retval NRF_ERROR_INVALID_LENGTH  The packet is empty. The reservation is released.
+ * @retval NRF_SUCCESS               The transmission was started.
+ */
+ret_code_t lora_tx_commit(uint8_t length);
+
+/**@brief Release the reserved TX buffer without sending.
+ */
+void lora_tx_cancel(void);
 ret_code_t lora_start_rx(void);
 bool lora_is_busy(void);
 void lora_loop(void);
@@ -0,0 +1,88 @@
+/*
+ * vim: noexpandtab
+ *
+ * Copyright (c) 2021-2022 Thomas Kolb <cfr34k-git@tkolb.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "lora_toa.h"
+
+const lora_modulation_t LORA_MODULATION_APRS = {
+	.sf              = 12,
+	.cr              = 1,      // 4/5
+	.bw_hz           = 125000,
+	.ldro            = true,   // mandatory for SF12 at 125 kHz
+	.n_preamble      = 8,
+	.explicit_header = true,
+	.crc             = true,
+};
+
+uint32_t lora_toa_us(const lora_modulation_t *mod, uint8_t payload_len)
+{
+	int32_t  bits = 8 * (int32_t)payload_len - 4 * mod->sf;
+	uint32_t bits_per_block = 4 * (mod->sf - ((mod->ldro) ? 2 : 0));
+	uint32_t n_blocks = 0;
+	uint32_t quarter_symbols;
+
+	if(mod->crc) {
+		bits += 16;
+	}
+
+	if(mod->explicit_header) {
+		bits += 20;
+	}
+
+	// the preamble is 2 symbols longer for SF5 and SF6, but the first block
+	// carries 8 bits less
+	if(mod->sf >= 7) {
+		bits += 8;
+		quarter_symbols = 4 * mod->n_preamble + 17; // preamble + 4.25 symbols
+	} else {
+		quarter_symbols = 4 * mod->n_preamble + 25; // preamble + 6.25 symbols
+	}
+
+	if(bits > 0) {
+		n_blocks = ((uint32_t)bits + bits_per_block - 1) / bits_per_block;
+	}
+
+	// 8 symbols for the first block, then (4+cr) symbols per block
+	quarter_symbols += 4 * (8 + n_blocks * (4 + mod->cr));
+
+	// T_sym = 2^SF / BW
+	return (uint32_t)(((uint64_t)quarter_symbols * (1000000ULL << mod->sf)) / (4ULL * mod->bw_hz));
+}
+
+uint32_t lora_toa_ms(const lora_modulation_t *mod, uint8_t payload_len)
+{
+	return (lora_toa_us(mod, payload_len) + 999) / 1000;
+}
+
+int16_t lora_toa_max_payload(const lora_modulation_t *mod, uint32_t toa_ms)
+{
+	int16_t len = -1;
+
+	// the time on air grows monotonically with the payload length
+	while(len < 255 && lora_toa_ms(mod, (uint8_t)(len + 1)) <= toa_ms) {
+		len++;
+	}
+
+	return len;
+}
@@ -0,0 +1,74 @@
+/*
+ * vim: noexpandtab
+ *
+ * Copyright (c) 2021-2022 Thomas Kolb <cfr34k-git@tkolb.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef LORA_TOA_H
+#define LORA_TOA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* LoRa modulation and packet parameters that determine the time on air of a
+ * packet. The values map directly to the SX1262 SetModulationParams and
+ * SetPacketParams commands. */
+typedef struct {
+	uint8_t  sf;              // spreading factor, 5 to 12
+	uint8_t  cr;              // coding rate 4/(4+cr), cr = 1 to 4
+	uint32_t bw_hz;           // bandwidth in Hz
+	bool     ldro;            // low data rate optimization
+	uint16_t n_preamble;      // number of preamble symbols
+	bool     explicit_header; // packet length and coding rate are sent in a header
+	bool     crc;             // a 16 bit payload CRC is appended
+} lora_modulation_t;
+
+/* Modulation used for LoRa-APRS: SF12, BW 125 kHz, CR 4/5, 8 preamble symbols.
+ * The preamble *must* be exactly 8 symbols long to make the ESP32/SX127x
+ * devices receive the message correctly. */
+extern const lora_modulation_t LORA_MODULATION_APRS;
+
+/**@brief Calculate the time on air of a packet.
+ * @details
+ * Implements the exact formula from the SX1262 datasheet (section 6.1.4),
+ * using integer arithmetic only.
+ *
+ * @param[in] mod          The modulation parameters.
+ * @param[in] payload_len  The payload length in bytes.
+ * @returns                The time on air in microseconds.
+ */
+uint32_t lora_toa_us(const lora_modulation_t *mod, uint8_t payload_len);
+
+/**@brief Calculate the time on air of a packet, rounded up to full milliseconds.
+ */
+uint32_t lora_toa_ms(const lora_modulation_t *mod, uint8_t payload_len);
+
+/**@brief Calculate the largest payload that can be sent within the given time.
+ *
+ * @param[in] mod       The modulation parameters.
+ * @param[in] toa_ms    The maximum time on air in milliseconds.
+ * @returns             The maximum payload length in bytes, or -1 if not even
+ *                      an empty packet fits.
+ */
+int16_t lora_toa_max_payload(const lora_modulation_t *mod, uint32_t toa_ms);
+
+#endif // LORA_TOA_H
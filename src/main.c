@@ -101,6 +101,8 @@
 #include "bme280.h"
 
 #include "aprs.h"
+#include "aprs_dedup.h"
+#include "aprs_history_store.h"
 
 #include "config.h"
 
@@ -167,7 +169,8 @@ bool m_nmea_has_position = false;
 
 display_state_t m_display_state = DISP_STATE_STARTUP;
 display_state_t m_prev_display_state = DISP_CYCLE_FIRST;
-uint8_t         m_display_rx_index = 0;
+uint16_t        m_display_rx_index = 0;
+aprs_rx_history_order_t m_display_rx_order = APRS_RX_HISTORY_BY_TIME;
 
 aprs_rx_raw_data_t m_last_undecodable_data;
 uint64_t m_last_undecodable_timestamp;
@@ -433,6 +436,22 @@ static void cb_aprs_service(aprs_service_evt_t evt)
 				aprs_set_icon(table, symbol);
 			}
 			break;
+
+		case APRS_SERVICE_EVT_SMARTBEACON_CHANGED:
+			{
+				tracker_smartbeacon_t params;
+
+				APP_ERROR_CHECK(aprs_service_get_smartbeacon(&m_aprs_service, &params));
+
+				if(tracker_set_smartbeacon(&params) == NRF_SUCCESS) {
+					settings_write(SETTINGS_ID_SMARTBEACON, (const uint8_t *)&params, sizeof(params));
+				} else {
+					// show the client that the parameters were rejected
+					NRF_LOG_WARNING("Invalid SmartBeaconing parameters rejected");
+					aprs_service_set_smartbeacon(&m_aprs_service, tracker_get_smartbeacon());
+				}
+			}
+			break;
 	}
 }
 
@@ -728,11 +747,15 @@ static void cb_gps(gps_evt_t evt, const nmea_data_t *data)
 			APP_ERROR_CHECK(gps_power_off());
 			break;
 
-		case GPS_EVT_DATA_RECEIVED:
+		case GPS_EVT_EPOCH_COMPLETE:
 			// make a copy for display rendering
 			m_nmea_data = *data;
 			m_nmea_has_position = m_nmea_has_position || m_nmea_data.pos_valid;
 
+			if(data->pos_valid) {
+				aprs_rx_history_set_reference(data->lat, data->lon);
+			}
+
 			//APP_ERROR_CHECK(lns_wrap_update_data(data));
 
 			if(data->datetime_valid) {
@@ -767,13 +790,37 @@ static void cb_lora(lora_evt_t evt, const lora_evt_data_t *data)
 	aprs_frame_t decoded_frame;
 	aprs_rx_raw_data_t raw;
 
+	char dup_source[sizeof(decoded_frame.source)];
+
 	bool switch_to_rxd = (m_display_state != DISP_STATE_LORA_PACKET_DETAIL && m_display_state != DISP_STATE_NAVIGATION);
 
 	switch(evt)
 	{
 		case LORA_EVT_PACKET_RECEIVED:
-			// try to parse the packet.
 			rx_timestamp = wall_clock_get_unix();
+
+			// copies of a recently received frame (e.g. from several
+			// digipeaters) only update the signal data. They are neither
+			// decoded nor forwarded via BLE and do not trigger a redraw.
+			if(aprs_dedup_check(data->rx_packet_data.data,
+			                    data->rx_packet_data.data_len,
+			                    time_base_get(),
+			                    dup_source, sizeof(dup_source))) {
+				raw.rssi       = data->rx_packet_data.rssi;
+				raw.signalRssi = data->rx_packet_data.signalRssi;
+				raw.snr        = data->rx_packet_data.snr;
+
+				aprs_history_store_add(
+						aprs_rx_history_update_signal(dup_source, &raw, rx_timestamp));
+
+				NRF_LOG_INFO("lora: duplicate frame dropped (%u hits, %u misses)",
+						aprs_dedup_get_stats()->hits, aprs_dedup_get_stats()->misses);
+
+				m_lora_rx_busy = false;
+				break;
+			}
+
+			// try to parse the packet.
 			decode_ok = aprs_parse_frame(
 			                       data->rx_packet_data.data,
 			                       data->rx_packet_data.data_len,
@@ -787,15 +834,17 @@ static void cb_lora(lora_evt_t evt, const lora_evt_data_t *data)
 				memcpy(raw.data, data->rx_packet_data.data, data->rx_packet_data.data_len);
 				raw.data_len = data->rx_packet_data.data_len;
 
-				uint8_t idx = aprs_rx_history_insert(
+				uint16_t idx = aprs_rx_history_insert(
 						&decoded_frame,
 						&raw,
 						rx_timestamp,
 						m_display_rx_index);
 
+				aprs_history_store_add(idx);
+
 				if(switch_to_rxd) {
 					// don't switch to rxd if we hear our own packet
-					if (strcmp(decoded_frame.source, aprs_get_source(NULL, -1))) {
+					if (!aprs_is_own_source(&decoded_frame)) {
 						m_display_rx_index = idx;
 					} else {
 						switch_to_rxd = false;
@@ -941,21 +990,34 @@ static void cb_buttons(uint8_t btn_id, uint8_t evt)
 					if(menusystem_is_active()) {
 						menusystem_input(MENUSYSTEM_INPUT_NEXT);
 					} else if(m_display_state == DISP_STATE_LORA_RX_OVERVIEW) {
-						const aprs_rx_history_t *history = aprs_get_rx_history();
+						// select the next station in the displayed order, the
+						// error line after the last one and then the first
+						// station again
+						uint16_t num_stations = aprs_rx_history_get_stats()->num_stations;
+						uint16_t pos = aprs_rx_history_get_position(m_display_rx_order, m_display_rx_index);
 
-						// skip unset entries
-						do {
-							m_display_rx_index++;
-						} while(m_display_rx_index < APRS_RX_HISTORY_SIZE
-								&& history->history[m_display_rx_index].rx_timestamp == 0);
+						pos = (pos < num_stations) ? pos + 1 : 0;
 
-						m_display_rx_index %= (APRS_RX_HISTORY_SIZE + 1);
+						if(aprs_rx_history_get_sorted(m_display_rx_order, pos, &m_display_rx_index, 1) == 0) {
+							m_display_rx_index = APRS_RX_HISTORY_SIZE;
+						}
 					}
 
 					// always refresh the display when touch button is pressed
 					// (only uses minimal additional power because the
 					// backlight is on anyways and the display therefore
 					// already powered).
+					m_epaper_update_requested = true;
+				}
+			} else if(evt == BUTTONS_EVT_LONGPRESS) {
+				// change the order of the station list and start at its top
+				if(!menusystem_is_active() && m_display_state == DISP_STATE_LORA_RX_OVERVIEW) {
+					m_display_rx_order = (m_display_rx_order + 1) % APRS_RX_HISTORY_NUM_ORDERS;
+
+					if(aprs_rx_history_get_sorted(m_display_rx_order, 0, &m_display_rx_index, 1) == 0) {
+						m_display_rx_index = APRS_RX_HISTORY_SIZE;
+					}
+
 					m_epaper_update_requested = true;
 				}
 			}
@@ -1070,6 +1132,28 @@ static void cb_settings(settings_evt_t evt, settings_id_t id)
 				NRF_LOG_WARNING("Error while loading APRS flags: 0x%08x", err_code);
 				// use default flags set in aprs_init().
 			}
+
+			len = sizeof(buffer);
+			err_code = settings_query(SETTINGS_ID_SMARTBEACON, buffer, &len);
+			if(err_code == NRF_SUCCESS) {
+				tracker_smartbeacon_t params;
+
+				if(len < sizeof(params)) {
+					err_code = NRF_ERROR_INVALID_LENGTH;
+				} else {
+					memcpy(&params, buffer, sizeof(params));
+					err_code = tracker_set_smartbeacon(&params);
+				}
+			}
+
+			if(err_code == NRF_SUCCESS) {
+				NRF_LOG_INFO("SmartBeaconing parameters loaded");
+			} else {
+				NRF_LOG_WARNING("Error while loading SmartBeaconing parameters: 0x%08x", err_code);
+				// use the defaults of tracker.c
+			}
+
+			aprs_service_set_smartbeacon(&m_aprs_service, tracker_get_smartbeacon());
 			break;
 
 		case SETTINGS_EVT_UPDATE_COMPLETE:
@@ -1423,6 +1507,7 @@ int main(void)
 
 	// settings set some values in this module, so we must initialize it first.
 	aprs_init();
+	aprs_dedup_init();
 
 	// load the settings (must be done before peer_manager_init()!)
 	settings_init(cb_settings);
@@ -1435,6 +1520,9 @@ int main(void)
 	conn_params_init();
 	peer_manager_init();
 
+	// the history store writes through the SoftDevice
+	APP_ERROR_CHECK(aprs_history_store_init());
+
 	buttons_leds_init();
 
 	periph_pwr_init();
@@ -1487,8 +1575,12 @@ int main(void)
 		}
 
 		epaper_loop();
+
+		// only request satellite details from the GNSS module while they are shown
+		gps_set_profile(gps_profile_select(m_display_state == DISP_STATE_GPS, m_tracker_active));
 		gps_loop();
 		lora_loop();
+		aprs_history_store_loop();
 
 		idle_state_handle();
 	}
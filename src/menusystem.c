@@ -62,6 +62,9 @@ enum aprs_config_adv_entry_ids_t {
 	APRS_CONFIG_ADV_ENTRY_IDX_PACKET_ID         = 1,
 	APRS_CONFIG_ADV_ENTRY_IDX_VBAT              = 2,
 	APRS_CONFIG_ADV_ENTRY_IDX_WEATHER           = 3,
+	APRS_CONFIG_ADV_ENTRY_IDX_MIC_E             = 4,
+	APRS_CONFIG_ADV_ENTRY_IDX_COURSE_SPEED      = 5,
+	APRS_CONFIG_ADV_ENTRY_IDX_TELEMETRY         = 6,
 
 	APRS_CONFIG_ADV_ENTRY_COUNT
 };
@@ -226,6 +229,27 @@ static void menusystem_update_values(void)
 		strncpy(entry->value,  "off", sizeof(entry->value));
 	}
 
+	entry = &(m_aprs_config_adv_menu.entries[APRS_CONFIG_ADV_ENTRY_IDX_MIC_E]);
+	if(aprs_flags & APRS_FLAG_MIC_E) {
+		strncpy(entry->value,  "on", sizeof(entry->value));
+	} else {
+		strncpy(entry->value,  "off", sizeof(entry->value));
+	}
+
+	entry = &(m_aprs_config_adv_menu.entries[APRS_CONFIG_ADV_ENTRY_IDX_COURSE_SPEED]);
+	if(aprs_flags & APRS_FLAG_COMPRESSED_COURSE_SPEED) {
+		strncpy(entry->value,  "on", sizeof(entry->value));
+	} else {
+		strncpy(entry->value,  "off", sizeof(entry->value));
+	}
+
+	entry = &(m_aprs_config_adv_menu.entries[APRS_CONFIG_ADV_ENTRY_IDX_TELEMETRY]);
+	if(aprs_flags & APRS_FLAG_TELEMETRY) {
+		strncpy(entry->value,  "on", sizeof(entry->value));
+	} else {
+		strncpy(entry->value,  "off", sizeof(entry->value));
+	}
+
 	// info menu
 	entry = &(m_info_menu.entries[INFO_ENTRY_IDX_APRS_SOURCE]);
 	aprs_get_source(entry->value, sizeof(entry->value));
@@ -381,6 +405,21 @@ static void menu_handler_aprs_config_adv(menu_t *menu, menuentry_t *entry)
 			}
 			break;
 
+		case APRS_CONFIG_ADV_ENTRY_IDX_MIC_E:
+			aprs_toggle_config_flag(APRS_FLAG_MIC_E);
+			flags_changed = true;
+			break;
+
+		case APRS_CONFIG_ADV_ENTRY_IDX_COURSE_SPEED:
+			aprs_toggle_config_flag(APRS_FLAG_COMPRESSED_COURSE_SPEED);
+			flags_changed = true;
+			break;
+
+		case APRS_CONFIG_ADV_ENTRY_IDX_TELEMETRY:
+			aprs_toggle_config_flag(APRS_FLAG_TELEMETRY);
+			flags_changed = true;
+			break;
+
 		default:
 			m_selected_entry = 0;
 			m_callback(MENUSYSTEM_EVT_REDRAW_REQUIRED, NULL);
@@ -583,6 +622,18 @@ void menusystem_init(menusystem_callback_t callback)
 	m_aprs_config_adv_menu.entries[APRS_CONFIG_ADV_ENTRY_IDX_WEATHER].text = "Weather report";
 	m_aprs_config_adv_menu.entries[APRS_CONFIG_ADV_ENTRY_IDX_WEATHER].value[0] = '\0';
 
+	m_aprs_config_adv_menu.entries[APRS_CONFIG_ADV_ENTRY_IDX_MIC_E].handler = menu_handler_aprs_config_adv;
+	m_aprs_config_adv_menu.entries[APRS_CONFIG_ADV_ENTRY_IDX_MIC_E].text = "Mic-E format";
+	m_aprs_config_adv_menu.entries[APRS_CONFIG_ADV_ENTRY_IDX_MIC_E].value[0] = '\0';
+
+	m_aprs_config_adv_menu.entries[APRS_CONFIG_ADV_ENTRY_IDX_COURSE_SPEED].handler = menu_handler_aprs_config_adv;
+	m_aprs_config_adv_menu.entries[APRS_CONFIG_ADV_ENTRY_IDX_COURSE_SPEED].text = "Compr. course/speed";
+	m_aprs_config_adv_menu.entries[APRS_CONFIG_ADV_ENTRY_IDX_COURSE_SPEED].value[0] = '\0';
+
+	m_aprs_config_adv_menu.entries[APRS_CONFIG_ADV_ENTRY_IDX_TELEMETRY].handler = menu_handler_aprs_config_adv;
+	m_aprs_config_adv_menu.entries[APRS_CONFIG_ADV_ENTRY_IDX_TELEMETRY].text = "Telemetry";
+	m_aprs_config_adv_menu.entries[APRS_CONFIG_ADV_ENTRY_IDX_TELEMETRY].value[0] = '\0';
+
 	// prepare the symbol select menu
 	m_symbol_select_menu.n_entries = SYMBOL_SELECT_ENTRY_COUNT;
 	m_symbol_select_menu.entries = m_symbol_select_entries;
@@ -23,7 +23,6 @@
  */
 
 #include <stdint.h>
-#include <stdlib.h>
 #include <string.h>
 
 #include <nrf_log.h>
@@ -45,90 +44,193 @@ static uint8_t hexchar2num(char hex)
 	}
 }
 
-#define INVALID_COORD 1024.0f
-
-static float nmea_coord_to_float(const char *token)
+/**@brief Parse a decimal number into a fixed-point integer.
+ * @details
+ * The number is scaled by 10^decimals, i.e. "12.345" with decimals = 2 results
+ * in 1234. Additional fractional digits are truncated. An optional leading '-'
+ * is accepted.
+ *
+ * @param[in]  token     The field to parse.
+ * @param[in]  decimals  Number of fractional digits in the result.
+ * @param[out] value     The parsed value.
+ * @returns              true if the field contained a valid number, false if it
+ *                       was empty or contained invalid characters.
+ */
+static bool nmea_parse_fixed(const char *token, uint8_t decimals, int32_t *value)
 {
-	char *dot = strchr(token, '.');
-	if(!dot) {
-		NRF_LOG_ERROR("nmea: could not find float in coordinate: '%s'", token);
-		return INVALID_COORD;
+	bool negative = false;
+	uint8_t digits = 0;
+	int32_t result = 0;
+
+	if(*token == '-') {
+		negative = true;
+		token++;
 	}
 
-	size_t dotpos = dot - token;
+	// integer part. Digits beyond the limit below are only counted, so the
+	// result cannot overflow before the check.
+	while(*token >= '0' && *token <= '9') {
+		if(digits < 9) {
+			result = result * 10 + (*token - '0');
+		}
+		token++;
+		digits++;
+	}
 
-	if((dotpos != 4) && (dotpos != 5)) {
-		NRF_LOG_ERROR("nmea: wrong dot position %d in coordinate: '%s'", dotpos, token);
-		return INVALID_COORD;
+	if(*token == '.') {
+		token++;
 	}
 
-	size_t degrees_len = dotpos - 2;
+	// fractional part
+	while(*token >= '0' && *token <= '9') {
+		if(decimals > 0) {
+			if(digits < 9) {
+				result = result * 10 + (*token - '0');
+			}
+			decimals--;
+			digits++;
+		}
 
-	float minutes;
-	char *endptr;
+		token++;
+	}
 
-	minutes = strtof(token + degrees_len, &endptr);
+	// the limit on the number of digits prevents overflows
+	if(*token != '\0' || digits == 0 || (digits + decimals) > 9) {
+		return false;
+	}
 
-	if(!endptr) {
-		NRF_LOG_ERROR("nmea: could not convert minute value to float: '%s'", token + degrees_len);
-		return INVALID_COORD;
+	// pad missing fractional digits
+	while(decimals > 0) {
+		result *= 10;
+		decimals--;
 	}
 
-	char degstr[4];
-	strncpy(degstr, token, degrees_len);
-	degstr[degrees_len] = '\0';
+	*value = negative ? -result : result;
+	return true;
+}
+
+/**@brief Parse a non-negative integer field. Parsing stops at the first non-digit.
+ *
+ * @returns  The parsed value or -1 if the field does not start with a digit.
+ *           Values above 999999999 are truncated to their first 9 digits.
+ */
+static int32_t nmea_parse_uint(const char *token)
+{
+	int32_t result = 0;
+	uint8_t digits = 0;
 
-	long degrees = strtol(degstr, &endptr, 10);
+	if(*token < '0' || *token > '9') {
+		return -1;
+	}
 
-	if(!endptr) {
-		NRF_LOG_ERROR("nmea: could not convert degrees string to integer: '%s'", degstr);
-		return INVALID_COORD;
+	while(*token >= '0' && *token <= '9') {
+		if(digits < 9) {
+			result = result * 10 + (*token - '0');
+			digits++;
+		}
+		token++;
 	}
 
-	return (float)degrees + minutes / 60.0f;
+	return result;
 }
 
-static float nmea_sign_from_char(char *polarity)
+/**@brief Parse two decimal digits.
+ *
+ * @returns  The parsed value or -1 if the characters are not digits.
+ */
+static int8_t nmea_parse_2digits(const char *s)
 {
-	char c = polarity[0];
-
-	if((c == 'N') || (c == 'E')) {
-		return 1.0f;
-	} else if((c == 'S') || (c == 'W')) {
-		return -1.0f;
-	} else {
-		NRF_LOG_ERROR("nmea: polarity char is not one of NSEW: '%s'", polarity);
-		return INVALID_COORD;
+	if(s[0] < '0' || s[0] > '9' || s[1] < '0' || s[1] > '9') {
+		return -1;
 	}
+
+	return (s[0] - '0') * 10 + (s[1] - '0');
 }
 
-/**@brief Tokenize the given string into parts separated by given character.
+/**@brief Convert a coordinate in NMEA format (dddmm.mmmm) into 1e-7 degrees.
  * @details
- * This works like the standard C function strtok(), but can recognize empty fields.
+ * This is done in integer arithmetic only, so the full precision of the
+ * minutes field is preserved. The result is rounded to the nearest unit.
+ *
+ * @param[in]  token     The coordinate field.
+ * @param[out] coord_e7  The coordinate in units of 1e-7 degrees.
+ * @returns              true if the coordinate was valid.
  */
-static char* nmea_tokenize(char *input_str, char sep)
+static bool nmea_coord_to_e7(const char *token, int32_t *coord_e7)
 {
-	static char *next_token_ptr = NULL;
+	int32_t degrees_minutes = 0;
+	int32_t minutes_frac = 0; // fractional minutes, scaled by 1e7
+	int32_t scale = 1000000;
+	size_t int_len = 0;
+
+	if(*token == '\0') {
+		// no fix yet
+		return false;
+	}
+
+	while(*token >= '0' && *token <= '9') {
+		if(int_len < 5) {
+			degrees_minutes = degrees_minutes * 10 + (*token - '0');
+		}
+		token++;
+		int_len++;
+	}
+
+	if((*token != '.') || (int_len != 4 && int_len != 5)) {
+		NRF_LOG_ERROR("nmea: invalid coordinate format");
+		return false;
+	}
 
-	if(input_str) {
-		next_token_ptr = input_str;
+	token++;
+
+	while(*token >= '0' && *token <= '9') {
+		minutes_frac += (*token++ - '0') * scale;
+		scale /= 10;
 	}
 
-	if(!next_token_ptr) {
-		return NULL;
+	if(*token != '\0') {
+		NRF_LOG_ERROR("nmea: invalid character in coordinate");
+		return false;
 	}
 
-	char *cur_token = next_token_ptr;
+	int32_t degrees = degrees_minutes / 100;
+	int32_t minutes_e7 = (degrees_minutes % 100) * 10000000 + minutes_frac;
+
+	if(minutes_e7 >= 600000000 || degrees > 180) {
+		NRF_LOG_ERROR("nmea: coordinate out of range");
+		return false;
+	}
 
-	char *next_sep = strchr(next_token_ptr, sep);
-	if(!next_sep) {
-		next_token_ptr = NULL;
+	*coord_e7 = degrees * 10000000 + (minutes_e7 + 30) / 60;
+	return true;
+}
+
+/**@brief Apply the hemisphere indicator to a coordinate.
+ *
+ * @returns  false if the polarity char is not one of NSEW.
+ */
+static bool nmea_apply_sign(const char *polarity, int32_t *coord_e7)
+{
+	char c = polarity[0];
+
+	if((c == 'N') || (c == 'E')) {
+		return true;
+	} else if((c == 'S') || (c == 'W')) {
+		*coord_e7 = -*coord_e7;
+		return true;
 	} else {
-		*next_sep = '\0';
-		next_token_ptr = next_sep + 1;
+		NRF_LOG_ERROR("nmea: polarity char is not one of NSEW: '%s'", polarity);
+		return false;
 	}
+}
+
+/**@brief Convert a fixed-point value with the given number of decimals to float.
+ */
+static float fixed_to_float(int32_t value, uint8_t decimals)
+{
+	static const float scale[] = {1.0f, 0.1f, 0.01f, 0.001f, 0.0001f};
 
-	return cur_token;
+	return (float)value * scale[decimals];
 }
 
 static void fix_info_to_data_struct(nmea_data_t *data,
@@ -178,343 +280,615 @@ static void fix_info_to_data_struct(nmea_data_t *data,
 	data->vdop = vdop;
 }
 
-ret_code_t nmea_parse(char *sentence, bool *position_updated, nmea_data_t *data)
+void nmea_sentence_init(nmea_sentence_t *sentence)
 {
-	if(position_updated != NULL) {
-		*position_updated = false;
+	sentence->len = 0;
+	sentence->checksum_calc = 0;
+	sentence->checksum_offset = 0;
+	sentence->num_fields = 0;
+	sentence->valid = false;
+}
+
+
+nmea_sentence_status_t nmea_sentence_append(nmea_sentence_t *sentence,
+		const uint8_t *data, size_t len, size_t *consumed)
+{
+	size_t i;
+	nmea_sentence_status_t status = NMEA_SENTENCE_INCOMPLETE;
+
+	for(i = 0; i < len; i++) {
+		char c = data[i];
+
+		if(c == '$') {
+			if(sentence->len != 0) {
+				// start of the next sentence; this one was cut off
+				status = NMEA_SENTENCE_RESTART;
+				break;
+			}
+
+			sentence->text[0] = c;
+			sentence->len = 1;
+			sentence->field[0] = 1;
+			sentence->num_fields = 1;
+			continue;
+		}
+
+		if(sentence->len == 0 || c == '\r') {
+			// ignore everything before the '$' and the line end
+			continue;
+		}
+
+		if(c == '\n') {
+			i++;
+			status = NMEA_SENTENCE_COMPLETE;
+			break;
+		}
+
+		if(sentence->len >= NMEA_MAX_SENTENCE_LEN - 1) {
+			i++;
+			status = NMEA_SENTENCE_OVERFLOW;
+			break;
+		}
+
+		if(sentence->checksum_offset == 0) {
+			if(c == '*') {
+				c = '\0';
+				sentence->checksum_offset = sentence->len + 1;
+			} else {
+				sentence->checksum_calc ^= (uint8_t)c;
+
+				if(c == ',') {
+					c = '\0';
+
+					if(sentence->num_fields < NMEA_MAX_FIELDS) {
+						sentence->field[sentence->num_fields] = sentence->len + 1;
+					}
+
+					// counted even if not stored, so overlong sentences can be detected
+					if(sentence->num_fields < 0xFF) {
+						sentence->num_fields++;
+					}
+				}
+			}
+		}
+
+		sentence->text[sentence->len++] = c;
 	}
 
-	if(sentence[0] != '$') {
-		NRF_LOG_ERROR("nmea: sentence does not start with '$'");
-		return NRF_ERROR_INVALID_DATA;
+	*consumed = i;
+
+	if(status == NMEA_SENTENCE_COMPLETE) {
+		sentence->text[sentence->len] = '\0';
+
+		const char *checksum_str = sentence->text + sentence->checksum_offset;
+
+		sentence->valid =
+			(sentence->checksum_offset != 0)
+			&& (sentence->len == sentence->checksum_offset + 2)
+			&& (sentence->num_fields <= NMEA_MAX_FIELDS)
+			&& (sentence->checksum_calc == (
+					(hexchar2num(checksum_str[0]) << 4)
+					+ hexchar2num(checksum_str[1])));
 	}
 
-	size_t len = strlen(sentence);
+	return status;
+}
+
+
+/* Sentence types are identified by the last three characters of the address
+ * field, packed into a single integer for quick comparison. */
+#define NMEA_TYPE(a, b, c) (((uint32_t)(a) << 16) | ((uint32_t)(b) << 8) | (uint32_t)(c))
+
+// pseudo system ID for the "GN" talker (data from multiple systems)
+#define SYS_ID_MULTI 0xFF
 
-	// strip newlines and carriage-returns from the end
-	char *endptr = sentence + len - 1;
-	while((endptr > sentence) &&
-			((*endptr == '\n') || (*endptr == '\r'))) {
-		endptr--;
-		len--;
+typedef void (*sentence_handler_t)(const nmea_sentence_t *sentence, uint8_t talker_sys_id, bool *position_updated, nmea_data_t *data);
+
+/**@brief Access a data field of the sentence.
+ *
+ * @param sentence  The indexed sentence.
+ * @param idx       Index of the data field. 0 is the first field after the address.
+ * @returns         The NUL-terminated field or an empty string if the field does not exist.
+ */
+static const char* nmea_field(const nmea_sentence_t *sentence, uint8_t idx)
+{
+	idx++; // skip the address field
+
+	if(idx >= sentence->num_fields) {
+		return "";
 	}
 
-	sentence[len] = '\0';
+	return sentence->text + sentence->field[idx];
+}
 
-	// try to find and extract the checksum, which starts at a '*'
-	endptr = sentence + len - 1;
-	while((endptr > sentence) && (*endptr != '*')) {
-		endptr--;
+/**@brief Number of data fields in the sentence (excluding the address field).
+ */
+static uint8_t nmea_num_data_fields(const nmea_sentence_t *sentence)
+{
+	return sentence->num_fields - 1;
+}
+
+/**@brief Decode the talker ID (first two characters of the address field).
+ *
+ * @returns  The NMEA_SYS_ID_* of the talker, SYS_ID_MULTI for combined solutions
+ *           or NMEA_SYS_ID_INVALID for unknown talkers.
+ */
+static uint8_t decode_talker(const char *address)
+{
+	switch(((uint16_t)address[0] << 8) | (uint8_t)address[1]) {
+		case ('G' << 8) | 'N': return SYS_ID_MULTI;
+		case ('G' << 8) | 'P': return NMEA_SYS_ID_GPS;
+		case ('G' << 8) | 'L': return NMEA_SYS_ID_GLONASS;
+		case ('G' << 8) | 'A': return NMEA_SYS_ID_GALILEO;
+		case ('G' << 8) | 'B': // BeiDou talker according to NMEA 4.11
+		case ('B' << 8) | 'D': return NMEA_SYS_ID_BEIDOU;
+		case ('G' << 8) | 'Q': // QZSS talker according to NMEA 4.11
+		case ('Q' << 8) | 'Z': return NMEA_SYS_ID_QZSS;
+		case ('G' << 8) | 'I': return NMEA_SYS_ID_NAVIC;
+		default:               return NMEA_SYS_ID_INVALID;
 	}
+}
 
-	if(endptr == sentence) {
-		NRF_LOG_ERROR("nmea: checksum not found. Sentence incomplete? %s", NRF_LOG_PUSH(sentence));
-		return NRF_ERROR_INVALID_DATA;
+/**@brief Parse the hhmmss part of a time field.
+ * @returns  true if the time was valid.
+ */
+static bool parse_time(const char *token, nmea_datetime_t *datetime)
+{
+	if(strlen(token) < 6) {
+		return false;
+	}
+
+	int8_t time_h = nmea_parse_2digits(token);
+	int8_t time_m = nmea_parse_2digits(token + 2);
+	int8_t time_s = nmea_parse_2digits(token + 4);
+
+	if(time_h < 0 || time_h > 23
+			|| time_m < 0 || time_m > 59
+			|| time_s < 0 || time_s > 59) {
+		return false;
+	}
+
+	datetime->time_h = time_h;
+	datetime->time_m = time_m;
+	datetime->time_s = time_s;
+
+	return true;
+}
+
+static void parse_gga(const nmea_sentence_t *sentence, uint8_t talker_sys_id, bool *position_updated, nmea_data_t *data)
+{
+	(void)talker_sys_id;
+
+	// parse Detailed GNSS position information
+	int32_t lat_e7 = 0, lon_e7 = 0, altitude_dm = 0;
+	bool data_valid = false;
+
+	// field 0: time
+
+	// field 5: quality indicator
+	switch(nmea_field(sentence, 5)[0]) {
+		case '1': // no differential corrections (autonomous)
+		case '2': // differentially corrected position (SBAS, DGPS,Atlas DGPSservice, L- Dif and e-Dif)
+		case '3': // ???
+		case '4': // RTK fixed or Atlas high precision services converged
+		case '5': // RTK float,Atlas high precision services converging
+			data_valid = true;
+			break;
+
+		case '0': // no position
+		default:
+			data_valid = false;
+			break;
+	}
+
+	if(data_valid) {
+		data_valid = nmea_coord_to_e7(nmea_field(sentence, 1), &lat_e7)
+			&& nmea_apply_sign(nmea_field(sentence, 2), &lat_e7)
+			&& nmea_coord_to_e7(nmea_field(sentence, 3), &lon_e7)
+			&& nmea_apply_sign(nmea_field(sentence, 4), &lon_e7);
+	}
+
+	// field 6: number of satellites in solution
+	// field 7: HDOP
+
+	// field 8: altitude
+	nmea_parse_fixed(nmea_field(sentence, 8), 1, &altitude_dm);
+
+	// field 9: unit of altitude
+	// field 10: geoidal separation
+	// field 11: unit of geoidal separation
+	// field 12: age of differential corrections in seconds
+	// field 13: DGPS station ID
+
+	if(data_valid) {
+		data->lat_e7 = lat_e7;
+		data->lon_e7 = lon_e7;
+		data->lat = (float)lat_e7 * 1e-7f;
+		data->lon = (float)lon_e7 * 1e-7f;
+		data->altitude = fixed_to_float(altitude_dm, 1);
+		data->pos_valid = true;
 	} else {
-		char *checksum_str = endptr + 1;
+		data->pos_valid = false;
+	}
+
+	*position_updated = true;
+}
 
-		// string ends at the asterisk before the checksum
-		*endptr = '\0';
+static void parse_rmc(const nmea_sentence_t *sentence, uint8_t talker_sys_id, bool *position_updated, nmea_data_t *data)
+{
+	(void)talker_sys_id;
 
-		uint8_t checksum =
-			(hexchar2num(checksum_str[0]) << 4)
-			+ hexchar2num(checksum_str[1]);
+	// parse date, time, ground speed and heading
+	int32_t speed_mknots = 0, heading_cdeg = 0;
+	bool data_valid = false;
 
-		uint8_t checksum_calc = 0;
-		uint8_t *ptr = (uint8_t*)(sentence + 1); // skip the '$'
+	nmea_datetime_t datetime;
+	bool time_valid;
+	int8_t date_d = -1, date_m = -1, date_y = -1;
+
+	// field 0: time
+	time_valid = parse_time(nmea_field(sentence, 0), &datetime);
+
+	// field 6: speed
+	nmea_parse_fixed(nmea_field(sentence, 6), 3, &speed_mknots);
+
+	// field 7: heading
+	nmea_parse_fixed(nmea_field(sentence, 7), 2, &heading_cdeg);
+
+	// field 8: date
+	const char *date = nmea_field(sentence, 8);
+	if(strlen(date) >= 6) {
+		date_d = nmea_parse_2digits(date);
+		date_m = nmea_parse_2digits(date + 2);
+		date_y = nmea_parse_2digits(date + 4);
+	}
+
+	// field 11: quality indicator
+	char quality = nmea_field(sentence, 11)[0];
+	if(quality == 'E' || quality == 'A' || quality == 'D') {
+		data_valid = true;
+	}
 
-		while(*ptr) {
-			checksum_calc ^= *ptr++;
+	if(data_valid) {
+		data->speed = fixed_to_float(speed_mknots, 3) * 0.5144444f;
+		data->heading = fixed_to_float(heading_cdeg, 2);
+		data->speed_heading_valid = true;
+
+		if(time_valid
+					&& date_d >= 1 && date_d <= 31
+					&& date_m >= 1 && date_m <= 12
+					&& date_y >= 0 && date_y <= 99) {
+			// WARNING: this assignment will only work properly until 2099.
+			// The GNZDA sentence, which contains the full year, overrides
+			// this if the module outputs it.
+			data->datetime.time_h = datetime.time_h;
+			data->datetime.time_m = datetime.time_m;
+			data->datetime.time_s = datetime.time_s;
+			data->datetime.date_d = date_d;
+			data->datetime.date_m = date_m;
+			data->datetime.date_y = 2000 + (uint16_t)date_y;
+
+			data->datetime_valid = true;
+		} else {
+			data->datetime_valid = true;
 		}
+	} else {
+		data->speed_heading_valid = false;
+		data->datetime_valid = false;
+	}
+
+	*position_updated = true;
+}
+
+static void parse_gsa(const nmea_sentence_t *sentence, uint8_t talker_sys_id, bool *position_updated, nmea_data_t *data)
+{
+	(void)position_updated;
+
+	// parse DOP and Active Satellites sentence.
+	bool auto_mode = false;
+	int fix_type = -1;
+	int32_t pdop = 0, hdop = 0, vdop = 0; // in 1/100
+	uint8_t used_sats = 0;
+	uint8_t sys_id = talker_sys_id;
+
+	// field 0: mode
+	if(nmea_field(sentence, 0)[0] == 'A') {
+		auto_mode = true;
+	}
 
-		if(checksum_calc != checksum) {
-			NRF_LOG_ERROR("nmea: checksum invalid! Expected: %02x, calculated: %02x", checksum, checksum_calc);
-			return NRF_ERROR_INVALID_DATA;
+	// field 1: fix type
+	char fix_type_char = nmea_field(sentence, 1)[0];
+	if(fix_type_char >= '1' && fix_type_char <= '3') {
+		fix_type = fix_type_char - '1';
+	}
+
+	// fields 2 to 13: used satellites
+	for(uint8_t i = 2; i <= 13; i++) {
+		if(nmea_field(sentence, i)[0] != '\0') {
+			used_sats++;
 		}
 	}
 
-	char *token = nmea_tokenize(sentence + 1, ','); // skip the '$' in the beginning
+	nmea_parse_fixed(nmea_field(sentence, 14), 2, &pdop);
+	nmea_parse_fixed(nmea_field(sentence, 15), 2, &hdop);
+	nmea_parse_fixed(nmea_field(sentence, 16), 2, &vdop);
 
-	if(strcmp(token, "GNGGA") == 0 || strcmp(token, "GPGGA") == 0) {
-		// parse Detailed GNSS position information
-		size_t info_token_idx = 0;
+	// field 17: system ID (NMEA 4.1 and later)
+	const char *sys_id_str = nmea_field(sentence, 17);
+	if(sys_id_str[0] != '\0') {
+		sys_id = hexchar2num(sys_id_str[0]);
+	}
 
-		float lat = INVALID_COORD, lon = INVALID_COORD, altitude = 0.0f;
-		bool data_valid = false;
+	if(sys_id == SYS_ID_MULTI) {
+		// combined solution without system ID, cannot be assigned
+		sys_id = NMEA_SYS_ID_INVALID;
+	}
 
-		while((token = nmea_tokenize(NULL, ','))) {
-			switch(info_token_idx) {
-				// case 0: time
+	if(fix_type >= 0) {
+		fix_info_to_data_struct(data, auto_mode, fix_type,
+				fixed_to_float(pdop, 2), fixed_to_float(hdop, 2), fixed_to_float(vdop, 2),
+				used_sats, sys_id);
+	}
+}
 
-				case 1:
-					lat = nmea_coord_to_float(token);
-					break;
+static void parse_gsv(const nmea_sentence_t *sentence, uint8_t talker_sys_id, bool *position_updated, nmea_data_t *data)
+{
+	(void)position_updated;
+
+	// parse Satellites in View sentence
+	nmea_sat_info_t *sat_list;
+	uint8_t         *sat_count;
+	uint8_t          sat_list_size;
+
+	switch(talker_sys_id) {
+		case NMEA_SYS_ID_GPS:
+			sat_list      = data->sat_info_gps;
+			sat_count     = &(data->sat_info_count_gps);
+			sat_list_size = NMEA_NUM_SAT_INFO;
+			break;
 
-				case 2:
-					lat *= nmea_sign_from_char(token);
-					break;
+		case NMEA_SYS_ID_GLONASS:
+			sat_list      = data->sat_info_glonass;
+			sat_count     = &(data->sat_info_count_glonass);
+			sat_list_size = NMEA_NUM_SAT_INFO;
+			break;
 
-				case 3:
-					lon = nmea_coord_to_float(token);
-					break;
+		case NMEA_SYS_ID_GALILEO:
+			sat_list      = data->sat_info_galileo;
+			sat_count     = &(data->sat_info_count_galileo);
+			sat_list_size = NMEA_NUM_SAT_INFO_GALILEO;
+			break;
 
-				case 4:
-					lon *= nmea_sign_from_char(token);
-					break;
+		case NMEA_SYS_ID_BEIDOU:
+			sat_list      = data->sat_info_beidou;
+			sat_count     = &(data->sat_info_count_beidou);
+			sat_list_size = NMEA_NUM_SAT_INFO_BEIDOU;
+			break;
 
-				case 5: // quality indicator
-					switch(token[0]) {
-						case '0': // no position
-							data_valid = false;
-							break;
+		case NMEA_SYS_ID_QZSS:
+			sat_list      = data->sat_info_qzss;
+			sat_count     = &(data->sat_info_count_qzss);
+			sat_list_size = NMEA_NUM_SAT_INFO_QZSS;
+			break;
 
-						case '1': // no differential corrections (autonomous)
-						case '2': // differentially corrected position (SBAS, DGPS,Atlas DGPSservice, L- Dif and e-Dif)
-						case '3': // ???
-						case '4': // RTK fixed or Atlas high precision services converged
-						case '5': // RTK float,Atlas high precision services converging
-							data_valid = true;
-							break;
+		default:
+			// satellite system not tracked
+			return;
+	}
 
-						default:
-							data_valid = false;
-							break;
-					}
-					break;
+	// field 1: number of this sentence
+	if(nmea_parse_uint(nmea_field(sentence, 1)) == 1) {
+		// reset the satellite list
+		*sat_count = 0;
+	}
 
-				// case 6: number of satellites in solution
-				// case 7: HDOP
+	// fields 3 to 6, 7 to 10, ...: satellite ID, elevation, azimuth, SNR.
+	// An optional signal ID may follow the last satellite.
+	uint8_t num_fields = nmea_num_data_fields(sentence);
 
-				case 8: // altitude
-					altitude = strtof(token, NULL);
-					break;
+	for(uint8_t i = 3; (i + 3) < num_fields && *sat_count < sat_list_size; i += 4) {
+		const char *snr = nmea_field(sentence, i + 3);
 
-				// case 9: unit of altitude
-				// case 10: geoidal separation
-				// case 11: unit of geoidal separation
-				// case 12: age of differential corrections in seconds
-				// case 13: DGPS station ID
-			}
+		sat_list[*sat_count].sat_id = nmea_parse_uint(nmea_field(sentence, i));
+		sat_list[*sat_count].snr = nmea_parse_uint(snr); // -1 if not tracked
 
-			info_token_idx++;
-		}
+		(*sat_count)++;
+	}
+}
 
-		if(data_valid) {
-			//NRF_LOG_INFO("Got valid position: Lat: " NRF_LOG_FLOAT_MARKER ", Lon: " NRF_LOG_FLOAT_MARKER, NRF_LOG_FLOAT(lat), NRF_LOG_FLOAT(lon));
+static void parse_vtg(const nmea_sentence_t *sentence, uint8_t talker_sys_id, bool *position_updated, nmea_data_t *data)
+{
+	(void)talker_sys_id;
+	(void)position_updated;
 
-			data->lat = lat;
-			data->lon = lon;
-			data->altitude = altitude;
-			data->pos_valid = true;
-		} else {
-			data->pos_valid = false;
-		}
+	// parse Course over Ground and Ground Speed
+	int32_t speed_mknots = 0, heading_cdeg = 0;
 
-		if(position_updated != NULL) {
-			*position_updated = true;
-		}
-	} else if(strcmp(token, "GNRMC") == 0) {
-		// parse date, time, ground speed and heading
-		size_t info_token_idx = 0;
-
-		float speed_knots = 0.0f, heading = 0.0f;
-		bool data_valid = false;
-
-		int8_t time_h = -1, time_m = -1, time_s = -1;
-		int8_t date_d = -1, date_m = -1, date_y = -1;
-		char timeparser_tmp[3];
-		timeparser_tmp[2] = '\0';
-
-		while((token = nmea_tokenize(NULL, ','))) {
-			switch(info_token_idx) {
-				case 0: // time
-					if(strlen(token) < 6) {
-						continue;
-					}
+	// field 0: course over ground, true
+	nmea_parse_fixed(nmea_field(sentence, 0), 2, &heading_cdeg);
+
+	// field 4: speed in knots
+	nmea_parse_fixed(nmea_field(sentence, 4), 3, &speed_mknots);
 
-					timeparser_tmp[0] = token[0];
-					timeparser_tmp[1] = token[1];
-					time_h = strtod(timeparser_tmp, NULL);
+	// field 8: mode indicator
+	char mode = nmea_field(sentence, 8)[0];
 
-					timeparser_tmp[0] = token[2];
-					timeparser_tmp[1] = token[3];
-					time_m = strtod(timeparser_tmp, NULL);
+	if(mode == 'E' || mode == 'A' || mode == 'D') {
+		data->speed = fixed_to_float(speed_mknots, 3) * 0.5144444f;
+		data->heading = fixed_to_float(heading_cdeg, 2);
+		data->speed_heading_valid = true;
+	} else {
+		data->speed_heading_valid = false;
+	}
+}
 
-					timeparser_tmp[0] = token[4];
-					timeparser_tmp[1] = token[5];
-					time_s = strtod(timeparser_tmp, NULL);
+static void parse_zda(const nmea_sentence_t *sentence, uint8_t talker_sys_id, bool *position_updated, nmea_data_t *data)
+{
+	(void)talker_sys_id;
+	(void)position_updated;
+
+	// parse Time and Date, which includes the full year
+	nmea_datetime_t datetime;
+
+	bool time_valid = parse_time(nmea_field(sentence, 0), &datetime);
+
+	int32_t date_d = nmea_parse_uint(nmea_field(sentence, 1));
+	int32_t date_m = nmea_parse_uint(nmea_field(sentence, 2));
+	int32_t date_y = nmea_parse_uint(nmea_field(sentence, 3));
+
+	// the module reports a date in 1980 before it has received the time from
+	// the satellites, so this is not considered valid.
+	if(time_valid
+			&& date_d >= 1 && date_d <= 31
+			&& date_m >= 1 && date_m <= 12
+			&& date_y >= 2000 && date_y <= 2255) {
+		datetime.date_d = date_d;
+		datetime.date_m = date_m;
+		datetime.date_y = date_y;
+
+		data->datetime = datetime;
+		data->datetime_valid = true;
+	}
+}
 
-					break;
+static const struct {
+	uint32_t           type;
+	sentence_handler_t handler;
+} m_sentence_handlers[] = {
+	// ordered by frequency in a typical epoch
+	{NMEA_TYPE('G', 'S', 'V'), parse_gsv},
+	{NMEA_TYPE('G', 'S', 'A'), parse_gsa},
+	{NMEA_TYPE('G', 'G', 'A'), parse_gga},
+	{NMEA_TYPE('R', 'M', 'C'), parse_rmc},
+	{NMEA_TYPE('V', 'T', 'G'), parse_vtg},
+	{NMEA_TYPE('Z', 'D', 'A'), parse_zda},
+};
 
-				case 6: // speed
-					speed_knots = strtof(token, NULL);
-					break;
+#define NUM_SENTENCE_HANDLERS (sizeof(m_sentence_handlers) / sizeof(m_sentence_handlers[0]))
 
-				case 7: // heading
-					heading = strtof(token, NULL);
-					break;
 
-				case 8: // date
-					if(strlen(token) < 6) {
-						continue;
-					}
+ret_code_t nmea_parse_sentence(const nmea_sentence_t *sentence, bool *position_updated, nmea_data_t *data)
+{
+	if(position_updated != NULL) {
+		*position_updated = false;
+	}
 
-					timeparser_tmp[0] = token[0];
-					timeparser_tmp[1] = token[1];
-					date_d = strtod(timeparser_tmp, NULL);
+	if(!sentence->valid) {
+		NRF_LOG_ERROR("nmea: sentence incomplete or checksum invalid.");
+		return NRF_ERROR_INVALID_DATA;
+	}
 
-					timeparser_tmp[0] = token[2];
-					timeparser_tmp[1] = token[3];
-					date_m = strtod(timeparser_tmp, NULL);
+	const char *address = sentence->text + sentence->field[0];
 
-					timeparser_tmp[0] = token[4];
-					timeparser_tmp[1] = token[5];
-					date_y = strtod(timeparser_tmp, NULL);
-					break;
+	if(strlen(address) != 5) {
+		// proprietary or unknown sentence format
+		return NRF_SUCCESS;
+	}
 
-				case 11: // quality indicator
-					if(token[0] == 'E' || token[0] == 'A' || token[0] == 'D') {
-						data_valid = true;
-					}
-			}
+	uint8_t talker_sys_id = decode_talker(address);
+	if(talker_sys_id == NMEA_SYS_ID_INVALID) {
+		return NRF_SUCCESS;
+	}
 
-			info_token_idx++;
-		}
+	uint32_t type = NMEA_TYPE(address[2], address[3], address[4]);
 
-		if(data_valid) {
-			//NRF_LOG_INFO("Got valid speed: " NRF_LOG_FLOAT_MARKER ", heading: " NRF_LOG_FLOAT_MARKER, NRF_LOG_FLOAT(speed), NRF_LOG_FLOAT(heading));
-
-			data->speed = speed_knots * 0.5144444f;
-			data->heading = heading;
-			data->speed_heading_valid = true;
-
-			if(time_h >= 0 && time_h <= 23
-						&& time_m >= 0 && time_m <= 59
-						&& time_s >= 0 && time_s <= 59
-						&& date_d >= 1 && date_d <= 31
-						&& date_m >= 1 && date_m <= 12
-						&& date_y >= 0 && date_y <= 99) {
-				// WARNING: this assignment will only work properly until 2099.
-				// Alternatively the GNZDA sentence, which contains the full
-				// year, could be parsed for date and time, but I'm not sure if
-				// that’s available on all devices.
-				data->datetime.time_h = time_h;
-				data->datetime.time_m = time_m;
-				data->datetime.time_s = time_s;
-				data->datetime.date_d = date_d;
-				data->datetime.date_m = date_m;
-				data->datetime.date_y = 2000 + (uint16_t)date_y;
-
-				data->datetime_valid = true;
-			} else {
-				data->datetime_valid = true;
-			}
-		} else {
-			data->speed_heading_valid = false;
-			data->datetime_valid = false;
-		}
+	bool dummy_position_updated;
+	if(position_updated == NULL) {
+		position_updated = &dummy_position_updated;
+	}
 
-		if(position_updated != NULL) {
-			*position_updated = true;
+	for(size_t i = 0; i < NUM_SENTENCE_HANDLERS; i++) {
+		if(m_sentence_handlers[i].type == type) {
+			m_sentence_handlers[i].handler(sentence, talker_sys_id, position_updated, data);
+			break;
 		}
+	}
 
-	} else if(strcmp(token, "GNGSA") == 0) {
-		// parse DOP and Active Satellites sentence.
-		size_t info_token_idx = 0;
-
-		bool auto_mode = false;
-		int fix_type = -1;
-		float pdop = 0.0f, hdop = 0.0f, vdop = 0.0f;
-		uint8_t used_sats = 0;
-		uint8_t sys_id = 0;
-
-		while((token = nmea_tokenize(NULL, ','))) {
-			switch(info_token_idx) {
-				case 0:
-					if(token[0] == 'A') {
-						auto_mode = true;
-					}
-					break;
+	return NRF_SUCCESS;
+}
 
-				case 1:
-					if(token[0] >= '1' && token[0] <= '3') {
-						fix_type = token[0] - '1';
-					}
-					break;
 
-				case 14:
-					pdop = strtof(token, NULL);
-					break;
+ret_code_t nmea_parse(const char *line, bool *position_updated, nmea_data_t *data)
+{
+	nmea_sentence_t sentence;
+	size_t consumed;
 
-				case 15:
-					hdop = strtof(token, NULL);
-					break;
+	if(position_updated != NULL) {
+		*position_updated = false;
+	}
 
-				case 16:
-					vdop = strtof(token, NULL);
-					break;
+	if(line[0] != '$') {
+		NRF_LOG_ERROR("nmea: sentence does not start with '$'");
+		return NRF_ERROR_INVALID_DATA;
+	}
 
-				case 17:
-					sys_id = hexchar2num(token[0]);
-					break;
-			}
+	nmea_sentence_init(&sentence);
 
-			if((info_token_idx >= 2) && (info_token_idx <= 13)) {
-				if(token[0] != '\0') {
-					used_sats++;
-				}
-			}
+	size_t len = strlen(line);
+	nmea_sentence_status_t status = nmea_sentence_append(&sentence, (const uint8_t*)line, len, &consumed);
 
-			info_token_idx++;
-		}
+	if(status == NMEA_SENTENCE_INCOMPLETE) {
+		// line end is optional here
+		uint8_t newline = '\n';
+		status = nmea_sentence_append(&sentence, &newline, 1, &consumed);
+	}
 
-		if(fix_type >= 0) {
-			fix_info_to_data_struct(data, auto_mode, fix_type, pdop, hdop, vdop, used_sats, sys_id);
-		}
-	} else if(strcmp(token, "GPGSV") == 0 || strcmp(token, "GLGSV") == 0) {
-		// parse Satellites in View sentence for GPS and GLONASS
-		size_t info_token_idx = 0;
-
-		bool is_gps = (token[1] == 'P');
-
-		nmea_sat_info_t *sat_list  = is_gps ? data->sat_info_gps          : data->sat_info_glonass;
-		uint8_t         *sat_count = is_gps ? &(data->sat_info_count_gps) : &(data->sat_info_count_glonass);
-
-		uint8_t current_sentence = 0;
-		uint8_t sat_id = 0;
-		while((token = nmea_tokenize(NULL, ','))) {
-			switch(info_token_idx) {
-				case 1:
-					current_sentence = strtod(token, NULL);
-					if(current_sentence == 1) {
-						// reset the satellite list
-						*sat_count = 0;
-					}
-					break;
-			}
+	if(status != NMEA_SENTENCE_COMPLETE) {
+		NRF_LOG_ERROR("nmea: sentence too long or incomplete.");
+		return NRF_ERROR_INVALID_DATA;
+	}
 
-			if(info_token_idx >= 3 && ((info_token_idx - 3) % 4) == 0) {
-				sat_id = strtod(token, NULL);
-			}
+	return nmea_parse_sentence(&sentence, position_updated, data);
+}
 
-			if((*sat_count < NMEA_NUM_SAT_INFO)
-					&& info_token_idx >= 6
-					&& ((info_token_idx - 6) % 4) == 0) {
-				sat_list[*sat_count].sat_id = sat_id;
-				if(token[0] != '\0') {
-					sat_list[*sat_count].snr = strtod(token, NULL);
-				} else {
-					sat_list[*sat_count].snr = -1; // not tracked
-				}
 
-				(*sat_count)++;
-			}
+size_t nmea_build_sentence(char *buf, size_t buf_len, const char *body)
+{
+	static const char hexdigits[] = "0123456789ABCDEF";
 
-			info_token_idx++;
-		}
+	size_t body_len = strlen(body);
+	uint8_t checksum = 0;
+
+	// '$' + body + '*' + 2 checksum digits + "\r\n" + NUL
+	if(body_len + 7 > buf_len) {
+		return 0;
 	}
 
-	return NRF_SUCCESS;
+	buf[0] = '$';
+
+	for(size_t i = 0; i < body_len; i++) {
+		checksum ^= (uint8_t)body[i];
+		buf[1 + i] = body[i];
+	}
+
+	char *p = buf + 1 + body_len;
+
+	*p++ = '*';
+	*p++ = hexdigits[checksum >> 4];
+	*p++ = hexdigits[checksum & 0x0F];
+	*p++ = '\r';
+	*p++ = '\n';
+	*p = '\0';
+
+	return (size_t)(p - buf);
+}
+
+
+bool nmea_check_sentence(const char *line)
+{
+	nmea_sentence_t sentence;
+	size_t consumed;
+
+	if(line[0] != '$') {
+		return false;
+	}
+
+	nmea_sentence_init(&sentence);
+
+	size_t len = strlen(line);
+	nmea_sentence_status_t status = nmea_sentence_append(&sentence, (const uint8_t*)line, len, &consumed);
+
+	return (status == NMEA_SENTENCE_COMPLETE) && (consumed == len) && sentence.valid;
 }
 
 
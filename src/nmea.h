@@ -26,6 +26,8 @@
 #define NMEA_H
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
 
 #include <sdk_errors.h>
 
@@ -47,6 +49,28 @@
 // number of tracked satellites per satellite system
 #define NMEA_NUM_SAT_INFO   32
 
+// maximum sentence length: 82 characters (the line end is not stored) plus the
+// terminating NUL byte.
+#define NMEA_MAX_SENTENCE_LEN  83
+
+// maximum number of fields in a sentence, including the address field. The
+// longest supported sentence is GSV with 4 satellites and signal ID (21 fields).
+#define NMEA_MAX_FIELDS        24
+
+// number of tracked satellites for the additional systems. These can be
+// reduced to save RAM if the GNSS module does not support the system.
+#ifndef NMEA_NUM_SAT_INFO_GALILEO
+#define NMEA_NUM_SAT_INFO_GALILEO  24
+#endif
+
+#ifndef NMEA_NUM_SAT_INFO_BEIDOU
+#define NMEA_NUM_SAT_INFO_BEIDOU   32
+#endif
+
+#ifndef NMEA_NUM_SAT_INFO_QZSS
+#define NMEA_NUM_SAT_INFO_QZSS      8
+#endif
+
 typedef struct
 {
 	uint8_t sys_id;
@@ -93,28 +117,117 @@ typedef struct
 
 	nmea_datetime_t datetime;
 	bool            datetime_valid;
+
+	nmea_sat_info_t sat_info_galileo[NMEA_NUM_SAT_INFO_GALILEO];
+	nmea_sat_info_t sat_info_beidou[NMEA_NUM_SAT_INFO_BEIDOU];
+	nmea_sat_info_t sat_info_qzss[NMEA_NUM_SAT_INFO_QZSS];
+
+	uint8_t sat_info_count_galileo;
+	uint8_t sat_info_count_beidou;
+	uint8_t sat_info_count_qzss;
+
+	// full-precision position, valid if pos_valid is set. lat and lon above
+	// contain the same position with limited precision.
+	int32_t lat_e7;            // in 1e-7 degrees
+	int32_t lon_e7;            // in 1e-7 degrees
 } nmea_data_t;
 
 
-/**@brief (Try to) parse the given NMEA sentence.
+/**@brief Indexed NMEA sentence.
+ * @details
+ * The sentence is indexed while it is received, so the parser can check the
+ * checksum and access each field directly without scanning the sentence again.
+ * All field separators (',' and '*') are replaced by NUL bytes in text, so each
+ * field can be used as a string. The line end is not stored.
+ */
+typedef struct
+{
+	char    text[NMEA_MAX_SENTENCE_LEN];
+	uint8_t len;                          // number of characters in text
+	uint8_t checksum_calc;                // XOR of all characters between '$' and '*'
+	uint8_t checksum_offset;              // offset of the checksum digits in text; 0 if not (yet) found
+	uint8_t num_fields;                   // number of fields, including the address field
+	uint8_t field[NMEA_MAX_FIELDS];       // offset of each field in text
+	bool    valid;                        // sentence is complete and the checksum matches
+} nmea_sentence_t;
+
+typedef enum
+{
+	NMEA_SENTENCE_INCOMPLETE,             // all data was consumed, more is needed
+	NMEA_SENTENCE_COMPLETE,               // the line end was reached
+	NMEA_SENTENCE_RESTART,                // a '$' was found before the line end
+	NMEA_SENTENCE_OVERFLOW,               // the sentence is too long
+} nmea_sentence_status_t;
+
+/**@brief Prepare the sentence for reception of a new line.
+ */
+void nmea_sentence_init(nmea_sentence_t *sentence);
+
+/**@brief Append received characters to the sentence and index them.
  * @details
- * The parsed data is stored in the given struct. TODO
+ * Characters before the initial '$' are skipped. Processing stops after the
+ * line end ('\n'), before a new '$' (which is not consumed) or after the
+ * character that did not fit into the sentence any more.
  *
- * Note that this function is destructive, i.e. the given sentence will be
- * modified. Separators will be replaced by null-bytes. This is done to save
- * memory and copy operations.
+ * When NMEA_SENTENCE_COMPLETE is returned, the valid flag of the sentence is
+ * updated.
  *
- * If any error is detected while parsing (no/wrong checksum), parsing will be
+ * @param[inout] sentence  The sentence to append to.
+ * @param[in]    data      Received characters.
+ * @param[in]    len       Number of received characters.
+ * @param[out]   consumed  Number of characters that were processed.
+ * @returns                The state of the sentence after processing.
+ */
+nmea_sentence_status_t nmea_sentence_append(nmea_sentence_t *sentence,
+		const uint8_t *data, size_t len, size_t *consumed);
+
+/**@brief Parse the given indexed NMEA sentence.
+ * @details
+ * The parsed data is stored in the given struct. Supported sentence types are
+ * GGA, RMC, GSA, GSV, VTG and ZDA from any talker. Other sentences are ignored.
+ *
+ * If the sentence is incomplete or its checksum is wrong, parsing will be
  * aborted, the error will be logged and no output data will be modified.
  *
- * @param[in]  sentence           The sentence to parse. Will be modified while parsing.
+ * @param[in]  sentence           The sentence to parse.
+ * @param[out] position_updated   Indicates whether the position was updated by this sentence.
+ *                                May be NULL if not needed.
+ * @param[inout] data             The data struct to fill/update.
+ * @retval NRF_ERROR_INVALID_DATA     The given sentence was not a valid NMEA sentence.
+ * @retval NRF_SUCCESS                If the sentence was parsed successfully.
+ */
+ret_code_t nmea_parse_sentence(const nmea_sentence_t *sentence, bool *position_updated, nmea_data_t *data);
+
+/**@brief (Try to) parse the given NMEA sentence string.
+ * @details
+ * Convenience wrapper which indexes the line and calls nmea_parse_sentence().
+ *
+ * @param[in]  line               The line to parse. The line end is optional.
  * @param[out] position_updated   Indicates whether the position was updated by this sentence.
  *                                May be NULL if not needed.
  * @param[inout] data             The data struct to fill/update.
  * @retval NRF_ERROR_INVALID_DATA     The given string was not a valid NMEA sentence.
  * @retval NRF_SUCCESS                If the sentence was parsed successfully.
  */
-ret_code_t nmea_parse(char *sentence, bool *position_updated, nmea_data_t *data);
+ret_code_t nmea_parse(const char *line, bool *position_updated, nmea_data_t *data);
+
+/**@brief Build a sentence from the given body.
+ * @details
+ * Adds the leading '$', the checksum and the line end ("\r\n") to the body,
+ * which contains everything between '$' and '*', e.g. "PCAS10,2".
+ *
+ * @param[out] buf      Buffer for the sentence. It is NUL-terminated.
+ * @param[in]  buf_len  Size of the buffer.
+ * @param[in]  body     The sentence body.
+ * @returns             Length of the sentence (without NUL), or 0 if the buffer is too small.
+ */
+size_t nmea_build_sentence(char *buf, size_t buf_len, const char *body);
+
+/**@brief Check that the given line is a single complete sentence with a valid checksum.
+ * @details
+ * The line must end with "\n" (an optional "\r" before it is accepted).
+ */
+bool nmea_check_sentence(const char *line);
 
 /**@brief Retrieve a string for the given fix type.
  */
@@ -0,0 +1,169 @@
+/*
+ * vim: noexpandtab
+ *
+ * Copyright (c) 2021-2022 Thomas Kolb <cfr34k-git@tkolb.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "nmea_rx.h"
+
+/* Prevent the compiler from moving memory accesses across this point. This is
+ * sufficient for the queue as producer and consumer run on the same core. */
+#define COMPILER_BARRIER() __asm__ volatile("" ::: "memory")
+
+void nmea_rx_init(nmea_rx_t *rx, nmea_rx_sentence_callback_t callback)
+{
+	memset(rx, 0, sizeof(*rx));
+
+	rx->callback = callback;
+}
+
+
+void nmea_rx_reset(nmea_rx_t *rx)
+{
+	if(rx->in_sentence) {
+		rx->lines_dropped++;
+	}
+
+	rx->in_sentence = false;
+}
+
+
+void nmea_rx_feed(nmea_rx_t *rx, const uint8_t *data, size_t len)
+{
+	const uint8_t *end = data + len;
+
+	rx->rx_bytes += len;
+
+	while(data < end) {
+		if(!rx->in_sentence) {
+			// skip everything up to the start of the next sentence
+			const uint8_t *start = memchr(data, '$', end - data);
+			if(!start) {
+				return;
+			}
+
+			data = start;
+			rx->in_sentence = true;
+			nmea_sentence_init(&rx->sentence);
+		}
+
+		size_t consumed;
+		nmea_sentence_status_t status =
+			nmea_sentence_append(&rx->sentence, data, end - data, &consumed);
+
+		data += consumed;
+
+		switch(status) {
+			case NMEA_SENTENCE_INCOMPLETE:
+				// wait for more data
+				break;
+
+			case NMEA_SENTENCE_COMPLETE:
+				rx->rx_lines++;
+				rx->in_sentence = false;
+
+				rx->callback(&rx->sentence);
+				break;
+
+			case NMEA_SENTENCE_RESTART:
+				// a '$' inside the line means that the previous sentence was
+				// cut off, e.g. by a UART error. Restart at the new sentence.
+			case NMEA_SENTENCE_OVERFLOW:
+				// line is too long for a valid NMEA sentence => discard it
+				rx->lines_dropped++;
+				rx->in_sentence = false;
+				break;
+		}
+	}
+}
+
+
+void nmea_rx_queue_init(nmea_rx_queue_t *q, nmea_sentence_t *slots, uint8_t num_slots)
+{
+	memset(q, 0, sizeof(*q));
+
+	q->slots = slots;
+	q->mask  = num_slots - 1;
+}
+
+
+void nmea_rx_queue_flush(nmea_rx_queue_t *q)
+{
+	q->tail = q->head;
+}
+
+
+uint8_t nmea_rx_queue_count(const nmea_rx_queue_t *q)
+{
+	return (uint8_t)(q->head - q->tail);
+}
+
+
+bool nmea_rx_queue_push(nmea_rx_queue_t *q, const nmea_sentence_t *sentence)
+{
+	uint8_t head = q->head;
+	uint8_t pending = (uint8_t)(head - q->tail);
+
+	if(pending > q->mask) {
+		q->lines_overrun++;
+		return false;
+	}
+
+	q->slots[head & q->mask] = *sentence;
+
+	// the slot must be completely written before it is published
+	COMPILER_BARRIER();
+
+	q->head = head + 1;
+
+	pending++;
+	if(pending > q->high_water_mark) {
+		q->high_water_mark = pending;
+	}
+
+	return true;
+}
+
+
+nmea_sentence_t* nmea_rx_queue_peek(nmea_rx_queue_t *q)
+{
+	uint8_t tail = q->tail;
+
+	if(q->head == tail) {
+		return NULL;
+	}
+
+	// do not read the slot before the head index
+	COMPILER_BARRIER();
+
+	return &q->slots[tail & q->mask];
+}
+
+
+void nmea_rx_queue_pop(nmea_rx_queue_t *q)
+{
+	// finish all accesses to the slot before it is released to the producer
+	COMPILER_BARRIER();
+
+	q->tail++;
+}
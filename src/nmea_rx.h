@@ -0,0 +1,140 @@
+/*
+ * vim: noexpandtab
+ *
+ * Copyright (c) 2021-2022 Thomas Kolb <cfr34k-git@tkolb.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef NMEA_RX_H
+#define NMEA_RX_H
+
+/**@file
+ *
+ * @brief Line assembly for the GNSS UART receive path.
+ *
+ * @details
+ * The UART driver hands over received data in chunks of arbitrary size (one
+ * chunk per DMA transfer). This module splits these chunks into complete NMEA
+ * sentences. While the bytes are copied, the checksum is calculated and the
+ * field positions are recorded (see nmea_sentence_t), so the parser does not
+ * need to scan the sentence again. It has no hardware dependencies, so it can
+ * also be fed from recorded byte streams on the host.
+ *
+ * Completed sentences are usually handed over from interrupt context to the
+ * main loop. The nmea_rx_queue_* functions implement a lock-free
+ * single-producer, single-consumer queue for this purpose.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "nmea.h"
+
+/**@brief Callback for completed sentences.
+ *
+ * @param sentence   The received and indexed sentence. Check sentence->valid
+ *                   for the checksum status.
+ */
+typedef void (*nmea_rx_sentence_callback_t)(const nmea_sentence_t *sentence);
+
+typedef struct {
+	nmea_sentence_t sentence;
+	bool            in_sentence;   // a '$' was seen and the sentence is being collected
+
+	nmea_rx_sentence_callback_t callback;
+
+	uint32_t rx_bytes;       // total number of bytes fed into the splitter
+	uint32_t rx_lines;       // number of complete lines passed to the callback
+	uint32_t lines_dropped;  // lines discarded due to overflow or restart
+} nmea_rx_t;
+
+/**@brief Initialize the line splitter.
+ *
+ * @param rx        The splitter state to initialize.
+ * @param callback  Function that is called for every complete sentence.
+ */
+void nmea_rx_init(nmea_rx_t *rx, nmea_rx_sentence_callback_t callback);
+
+/**@brief Discard the partially received line (e.g. after a UART error).
+ */
+void nmea_rx_reset(nmea_rx_t *rx);
+
+/**@brief Process a chunk of received bytes.
+ * @details
+ * Every sentence that is completed by this chunk is passed to the callback
+ * before this function returns. Bytes outside of a sentence (i.e. before the
+ * first '$') are ignored. Lines that do not fit into the sentence buffer and
+ * lines that are interrupted by a new '$' are discarded and counted as dropped.
+ *
+ * @param rx    The splitter state.
+ * @param data  Pointer to the received bytes.
+ * @param len   Number of received bytes.
+ */
+void nmea_rx_feed(nmea_rx_t *rx, const uint8_t *data, size_t len);
+
+typedef struct {
+	nmea_sentence_t *slots;
+	uint8_t          mask;            // number of slots - 1
+
+	volatile uint8_t head;            // next slot to write; only modified by the producer
+	volatile uint8_t tail;            // next slot to read; only modified by the consumer
+
+	uint8_t  high_water_mark;         // maximum number of sentences pending at the same time
+	uint32_t lines_overrun;           // sentences dropped because the queue was full
+} nmea_rx_queue_t;
+
+/**@brief Initialize a sentence queue.
+ *
+ * @param q          The queue to initialize.
+ * @param slots      Storage for the queued sentences.
+ * @param num_slots  Number of entries in slots. Must be a power of two and at most 128.
+ */
+void nmea_rx_queue_init(nmea_rx_queue_t *q, nmea_sentence_t *slots, uint8_t num_slots);
+
+/**@brief Discard all pending sentences. Must not be called while the producer is active.
+ */
+void nmea_rx_queue_flush(nmea_rx_queue_t *q);
+
+/**@brief Append a sentence to the queue (producer side).
+ *
+ * @returns  true if the sentence was queued, false if the queue is full. In
+ *           that case the sentence is dropped and counted in lines_overrun.
+ */
+bool nmea_rx_queue_push(nmea_rx_queue_t *q, const nmea_sentence_t *sentence);
+
+/**@brief Access the oldest pending sentence (consumer side).
+ * @details
+ * The returned sentence stays valid until nmea_rx_queue_pop() is called.
+ *
+ * @param q    The queue.
+ * @returns    Pointer to the sentence or NULL if the queue is empty.
+ */
+nmea_sentence_t* nmea_rx_queue_peek(nmea_rx_queue_t *q);
+
+/**@brief Release the sentence returned by nmea_rx_queue_peek() (consumer side).
+ */
+void nmea_rx_queue_pop(nmea_rx_queue_t *q);
+
+/**@brief Number of sentences currently pending in the queue.
+ */
+uint8_t nmea_rx_queue_count(const nmea_rx_queue_t *q);
+
+#endif // NMEA_RX_H
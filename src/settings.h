@@ -50,6 +50,7 @@ typedef enum
 	SETTINGS_ID_LORA_POWER       = 0x0004,
 	SETTINGS_ID_APRS_FLAGS       = 0x0005,
 	SETTINGS_ID_LAST_BLE_SYMBOL  = 0x0006,
+	SETTINGS_ID_SMARTBEACON      = 0x0007, // tracker_smartbeacon_t
 } settings_id_t;
 
 /**@brief Events sent via the callback function.
@@ -33,18 +33,120 @@
 
 #include "tracker.h"
 
-static float m_last_tx_heading = 0.0f;
+#if LORA_TX_BUFFER_SIZE < APRS_MAX_FRAME_LEN
+#error "APRS frames are built in the LoRa TX buffer, which is too small."
+#endif
 
-static float m_last_tx_lat = 0.0f;
-static float m_last_tx_lon = 0.0f;
+static float m_last_tx_heading = 0.0f;
 
 static uint64_t m_last_tx_time = 0;
 static uint64_t m_last_wx_time = 0;
 
+static uint64_t m_last_tlm_defs_time = 0; // last complete set of definitions
+static uint64_t m_last_tlm_def_tx_time = 0;
+static uint8_t  m_next_tlm_def = PACKET_TYPE_TLM_PARM;
+
 static uint32_t m_tx_counter = 0;
 
+static tracker_smartbeacon_t m_smartbeacon = {
+	.slow_speed_kmh     = TRACKER_SB_SLOW_SPEED_KMH,
+	.slow_rate_s        = TRACKER_SB_SLOW_RATE_S,
+	.fast_speed_kmh     = TRACKER_SB_FAST_SPEED_KMH,
+	.fast_rate_s        = TRACKER_SB_FAST_RATE_S,
+	.min_turn_angle_deg = TRACKER_SB_MIN_TURN_ANGLE_DEG,
+	.turn_slope         = TRACKER_SB_TURN_SLOPE,
+	.min_turn_time_s    = TRACKER_SB_MIN_TURN_TIME_S,
+};
+
 static tracker_callback m_callback;
 
+/**@brief Build a frame directly in the LoRa TX buffer and send it.
+ *
+ * @returns  true if the transmission was started.
+ */
+static bool send_frame(const aprs_args_t *args, uint8_t packet_type)
+{
+	uint8_t *frame = lora_tx_reserve();
+
+	if(!frame) {
+		NRF_LOG_WARNING("tracker: LoRa TX buffer busy, frame dropped");
+		return false;
+	}
+
+	size_t frame_len = aprs_build_frame(frame, args, packet_type);
+
+	if(frame_len == 0 || frame_len > LORA_MAX_PACKET_LEN) {
+		lora_tx_cancel();
+		return false;
+	}
+
+	NRF_LOG_INFO("Generated frame:");
+	NRF_LOG_HEXDUMP_INFO(frame, frame_len);
+
+	return lora_tx_commit(frame_len) == NRF_SUCCESS;
+}
+
+
+/**@brief Send the next telemetry definition message if one is due.
+ * @details
+ * PARM, UNIT and EQNS are sent one at a time, at least 20 s apart from any
+ * other frame, starting after the first position report and then every
+ * TLM_DEFS_INTERVAL_MS.
+ *
+ * @returns  true if a definition message was sent.
+ */
+static bool send_telemetry_definitions(uint64_t now)
+{
+	if(!(aprs_get_config_flags() & APRS_FLAG_TELEMETRY) || !m_last_tx_time) {
+		return false;
+	}
+
+	if(m_next_tlm_def == PACKET_TYPE_TLM_PARM && m_last_tlm_defs_time
+			&& (now - m_last_tlm_defs_time) < TLM_DEFS_INTERVAL_MS) {
+		return false;
+	}
+
+	if((now - m_last_tx_time) < 20000 || (now - m_last_tlm_def_tx_time) < 20000) {
+		return false;
+	}
+
+	aprs_args_t args = {0};
+
+	if(!send_frame(&args, m_next_tlm_def)) {
+		return false;
+	}
+
+	NRF_LOG_INFO("tracker: sent telemetry definition %d", m_next_tlm_def);
+
+	m_last_tlm_def_tx_time = now;
+
+	if(m_next_tlm_def == PACKET_TYPE_TLM_EQNS) {
+		m_next_tlm_def = PACKET_TYPE_TLM_PARM;
+		m_last_tlm_defs_time = now;
+	} else {
+		m_next_tlm_def++;
+	}
+
+	return true;
+}
+
+
+/**@brief Time between position reports at the given speed.
+ */
+static uint64_t smartbeacon_interval_ms(float speed_kmh)
+{
+	const tracker_smartbeacon_t *sb = &m_smartbeacon;
+
+	if(speed_kmh <= sb->slow_speed_kmh) {
+		return sb->slow_rate_s * 1000ULL;
+	} else if(speed_kmh >= sb->fast_speed_kmh) {
+		return sb->fast_rate_s * 1000ULL;
+	} else {
+		return (uint64_t)(sb->fast_rate_s * 1000.0f * sb->fast_speed_kmh / speed_kmh);
+	}
+}
+
+
 ret_code_t tracker_init(tracker_callback callback)
 {
 	m_callback = callback;
@@ -62,15 +164,9 @@ ret_code_t tracker_run(const nmea_data_t *data, aprs_args_t *args)
         if ((now - m_last_tx_time) > 20000) {
           if ((now - m_last_wx_time) > WX_INTERVAL_MS) {
             if (m_last_wx_time) {
-	      uint8_t message[APRS_MAX_FRAME_LEN];
-	      size_t frame_len;
-	      frame_len = aprs_build_frame(message, args, PACKET_TYPE_WX);
-              if (frame_len > 0) {
+	      if (send_frame(args, PACKET_TYPE_WX)) {
 	        //args->frame_id = ++m_tx_counter;
-	        NRF_LOG_INFO("tracker: sending WX report");
-	        NRF_LOG_INFO("Generated frame:");
-	        NRF_LOG_HEXDUMP_INFO(message, frame_len);
-	        lora_send_packet(message, frame_len);
+	        NRF_LOG_INFO("tracker: sent WX report");
 		m_callback(TRACKER_EVT_TRANSMISSION_STARTED);
               }
             }
@@ -83,24 +179,31 @@ ret_code_t tracker_run(const nmea_data_t *data, aprs_args_t *args)
 	  return NRF_ERROR_BUSY;
         }
 
-	if(!data->pos_valid) {
-		// do not transmit invalid positions
-		return NRF_ERROR_INVALID_DATA;
+	if(send_telemetry_definitions(now)) {
+		m_callback(TRACKER_EVT_TRANSMISSION_STARTED);
+		return NRF_SUCCESS;
 	}
 
-	if((now - m_last_tx_time) < MIN_TX_INTERVAL_MS) {
+	if(m_last_tlm_def_tx_time && (now - m_last_tlm_def_tx_time) < 20000) {
 		// do not transmit too often
 		return NRF_ERROR_BUSY;
 	}
 
-
-	if((now - m_last_tx_time) > MAX_TX_INTERVAL_MS) {
-		// transmit if the previous one was too long ago
-		NRF_LOG_INFO("tracker: forced tx after %d ms idle", now - m_last_tx_time);
-		do_tx = true;
+	if(!data->pos_valid) {
+		// do not transmit invalid positions
+		return NRF_ERROR_INVALID_DATA;
 	}
 
-	if(data->speed_heading_valid && (data->speed >= HEADING_CHECK_MIN_SPEED)) {
+	float speed_kmh = data->speed_heading_valid ? data->speed * 3.6f : 0.0f;
+	uint64_t interval = smartbeacon_interval_ms(speed_kmh);
+
+	if(!m_last_tx_time || (now - m_last_tx_time) >= interval) {
+		NRF_LOG_INFO("tracker: %d s since last TX at %d km/h", (int)((now - m_last_tx_time) / 1000), (int)speed_kmh);
+		do_tx = true;
+	} else if(speed_kmh > m_smartbeacon.slow_speed_kmh
+			&& (now - m_last_tx_time) >= m_smartbeacon.min_turn_time_s * 1000ULL) {
+		// corner pegging: slower stations need a sharper turn
+		float turn_threshold = m_smartbeacon.min_turn_angle_deg + m_smartbeacon.turn_slope / speed_kmh;
 		float delta_heading = data->heading - m_last_tx_heading;
 
 		if(delta_heading < -180.0f) {
@@ -113,54 +216,53 @@ ret_code_t tracker_run(const nmea_data_t *data, aprs_args_t *args)
 			delta_heading = -delta_heading;
 		}
 
-		if(delta_heading >= MAX_HEADING_DELTA_DEG) {
+		if(delta_heading >= turn_threshold) {
 			NRF_LOG_INFO("tracker: heading changed too much: was: %d, is: %d, delta: %d", (int)(m_last_tx_heading + 0.5f), (int)(data->heading + 0.5f), (int)(delta_heading + 0.5f));
 			do_tx = true;
 		}
 	}
 
-	float distance = great_circle_distance_m(
-			data->lat, data->lon,
-			m_last_tx_lat, m_last_tx_lon);
-
-	if(distance >= MAX_DISTANCE_M) {
-		NRF_LOG_INFO("tracker: distance since last TX too high: %d m", (int)(distance + 0.5f));
-		do_tx = true;
-	}
-
 	if(do_tx) {
 		if(data->speed_heading_valid) {
 			m_last_tx_heading = data->heading;
 		}
 
-		m_last_tx_lat = data->lat;
-		m_last_tx_lon = data->lon;
 		m_last_tx_time = now;
 
 		// generate a new APRS packet
-		uint8_t message[APRS_MAX_FRAME_LEN];
-		size_t  frame_len;
-
 		aprs_update_pos_time(data->lat, data->lon, data->altitude, now / 1000);
+		aprs_update_speed_course(data->speed, data->heading, data->speed_heading_valid);
 
 		args->frame_id = ++m_tx_counter;
-		//frame_len = aprs_build_frame(message, args);
-		frame_len = aprs_build_frame(message, args, PACKET_TYPE_POSITION);
+		send_frame(args, PACKET_TYPE_POSITION);
 
-		if (frame_len > 0) {
-		  NRF_LOG_INFO("Generated frame:");
-		  NRF_LOG_HEXDUMP_INFO(message, frame_len);
+		m_callback(TRACKER_EVT_TRANSMISSION_STARTED);
+	}
 
-		  lora_send_packet(message, frame_len);
-                }
+	return NRF_SUCCESS;
+}
 
-		m_callback(TRACKER_EVT_TRANSMISSION_STARTED);
+
+ret_code_t tracker_set_smartbeacon(const tracker_smartbeacon_t *params)
+{
+	if(params->slow_speed_kmh == 0 || params->fast_speed_kmh <= params->slow_speed_kmh
+			|| params->fast_rate_s < 10 || params->slow_rate_s < params->fast_rate_s
+			|| params->min_turn_time_s < 5) {
+		return NRF_ERROR_INVALID_PARAM;
 	}
 
+	m_smartbeacon = *params;
+
 	return NRF_SUCCESS;
 }
 
 
+const tracker_smartbeacon_t* tracker_get_smartbeacon(void)
+{
+	return &m_smartbeacon;
+}
+
+
 void tracker_force_tx(void)
 {
 	// force transmission by resetting the last transmission time.
@@ -30,10 +30,44 @@
 #include "nmea.h"
 #include "aprs.h"
 
+// SmartBeaconing defaults, see tracker_smartbeacon_t
+#define TRACKER_SB_SLOW_SPEED_KMH      5
+#define TRACKER_SB_SLOW_RATE_S      1800
+#define TRACKER_SB_FAST_SPEED_KMH     90
+#define TRACKER_SB_FAST_RATE_S        60
+#define TRACKER_SB_MIN_TURN_ANGLE_DEG 28
+#define TRACKER_SB_TURN_SLOPE        240
+#define TRACKER_SB_MIN_TURN_TIME_S    30
+
 typedef enum {
 	TRACKER_EVT_TRANSMISSION_STARTED,
 } tracker_evt_t;
 
+/* SmartBeaconing parameters.
+ *
+ * Position reports are sent at a rate proportional to the speed: every
+ * slow_rate_s at or below slow_speed_kmh, every fast_rate_s at or above
+ * fast_speed_kmh and every fast_rate_s * fast_speed_kmh / speed in between,
+ * so the reports are about the same distance apart.
+ *
+ * Above slow_speed_kmh, a report is also sent when the heading changed by more
+ * than min_turn_angle_deg + turn_slope / speed (in km/h) since the last one, but
+ * not earlier than min_turn_time_s after it ("corner pegging"). So slow
+ * stations need a sharper turn.
+ *
+ * The structure is stored as is in the settings and exchanged in the same
+ * layout over BLE: seven uint16_t in little endian byte order.
+ */
+typedef struct {
+	uint16_t slow_speed_kmh;
+	uint16_t slow_rate_s;
+	uint16_t fast_speed_kmh;
+	uint16_t fast_rate_s;
+	uint16_t min_turn_angle_deg;
+	uint16_t turn_slope;         // in degrees * km/h
+	uint16_t min_turn_time_s;
+} tracker_smartbeacon_t;
+
 typedef void (*tracker_callback)(tracker_evt_t evt);
 
 /**@brief Initialize all modules necessary for tracking.
@@ -41,6 +75,9 @@ typedef void (*tracker_callback)(tracker_evt_t evt);
 ret_code_t tracker_init(tracker_callback callback);
 
 /**@brief Process a new position report in the tracker.
+ * @details
+ * A position report is sent when one is due according to the SmartBeaconing
+ * parameters (see tracker_smartbeacon_t) or after tracker_force_tx().
  *
  * @param data     Latest NMEA data from the GNSS module.
  * @param args     Arguments for building the APRS frame. The frame_id field
@@ -49,6 +86,20 @@ ret_code_t tracker_init(tracker_callback callback);
  */
 ret_code_t tracker_run(const nmea_data_t *data, aprs_args_t *args);
 
+/**@brief Set the SmartBeaconing parameters.
+ *
+ * @retval NRF_ERROR_INVALID_PARAM  If the speeds or rates are zero, the fast
+ *                                  speed is not above the slow speed, the fast
+ *                                  rate is above the slow rate or below 10 s,
+ *                                  or the minimum turn time is below 5 s. The
+ *                                  parameters are not changed then.
+ */
+ret_code_t tracker_set_smartbeacon(const tracker_smartbeacon_t *params);
+
+/**@brief Get the current SmartBeaconing parameters.
+ */
+const tracker_smartbeacon_t* tracker_get_smartbeacon(void);
+
 /**@brief Force a transmission on the next valid GPS update.
  */
 void tracker_force_tx(void);
@@ -140,7 +140,8 @@ bool m_aprs_decode_ok = true;
 uint8_t m_display_message[256] = "Hello World!";
 uint8_t m_display_message_len = 12;
 
-uint8_t m_display_rx_index = 0;
+uint16_t m_display_rx_index = 0;
+aprs_rx_history_order_t m_display_rx_order = APRS_RX_HISTORY_BY_TIME;
 
 float m_rssi = -100, m_snr = 42, m_signalRssi = -127;
 
@@ -252,6 +253,8 @@ int main(int argc, char **argv) {
 
 	screen = init_sdl();
 
+	aprs_rx_history_set_reference(m_nmea_data.lat, m_nmea_data.lon);
+
 	// add some frames to the RX history
 	aprs_frame_t frame;
 	aprs_rx_raw_data_t raw = {"", 0, -23.0, 10.0, -142.0};
@@ -263,7 +266,7 @@ int main(int argc, char **argv) {
 	raw.data_len = len;
 
 	if(aprs_parse_frame((uint8_t*)data, strlen(data), &frame)) {
-		aprs_rx_history_insert(&frame, &raw, time(NULL)-10, 255);
+		aprs_rx_history_insert(&frame, &raw, time(NULL)-10, APRS_RX_HISTORY_SIZE);
 	}
 
 	raw.signalRssi = -123.0f;
@@ -275,7 +278,7 @@ int main(int argc, char **argv) {
 	raw.data_len = len;
 
 	if(aprs_parse_frame((uint8_t*)data, strlen(data), &frame)) {
-		aprs_rx_history_insert(&frame, &raw, time(NULL)-10000, 255);
+		aprs_rx_history_insert(&frame, &raw, time(NULL)-10000, APRS_RX_HISTORY_SIZE);
 	}
 
 	data = "<\xff\001DH0xxx-14>APLC12,qAO,DO2TE-10:!\\6!czQGAQYA2QLoRaCube-System";
@@ -285,7 +288,7 @@ int main(int argc, char **argv) {
 	raw.data_len = len;
 
 	if(aprs_parse_frame((uint8_t*)data, strlen(data), &frame)) {
-		//aprs_rx_history_insert(&frame, &raw, time(NULL)-1000000, 255);
+		//aprs_rx_history_insert(&frame, &raw, time(NULL)-1000000, APRS_RX_HISTORY_SIZE);
 	}
 
 	while(running && SDL_WaitEvent(&event)) {
@@ -308,8 +311,26 @@ int main(int argc, char **argv) {
 			}
 
 			if(m_display_state == DISP_STATE_LORA_RX_OVERVIEW) {
-				m_display_rx_index++;
-				m_display_rx_index %= APRS_RX_HISTORY_SIZE+1;
+				uint16_t num_stations = aprs_rx_history_get_stats()->num_stations;
+				uint16_t pos = aprs_rx_history_get_position(m_display_rx_order, m_display_rx_index);
+
+				pos = (pos < num_stations) ? pos + 1 : 0;
+
+				if(aprs_rx_history_get_sorted(m_display_rx_order, pos, &m_display_rx_index, 1) == 0) {
+					m_display_rx_index = APRS_RX_HISTORY_SIZE;
+				}
+
+				m_redraw_required = true;
+			}
+		} else if(event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_UP) {
+			// like a long press of the touch button
+			if(m_display_state == DISP_STATE_LORA_RX_OVERVIEW) {
+				m_display_rx_order = (m_display_rx_order + 1) % APRS_RX_HISTORY_NUM_ORDERS;
+
+				if(aprs_rx_history_get_sorted(m_display_rx_order, 0, &m_display_rx_index, 1) == 0) {
+					m_display_rx_index = APRS_RX_HISTORY_SIZE;
+				}
+
 				m_redraw_required = true;
 			}
 		}
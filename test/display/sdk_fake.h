@@ -8,5 +8,7 @@ typedef uint32_t ret_code_t;
 #define NRF_SUCCESS                0
 #define NRF_ERROR_BUSY             1
 #define NRF_ERROR_INVALID_PARAM    2
+#define NRF_ERROR_INVALID_DATA     3
+#define NRF_ERROR_INVALID_STATE    4
 
 #endif // SDK_FAKE_H
@@ -0,0 +1,51 @@
+/*
+ * Counting wrappers for the heap functions, see alloc_count.h.
+ */
+
+#include <stdlib.h>
+
+#include "alloc_count.h"
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void  __real_free(void *ptr);
+
+static size_t m_allocs;
+static size_t m_bytes;
+
+void *__wrap_malloc(size_t size)
+{
+	m_allocs++;
+	m_bytes += size;
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+	m_allocs++;
+	m_bytes += nmemb * size;
+	return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+	m_allocs++;
+	m_bytes += size;
+	return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void *ptr)
+{
+	__real_free(ptr);
+}
+
+size_t alloc_count_get(void)
+{
+	return m_allocs;
+}
+
+size_t alloc_count_get_bytes(void)
+{
+	return m_bytes;
+}
@@ -0,0 +1,23 @@
+/*
+ * Heap allocation counter for the host benchmarks.
+ *
+ * The firmware does not use the heap, so the parsers and the tracker must not
+ * allocate memory. Link with ALLOC_LDFLAGS (see the Makefile): malloc(),
+ * calloc(), realloc() and free() calls of the linked objects are then counted
+ * by alloc_count.c. Allocations inside the C library are not seen.
+ */
+
+#ifndef ALLOC_COUNT_H
+#define ALLOC_COUNT_H
+
+#include <stddef.h>
+
+/**@brief Number of malloc(), calloc() and realloc() calls so far.
+ */
+size_t alloc_count_get(void);
+
+/**@brief Total number of bytes requested so far.
+ */
+size_t alloc_count_get_bytes(void);
+
+#endif // ALLOC_COUNT_H
@@ -0,0 +1,6 @@
+#ifndef APP_TIMER_FAKE_H
+#define APP_TIMER_FAKE_H
+
+/* tracker.c includes app_timer.h, but does not use any timers. */
+
+#endif // APP_TIMER_FAKE_H
@@ -0,0 +1,83 @@
+/*
+ * Loader for the APRS frame corpus (data/aprs_frames.txt) of the host
+ * benchmarks and fuzz drivers.
+ *
+ * Each line holds one frame without the "<\xFF\x01" LoRa prefix. Non-printable
+ * bytes and backslashes are escaped as \xNN, lines starting with '#' are
+ * comments. The loaded frames include the prefix, exactly as received.
+ */
+
+#ifndef APRS_CORPUS_H
+#define APRS_CORPUS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define APRS_CORPUS_MAX_FRAMES     1024
+#define APRS_CORPUS_MAX_FRAME_LEN  256
+
+typedef struct {
+	uint8_t data[APRS_CORPUS_MAX_FRAME_LEN + 1]; // room for a NUL byte behind the frame
+	size_t  len;
+} aprs_corpus_frame_t;
+
+static aprs_corpus_frame_t m_corpus[APRS_CORPUS_MAX_FRAMES];
+static size_t              m_corpus_size;
+
+static int corpus_hex_digit(char c)
+{
+	if(c >= '0' && c <= '9') return c - '0';
+	if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+/**@brief Load the corpus file.
+ *
+ * @returns  The number of frames loaded or -1 if the file cannot be read.
+ */
+static int corpus_load(const char *filename)
+{
+	FILE *f = fopen(filename, "r");
+	char line[4 * APRS_CORPUS_MAX_FRAME_LEN];
+
+	if(!f) {
+		perror(filename);
+		return -1;
+	}
+
+	m_corpus_size = 0;
+
+	while(fgets(line, sizeof(line), f) && m_corpus_size < APRS_CORPUS_MAX_FRAMES) {
+		aprs_corpus_frame_t *frame = &m_corpus[m_corpus_size];
+		size_t line_len = strcspn(line, "\r\n");
+
+		if(line_len == 0 || line[0] == '#') {
+			continue;
+		}
+
+		frame->data[0] = '<';
+		frame->data[1] = 0xFF;
+		frame->data[2] = 0x01;
+		frame->len = 3;
+
+		for(size_t i = 0; i < line_len && frame->len < APRS_CORPUS_MAX_FRAME_LEN; i++) {
+			if(line[i] == '\\' && i + 3 < line_len && line[i+1] == 'x'
+					&& corpus_hex_digit(line[i+2]) >= 0 && corpus_hex_digit(line[i+3]) >= 0) {
+				frame->data[frame->len++] = corpus_hex_digit(line[i+2]) * 16 + corpus_hex_digit(line[i+3]);
+				i += 3;
+			} else {
+				frame->data[frame->len++] = line[i];
+			}
+		}
+
+		m_corpus_size++;
+	}
+
+	fclose(f);
+	return (int)m_corpus_size;
+}
+
+#endif // APRS_CORPUS_H
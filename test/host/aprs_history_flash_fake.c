@@ -0,0 +1,151 @@
+/*
+ * Fake flash for the history store host tests.
+ *
+ * The pages behave like NOR flash: erasing sets all bytes to 0xFF, writing can
+ * only clear bits. Operations finish immediately, but the flash reports to be
+ * busy until it was polled once, so the caller has to wait like on the target.
+ */
+
+#include <string.h>
+
+#include "aprs_history_flash.h"
+#include "aprs_history_flash_fake.h"
+
+static uint8_t  m_flash[APRS_HISTORY_FLASH_PAGES][APRS_HISTORY_FLASH_PAGE_SIZE]
+	__attribute__((aligned(4)));
+static uint32_t m_erase_count[APRS_HISTORY_FLASH_PAGES];
+static uint32_t m_overwrites;
+static bool     m_busy;
+
+static bool     m_power_cut_enabled;
+static uint32_t m_power_budget;   // bytes until the power cut
+static bool     m_power_lost;
+
+/**@brief Take bytes from the power budget.
+ * @returns  The number of bytes that are done before the power is lost.
+ */
+static uint32_t consume_budget(uint32_t bytes)
+{
+	if(m_power_lost) {
+		return 0;
+	}
+
+	if(!m_power_cut_enabled || bytes < m_power_budget) {
+		m_power_budget -= m_power_cut_enabled ? bytes : 0;
+		return bytes;
+	}
+
+	bytes = m_power_budget;
+	m_power_budget = 0;
+	m_power_lost = true;
+	return bytes;
+}
+
+void flash_fake_reset(void)
+{
+	memset(m_flash, 0xFF, sizeof(m_flash));
+	memset(m_erase_count, 0, sizeof(m_erase_count));
+	m_overwrites = 0;
+	m_busy = false;
+	flash_fake_power_on();
+}
+
+void flash_fake_power_cut_after(uint32_t bytes)
+{
+	m_power_cut_enabled = true;
+	m_power_budget = bytes;
+}
+
+bool flash_fake_power_lost(void)
+{
+	return m_power_lost;
+}
+
+void flash_fake_power_on(void)
+{
+	m_power_cut_enabled = false;
+	m_power_lost = false;
+	m_busy = false;
+}
+
+uint32_t flash_fake_erase_count(uint8_t page)
+{
+	return m_erase_count[page];
+}
+
+uint32_t flash_fake_overwrites(void)
+{
+	return m_overwrites;
+}
+
+ret_code_t aprs_history_flash_init(void)
+{
+	return NRF_SUCCESS;
+}
+
+const uint8_t* aprs_history_flash_page(uint8_t page)
+{
+	return m_flash[page];
+}
+
+ret_code_t aprs_history_flash_write(uint8_t page, uint16_t offset, const void *data, size_t len)
+{
+	const uint8_t *bytes = data;
+
+	if(m_busy) {
+		return NRF_ERROR_BUSY;
+	}
+
+	if(page >= APRS_HISTORY_FLASH_PAGES || (offset % 4) != 0 || (len % 4) != 0
+			|| offset + len > APRS_HISTORY_FLASH_PAGE_SIZE) {
+		return NRF_ERROR_INVALID_PARAM;
+	}
+
+	bool lost_before = m_power_lost;
+	uint32_t done = consume_budget(len);
+
+	for(uint32_t i = 0; i < done; i++) {
+		if(m_flash[page][offset + i] != 0xFF) {
+			m_overwrites++;
+		}
+
+		m_flash[page][offset + i] &= bytes[i];
+	}
+
+	if(!lost_before && done < len) {
+		// the interrupted byte is only partially programmed
+		m_flash[page][offset + done] &= bytes[done] | 0x5A;
+	}
+
+	m_busy = true;
+	return NRF_SUCCESS;
+}
+
+ret_code_t aprs_history_flash_erase(uint8_t page)
+{
+	if(m_busy) {
+		return NRF_ERROR_BUSY;
+	}
+
+	if(page >= APRS_HISTORY_FLASH_PAGES) {
+		return NRF_ERROR_INVALID_PARAM;
+	}
+
+	uint32_t done = consume_budget(APRS_HISTORY_FLASH_PAGE_SIZE);
+
+	if(done > 0) {
+		memset(m_flash[page], 0xFF, done);
+		m_erase_count[page]++;
+	}
+
+	m_busy = true;
+	return NRF_SUCCESS;
+}
+
+bool aprs_history_flash_is_busy(void)
+{
+	bool busy = m_busy;
+
+	m_busy = false;
+	return busy;
+}
@@ -0,0 +1,36 @@
+#ifndef APRS_HISTORY_FLASH_FAKE_H
+#define APRS_HISTORY_FLASH_FAKE_H
+
+/* Controls of the fake flash for the history store tests. */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**@brief Erase all pages and clear the counters.
+ */
+void flash_fake_reset(void);
+
+/**@brief Cut the power after the given number of bytes were programmed.
+ * @details
+ * An erase counts as APRS_HISTORY_FLASH_PAGE_SIZE bytes. The operation that
+ * reaches the limit is done partially: a write programs the bytes before the
+ * limit and some bits of the next one, an erase erases only the beginning of
+ * the page. All later operations are ignored until flash_fake_power_on().
+ */
+void flash_fake_power_cut_after(uint32_t bytes);
+
+bool flash_fake_power_lost(void);
+
+/**@brief Restore the power (and disable the power cut).
+ */
+void flash_fake_power_on(void);
+
+uint32_t flash_fake_erase_count(uint8_t page);
+
+/**@brief Number of bytes written that were not erased before.
+ * @details
+ * NOR flash can only clear bits, so such writes corrupt the data.
+ */
+uint32_t flash_fake_overwrites(void);
+
+#endif // APRS_HISTORY_FLASH_FAKE_H
@@ -0,0 +1,161 @@
+/*
+ * Host benchmark for the APRS frame builder.
+ *
+ * Builds position and weather frames for all combinations of the APRS config
+ * flags and a few path setups and reports the number of frames built per
+ * second. Only the public API of aprs.c is used, so the benchmark can also be
+ * built against older versions of aprs.c (see the bench target in the
+ * Makefile).
+ *
+ * With --dump, every frame is printed once (non-printable bytes escaped)
+ * instead. The dumps of two versions must be identical.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "aprs.h"
+
+#define NUM_FLAG_COMBINATIONS  (1 << 6)
+
+#define MIN_RUNTIME_S          0.2
+
+typedef struct {
+	const char *dest;
+	const char *path[2];
+} path_setup_t;
+
+static const path_setup_t m_path_setups[] = {
+	{"APLT00", {NULL,      NULL}},
+	{"APLT00", {"1",       NULL}},
+	{"APLT00", {"WIDE1-1", NULL}},
+	{"APZ001", {"WIDE1-1", "WIDE2-1"}},
+};
+
+#define NUM_PATH_SETUPS (sizeof(m_path_setups) / sizeof(m_path_setups[0]))
+
+/* Fixed time base, so the comment rate limit and the weather timestamp do not
+ * depend on when the benchmark is run. */
+uint64_t time_base_get(void)
+{
+	return 0;
+}
+
+static double now_s(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void setup(const path_setup_t *setup)
+{
+	aprs_init();
+	aprs_set_source("DL9SAU-12");
+	aprs_set_dest(setup->dest);
+
+	aprs_clear_path();
+	for(size_t i = 0; i < 2; i++) {
+		if(setup->path[i]) {
+			aprs_add_path(setup->path[i]);
+		}
+	}
+
+	aprs_set_icon_default(AI_BIKE);
+	aprs_set_comment("T-Echo LoRa APRS");
+	aprs_update_pos_time(48.137154f, 11.576124f, 519.3f, 1700000000);
+}
+
+static void init_args(aprs_args_t *args)
+{
+	args->frame_id = 42;
+	args->vbat_millivolt = 3987;
+	args->transmit_env_data = true;
+	args->temperature_celsius = 21.4f;
+	args->humidity_rH = 48.6f;
+	args->pressure_hPa = 1013.2f;
+}
+
+static void dump_frame(const uint8_t *frame, size_t len)
+{
+	for(size_t i = 0; i < len; i++) {
+		if(frame[i] >= 0x20 && frame[i] < 0x7F && frame[i] != '\\') {
+			putchar(frame[i]);
+		} else {
+			printf("\\x%02X", frame[i]);
+		}
+	}
+	putchar('\n');
+}
+
+/**@brief Build all frame variants of one path setup.
+ *
+ * @returns  The number of frames built.
+ */
+static size_t build_all(aprs_args_t *args, bool dump)
+{
+	static uint8_t frame[APRS_MAX_FRAME_LEN];
+	size_t frames = 0;
+
+	for(uint32_t flags = 0; flags < NUM_FLAG_COMBINATIONS; flags++) {
+		aprs_set_config_flags(flags);
+
+		for(uint8_t type = PACKET_TYPE_POSITION; type <= PACKET_TYPE_WX; type++) {
+			size_t len = aprs_build_frame(frame, args, type);
+
+			if(dump) {
+				printf("%s %02X %u: ", type == PACKET_TYPE_WX ? "wx " : "pos", flags, args->frame_id);
+				dump_frame(frame, len);
+			}
+
+			if(len > 0) {
+				frames++;
+			}
+
+			args->frame_id++;
+		}
+	}
+
+	return frames;
+}
+
+int main(int argc, char **argv)
+{
+	bool dump = (argc > 1) && (strcmp(argv[1], "--dump") == 0);
+	aprs_args_t args;
+
+	if(dump) {
+		for(size_t i = 0; i < NUM_PATH_SETUPS; i++) {
+			init_args(&args);
+			setup(&m_path_setups[i]);
+			build_all(&args, true);
+		}
+
+		return 0;
+	}
+
+	for(size_t i = 0; i < NUM_PATH_SETUPS; i++) {
+		size_t frames = 0;
+		double start, elapsed;
+
+		init_args(&args);
+		setup(&m_path_setups[i]);
+
+		start = now_s();
+		do {
+			for(int rep = 0; rep < 100; rep++) {
+				frames += build_all(&args, false);
+			}
+			elapsed = now_s() - start;
+		} while(elapsed < MIN_RUNTIME_S);
+
+		printf("path %-17s %9.0f frames/s (%6.0f ns/frame)\n",
+				m_path_setups[i].path[1] ? "WIDE1-1,WIDE2-1" :
+				m_path_setups[i].path[0] ? m_path_setups[i].path[0] : "(none)",
+				frames / elapsed, elapsed * 1e9 / frames);
+	}
+
+	return 0;
+}
@@ -0,0 +1,179 @@
+/*
+ * Host benchmark for the spatial queries of the RX history.
+ *
+ * Fills the history with stations within about 100 km of a position, half of
+ * them in a few towns, and measures "closest 5 stations" and "stations within
+ * 10 km" from random positions in the area. For comparison, the same queries
+ * are answered by a scan of all stations, as the display did before. Build
+ * with -DAPRS_RX_HISTORY_SIZE=n to measure different history sizes (see the
+ * Makefile).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "aprs.h"
+#include "utils.h"
+
+#define CENTER_LAT   49.72f
+#define CENTER_LON   11.05f
+#define NUM_QUERIES  1000
+
+uint64_t time_base_get(void)
+{
+	return 0;
+}
+
+static double now_s(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint32_t m_rng_state = 0x12345678;
+
+static uint32_t rng(void)
+{
+	// xorshift32
+	m_rng_state ^= m_rng_state << 13;
+	m_rng_state ^= m_rng_state >> 17;
+	m_rng_state ^= m_rng_state << 5;
+	return m_rng_state;
+}
+
+/* Random offset in degrees of latitude, up to about max_km. */
+static float offset(float max_km)
+{
+	return ((float)(rng() % 20001) - 10000.0f) * 1e-4f * max_km / 111.0f;
+}
+
+static void fill_history(void)
+{
+	aprs_frame_t frame;
+	aprs_rx_raw_data_t raw = {0};
+
+	raw.data_len = 8;
+	memset(raw.data, '#', raw.data_len);
+
+	for(uint32_t i = 0; i < APRS_RX_HISTORY_SIZE; i++) {
+		memset(&frame, 0, sizeof(frame));
+		snprintf(frame.source, sizeof(frame.source), "DB%uAB-%u", i / 16, i % 16);
+
+		if(i % 2) {
+			// one of 8 towns
+			frame.lat = CENTER_LAT + (float)(i % 8) * 0.1f - 0.4f + offset(3.0f);
+			frame.lon = CENTER_LON - (float)(i % 8) * 0.15f + 0.6f + offset(3.0f) * 1.5f;
+		} else {
+			frame.lat = CENTER_LAT + offset(100.0f);
+			frame.lon = CENTER_LON + offset(100.0f) * 1.5f;
+		}
+
+		aprs_rx_history_insert(&frame, &raw, i + 1, APRS_RX_HISTORY_SIZE);
+	}
+}
+
+/* Reference: distance to every station, keeping the closest count. */
+static uint16_t scan_nearest(float lat, float lon, uint16_t *idx, float *distance, uint16_t count)
+{
+	uint16_t n = 0;
+
+	for(uint16_t i = 0; i < aprs_rx_history_get_stats()->num_entries; i++) {
+		const aprs_rx_history_entry_t *entry = aprs_rx_history_get(i);
+
+		if(entry->rx_timestamp == 0) {
+			continue;
+		}
+
+		float d = great_circle_distance_m(lat, lon, entry->lat, entry->lon);
+
+		if(n == count && d >= distance[n - 1]) {
+			continue;
+		}
+
+		uint16_t pos = (n < count) ? n++ : n - 1;
+
+		while(pos > 0 && distance[pos - 1] > d) {
+			idx[pos] = idx[pos - 1];
+			distance[pos] = distance[pos - 1];
+			pos--;
+		}
+
+		idx[pos] = i;
+		distance[pos] = d;
+	}
+
+	return n;
+}
+
+static uint16_t scan_within(float lat, float lon, float radius_m)
+{
+	uint16_t n = 0;
+
+	for(uint16_t i = 0; i < aprs_rx_history_get_stats()->num_entries; i++) {
+		const aprs_rx_history_entry_t *entry = aprs_rx_history_get(i);
+
+		if(entry->rx_timestamp != 0 && great_circle_distance_m(lat, lon, entry->lat, entry->lon) <= radius_m) {
+			n++;
+		}
+	}
+
+	return n;
+}
+
+int main(void)
+{
+	static float lat[NUM_QUERIES], lon[NUM_QUERIES];
+	uint16_t idx[5];
+	float distance[5];
+	uint32_t sum_grid = 0, sum_scan = 0;
+	double t0, t_nearest, t_nearest_scan, t_within, t_within_scan;
+
+	aprs_init();
+	fill_history();
+
+	for(int i = 0; i < NUM_QUERIES; i++) {
+		lat[i] = CENTER_LAT + offset(50.0f);
+		lon[i] = CENTER_LON + offset(50.0f) * 1.5f;
+	}
+
+	t0 = now_s();
+	for(int i = 0; i < NUM_QUERIES; i++) {
+		aprs_rx_history_find_nearest(lat[i], lon[i], idx, distance, 5);
+		sum_grid += idx[4];
+	}
+	t_nearest = now_s() - t0;
+
+	t0 = now_s();
+	for(int i = 0; i < NUM_QUERIES; i++) {
+		scan_nearest(lat[i], lon[i], idx, distance, 5);
+		sum_scan += idx[4];
+	}
+	t_nearest_scan = now_s() - t0;
+
+	t0 = now_s();
+	for(int i = 0; i < NUM_QUERIES; i++) {
+		sum_grid += aprs_rx_history_find_within(lat[i], lon[i], 10000.0f, idx, NULL, 5);
+	}
+	t_within = now_s() - t0;
+
+	t0 = now_s();
+	for(int i = 0; i < NUM_QUERIES; i++) {
+		sum_scan += scan_within(lat[i], lon[i], 10000.0f);
+	}
+	t_within_scan = now_s() - t0;
+
+	printf("%4u stations: closest 5 %6.0f ns (scan %6.0f ns), within 10 km %6.0f ns (scan %6.0f ns)\n",
+			aprs_rx_history_get_stats()->num_stations,
+			t_nearest * 1e9 / NUM_QUERIES, t_nearest_scan * 1e9 / NUM_QUERIES,
+			t_within * 1e9 / NUM_QUERIES, t_within_scan * 1e9 / NUM_QUERIES);
+
+	if(sum_grid != sum_scan) {
+		fprintf(stderr, "grid and scan results differ\n");
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,223 @@
+/*
+ * Host benchmark for the RX history.
+ *
+ * Inserts 10000 frames from 500 distinct stations and reports the average and
+ * the slowest time per insert. Build with -DAPRS_RX_HISTORY_SIZE=n to measure
+ * different history sizes (see the Makefile). The benchmark can also be built
+ * against older versions of aprs.c, which store the history in fixed-size
+ * entries.
+ *
+ * The frames have realistic lengths, so the number of stations held at the end
+ * and the RAM used per station are reported as well.
+ *
+ * Every 50 frames, the index returned last is protected, like the entry shown
+ * on the display. With --dump, the final history is printed instead, which must
+ * be identical for all implementations.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "aprs.h"
+
+#define NUM_FRAMES    10000
+#define NUM_STATIONS  500
+#define REPETITIONS   20
+
+static aprs_frame_t       m_frames[NUM_FRAMES];
+static aprs_rx_raw_data_t m_raw[NUM_FRAMES];
+
+uint64_t time_base_get(void)
+{
+	return 0;
+}
+
+static double now_s(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint32_t m_rng_state = 0x12345678;
+
+static uint32_t rng(void)
+{
+	// xorshift32
+	m_rng_state ^= m_rng_state << 13;
+	m_rng_state ^= m_rng_state >> 17;
+	m_rng_state ^= m_rng_state << 5;
+	return m_rng_state;
+}
+
+/* Some stations are heard much more often than others: pick from a small set of
+ * busy stations half of the time. The raw frame is a readable position report
+ * with a comment of random length. */
+static void generate_frames(void)
+{
+	for(size_t i = 0; i < NUM_FRAMES; i++) {
+		aprs_frame_t *frame = &m_frames[i];
+		aprs_rx_raw_data_t *raw = &m_raw[i];
+		uint32_t station = (rng() & 1) ? rng() % 20 : rng() % NUM_STATIONS;
+		size_t comment_len = rng() % 40;
+
+		memset(frame, 0, sizeof(*frame));
+
+		snprintf(frame->source, sizeof(frame->source), "D%c%u%c%c-%u",
+				'A' + station % 26, station % 10, 'A' + (station / 10) % 26,
+				'A' + station / 260, station % 16);
+		strcpy(frame->dest, "APLT00");
+		strcpy(frame->via, "WIDE1-1");
+		frame->lat = 48.0f + station * 0.01f;
+		frame->lon = 8.0f + (rng() % 1000) * 0.001f;
+		frame->table = '/';
+		frame->symbol = '>';
+
+		for(size_t j = 0; j < comment_len; j++) {
+			frame->comment[j] = 'a' + rng() % 26;
+		}
+
+		raw->data_len = snprintf((char*)raw->data, sizeof(raw->data),
+				"<\xff\x01%s>%s,%s:!4903.50N/00824.11E>%s",
+				frame->source, frame->dest, frame->via, frame->comment);
+		raw->rssi = -(float)(rng() % 130);
+	}
+}
+
+static void run(double *worst_ns)
+{
+	uint16_t protected_index = APRS_RX_HISTORY_SIZE;
+	uint16_t idx;
+
+	aprs_init();
+
+	for(size_t i = 0; i < NUM_FRAMES; i++) {
+		double t0 = worst_ns ? now_s() : 0.0;
+
+		idx = aprs_rx_history_insert(&m_frames[i], &m_raw[i], 1000 + i, protected_index);
+
+		if(worst_ns) {
+			double ns = (now_s() - t0) * 1e9;
+
+			if(ns > *worst_ns) {
+				*worst_ns = ns;
+			}
+		}
+
+		if(i % 50 == 0) {
+			protected_index = idx;
+		}
+	}
+}
+
+#ifdef APRS_RX_HISTORY_ARENA_SIZE
+
+static void dump(void)
+{
+	char source[16];
+
+	run(NULL);
+
+	for(size_t i = 0; i < aprs_rx_history_get_stats()->num_entries; i++) {
+		const aprs_rx_history_entry_t *entry = aprs_rx_history_get(i);
+
+		aprs_rx_history_get_string(entry, APRS_RX_HISTORY_SOURCE, source, sizeof(source));
+		printf("%3zu %-10s %.4f %.4f %llu\n", i, source, entry->lat, entry->lon,
+				(unsigned long long)entry->rx_timestamp);
+	}
+}
+
+/* Stations in the history after run() and the RAM they use. The index sizes
+ * follow aprs.c: two hash slots per entry (rounded up to a power of two) and
+ * one grid bucket per two hash slots, the update order, the free list, the
+ * orders by distance and RSSI and the grid links, all of uint16_t. The record
+ * buffer is not counted. */
+static void memory_usage(size_t *stations, size_t *ram)
+{
+	size_t hash_size = 64;
+
+	while(hash_size < 2 * APRS_RX_HISTORY_SIZE) {
+		hash_size *= 2;
+	}
+
+	*stations = 0;
+
+	for(size_t i = 0; i < aprs_rx_history_get_stats()->num_entries; i++) {
+		if(aprs_rx_history_get(i)->rx_timestamp != 0) {
+			(*stations)++;
+		}
+	}
+
+	*ram = APRS_RX_HISTORY_SIZE * (sizeof(aprs_rx_history_entry_t) + 6 * sizeof(uint16_t))
+		+ (hash_size + hash_size / 2) * sizeof(uint16_t) + APRS_RX_HISTORY_ARENA_SIZE;
+}
+
+#else
+
+static void dump(void)
+{
+	const aprs_rx_history_t *history = aprs_get_rx_history();
+
+	run(NULL);
+
+	for(size_t i = 0; i < history->num_entries; i++) {
+		printf("%3zu %-10s %.4f %.4f %llu\n", i, history->history[i].decoded.source,
+				history->history[i].decoded.lat, history->history[i].decoded.lon,
+				(unsigned long long)history->history[i].rx_timestamp);
+	}
+}
+
+static void memory_usage(size_t *stations, size_t *ram)
+{
+	*stations = aprs_get_rx_history()->num_entries;
+	*ram = sizeof(aprs_rx_history_t);
+}
+
+#endif
+
+int main(int argc, char **argv)
+{
+	generate_frames();
+
+	if(argc > 1 && strcmp(argv[1], "--dump") == 0) {
+		dump();
+		return 0;
+	}
+
+	double best_ns = 1e12;
+	double worst_ns = 1e12;
+
+	// best of several runs to suppress scheduling noise
+	for(int rep = 0; rep < REPETITIONS; rep++) {
+		double t0 = now_s();
+		run(NULL);
+		double ns = (now_s() - t0) * 1e9 / NUM_FRAMES;
+
+		if(ns < best_ns) {
+			best_ns = ns;
+		}
+	}
+
+	// the slowest single insert, of the run where it was fastest
+	for(int rep = 0; rep < REPETITIONS; rep++) {
+		double run_worst_ns = 0.0;
+		run(&run_worst_ns);
+
+		if(run_worst_ns < worst_ns) {
+			worst_ns = run_worst_ns;
+		}
+	}
+
+	size_t stations, ram;
+
+	memory_usage(&stations, &ram);
+
+	printf("history size %4d: %d frames from %d stations: %7.1f ns/insert average, %7.0f ns worst\n",
+			APRS_RX_HISTORY_SIZE, NUM_FRAMES, NUM_STATIONS, best_ns, worst_ns);
+	printf("                   %zu stations held in %zu B RAM, %zu B/station\n",
+			stations, ram, ram / stations);
+
+	return 0;
+}
@@ -0,0 +1,137 @@
+/*
+ * Host benchmark for the APRS frame parser.
+ *
+ * Parses all frames of the corpus repeatedly and reports the throughput, the
+ * average and the slowest time per frame and the number of heap allocations
+ * (which must be zero, see alloc_count.h). Only aprs_parse_frame() is used, so
+ * the benchmark can also be built against older versions of aprs.c (see the
+ * bench target in the Makefile). Older parsers rely on a NUL byte behind the
+ * frame, so one is always provided.
+ *
+ * With --dump, the decoded fields of every frame are printed instead.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "aprs.h"
+#include "aprs_corpus.h"
+#include "alloc_count.h"
+
+#define MIN_RUNTIME_S  0.2
+
+uint64_t time_base_get(void)
+{
+	return 0;
+}
+
+static double now_s(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void dump(void)
+{
+	for(size_t i = 0; i < m_corpus_size; i++) {
+		aprs_frame_t result;
+
+		memset(&result, 0, sizeof(result));
+		m_corpus[i].data[m_corpus[i].len] = '\0';
+
+		if(aprs_parse_frame(m_corpus[i].data, m_corpus[i].len, &result)) {
+			printf("%3zu ok  %s>%s via '%s' %.6f %.6f %.1f m sym %c%c comment '%s'\n",
+					i, result.source, result.dest, result.via,
+					result.lat, result.lon, result.alt,
+					result.table, result.symbol, result.comment);
+		} else {
+			printf("%3zu err %s\n", i, aprs_get_parser_error());
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const char *corpus = "data/aprs_frames.txt";
+	bool do_dump = false;
+
+	for(int i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "--dump") == 0) {
+			do_dump = true;
+		} else {
+			corpus = argv[i];
+		}
+	}
+
+	if(corpus_load(corpus) <= 0) {
+		fprintf(stderr, "No frames in %s.\n", corpus);
+		return 1;
+	}
+
+	if(do_dump) {
+		dump();
+		return 0;
+	}
+
+	static aprs_frame_t result;
+	size_t frames = 0;
+	size_t decoded = 0;
+	double worst_ns = 0.0;
+	size_t worst_idx = 0;
+	size_t bytes = 0;
+	size_t allocs = alloc_count_get();
+	double start = now_s();
+	double elapsed;
+
+	for(size_t i = 0; i < m_corpus_size; i++) {
+		m_corpus[i].data[m_corpus[i].len] = '\0';
+		bytes += m_corpus[i].len;
+	}
+
+	do {
+		for(int rep = 0; rep < 100; rep++) {
+			for(size_t i = 0; i < m_corpus_size; i++) {
+				if(aprs_parse_frame(m_corpus[i].data, m_corpus[i].len, &result)) {
+					decoded++;
+				}
+			}
+			frames += m_corpus_size;
+		}
+		elapsed = now_s() - start;
+	} while(elapsed < MIN_RUNTIME_S);
+
+	// slowest frame: best of several runs to suppress scheduling noise
+	for(size_t i = 0; i < m_corpus_size; i++) {
+		double best_ns = 1e12;
+
+		for(int rep = 0; rep < 20; rep++) {
+			double t0 = now_s();
+			for(int k = 0; k < 100; k++) {
+				aprs_parse_frame(m_corpus[i].data, m_corpus[i].len, &result);
+			}
+			double ns = (now_s() - t0) * 1e9 / 100;
+
+			if(ns < best_ns) {
+				best_ns = ns;
+			}
+		}
+
+		if(best_ns > worst_ns) {
+			worst_ns = best_ns;
+			worst_idx = i;
+		}
+	}
+
+	allocs = alloc_count_get() - allocs;
+
+	printf("%zu frames (%zu decoded): %7.0f ns/frame average, %7.0f ns worst (frame %zu)\n",
+			m_corpus_size, decoded * m_corpus_size / frames,
+			elapsed * 1e9 / frames, worst_ns, worst_idx);
+	printf("  %.0f frames/s, %.1f MB/s, %zu heap allocations\n",
+			frames / elapsed, (double)bytes * frames / m_corpus_size / elapsed / 1e6, allocs);
+
+	return allocs ? 1 : 0;
+}
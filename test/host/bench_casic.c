@@ -0,0 +1,151 @@
+/*
+ * Host benchmark comparing the CASIC binary decoder with the NMEA parser.
+ *
+ * Both corpora contain the same epochs (see gen_casic_corpus.c). Each stream
+ * is decoded repeatedly and the average time per epoch is reported, together
+ * with the amount of data and the resulting UART time at 9600 baud:
+ *
+ * - nmea_parse():  every line of the NMEA stream parsed with nmea_parse()
+ * - NMEA rx path:  nmea_rx_feed() + nmea_parse_sentence(), as in gps.c
+ * - CASIC rx path: casic_rx_feed() + casic_parse_frame(), as in gps.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "nmea_rx.h"
+#include "nmea.h"
+#include "casic_rx.h"
+#include "casic.h"
+
+#define MAX_STREAM_SIZE  65536
+#define MAX_LINE_LEN     128
+#define NUM_EPOCHS       10   // epochs in the corpus
+
+#define MIN_RUNTIME_S    0.2
+
+static nmea_data_t m_data;
+
+static double now_s(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void cb_sentence(const nmea_sentence_t *sentence)
+{
+	nmea_parse_sentence(sentence, NULL, &m_data);
+}
+
+static void cb_frame(const casic_frame_t *frame)
+{
+	casic_parse_frame(frame, NULL, &m_data);
+}
+
+typedef enum {
+	MODE_NMEA_PARSE,
+	MODE_NMEA_RX,
+	MODE_CASIC_RX
+} bench_mode_t;
+
+/**@brief Decode the stream repeatedly for at least MIN_RUNTIME_S.
+ *
+ * @returns  The average time per pass in nanoseconds.
+ */
+static double bench(bench_mode_t mode, const uint8_t *stream, size_t len)
+{
+	static nmea_rx_t nmea_rx;
+	static casic_rx_t casic_rx;
+	size_t passes = 0;
+	double start = now_s();
+	double elapsed;
+
+	nmea_rx_init(&nmea_rx, cb_sentence);
+	casic_rx_init(&casic_rx, cb_frame);
+
+	do {
+		for(int rep = 0; rep < 100; rep++) {
+			switch(mode) {
+				case MODE_NMEA_PARSE:
+					{
+						const char *p = (const char*)stream;
+						const char *end = p + len;
+
+						while(p < end) {
+							const char *eol = memchr(p, '\n', end - p);
+							size_t line_len = eol ? (size_t)(eol - p + 1) : (size_t)(end - p);
+							char line[MAX_LINE_LEN];
+
+							if(line_len < sizeof(line)) {
+								memcpy(line, p, line_len);
+								line[line_len] = '\0';
+								nmea_parse(line, NULL, &m_data);
+							}
+
+							p += line_len;
+						}
+					}
+					break;
+
+				case MODE_NMEA_RX:
+					nmea_rx_feed(&nmea_rx, stream, len);
+					break;
+
+				case MODE_CASIC_RX:
+					casic_rx_feed(&casic_rx, stream, len);
+					break;
+			}
+
+			passes++;
+		}
+
+		elapsed = now_s() - start;
+	} while(elapsed < MIN_RUNTIME_S);
+
+	return elapsed * 1e9 / passes;
+}
+
+static size_t read_file(const char *filename, uint8_t *buf, size_t buf_len)
+{
+	FILE *f = fopen(filename, "rb");
+	if(!f) {
+		perror(filename);
+		exit(2);
+	}
+
+	size_t len = fread(buf, 1, buf_len, f);
+	fclose(f);
+
+	return len;
+}
+
+static void report(const char *name, double ns_per_pass, size_t len)
+{
+	printf("  %-14s %6zu bytes/epoch  %6.1f ms UART/epoch  %8.0f ns/epoch\n",
+			name, len / NUM_EPOCHS,
+			len * 10.0 / 9600.0 * 1000.0 / NUM_EPOCHS, // 8N1: 10 bits per byte
+			ns_per_pass / NUM_EPOCHS);
+}
+
+int main(int argc, char **argv)
+{
+	static uint8_t nmea[MAX_STREAM_SIZE];
+	static uint8_t bin[MAX_STREAM_SIZE];
+
+	if(argc < 3) {
+		fprintf(stderr, "usage: %s <recorded nmea stream> <casic binary stream>\n", argv[0]);
+		return 2;
+	}
+
+	size_t nmea_len = read_file(argv[1], nmea, sizeof(nmea));
+	size_t bin_len = read_file(argv[2], bin, sizeof(bin));
+
+	report("nmea_parse()", bench(MODE_NMEA_PARSE, nmea, nmea_len), nmea_len);
+	report("NMEA rx path", bench(MODE_NMEA_RX, nmea, nmea_len), nmea_len);
+	report("CASIC rx path", bench(MODE_CASIC_RX, bin, bin_len), bin_len);
+
+	return 0;
+}
@@ -0,0 +1,271 @@
+/*
+ * Host benchmark for the station list (DISP_STATE_LORA_RX_OVERVIEW).
+ *
+ * Fills the RX history with stations around the own position and measures
+ * redraw_display() of the station list for every page in each order. The
+ * e-Paper framebuffer is replaced by stubs that only count the calls, so the
+ * time is spent in display.c and the history. Build with
+ * -DAPRS_RX_HISTORY_SIZE=n to measure different history sizes (see the
+ * Makefile).
+ *
+ * For comparison, the cost of a list sorted on every redraw is measured: the
+ * distance and direction of all stations are calculated and the indices are
+ * sorted with qsort(). The cost of maintaining the orders is reported as the
+ * time per insert and per update of the reference position.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "aprs.h"
+#include "display.h"
+#include "epaper.h"
+#include "nmea.h"
+#include "utils.h"
+
+#define REF_LAT  49.7225f
+#define REF_LON  11.0568f
+
+// variables of main.c used by display.c
+nmea_data_t        m_nmea_data;
+bool               m_nmea_has_position = true;
+bool               m_lora_rx_active = true;
+bool               m_tracker_active = false;
+bool               m_gnss_keep_active = false;
+display_state_t    m_display_state = DISP_STATE_LORA_RX_OVERVIEW;
+bool               m_lora_rx_busy = false;
+bool               m_lora_tx_busy = false;
+uint8_t            m_bat_percent = 80;
+uint16_t           m_bat_millivolt = 3900;
+aprs_rx_raw_data_t m_last_undecodable_data;
+uint64_t           m_last_undecodable_timestamp = 0;
+uint16_t           m_display_rx_index = 0;
+aprs_rx_history_order_t m_display_rx_order = APRS_RX_HISTORY_BY_TIME;
+char               m_passkey[6];
+
+static uint32_t m_draw_calls;
+
+uint64_t time_base_get(void)
+{
+	return 0;
+}
+
+/* Framebuffer stubs */
+void epaper_fb_clear(uint8_t color) { m_draw_calls++; }
+void epaper_fb_move_to(uint8_t x, uint8_t y) { m_draw_calls++; }
+void epaper_fb_line_to(uint8_t xe, uint8_t ye, uint8_t color) { m_draw_calls++; }
+void epaper_fb_circle(uint8_t radius, uint8_t color) { m_draw_calls++; }
+void epaper_fb_draw_rect(uint8_t left, uint8_t top, uint8_t right, uint8_t bottom, uint8_t color) { m_draw_calls++; }
+void epaper_fb_fill_rect(uint8_t left, uint8_t top, uint8_t right, uint8_t bottom, uint8_t color) { m_draw_calls++; }
+void epaper_fb_set_font(const GFXfont *font) { }
+uint8_t epaper_fb_calc_text_width(const char *s) { return 6 * strlen(s); }
+ret_code_t epaper_fb_draw_string(const char *s, uint8_t color) { m_draw_calls += strlen(s); return NRF_SUCCESS; }
+ret_code_t epaper_fb_draw_data_wrapped(const uint8_t *s, size_t len, uint8_t color) { m_draw_calls += len; return NRF_SUCCESS; }
+ret_code_t epaper_fb_draw_string_wrapped(const char *s, uint8_t color) { m_draw_calls += strlen(s); return NRF_SUCCESS; }
+uint8_t epaper_fb_get_line_height(void) { return 16; }
+uint8_t epaper_fb_get_cursor_pos_y(void) { return 0; }
+ret_code_t epaper_update(bool full_refresh) { return NRF_SUCCESS; }
+
+/* Stubs of other modules */
+bool menusystem_is_active(void) { return false; }
+void menusystem_render(uint8_t base_y) { }
+uint32_t tracker_get_tx_counter(void) { return 0; }
+bool bme280_is_present(void) { return false; }
+float bme280_get_temperature(void) { return 0.0f; }
+float bme280_get_humidity(void) { return 0.0f; }
+float bme280_get_pressure(void) { return 0.0f; }
+
+static double now_s(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint32_t m_rng_state = 0x12345678;
+
+static uint32_t rng(void)
+{
+	// xorshift32
+	m_rng_state ^= m_rng_state << 13;
+	m_rng_state ^= m_rng_state >> 17;
+	m_rng_state ^= m_rng_state << 5;
+	return m_rng_state;
+}
+
+/* Receive a short position report from a station within about 50 km. */
+static void receive(uint32_t station, uint64_t timestamp)
+{
+	char text[128];
+	aprs_rx_raw_data_t raw;
+	aprs_frame_t frame;
+
+	float lat = REF_LAT + ((float)(rng() % 10000) - 5000.0f) * 1e-4f * 0.45f;
+	float lon = REF_LON + ((float)(rng() % 10000) - 5000.0f) * 1e-4f * 0.7f;
+
+	snprintf(text, sizeof(text), "DB%uAB-%u>APLT00,WIDE1-1:!%02d%05.2fN/%03d%05.2fE>LoRa",
+			station / 16, station % 16,
+			(int)lat, (lat - (int)lat) * 60.0f, (int)lon, (lon - (int)lon) * 60.0f);
+
+	raw.data[0] = '<';
+	raw.data[1] = 0xff;
+	raw.data[2] = 0x01;
+	strcpy((char*)raw.data + 3, text);
+	raw.data_len = strlen(text) + 3;
+	raw.rssi = -(float)(rng() % 520) / 4.0f;
+	raw.snr = (float)((int)(rng() % 120) - 80) / 4.0f;
+	raw.signalRssi = raw.rssi;
+
+	if(!aprs_parse_frame(raw.data, raw.data_len, &frame)) {
+		fprintf(stderr, "cannot parse %s: %s\n", text, aprs_get_parser_error());
+		exit(1);
+	}
+
+	aprs_rx_history_insert(&frame, &raw, timestamp, APRS_RX_HISTORY_SIZE);
+}
+
+/* Redraw every page of the list in the given order.
+ *
+ * @returns  The number of redraws.
+ */
+static uint32_t redraw_all_pages(aprs_rx_history_order_t order)
+{
+	uint16_t num_stations = aprs_rx_history_get_stats()->num_stations;
+	uint32_t count = 0;
+
+	m_display_rx_order = order;
+
+	for(uint16_t pos = 0; pos < num_stations; pos += 3) {
+		aprs_rx_history_get_sorted(order, pos, &m_display_rx_index, 1);
+		redraw_display(false);
+		count++;
+	}
+
+	return count;
+}
+
+typedef struct {
+	uint16_t idx;
+	float    distance;
+} sort_item_t;
+
+static int compare_distance(const void *a, const void *b)
+{
+	float da = ((const sort_item_t*)a)->distance;
+	float db = ((const sort_item_t*)b)->distance;
+
+	return (da > db) - (da < db);
+}
+
+/* The list sorted by distance on every redraw, without drawing.
+ *
+ * @returns  The number of pages.
+ */
+static uint32_t sort_all_pages(float *checksum)
+{
+	static sort_item_t items[APRS_RX_HISTORY_SIZE];
+	uint16_t num_stations = aprs_rx_history_get_stats()->num_stations;
+	uint32_t count = 0;
+
+	for(uint16_t pos = 0; pos < num_stations; pos += 3) {
+		uint16_t n = 0;
+
+		for(uint16_t i = 0; i < aprs_rx_history_get_stats()->num_entries; i++) {
+			const aprs_rx_history_entry_t *entry = aprs_rx_history_get(i);
+
+			if(entry->rx_timestamp == 0) {
+				continue;
+			}
+
+			items[n].idx = i;
+			items[n].distance = great_circle_distance_m(REF_LAT, REF_LON, entry->lat, entry->lon);
+			*checksum += direction_angle(REF_LAT, REF_LON, entry->lat, entry->lon);
+			n++;
+		}
+
+		qsort(items, n, sizeof(items[0]), compare_distance);
+		*checksum += items[pos].distance;
+		count++;
+	}
+
+	return count;
+}
+
+int main(void)
+{
+	const aprs_rx_history_stats_t *stats = aprs_rx_history_get_stats();
+	uint32_t num_inserts = APRS_RX_HISTORY_SIZE * 8;
+	double t0, t;
+
+	aprs_init();
+	aprs_rx_history_set_reference(REF_LAT, REF_LON);
+	m_nmea_data.lat = REF_LAT;
+	m_nmea_data.lon = REF_LON;
+
+	t0 = now_s();
+
+	for(uint32_t i = 1; i <= num_inserts; i++) {
+		receive(rng() % APRS_RX_HISTORY_SIZE, i);
+	}
+
+	double insert_ns = (now_s() - t0) * 1e9 / num_inserts;
+
+	printf("%4u stations: insert %.0f ns (parsing included)\n", stats->num_stations, insert_ns);
+
+	static const char *const order_names[APRS_RX_HISTORY_NUM_ORDERS] = {"time", "distance", "RSSI"};
+
+	for(aprs_rx_history_order_t order = 0; order < APRS_RX_HISTORY_NUM_ORDERS; order++) {
+		uint32_t count = 0;
+
+		t0 = now_s();
+
+		do {
+			count += redraw_all_pages(order);
+			t = now_s() - t0;
+		} while(t < 0.2);
+
+		printf("      redraw by %-8s %6.0f ns per page\n", order_names[order], t * 1e9 / count);
+	}
+
+	uint32_t count = 0;
+	float checksum = 0.0f;
+
+	t0 = now_s();
+
+	do {
+		count += sort_all_pages(&checksum);
+		t = now_s() - t0;
+	} while(t < 0.2);
+
+	printf("      sort on redraw   %6.0f ns per page (without drawing)\n", t * 1e9 / count);
+
+	// a walk below the threshold, then moves that sort again
+	count = 0;
+	t0 = now_s();
+
+	for(uint32_t i = 0; i < 100000; i++) {
+		aprs_rx_history_set_reference(REF_LAT + (i % 2) * 0.0001f, REF_LON);
+	}
+
+	double ref_small_ns = (now_s() - t0) * 1e9 / 100000;
+
+	t0 = now_s();
+
+	for(uint32_t i = 0; i < 1000; i++) {
+		aprs_rx_history_set_reference(REF_LAT + (i % 2) * 0.002f, REF_LON);
+	}
+
+	double ref_move_ns = (now_s() - t0) * 1e9 / 1000;
+
+	printf("      reference update %6.0f ns below threshold, %.0f ns with recalculation\n",
+			ref_small_ns, ref_move_ns);
+
+	// keep the results alive
+	if(checksum == 12345.0f || m_draw_calls == 0) {
+		printf("%f %u\n", checksum, m_draw_calls);
+	}
+
+	return 0;
+}
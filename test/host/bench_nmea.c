@@ -0,0 +1,230 @@
+/*
+ * Host benchmark for the NMEA parser.
+ *
+ * Parses all lines of a recorded NMEA stream repeatedly and reports the
+ * average time per sentence, in total and for each sentence type, followed by
+ * the throughput, the slowest sentence and the number of heap allocations
+ * (which must be zero, see alloc_count.h). Only
+ * nmea_parse() and nmea_data_t are required, so the benchmark can also be built
+ * against older versions of nmea.c (see the bench target in the Makefile).
+ *
+ * If the parser supports pre-indexed sentences (nmea_sentence_t), the time of
+ * nmea_parse_sentence() alone is reported as well. This is the part that runs
+ * in the main loop; the indexing is done while receiving.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "nmea.h"
+#include "alloc_count.h"
+
+#define MAX_STREAM_SIZE  65536
+#define MAX_LINES        1024
+#define MAX_LINE_LEN     128
+
+#define MIN_RUNTIME_S    0.2
+
+static char   m_lines[MAX_LINES][MAX_LINE_LEN];
+static size_t m_num_lines;
+
+static double now_s(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**@brief Parse the lines of the given type (or all lines if type is NULL)
+ * repeatedly for at least MIN_RUNTIME_S.
+ *
+ * @returns  The average time per sentence in nanoseconds.
+ */
+static double bench(const char *type, bool indexed, nmea_data_t *data)
+{
+	size_t sentences = 0;
+	size_t errors = 0;
+	double start = now_s();
+	double elapsed;
+
+#ifdef NMEA_MAX_FIELDS
+	static nmea_sentence_t indexed_lines[MAX_LINES];
+
+	for(size_t i = 0; i < m_num_lines; i++) {
+		size_t consumed;
+
+		nmea_sentence_init(&indexed_lines[i]);
+		nmea_sentence_append(&indexed_lines[i], (const uint8_t*)m_lines[i], strlen(m_lines[i]), &consumed);
+	}
+#endif
+
+	// select the lines to parse before the measurement
+	static size_t selected[MAX_LINES];
+	size_t num_selected = 0;
+
+	for(size_t i = 0; i < m_num_lines; i++) {
+		if(!type || strncmp(m_lines[i] + 1, type, 5) == 0) {
+			selected[num_selected++] = i;
+		}
+	}
+
+	do {
+		for(int rep = 0; rep < 100; rep++) {
+			for(size_t j = 0; j < num_selected; j++) {
+				size_t i = selected[j];
+				char buf[MAX_LINE_LEN];
+				bool pos_updated;
+				ret_code_t err_code;
+
+				if(indexed) {
+#ifdef NMEA_MAX_FIELDS
+					err_code = nmea_parse_sentence(&indexed_lines[i], &pos_updated, data);
+#else
+					err_code = NRF_ERROR_INVALID_DATA;
+#endif
+				} else {
+					// older versions of nmea_parse() modify the line
+					strcpy(buf, m_lines[i]);
+					err_code = nmea_parse(buf, &pos_updated, data);
+				}
+
+				if(err_code != NRF_SUCCESS) {
+					errors++;
+				}
+
+				sentences++;
+			}
+		}
+
+		elapsed = now_s() - start;
+	} while(elapsed < MIN_RUNTIME_S);
+
+	if(errors) {
+		fprintf(stderr, "%zu parser errors!\n", errors);
+	}
+
+	return elapsed * 1e9 / sentences;
+}
+
+static void print_result(const char *type, nmea_data_t *data)
+{
+	printf("%-8s %10.1f ns/sentence", type ? type : "all", bench(type, false, data));
+
+#ifdef NMEA_MAX_FIELDS
+	printf(", %10.1f ns/sentence pre-indexed", bench(type, true, data));
+#endif
+
+	printf("\n");
+}
+
+/**@brief Report the throughput and the slowest sentence.
+ * @details
+ * Each line is timed separately, best of several runs to suppress scheduling
+ * noise.
+ */
+static void print_totals(double avg_ns, nmea_data_t *data)
+{
+	size_t bytes = 0;
+	double worst_ns = 0.0;
+	size_t worst_idx = 0;
+
+	for(size_t i = 0; i < m_num_lines; i++) {
+		double best_ns = 1e12;
+		char buf[MAX_LINE_LEN];
+		bool pos_updated;
+
+		bytes += strlen(m_lines[i]);
+
+		for(int rep = 0; rep < 20; rep++) {
+			double t0 = now_s();
+			for(int k = 0; k < 100; k++) {
+				strcpy(buf, m_lines[i]);
+				nmea_parse(buf, &pos_updated, data);
+			}
+			double ns = (now_s() - t0) * 1e9 / 100;
+
+			if(ns < best_ns) {
+				best_ns = ns;
+			}
+		}
+
+		if(best_ns > worst_ns) {
+			worst_ns = best_ns;
+			worst_idx = i;
+		}
+	}
+
+	printf("%.0f sentences/s, %.1f MB/s, %.1f ns worst (line %zu: %.6s)\n",
+			1e9 / avg_ns, bytes / (double)m_num_lines / avg_ns * 1e3,
+			worst_ns, worst_idx + 1, m_lines[worst_idx]);
+}
+
+int main(int argc, char **argv)
+{
+	static char stream[MAX_STREAM_SIZE + 1];
+	static nmea_data_t data;
+
+	if(argc < 2) {
+		fprintf(stderr, "usage: %s <recorded nmea stream>\n", argv[0]);
+		return 2;
+	}
+
+	FILE *f = fopen(argv[1], "rb");
+	if(!f) {
+		perror(argv[1]);
+		return 2;
+	}
+
+	size_t stream_len = fread(stream, 1, MAX_STREAM_SIZE, f);
+	fclose(f);
+
+	stream[stream_len] = '\0';
+
+	// split into lines (including the line end, like the receiver provides them)
+	char *p = stream;
+	while(*p && m_num_lines < MAX_LINES) {
+		char *eol = strchr(p, '\n');
+		size_t len = eol ? (size_t)(eol - p + 1) : strlen(p);
+
+		if(len < MAX_LINE_LEN) {
+			memcpy(m_lines[m_num_lines], p, len);
+			m_lines[m_num_lines][len] = '\0';
+			m_num_lines++;
+		}
+
+		p += len;
+	}
+
+	size_t allocs = alloc_count_get();
+
+	print_totals(bench(NULL, false, &data), &data);
+	print_result(NULL, &data);
+
+	// per sentence type
+	for(size_t i = 0; i < m_num_lines; i++) {
+		char type[6];
+
+		memcpy(type, m_lines[i] + 1, 5);
+		type[5] = '\0';
+
+		bool seen = false;
+		for(size_t j = 0; j < i; j++) {
+			if(strncmp(m_lines[j] + 1, type, 5) == 0) {
+				seen = true;
+				break;
+			}
+		}
+
+		if(!seen) {
+			print_result(type, &data);
+		}
+	}
+
+	allocs = alloc_count_get() - allocs;
+	printf("%zu heap allocations\n", allocs);
+
+	// prevent the parsed data from being optimized away
+	return (allocs || data.sat_info_count_gps == 0xFF) ? 1 : 0;
+}
@@ -0,0 +1,179 @@
+/*
+ * Host benchmark for the tracker.
+ *
+ * A recorded NMEA stream is replayed epoch by epoch, the same way gps_loop()
+ * and cb_gps() in main.c process it: the sentences are indexed, grouped into
+ * epochs by gps_epoch.c and each completed epoch is passed to tracker_run().
+ * The system time follows the UTC time of the stream. Frames are "sent" by a
+ * fake LoRa TX buffer.
+ *
+ * Reports the number of transmitted frames, the average and the slowest time
+ * per epoch (parsing and tracker) and the number of heap allocations (which
+ * must be zero, see alloc_count.h). With --dump, the transmitted frames are
+ * printed instead.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "nmea.h"
+#include "gps_epoch.h"
+#include "lora.h"
+#include "tracker.h"
+#include "alloc_count.h"
+
+#define MAX_LINE_LEN  128
+
+static uint64_t    m_now;
+
+static uint8_t     m_tx_buffer[LORA_TX_BUFFER_SIZE];
+static bool        m_tx_reserved;
+static size_t      m_frames_sent;
+static size_t      m_bytes_sent;
+static bool        m_dump;
+
+static nmea_data_t m_nmea_data;
+static gps_epoch_t m_epoch;
+
+uint64_t time_base_get(void)
+{
+	return m_now;
+}
+
+uint8_t* lora_tx_reserve(void)
+{
+	if(m_tx_reserved) {
+		return NULL;
+	}
+
+	m_tx_reserved = true;
+	return m_tx_buffer;
+}
+
+ret_code_t lora_tx_commit(uint8_t length)
+{
+	if(!m_tx_reserved) {
+		return NRF_ERROR_INVALID_STATE;
+	}
+
+	m_tx_reserved = false;
+	m_frames_sent++;
+	m_bytes_sent += length;
+
+	if(m_dump) {
+		printf("%02u:%02u:%02u %3u B %.*s\n",
+				m_nmea_data.datetime.time_h, m_nmea_data.datetime.time_m, m_nmea_data.datetime.time_s,
+				length, length - 3, (const char*)m_tx_buffer + 3);
+	}
+
+	return NRF_SUCCESS;
+}
+
+void lora_tx_cancel(void)
+{
+	m_tx_reserved = false;
+}
+
+static void cb_tracker(tracker_evt_t evt)
+{
+	(void)evt;
+}
+
+static double now_s(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void run_epoch(void)
+{
+	const nmea_datetime_t *dt = &m_nmea_data.datetime;
+	aprs_args_t args = {
+		.vbat_millivolt = 3900,
+	};
+
+	m_now = ((dt->time_h * 60 + dt->time_m) * 60 + dt->time_s) * 1000ULL;
+
+	tracker_run(&m_nmea_data, &args);
+}
+
+int main(int argc, char **argv)
+{
+	const char *stream = "data/drive_1hz.nmea";
+	char line[MAX_LINE_LEN];
+	size_t epochs = 0;
+	double total_ns = 0.0;
+	double epoch_ns = 0.0;
+	double worst_ns = 0.0;
+
+	for(int i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "--dump") == 0) {
+			m_dump = true;
+		} else {
+			stream = argv[i];
+		}
+	}
+
+	FILE *f = fopen(stream, "r");
+	if(!f) {
+		perror(stream);
+		return 2;
+	}
+
+	aprs_init();
+	aprs_set_source("DL9SAU-12");
+	aprs_set_dest("APLT00");
+	aprs_set_icon('/', '>');
+	aprs_set_comment("host replay");
+	aprs_set_config_flags(APRS_FLAG_COMPRESS_LOCATION | APRS_FLAG_ADD_ALTITUDE);
+
+	tracker_init(cb_tracker);
+	gps_epoch_init(&m_epoch);
+
+	size_t allocs = alloc_count_get();
+
+	while(fgets(line, sizeof(line), f)) {
+		nmea_sentence_t sentence;
+		size_t consumed;
+		double t0 = now_s();
+
+		nmea_sentence_init(&sentence);
+		nmea_sentence_append(&sentence, (const uint8_t*)line, strlen(line), &consumed);
+
+		if(gps_epoch_begin_sentence(&m_epoch, &sentence)) {
+			run_epoch();
+
+			epoch_ns += (now_s() - t0) * 1e9;
+			if(epoch_ns > worst_ns) {
+				worst_ns = epoch_ns;
+			}
+
+			total_ns += epoch_ns;
+			epoch_ns = 0.0;
+			epochs++;
+			t0 = now_s();
+		}
+
+		if(nmea_parse_sentence(&sentence, NULL, &m_nmea_data) == NRF_SUCCESS) {
+			gps_epoch_end_sentence(&m_epoch);
+		}
+
+		epoch_ns += (now_s() - t0) * 1e9;
+	}
+
+	fclose(f);
+
+	allocs = alloc_count_get() - allocs;
+
+	if(!m_dump) {
+		printf("%zu epochs: %zu frames (%zu B) sent, %7.0f ns/epoch average, %7.0f ns worst\n",
+				epochs, m_frames_sent, m_bytes_sent,
+				epochs ? total_ns / epochs : 0.0, worst_ns);
+		printf("  %zu heap allocations\n", allocs);
+	}
+
+	return (allocs || m_frames_sent == 0) ? 1 : 0;
+}
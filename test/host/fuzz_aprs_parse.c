@@ -0,0 +1,128 @@
+/*
+ * Fuzz target for aprs_parse_frame().
+ *
+ * LLVMFuzzerTestOneInput() is the libFuzzer entry point (build with
+ * "make fuzz_aprs_parse_libfuzzer CC=clang"). Every input is copied into a
+ * buffer of exactly its size, so AddressSanitizer reports any read behind the
+ * frame.
+ *
+ * Without libFuzzer, main() provides two modes:
+ * - AFL style: parse stdin or each file given on the command line once.
+ * - --mutate N CORPUS: run N random mutations of the corpus frames (see
+ *   fuzz_mutator.h). This runs with ASan/UBSan in "make fuzz".
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "aprs.h"
+
+uint64_t time_base_get(void)
+{
+	return 0;
+}
+
+static void parse(const uint8_t *data, size_t size)
+{
+	uint8_t *frame = malloc(size ? size : 1);
+	aprs_frame_t result;
+
+	memcpy(frame, data, size);
+	aprs_parse_frame(frame, size, &result);
+	free(frame);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	uint8_t prefixed[APRS_MAX_FRAME_LEN + 3];
+
+	// as received, and with the LoRa prefix to reach the text parser
+	parse(data, size);
+
+	if(size <= APRS_MAX_FRAME_LEN) {
+		prefixed[0] = '<';
+		prefixed[1] = 0xFF;
+		prefixed[2] = 0x01;
+		memcpy(prefixed + 3, data, size);
+		parse(prefixed, size + 3);
+	}
+
+	return 0;
+}
+
+#ifndef FUZZ_LIBFUZZER
+
+#include "aprs_corpus.h"
+#include "fuzz_mutator.h"
+
+static const uint8_t m_interesting_bytes[] = {
+	'\0', ' ', '!', '/', ':', ',', '>', '<', '|', '}', '{', '`', '\'', 'A', '=', '.', 'N', 'W', 0x7F, 0xFF,
+};
+
+static int run_mutations(unsigned long iterations, const char *corpus)
+{
+	uint8_t buf[APRS_MAX_FRAME_LEN];
+
+	if(corpus_load(corpus) <= 0) {
+		fprintf(stderr, "No frames in %s.\n", corpus);
+		return 1;
+	}
+
+	for(unsigned long i = 0; i < iterations; i++) {
+		const aprs_corpus_frame_t *frame = &m_corpus[i % m_corpus_size];
+		size_t len = frame->len;
+
+		if(len > sizeof(buf)) {
+			len = sizeof(buf);
+		}
+
+		const aprs_corpus_frame_t *other = &m_corpus[rng() % m_corpus_size];
+
+		memcpy(buf, frame->data, len);
+		len = fuzz_mutate(buf, len, sizeof(buf), m_interesting_bytes, sizeof(m_interesting_bytes),
+				other->data, other->len);
+
+		parse(buf, len);
+	}
+
+	printf("fuzz_aprs_parse: %lu mutated frames parsed.\n", iterations);
+	return 0;
+}
+
+static int run_file(FILE *f)
+{
+	uint8_t buf[4096];
+	size_t len = fread(buf, 1, sizeof(buf), f);
+
+	LLVMFuzzerTestOneInput(buf, len);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	if(argc == 4 && strcmp(argv[1], "--mutate") == 0) {
+		return run_mutations(strtoul(argv[2], NULL, 10), argv[3]);
+	}
+
+	if(argc == 1) {
+		return run_file(stdin);
+	}
+
+	for(int i = 1; i < argc; i++) {
+		FILE *f = fopen(argv[i], "rb");
+
+		if(!f) {
+			perror(argv[i]);
+			return 1;
+		}
+
+		run_file(f);
+		fclose(f);
+	}
+
+	return 0;
+}
+
+#endif // FUZZ_LIBFUZZER
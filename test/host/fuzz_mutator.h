@@ -0,0 +1,97 @@
+/*
+ * Simple corpus mutator for the fuzz drivers without libFuzzer.
+ *
+ * The mutations (bit flips, byte changes, insertions, deletions, truncation and
+ * splicing with another corpus entry) use a fixed seed, so every run is
+ * reproducible.
+ */
+
+#ifndef FUZZ_MUTATOR_H
+#define FUZZ_MUTATOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+static uint32_t m_rng_state = 0x12345678;
+
+static uint32_t rng(void)
+{
+	// xorshift32
+	m_rng_state ^= m_rng_state << 13;
+	m_rng_state ^= m_rng_state >> 17;
+	m_rng_state ^= m_rng_state << 5;
+	return m_rng_state;
+}
+
+/**@brief Apply one to four random mutations to the buffer.
+ *
+ * @param buf          The data to mutate.
+ * @param len          Length of the data.
+ * @param max_len      Size of the buffer.
+ * @param interesting  Bytes with a special meaning for the parser.
+ * @param n_interesting Number of interesting bytes.
+ * @param splice       Another corpus entry to splice in.
+ * @param splice_len   Length of the other corpus entry.
+ * @returns            The new length of the data.
+ */
+static size_t fuzz_mutate(uint8_t *buf, size_t len, size_t max_len,
+		const uint8_t *interesting, size_t n_interesting,
+		const uint8_t *splice, size_t splice_len)
+{
+	uint32_t n_mutations = 1 + rng() % 4;
+
+	for(uint32_t m = 0; m < n_mutations; m++) {
+		size_t pos = len ? rng() % len : 0;
+
+		switch(rng() % 7) {
+			case 0: // bit flip
+				if(len) buf[pos] ^= 1 << (rng() % 8);
+				break;
+
+			case 1: // random byte
+				if(len) buf[pos] = rng();
+				break;
+
+			case 2: // interesting byte
+				if(len) buf[pos] = interesting[rng() % n_interesting];
+				break;
+
+			case 3: // insert
+				if(len < max_len) {
+					memmove(buf + pos + 1, buf + pos, len - pos);
+					buf[pos] = interesting[rng() % n_interesting];
+					len++;
+				}
+				break;
+
+			case 4: // delete
+				if(len) {
+					memmove(buf + pos, buf + pos + 1, len - pos - 1);
+					len--;
+				}
+				break;
+
+			case 5: // truncate
+				len = pos;
+				break;
+
+			case 6: { // splice with another entry
+				size_t other_pos = rng() % (splice_len + 1);
+				size_t copy = splice_len - other_pos;
+
+				if(pos + copy > max_len) {
+					copy = max_len - pos;
+				}
+
+				memcpy(buf + pos, splice + other_pos, copy);
+				len = pos + copy;
+				break;
+			}
+		}
+	}
+
+	return len;
+}
+
+#endif // FUZZ_MUTATOR_H
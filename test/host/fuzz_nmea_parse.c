@@ -0,0 +1,188 @@
+/*
+ * Fuzz target for nmea_parse() and the indexed reception path
+ * (nmea_sentence_append() and nmea_parse_sentence()).
+ *
+ * LLVMFuzzerTestOneInput() is the libFuzzer entry point (build with
+ * "make fuzz_nmea_parse_libfuzzer CC=clang"). The input is copied into a
+ * buffer of exactly its size (plus the NUL byte nmea_parse() requires), so
+ * AddressSanitizer reports any read behind the line.
+ *
+ * Without libFuzzer, main() provides two modes:
+ * - AFL style: parse stdin or each file given on the command line once.
+ * - --mutate N CORPUS: run N random mutations of the lines of a recorded NMEA
+ *   stream (see fuzz_mutator.h). Half of the mutated lines get a correct
+ *   checksum again, otherwise hardly any of them would reach the field parsers.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "nmea.h"
+
+static nmea_data_t m_data;
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	char *line = malloc(size + 1);
+	nmea_sentence_t sentence;
+	bool pos_updated;
+
+	memcpy(line, data, size);
+	line[size] = '\0';
+	nmea_parse(line, &pos_updated, &m_data);
+	free(line);
+
+	// as received: the input may contain several sentences
+	uint8_t *rx = malloc(size ? size : 1);
+	size_t offset = 0;
+
+	memcpy(rx, data, size);
+	nmea_sentence_init(&sentence);
+
+	while(offset < size) {
+		size_t consumed;
+		nmea_sentence_status_t status = nmea_sentence_append(&sentence, rx + offset, size - offset, &consumed);
+
+		offset += consumed;
+
+		if(status != NMEA_SENTENCE_INCOMPLETE) {
+			nmea_parse_sentence(&sentence, &pos_updated, &m_data);
+			nmea_sentence_init(&sentence);
+		}
+
+		if(consumed == 0 && status == NMEA_SENTENCE_INCOMPLETE) {
+			break;
+		}
+	}
+
+	free(rx);
+	return 0;
+}
+
+#ifndef FUZZ_LIBFUZZER
+
+#include "fuzz_mutator.h"
+
+#define MAX_LINES     4096
+#define MAX_LINE_LEN  128
+
+static uint8_t m_lines[MAX_LINES][MAX_LINE_LEN];
+static size_t  m_line_len[MAX_LINES];
+static size_t  m_num_lines;
+
+static const uint8_t m_interesting_bytes[] = {
+	'\0', '\r', '\n', '$', '*', ',', '.', '-', '0', '9', 'A', 'E', 'N', 'S', 'V', 'W', 0x7F, 0xFF,
+};
+
+static int load_lines(const char *filename)
+{
+	FILE *f = fopen(filename, "r");
+	char line[MAX_LINE_LEN];
+
+	if(!f) {
+		perror(filename);
+		return -1;
+	}
+
+	m_num_lines = 0;
+
+	while(fgets(line, sizeof(line), f) && m_num_lines < MAX_LINES) {
+		size_t len = strlen(line);
+
+		memcpy(m_lines[m_num_lines], line, len);
+		m_line_len[m_num_lines] = len;
+		m_num_lines++;
+	}
+
+	fclose(f);
+	return (int)m_num_lines;
+}
+
+/**@brief Recalculate the checksum of a mutated sentence, if it still has one.
+ */
+static void fix_checksum(uint8_t *buf, size_t len)
+{
+	static const char hex[] = "0123456789ABCDEF";
+	uint8_t checksum = 0;
+	size_t i;
+
+	if(len == 0 || buf[0] != '$') {
+		return;
+	}
+
+	for(i = 1; i < len && buf[i] != '*'; i++) {
+		checksum ^= buf[i];
+	}
+
+	if(i + 2 < len) {
+		buf[i + 1] = hex[checksum >> 4];
+		buf[i + 2] = hex[checksum & 0x0F];
+	}
+}
+
+static int run_mutations(unsigned long iterations, const char *corpus)
+{
+	uint8_t buf[MAX_LINE_LEN];
+
+	if(load_lines(corpus) <= 0) {
+		fprintf(stderr, "No lines in %s.\n", corpus);
+		return 1;
+	}
+
+	for(unsigned long i = 0; i < iterations; i++) {
+		size_t line = i % m_num_lines;
+		size_t other = rng() % m_num_lines;
+		size_t len = m_line_len[line];
+
+		memcpy(buf, m_lines[line], len);
+		len = fuzz_mutate(buf, len, sizeof(buf), m_interesting_bytes, sizeof(m_interesting_bytes),
+				m_lines[other], m_line_len[other]);
+
+		if(rng() & 1) {
+			fix_checksum(buf, len);
+		}
+
+		LLVMFuzzerTestOneInput(buf, len);
+	}
+
+	printf("fuzz_nmea_parse: %lu mutated sentences parsed.\n", iterations);
+	return 0;
+}
+
+static int run_file(FILE *f)
+{
+	uint8_t buf[4096];
+	size_t len = fread(buf, 1, sizeof(buf), f);
+
+	LLVMFuzzerTestOneInput(buf, len);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	if(argc == 4 && strcmp(argv[1], "--mutate") == 0) {
+		return run_mutations(strtoul(argv[2], NULL, 10), argv[3]);
+	}
+
+	if(argc == 1) {
+		return run_file(stdin);
+	}
+
+	for(int i = 1; i < argc; i++) {
+		FILE *f = fopen(argv[i], "rb");
+
+		if(!f) {
+			perror(argv[i]);
+			return 1;
+		}
+
+		run_file(f);
+		fclose(f);
+	}
+
+	return 0;
+}
+
+#endif // FUZZ_LIBFUZZER
@@ -0,0 +1,199 @@
+/*
+ * Generate a CASIC binary corpus from a recorded NMEA stream.
+ *
+ * The NMEA stream is parsed epoch by epoch and each epoch is encoded as the
+ * binary messages the module would output instead (NAV-TIMEUTC, NAV-PV,
+ * NAV-DOP and the satellite information). The result therefore contains the
+ * same navigation data as the NMEA stream, which allows to compare both
+ * decoders directly:
+ *
+ *   ./gen_casic_corpus data/casic_1hz.nmea data/casic_1hz.bin
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nmea.h"
+#include "casic.h"
+
+#define MAX_LINE_LEN  128
+
+static FILE *m_out;
+static uint32_t m_run_time = 100000;
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+	p[0] = v & 0xFF;
+	p[1] = v >> 8;
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+	for(int i = 0; i < 4; i++) {
+		p[i] = (v >> (8 * i)) & 0xFF;
+	}
+}
+
+static void put_f32(uint8_t *p, float f)
+{
+	uint32_t raw;
+	memcpy(&raw, &f, sizeof(raw));
+	put_u32(p, raw);
+}
+
+static void put_f64(uint8_t *p, double d)
+{
+	uint64_t raw;
+	memcpy(&raw, &d, sizeof(raw));
+	put_u32(p, raw & 0xFFFFFFFF);
+	put_u32(p + 4, raw >> 32);
+}
+
+static void write_frame(uint8_t id, const uint8_t *payload, uint16_t len)
+{
+	uint8_t frame[CASIC_FRAME_OVERHEAD + CASIC_MAX_PAYLOAD_LEN];
+
+	size_t frame_len = casic_build_frame(frame, sizeof(frame), CASIC_CLASS_NAV, id, payload, len);
+	if(frame_len == 0) {
+		fprintf(stderr, "frame too long\n");
+		exit(1);
+	}
+
+	fwrite(frame, 1, frame_len, m_out);
+}
+
+static uint8_t sats_used(const nmea_data_t *data, uint8_t sys_id)
+{
+	for(int i = 0; i < NMEA_NUM_FIX_INFO; i++) {
+		if(data->fix_info[i].sys_id == sys_id) {
+			return data->fix_info[i].sats_used;
+		}
+	}
+
+	return 0;
+}
+
+static void write_satinfo(uint8_t id, const nmea_sat_info_t *sats, uint8_t count, uint8_t used)
+{
+	uint8_t p[CASIC_MAX_PAYLOAD_LEN];
+
+	if(count > CASIC_MAX_SAT_INFO) {
+		count = CASIC_MAX_SAT_INFO;
+	}
+
+	memset(p, 0, sizeof(p));
+	put_u32(&p[0], m_run_time);
+	p[4] = count;
+	p[5] = used;
+
+	for(uint8_t i = 0; i < count; i++) {
+		uint8_t *sv = &p[8 + 12 * i];
+
+		sv[0] = i;
+		sv[1] = sats[i].sat_id;
+		sv[4] = (sats[i].snr < 0) ? 0 : sats[i].snr;
+	}
+
+	write_frame(id, p, 8 + 12 * count);
+}
+
+static void write_epoch(const nmea_data_t *data)
+{
+	uint8_t p[CASIC_MAX_PAYLOAD_LEN];
+
+	// NAV-TIMEUTC
+	memset(p, 0, 24);
+	put_u32(&p[0], m_run_time);
+	put_u16(&p[14], data->datetime.date_y);
+	p[16] = data->datetime.date_m;
+	p[17] = data->datetime.date_d;
+	p[18] = data->datetime.time_h;
+	p[19] = data->datetime.time_m;
+	p[20] = data->datetime.time_s;
+	p[21] = data->datetime_valid;
+	p[23] = data->datetime_valid;
+	write_frame(CASIC_ID_NAV_TIMEUTC, p, 24);
+
+	// NAV-PV
+	uint8_t gps = sats_used(data, NMEA_SYS_ID_GPS);
+	uint8_t bds = sats_used(data, NMEA_SYS_ID_BEIDOU);
+	uint8_t gln = sats_used(data, NMEA_SYS_ID_GLONASS);
+
+	memset(p, 0, 80);
+	put_u32(&p[0], m_run_time);
+	p[4] = data->pos_valid ? 7 : 0;
+	p[5] = data->speed_heading_valid ? 7 : 0;
+	p[7] = gps + bds + gln;
+	p[8] = gps;
+	p[9] = bds;
+	p[10] = gln;
+	put_f32(&p[12], data->pdop);
+	put_f64(&p[16], data->lon_e7 * 1e-7);
+	put_f64(&p[24], data->lat_e7 * 1e-7);
+	put_f32(&p[32], data->altitude + 47.9f); // above the ellipsoid
+	put_f32(&p[36], 47.9f);
+	put_f32(&p[64], data->speed);
+	put_f32(&p[68], data->heading);
+	write_frame(CASIC_ID_NAV_PV, p, 80);
+
+	// NAV-DOP
+	memset(p, 0, 28);
+	put_u32(&p[0], m_run_time);
+	put_f32(&p[4], data->pdop);
+	put_f32(&p[8], data->hdop);
+	put_f32(&p[12], data->vdop);
+	write_frame(CASIC_ID_NAV_DOP, p, 28);
+
+	write_satinfo(CASIC_ID_NAV_GPSINFO, data->sat_info_gps, data->sat_info_count_gps, gps);
+	write_satinfo(CASIC_ID_NAV_GLNINFO, data->sat_info_glonass, data->sat_info_count_glonass, gln);
+
+	m_run_time += 1000;
+}
+
+int main(int argc, char **argv)
+{
+	static nmea_data_t data;
+	char line[MAX_LINE_LEN];
+	char time[16] = "";
+	bool have_epoch = false;
+
+	if(argc < 3) {
+		fprintf(stderr, "usage: %s <input.nmea> <output.bin>\n", argv[0]);
+		return 1;
+	}
+
+	FILE *in = fopen(argv[1], "r");
+	if(!in) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	m_out = fopen(argv[2], "wb");
+	if(!m_out) {
+		perror(argv[2]);
+		return 1;
+	}
+
+	while(fgets(line, sizeof(line), in)) {
+		// a GGA sentence with a new time starts the next epoch
+		if(strncmp(line + 3, "GGA,", 4) == 0 && strncmp(line + 7, time, 10) != 0) {
+			if(have_epoch) {
+				write_epoch(&data);
+			}
+
+			memcpy(time, line + 7, 10);
+			have_epoch = true;
+		}
+
+		nmea_parse(line, NULL, &data);
+	}
+
+	if(have_epoch) {
+		write_epoch(&data);
+	}
+
+	fclose(in);
+	fclose(m_out);
+	return 0;
+}
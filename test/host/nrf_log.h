@@ -0,0 +1,26 @@
+#ifndef NRF_LOG_FAKE_H
+#define NRF_LOG_FAKE_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/* Logging is disabled in the host tests. The arguments are still evaluated to
+ * avoid warnings about unused variables. */
+static inline void nrf_log_fake(const char *fmt, ...)
+{
+	(void)fmt;
+}
+
+#define NRF_LOG_ERROR(...)    nrf_log_fake(__VA_ARGS__)
+#define NRF_LOG_WARNING(...)  nrf_log_fake(__VA_ARGS__)
+#define NRF_LOG_INFO(...)     nrf_log_fake(__VA_ARGS__)
+#define NRF_LOG_DEBUG(...)    nrf_log_fake(__VA_ARGS__)
+
+#define NRF_LOG_HEXDUMP_INFO(p_data, len)   nrf_log_fake("", p_data, len)
+#define NRF_LOG_HEXDUMP_DEBUG(p_data, len)  nrf_log_fake("", p_data, len)
+
+#define NRF_LOG_PUSH(str)     (str)
+#define NRF_LOG_FLOAT_MARKER  "%f"
+#define NRF_LOG_FLOAT(val)    (val)
+
+#endif // NRF_LOG_FAKE_H
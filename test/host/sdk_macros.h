@@ -0,0 +1,28 @@
+#ifndef SDK_MACROS_FAKE_H
+#define SDK_MACROS_FAKE_H
+
+#include "sdk_fake.h"
+
+#define VERIFY_SUCCESS(statement) \
+	do { \
+		ret_code_t _err_code = (statement); \
+		if(_err_code != NRF_SUCCESS) { \
+			return _err_code; \
+		} \
+	} while(0)
+
+#define VERIFY_TRUE(statement, err_code) \
+	do { \
+		if(!(statement)) { \
+			return err_code; \
+		} \
+	} while(0)
+
+#define VERIFY_PARAM_NOT_NULL(param) \
+	do { \
+		if((param) == NULL) { \
+			return NRF_ERROR_INVALID_PARAM; \
+		} \
+	} while(0)
+
+#endif // SDK_MACROS_FAKE_H
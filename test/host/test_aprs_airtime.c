@@ -0,0 +1,240 @@
+/*
+ * Host-side test for the LoRa time on air model and the airtime-budgeted
+ * composition of APRS position reports.
+ *
+ * Prints a table with the frame length and time on air of each flag
+ * combination for several budgets.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "aprs.h"
+#include "lora_toa.h"
+
+static int m_failed;
+
+#define CHECK(cond) do { \
+	if(!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		m_failed++; \
+	} \
+} while(0)
+
+#define COMMENT "T-Echo LoRa APRS"
+
+// position flags that influence the frame length (weather only affects WX frames)
+#define NUM_FLAG_COMBINATIONS  (1 << 5)
+
+static const uint32_t m_budgets_ms[] = {0, 3500, 3000, 2700, 2400};
+
+#define NUM_BUDGETS (sizeof(m_budgets_ms) / sizeof(m_budgets_ms[0]))
+
+static uint64_t m_now;
+
+/* Simulated time base. Advancing it by more than an hour makes the comment due. */
+uint64_t time_base_get(void)
+{
+	return m_now;
+}
+
+static void setup(void)
+{
+	m_now += 3600001;
+
+	aprs_init();
+	aprs_set_source("DL9SAU-12");
+	aprs_set_dest("APLT00");
+	aprs_add_path("WIDE1-1");
+	aprs_set_icon_default(AI_BIKE);
+	aprs_set_comment(COMMENT);
+	aprs_update_pos_time(48.137154f, 11.576124f, 519.3f, 1700000000);
+}
+
+static size_t build(uint8_t *frame)
+{
+	aprs_args_t args = {
+		.frame_id = 42,
+		.vbat_millivolt = 3987,
+		.transmit_env_data = false,
+	};
+
+	return aprs_build_frame(frame, &args, PACKET_TYPE_POSITION);
+}
+
+/**@brief Build a frame in a state where the comment is due.
+ */
+static size_t build_with_comment(uint8_t *frame, uint32_t flags, uint32_t budget_ms)
+{
+	setup();
+	aprs_set_config_flags(flags);
+	aprs_set_airtime_budget(budget_ms);
+
+	return build(frame);
+}
+
+static void test_toa_model(void)
+{
+	lora_modulation_t sf7 = {
+		.sf = 7, .cr = 1, .bw_hz = 125000, .ldro = false,
+		.n_preamble = 8, .explicit_header = true, .crc = true};
+
+	// reference values from the Semtech LoRa calculator
+	CHECK(lora_toa_us(&sf7, 10) == 41216);
+	CHECK(lora_toa_us(&LORA_MODULATION_APRS, 0) == 663552);
+	CHECK(lora_toa_us(&LORA_MODULATION_APRS, 100) == 3940352);
+	CHECK(lora_toa_ms(&LORA_MODULATION_APRS, 100) == 3941);
+
+	// with LDRO at SF12, each block of 5 bytes needs 5 symbols of 32.768 ms
+	CHECK(lora_toa_us(&LORA_MODULATION_APRS, 105) - lora_toa_us(&LORA_MODULATION_APRS, 100) == 5 * 32768);
+
+	for(uint16_t len = 1; len < 256; len++) {
+		CHECK(lora_toa_us(&LORA_MODULATION_APRS, len) >= lora_toa_us(&LORA_MODULATION_APRS, len - 1));
+	}
+
+	// largest payload within a budget
+	CHECK(lora_toa_max_payload(&LORA_MODULATION_APRS, 600) == -1);
+	CHECK(lora_toa_max_payload(&LORA_MODULATION_APRS, 664) >= 0);
+	CHECK(lora_toa_max_payload(&LORA_MODULATION_APRS, 100000) == 255);
+
+	for(uint32_t budget = 700; budget < 10000; budget += 97) {
+		int16_t max = lora_toa_max_payload(&LORA_MODULATION_APRS, budget);
+
+		CHECK(max >= 0);
+		CHECK(lora_toa_ms(&LORA_MODULATION_APRS, max) <= budget);
+		CHECK(max == 255 || lora_toa_ms(&LORA_MODULATION_APRS, max + 1) > budget);
+	}
+}
+
+static void test_budget_table(void)
+{
+	static uint8_t frame[APRS_MAX_FRAME_LEN];
+
+	printf("flags ");
+	for(size_t b = 0; b < NUM_BUDGETS; b++) {
+		if(m_budgets_ms[b] == 0) {
+			printf("|   unlimited   ");
+		} else {
+			printf("| budget %4u ms", m_budgets_ms[b]);
+		}
+	}
+	printf("\n");
+
+	for(uint32_t flags = 0; flags < NUM_FLAG_COMBINATIONS; flags++) {
+		size_t bare_len, full_len;
+
+		// the bare position report is the lower bound
+		setup();
+		aprs_set_config_flags(flags & APRS_FLAG_COMPRESS_LOCATION);
+		build(frame); // consumes the comment
+		bare_len = build(frame);
+
+		printf(" 0x%02X ", flags);
+
+		for(size_t b = 0; b < NUM_BUDGETS; b++) {
+			size_t len = build_with_comment(frame, flags, m_budgets_ms[b]);
+			uint32_t toa_ms = lora_toa_ms(&LORA_MODULATION_APRS, len);
+
+			printf("| %3zu B %5u ms ", len, toa_ms);
+
+			CHECK(len >= bare_len);
+
+			if(m_budgets_ms[b] == 0) {
+				full_len = len;
+			} else {
+				CHECK(len <= full_len);
+
+				if(lora_toa_ms(&LORA_MODULATION_APRS, bare_len) <= m_budgets_ms[b]) {
+					CHECK(toa_ms <= m_budgets_ms[b]);
+				} else {
+					CHECK(len == bare_len);
+				}
+
+				// if everything fits, nothing is removed
+				if(lora_toa_ms(&LORA_MODULATION_APRS, full_len) <= m_budgets_ms[b]) {
+					CHECK(len == full_len);
+				}
+			}
+		}
+
+		printf("\n");
+	}
+}
+
+static void test_priorities(void)
+{
+	static uint8_t frame[APRS_MAX_FRAME_LEN];
+	uint32_t all = APRS_FLAG_ADD_DAO | APRS_FLAG_ADD_FRAME_COUNTER
+		| APRS_FLAG_ADD_ALTITUDE | APRS_FLAG_ADD_VBAT;
+	size_t len;
+
+	// 2400 ms allow 50 bytes: the position (48 bytes) only
+	len = build_with_comment(frame, all, 2400);
+	CHECK(len == 48);
+	CHECK(lora_toa_max_payload(&LORA_MODULATION_APRS, 2400) == 50);
+
+	// 2700 ms allow 60 bytes: position and DAO (highest default priority)
+	len = build_with_comment(frame, all, 2700);
+	CHECK(lora_toa_max_payload(&LORA_MODULATION_APRS, 2700) == 60);
+	CHECK(strstr((char*)frame, "!W") != NULL);
+	CHECK(strstr((char*)frame, "/A=") == NULL);
+	CHECK(strstr((char*)frame, COMMENT) == NULL);
+
+	// altitude does not fit anymore, but the lower priority Vbat does
+	CHECK(strstr((char*)frame, "3.98V !W") != NULL);
+	CHECK(strstr((char*)frame, "#42") == NULL);
+	CHECK(len <= 60);
+
+	// prefer the comment over everything else
+	setup();
+	aprs_set_config_flags(all);
+	aprs_set_airtime_budget(2800);
+	aprs_set_field_priority(APRS_FIELD_COMMENT, 10);
+	CHECK(aprs_get_field_priority(APRS_FIELD_COMMENT) == 10);
+	len = build(frame);
+	CHECK(strstr((char*)frame, COMMENT) != NULL);
+	CHECK(strstr((char*)frame, "!W") == NULL);
+
+	// the budget applies to the complete frame
+	CHECK(lora_toa_ms(&LORA_MODULATION_APRS, len) <= 2800);
+}
+
+static void test_comment_retry(void)
+{
+	static uint8_t frame[APRS_MAX_FRAME_LEN];
+	uint32_t flags = APRS_FLAG_ADD_FRAME_COUNTER;
+
+	// the comment does not fit: it is not counted as sent
+	build_with_comment(frame, flags, 2400);
+	CHECK(strstr((char*)frame, COMMENT) == NULL);
+
+	aprs_set_airtime_budget(0);
+	CHECK(aprs_get_airtime_budget() == 0);
+	build(frame);
+	CHECK(strstr((char*)frame, COMMENT) != NULL);
+
+	// sent once, then skipped for the next 9 frames
+	for(int i = 0; i < 9; i++) {
+		build(frame);
+		CHECK(strstr((char*)frame, COMMENT) == NULL);
+	}
+
+	build(frame);
+	CHECK(strstr((char*)frame, COMMENT) != NULL);
+}
+
+int main(void)
+{
+	test_toa_model();
+	test_budget_table();
+	test_priorities();
+	test_comment_retry();
+
+	if(m_failed) {
+		fprintf(stderr, "test_aprs_airtime: %d checks failed.\n", m_failed);
+		return 1;
+	}
+
+	printf("test_aprs_airtime: all checks passed.\n");
+	return 0;
+}
@@ -0,0 +1,232 @@
+/*
+ * Host-side test for the packed callsigns.
+ *
+ * All AX.25 callsign forms (1 to 6 letters and digits, without SSID or with
+ * SSID 0 to 15) must survive packing and unpacking, distinct callsigns must
+ * result in distinct values and the order must follow the strings.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "aprs.h"
+#include "aprs_call.h"
+
+static int m_failed;
+
+#define CHECK(cond) do { \
+	if(!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		m_failed++; \
+	} \
+} while(0)
+
+static const char m_call_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+
+uint64_t time_base_get(void)
+{
+	return 0;
+}
+
+static uint32_t m_rng_state = 0x12345678;
+
+static uint32_t rng(void)
+{
+	// xorshift32
+	m_rng_state ^= m_rng_state << 13;
+	m_rng_state ^= m_rng_state >> 17;
+	m_rng_state ^= m_rng_state << 5;
+	return m_rng_state;
+}
+
+static void check_round_trip(const char *call)
+{
+	char buf[APRS_CALL_MAX_LEN + 1];
+	aprs_call_t packed = aprs_call_pack(call);
+
+	if(packed == APRS_CALL_INVALID
+			|| aprs_call_unpack(packed, buf, sizeof(buf)) != strlen(call)
+			|| strcmp(buf, call) != 0
+			|| aprs_call_pack_n(call, strlen(call)) != packed) {
+		fprintf(stderr, "round trip failed for '%s'\n", call);
+		m_failed++;
+	}
+}
+
+/* Every base call length with every SSID form, random characters. */
+static void test_all_forms(void)
+{
+	char call[16];
+
+	for(int len = 1; len <= 6; len++) {
+		for(int ssid = -1; ssid <= 15; ssid++) {
+			for(int n = 0; n < 1000; n++) {
+				for(int i = 0; i < len; i++) {
+					call[i] = m_call_chars[rng() % (sizeof(m_call_chars) - 1)];
+				}
+
+				call[len] = '\0';
+
+				if(ssid >= 0) {
+					snprintf(call + len, sizeof(call) - len, "-%d", ssid);
+				}
+
+				check_round_trip(call);
+			}
+		}
+	}
+
+	// the extremes
+	check_round_trip("A");
+	check_round_trip("0");
+	check_round_trip("ZZZZZZ-15");
+	check_round_trip("999999-15");
+	check_round_trip("DL9SAU-12");
+	check_round_trip("WIDE1-1");
+	check_round_trip("APLT00");
+
+	// non-AX.25 names up to 12 characters
+	check_round_trip("OE3XYZ-IG");
+	check_round_trip("DB0ABC-10/P");
+	check_round_trip("ABCDEFGHIJKL");
+	check_round_trip("9.9.9.9-----");
+}
+
+/* Order of the packing alphabet: end of string, letters, digits, '-'. */
+static int call_strcmp(const char *a, const char *b)
+{
+	static const char order[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-";
+
+	for(;; a++, b++) {
+		int rank_a = *a ? (int)(strchr(order, *a) - order) + 1 : 0;
+		int rank_b = *b ? (int)(strchr(order, *b) - order) + 1 : 0;
+
+		if(rank_a != rank_b || rank_a == 0) {
+			return rank_a - rank_b;
+		}
+	}
+}
+
+#define NUM_SHORT_CALLS  ((36 + 36 * 36) * 17)
+
+static aprs_call_t m_packed[NUM_SHORT_CALLS];
+static char        m_calls[NUM_SHORT_CALLS][8];
+
+static int compare_packed(const void *a, const void *b)
+{
+	aprs_call_t pa = m_packed[*(const size_t*)a];
+	aprs_call_t pb = m_packed[*(const size_t*)b];
+
+	return (pa > pb) - (pa < pb);
+}
+
+/* Distinct values for all calls with up to 2 characters and every SSID, and the
+ * numeric order is the string order. */
+static void test_unique_and_sorted(void)
+{
+	static size_t order[NUM_SHORT_CALLS];
+	size_t n = 0;
+
+	for(int len = 1; len <= 2; len++) {
+		for(int a = 0; a < 36; a++) {
+			for(int b = 0; b < (len == 2 ? 36 : 1); b++) {
+				for(int ssid = -1; ssid <= 15; ssid++) {
+					char *call = m_calls[n];
+
+					call[0] = m_call_chars[a];
+					call[1] = m_call_chars[b];
+					call[len] = '\0';
+
+					if(ssid >= 0) {
+						snprintf(call + len, 6, "-%d", ssid);
+					}
+
+					m_packed[n] = aprs_call_pack(call);
+					order[n] = n;
+					n++;
+				}
+			}
+		}
+	}
+
+	CHECK(n == NUM_SHORT_CALLS);
+
+	qsort(order, n, sizeof(order[0]), compare_packed);
+
+	for(size_t i = 1; i < n; i++) {
+		const char *prev = m_calls[order[i - 1]];
+		const char *call = m_calls[order[i]];
+
+		if(m_packed[order[i - 1]] == m_packed[order[i]] || call_strcmp(prev, call) >= 0) {
+			fprintf(stderr, "'%s' sorted before '%s'\n", prev, call);
+			m_failed++;
+			return;
+		}
+	}
+}
+
+static void test_invalid(void)
+{
+	char buf[APRS_CALL_MAX_LEN + 1];
+
+	CHECK(aprs_call_pack("") == APRS_CALL_INVALID);
+	CHECK(aprs_call_pack("ABCDEFGHIJKLM") == APRS_CALL_INVALID); // 13 characters
+	CHECK(aprs_call_pack("dl9sau") == APRS_CALL_INVALID);
+	CHECK(aprs_call_pack("DL9SAU 12") == APRS_CALL_INVALID);
+	CHECK(aprs_call_pack("DB0ABC*") == APRS_CALL_INVALID);
+	CHECK(aprs_call_pack_n("DL9SAU-12", 0) == APRS_CALL_INVALID);
+
+	// only the given length is used
+	CHECK(aprs_call_pack_n("DL9SAU>APRS", 6) == aprs_call_pack("DL9SAU"));
+
+	CHECK(aprs_call_unpack(APRS_CALL_INVALID, buf, sizeof(buf)) == 0);
+	CHECK(buf[0] == '\0');
+
+	// buffer too small
+	CHECK(aprs_call_unpack(aprs_call_pack("DL9SAU-12"), buf, 9) == 0);
+	CHECK(buf[0] == '\0');
+	CHECK(aprs_call_unpack(aprs_call_pack("DL9SAU-12"), buf, 10) == 9);
+}
+
+/* The parser provides the packed source, which is used to detect own frames. */
+static void test_parser(void)
+{
+	uint8_t frame[APRS_MAX_FRAME_LEN];
+	aprs_frame_t result;
+
+	aprs_init();
+	aprs_set_source("DL9SAU-12");
+
+	strcpy((char*)frame, "<\xFF\x01" "DL9SAU-12>APLT00,DB0ABC*:!4903.50N/00824.11E>");
+	CHECK(aprs_parse_frame(frame, strlen((char*)frame), &result));
+	CHECK(result.source_call == aprs_call_pack("DL9SAU-12"));
+	CHECK(aprs_is_own_source(&result));
+
+	strcpy((char*)frame, "<\xFF\x01" "DL9SAU-1>APLT00,DB0ABC*:!4903.50N/00824.11E>");
+	CHECK(aprs_parse_frame(frame, strlen((char*)frame), &result));
+	CHECK(!aprs_is_own_source(&result));
+
+	// names that cannot be packed are compared as strings
+	aprs_set_source("dl9sau");
+	strcpy((char*)frame, "<\xFF\x01" "dl9sau>APLT00:!4903.50N/00824.11E>");
+	CHECK(aprs_parse_frame(frame, strlen((char*)frame), &result));
+	CHECK(result.source_call == APRS_CALL_INVALID);
+	CHECK(aprs_is_own_source(&result));
+}
+
+int main(void)
+{
+	test_all_forms();
+	test_unique_and_sorted();
+	test_invalid();
+	test_parser();
+
+	if(m_failed) {
+		fprintf(stderr, "test_aprs_call: %d checks failed.\n", m_failed);
+		return 1;
+	}
+
+	printf("test_aprs_call: all checks passed.\n");
+	return 0;
+}
@@ -0,0 +1,223 @@
+/*
+ * Host-side test for the cs bytes of the compressed position format:
+ * altitude, course/speed and radio range, encoding and decoding.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "aprs.h"
+#include "lora_toa.h"
+
+static int m_failed;
+
+#define CHECK(cond) do { \
+	if(!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		m_failed++; \
+	} \
+} while(0)
+
+#define KNOTS  0.514444f
+#define FEET   0.3048f
+
+uint64_t time_base_get(void)
+{
+	return 0;
+}
+
+static void setup(uint32_t flags)
+{
+	aprs_init();
+	aprs_set_source("DL9SAU-12");
+	aprs_set_dest("APLT00");
+	aprs_set_icon('/', '>');
+	aprs_set_comment("");
+	aprs_set_config_flags(flags);
+	aprs_update_pos_time(49.5f, -72.75f, 10004 * FEET, 0);
+}
+
+static size_t build(uint8_t *frame)
+{
+	aprs_args_t args = {
+		.frame_id = 42,
+		.vbat_millivolt = 3987,
+	};
+
+	return aprs_build_frame(frame, &args, PACKET_TYPE_POSITION);
+}
+
+static bool parse(const char *text, aprs_frame_t *result)
+{
+	uint8_t frame[APRS_MAX_FRAME_LEN];
+
+	frame[0] = '<';
+	frame[1] = 0xFF;
+	frame[2] = 0x01;
+	strcpy((char*)frame + 3, text);
+
+	memset(result, 0, sizeof(*result));
+	return aprs_parse_frame(frame, strlen(text) + 3, result);
+}
+
+/* Examples from the APRS specification, chapter 9. */
+static void test_decode_spec_vectors(void)
+{
+	aprs_frame_t result;
+
+	// course 88°, speed 36.2 knots
+	CHECK(parse("N0CALL>APRS:!/5L!!<*e7>7P[", &result));
+	CHECK(fabsf(result.lat - 49.5f) < 1e-4f);
+	CHECK(fabsf(result.lon + 72.75f) < 1e-4f);
+	CHECK(result.course == 88);
+	CHECK(fabsf(result.speed - 36.2f * KNOTS) < 0.05f * KNOTS);
+	CHECK(result.alt == 0.0f);
+	CHECK(result.range == 0.0f);
+
+	// radio range 20 miles
+	CHECK(parse("N0CALL>APRS:!/5L!!<*e7>{?!", &result));
+	CHECK(fabsf(result.range - 20.12f * 1.609344f) < 0.01f);
+	CHECK(result.speed == 0.0f);
+	CHECK(result.course == 0);
+
+	// altitude 10004 ft
+	CHECK(parse("N0CALL>APRS:!/5L!!<*e7OS]S", &result));
+	CHECK(fabsf(result.alt - 10004 * FEET) < 1.0f);
+	CHECK(result.course == 0);
+
+	// no cs data
+	CHECK(parse("N0CALL>APRS:!/5L!!<*e7>  !", &result));
+	CHECK(result.alt == 0.0f);
+	CHECK(result.course == 0);
+	CHECK(result.speed == 0.0f);
+
+	// course/speed and an additional altitude field
+	CHECK(parse("N0CALL>APRS:!/5L!!<*e7>7P[/A=001234", &result));
+	CHECK(result.course == 88);
+	CHECK(fabsf(result.alt - 1234 * FEET) < 1e-3f);
+}
+
+static void test_encode(void)
+{
+	uint8_t frame[APRS_MAX_FRAME_LEN];
+
+	// default: altitude in the cs bytes (the encoder truncates to 10003 ft)
+	setup(APRS_FLAG_COMPRESS_LOCATION | APRS_FLAG_ADD_ALTITUDE);
+	aprs_update_speed_course(36.2f * KNOTS, 88.0f, true);
+	build(frame);
+	CHECK(strcmp((char*)frame + 3, "DL9SAU-12>APLT00:!/5L!!<*e7>S\\Q") == 0);
+
+	// course/speed, altitude as a separate field
+	setup(APRS_FLAG_COMPRESS_LOCATION | APRS_FLAG_COMPRESSED_COURSE_SPEED | APRS_FLAG_ADD_ALTITUDE);
+	aprs_update_speed_course(36.2f * KNOTS, 88.0f, true);
+	build(frame);
+	CHECK(strcmp((char*)frame + 3, "DL9SAU-12>APLT00:!/5L!!<*e7>7PY/A=010004") == 0);
+
+	// without altitude
+	setup(APRS_FLAG_COMPRESS_LOCATION | APRS_FLAG_COMPRESSED_COURSE_SPEED);
+	aprs_update_speed_course(36.2f * KNOTS, 88.0f, true);
+	build(frame);
+	CHECK(strcmp((char*)frame + 3, "DL9SAU-12>APLT00:!/5L!!<*e7>7PY") == 0);
+
+	// unknown course and speed
+	setup(APRS_FLAG_COMPRESS_LOCATION | APRS_FLAG_COMPRESSED_COURSE_SPEED);
+	aprs_update_speed_course(0.0f, 0.0f, false);
+	build(frame);
+	CHECK(strcmp((char*)frame + 3, "DL9SAU-12>APLT00:!/5L!!<*e7>  Y") == 0);
+
+	// Mic-E takes precedence, the flag has no effect there
+	setup(APRS_FLAG_MIC_E | APRS_FLAG_COMPRESSED_COURSE_SPEED);
+	aprs_update_speed_course(36.2f * KNOTS, 88.0f, true);
+	build(frame);
+	CHECK(strchr((char*)frame, ':')[1] == '`');
+}
+
+static void test_round_trip(void)
+{
+	static const float speeds_kt[] = {0, 0.5f, 1, 5, 20, 36.2f, 100, 500, 1000};
+	static const float courses[] = {0, 1, 45, 88, 179, 270, 357, 359, 360};
+
+	uint8_t frame[APRS_MAX_FRAME_LEN];
+	aprs_frame_t result;
+
+	for(size_t i = 0; i < sizeof(speeds_kt) / sizeof(speeds_kt[0]); i++) {
+		for(size_t j = 0; j < sizeof(courses) / sizeof(courses[0]); j++) {
+			setup(APRS_FLAG_COMPRESS_LOCATION | APRS_FLAG_COMPRESSED_COURSE_SPEED | APRS_FLAG_ADD_ALTITUDE);
+			aprs_update_speed_course(speeds_kt[i] * KNOTS, courses[j], true);
+
+			size_t len = build(frame);
+			CHECK(aprs_parse_frame(frame, len, &result));
+
+			// course resolution is 4°
+			int course_diff = ((int)result.course - (int)courses[j] + 360 + 180) % 360 - 180;
+			CHECK(result.course >= 4 && result.course <= 360);
+			CHECK(course_diff >= -2 && course_diff <= 2);
+
+			// speed resolution is 8 % (the highest encodable speed is about 930 knots)
+			float speed_kt = result.speed / KNOTS;
+			float expected_kt = (speeds_kt[i] > 930.0f) ? 930.0f : speeds_kt[i];
+			CHECK(fabsf(speed_kt - expected_kt) <= 0.04f * expected_kt + 0.04f);
+
+			CHECK(fabsf(result.alt - 10004 * FEET) < 0.5f);
+			CHECK(fabsf(result.lat - 49.5f) < 1e-4f);
+			CHECK(fabsf(result.lon + 72.75f) < 1e-4f);
+		}
+	}
+}
+
+/* Under the airtime budget, the /A= field is an optional field like the others. */
+static void test_airtime(void)
+{
+	uint8_t frame[APRS_MAX_FRAME_LEN];
+	uint32_t flags = APRS_FLAG_COMPRESS_LOCATION | APRS_FLAG_COMPRESSED_COURSE_SPEED
+		| APRS_FLAG_ADD_ALTITUDE | APRS_FLAG_ADD_FRAME_COUNTER;
+	size_t len_full, len;
+
+	setup(flags);
+	aprs_update_speed_course(5.0f, 123.0f, true);
+	len_full = build(frame);
+	CHECK(strstr((char*)frame, "/A=") != NULL);
+
+	setup(flags);
+	aprs_set_airtime_budget(lora_toa_ms(&LORA_MODULATION_APRS, len_full) - 1);
+	aprs_update_speed_course(5.0f, 123.0f, true);
+	len = build(frame);
+
+	CHECK(len < len_full);
+	CHECK(strstr((char*)frame, "/A=") != NULL); // altitude has priority over the frame counter
+	CHECK(strstr((char*)frame, "#42") == NULL);
+
+	setup(flags);
+	aprs_set_airtime_budget(lora_toa_ms(&LORA_MODULATION_APRS, len_full) - 1);
+	aprs_set_field_priority(APRS_FIELD_ALTITUDE, 0);
+	aprs_update_speed_course(5.0f, 123.0f, true);
+	build(frame);
+
+	CHECK(strstr((char*)frame, "/A=") == NULL);
+	CHECK(strstr((char*)frame, "#42") != NULL);
+
+	setup(APRS_FLAG_COMPRESS_LOCATION | APRS_FLAG_ADD_ALTITUDE);
+	len = build(frame);
+	printf("altitude in cs:          %3zu B %5u ms\n", len, lora_toa_ms(&LORA_MODULATION_APRS, len));
+
+	setup(APRS_FLAG_COMPRESS_LOCATION | APRS_FLAG_COMPRESSED_COURSE_SPEED | APRS_FLAG_ADD_ALTITUDE);
+	len = build(frame);
+	printf("course/speed in cs + /A= %3zu B %5u ms\n", len, lora_toa_ms(&LORA_MODULATION_APRS, len));
+}
+
+int main(void)
+{
+	test_decode_spec_vectors();
+	test_encode();
+	test_round_trip();
+	test_airtime();
+
+	if(m_failed) {
+		fprintf(stderr, "test_aprs_compressed: %d checks failed.\n", m_failed);
+		return 1;
+	}
+
+	printf("test_aprs_compressed: all checks passed.\n");
+	return 0;
+}
@@ -0,0 +1,203 @@
+/*
+ * Host-side test for the duplicate frame cache.
+ *
+ * Synthetic streams of frames as they arrive in a digipeater-rich area: every
+ * beacon is received directly and via one or more digipeaters, which only
+ * changes the path. Only the first copy may be decoded.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "aprs.h"
+#include "aprs_dedup.h"
+
+static int m_failed;
+
+#define CHECK(cond) do { \
+	if(!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		m_failed++; \
+	} \
+} while(0)
+
+uint64_t time_base_get(void)
+{
+	return 0;
+}
+
+static size_t make_frame(uint8_t *frame, const char *text)
+{
+	frame[0] = '<';
+	frame[1] = 0xFF;
+	frame[2] = 0x01;
+	strcpy((char*)frame + 3, text);
+
+	return strlen(text) + 3;
+}
+
+static bool check(const char *text, uint64_t now)
+{
+	uint8_t frame[APRS_MAX_FRAME_LEN];
+	size_t len = make_frame(frame, text);
+
+	return aprs_dedup_check(frame, len, now, NULL, 0);
+}
+
+static void test_paths(void)
+{
+	char source[16];
+	uint8_t frame[APRS_MAX_FRAME_LEN];
+	size_t len;
+
+	aprs_dedup_init();
+
+	CHECK(!check("DL9SAU-12>APLT00,WIDE1-1:!4903.50N/00824.11E>comment", 1000));
+	CHECK(check("DL9SAU-12>APLT00,DB0ABC*,WIDE1*:!4903.50N/00824.11E>comment", 3000));
+	CHECK(check("DL9SAU-12>APLT00,DB0XYZ*:!4903.50N/00824.11E>comment", 4000));
+	CHECK(check("DL9SAU-12>APLT00:!4903.50N/00824.11E>comment", 5000));
+
+	// different information field, source or destination
+	CHECK(!check("DL9SAU-12>APLT00,WIDE1-1:!4903.51N/00824.11E>comment", 6000));
+	CHECK(!check("DL9SAU-11>APLT00,WIDE1-1:!4903.50N/00824.11E>comment", 6000));
+	CHECK(!check("DL9SAU-12>APLT01,WIDE1-1:!4903.50N/00824.11E>comment", 6000));
+
+	// Mic-E: the latitude is in the destination
+	CHECK(!check("DL9SAU-12>T4SP0W,WIDE1-1:`(_fn\"Oj/", 7000));
+	CHECK(!check("DL9SAU-12>T4SP1W,WIDE1-1:`(_fn\"Oj/", 7000));
+	CHECK(check("DL9SAU-12>T4SP1W,DB0ABC*:`(_fn\"Oj/", 8000));
+
+	// the source call is returned
+	len = make_frame(frame, "DB0ABC>APRS,WIDE2-2:>status");
+	CHECK(!aprs_dedup_check(frame, len, 9000, source, sizeof(source)));
+	CHECK(strcmp(source, "DB0ABC") == 0);
+	CHECK(aprs_dedup_check(frame, len, 9500, source, 4));
+	CHECK(strcmp(source, "DB0") == 0);
+
+	// frames without a header are compared as a whole
+	CHECK(!check("garbage", 10000));
+	CHECK(check("garbage", 10000));
+	CHECK(!check("garbagf", 10000));
+
+	CHECK(aprs_dedup_get_stats()->hits == 6);
+	CHECK(aprs_dedup_get_stats()->misses == 9);
+}
+
+static void test_window(void)
+{
+	const char *beacon = "DB0ABC>APRS:!4903.50N/00824.11E#fixed station";
+
+	aprs_dedup_init();
+
+	CHECK(!check(beacon, 100000));
+	CHECK(check(beacon, 100000 + APRS_DEDUP_WINDOW_MS - 1));
+
+	// duplicates do not extend the window: the next beacon is reported
+	CHECK(!check(beacon, 100000 + APRS_DEDUP_WINDOW_MS));
+	CHECK(check(beacon, 100000 + APRS_DEDUP_WINDOW_MS + 1000));
+}
+
+/* Many stations, each heard directly and via two digipeaters. */
+static void test_stream(void)
+{
+	char text[128];
+	uint64_t now = 0;
+	uint32_t decoded = 0;
+
+	aprs_dedup_init();
+
+	for(int round = 0; round < 10; round++) {
+		for(int station = 0; station < 40; station++) {
+			static const char *paths[] = {"WIDE1-1", "DB0ABC*,WIDE1*", "DB0XYZ*,DB0ABC*,WIDE2*"};
+
+			// a new position in every round
+			for(int copy = 0; copy < 3; copy++) {
+				snprintf(text, sizeof(text), "DL%dAB-7>APLT00,%s:!49%02d.50N/00824.11E>",
+						station, paths[copy], round);
+
+				if(!check(text, now + copy * 2000)) {
+					decoded++;
+				}
+			}
+
+			now += 500;
+		}
+
+		now += 60000;
+	}
+
+	CHECK(decoded == 400);
+	CHECK(aprs_dedup_get_stats()->hits == 800);
+	CHECK(aprs_dedup_get_stats()->misses == 400);
+
+	// more stations within the window than the cache can hold: the oldest
+	// entries are replaced, copies arriving shortly after are still detected
+	aprs_dedup_init();
+
+	for(int station = 0; station < 4 * APRS_DEDUP_SIZE; station++) {
+		snprintf(text, sizeof(text), "DL%dAB-7>APLT00,WIDE1-1:!4900.50N/00824.11E>", station);
+		CHECK(!check(text, station * 10));
+
+		snprintf(text, sizeof(text), "DL%dAB-7>APLT00,DB0ABC*:!4900.50N/00824.11E>", station);
+		CHECK(check(text, station * 10 + 5));
+	}
+
+	// evicted
+	CHECK(!check("DL0AB-7>APLT00,DB0XYZ*:!4900.50N/00824.11E>", 4 * APRS_DEDUP_SIZE * 10));
+}
+
+/* Duplicates only update the signal data of the history entry (as in cb_lora()). */
+static void test_history_update(void)
+{
+	uint8_t frame[APRS_MAX_FRAME_LEN];
+	size_t len;
+	char source[16];
+	aprs_frame_t decoded;
+	aprs_rx_raw_data_t raw = {0};
+	const aprs_rx_history_entry_t *entry = aprs_rx_history_get(0);
+	const uint8_t *data;
+
+	aprs_init();
+	aprs_dedup_init();
+
+	raw.data_len = make_frame(raw.data, "DL9SAU-12>APLT00,WIDE1-1:!4903.50N/00824.11E>comment");
+	CHECK(aprs_parse_frame(raw.data, raw.data_len, &decoded));
+	raw.rssi = -110.0f;
+	raw.snr = -5.0f;
+
+	CHECK(!aprs_dedup_check(raw.data, raw.data_len, 1000, source, sizeof(source)));
+
+	uint16_t idx = aprs_rx_history_insert(&decoded, &raw, 1000, APRS_RX_HISTORY_SIZE);
+	CHECK(idx == 0);
+
+	len = make_frame(frame, "DL9SAU-12>APLT00,DB0ABC*,WIDE1*:!4903.50N/00824.11E>comment");
+	raw.rssi = -90.0f;
+	raw.snr = 7.5f;
+
+	CHECK(aprs_dedup_check(frame, len, 3000, source, sizeof(source)));
+	CHECK(aprs_rx_history_update_signal(source, &raw, 1003) == 0);
+	CHECK(entry->rssi == -90.0f);
+	CHECK(entry->snr == 7.5f);
+	CHECK(entry->rx_timestamp == 1003);
+	data = aprs_rx_history_get_data(entry, &len);
+	CHECK(len == raw.data_len && memcmp(data, raw.data, len) == 0);
+	CHECK(aprs_rx_history_get_stats()->num_entries == 1);
+
+	CHECK(aprs_rx_history_update_signal("DL9SAU-1", &raw, 1004) == APRS_RX_HISTORY_SIZE);
+}
+
+int main(void)
+{
+	test_paths();
+	test_window();
+	test_stream();
+	test_history_update();
+
+	if(m_failed) {
+		fprintf(stderr, "test_aprs_dedup: %d checks failed.\n", m_failed);
+		return 1;
+	}
+
+	printf("test_aprs_dedup: all checks passed.\n");
+	return 0;
+}
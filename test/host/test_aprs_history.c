@@ -0,0 +1,687 @@
+/*
+ * Host-side test for the RX history index and arena.
+ *
+ * A long random sequence of inserts and signal updates is checked against a
+ * simple model of the history: linear search by call, replacement of the
+ * least recently updated entry, except the protected one. The frames have
+ * random lengths, so stations are also replaced to make room in the arena. The
+ * model replays these replacements (the number is taken from the statistics).
+ *
+ * With realistic frames, the arena limits the number of stations. The stored
+ * frames and decoded fields must be returned unchanged, and only the least
+ * recently updated stations may be missing.
+ *
+ * The sorted orders must contain every station exactly once, sorted by time,
+ * distance or RSSI, while stations are inserted, updated and replaced and the
+ * reference position moves.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "aprs.h"
+#include "utils.h"
+
+static int m_failed;
+
+#define CHECK(cond) do { \
+	if(!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		m_failed++; \
+	} \
+} while(0)
+
+typedef struct {
+	char     call[16];
+	uint64_t timestamp;
+	uint32_t order;     // of the last update, 0 if the entry is free
+} model_entry_t;
+
+static model_entry_t m_model[APRS_RX_HISTORY_SIZE];
+static size_t        m_model_size;
+static uint32_t      m_model_order;
+static uint16_t      m_model_free[APRS_RX_HISTORY_SIZE]; // stack of free entries
+static size_t        m_model_num_free;
+
+uint64_t time_base_get(void)
+{
+	return 0;
+}
+
+static uint32_t m_rng_state = 0x12345678;
+
+static uint32_t rng(void)
+{
+	// xorshift32
+	m_rng_state ^= m_rng_state << 13;
+	m_rng_state ^= m_rng_state >> 17;
+	m_rng_state ^= m_rng_state << 5;
+	return m_rng_state;
+}
+
+static uint16_t model_oldest(uint16_t exclude1, uint16_t exclude2)
+{
+	uint32_t oldest = UINT32_MAX;
+	uint16_t idx = APRS_RX_HISTORY_SIZE;
+
+	for(size_t i = 0; i < m_model_size; i++) {
+		if(i != exclude1 && i != exclude2 && m_model[i].order != 0 && m_model[i].order < oldest) {
+			oldest = m_model[i].order;
+			idx = i;
+		}
+	}
+
+	return idx;
+}
+
+static uint16_t model_insert(const char *call, bool has_position, uint64_t timestamp, uint16_t protected_index)
+{
+	size_t idx;
+
+	for(idx = 0; idx < m_model_size; idx++) {
+		if(strcmp(m_model[idx].call, call) == 0) {
+			break;
+		}
+	}
+
+	if(idx == m_model_size) {
+		if(!has_position) {
+			return m_model_size;
+		}
+
+		if(m_model_num_free > 0) {
+			idx = m_model_free[--m_model_num_free];
+		} else if(m_model_size < APRS_RX_HISTORY_SIZE) {
+			m_model_size++;
+		} else {
+			idx = model_oldest(protected_index, APRS_RX_HISTORY_SIZE);
+		}
+	}
+
+	strcpy(m_model[idx].call, call);
+	m_model[idx].timestamp = timestamp;
+	m_model[idx].order = ++m_model_order;
+	return idx;
+}
+
+/* Replay the replacements for arena space: the least recently updated stations
+ * are removed, except the protected and the updated one. */
+static void model_arena_events(uint32_t evictions, uint16_t protected_index, uint16_t updated)
+{
+	while(evictions-- > 0) {
+		uint16_t idx = model_oldest(protected_index, updated);
+
+		CHECK(idx < APRS_RX_HISTORY_SIZE);
+
+		if(m_failed) {
+			return;
+		}
+
+		memset(&m_model[idx], 0, sizeof(m_model[idx]));
+		m_model_free[m_model_num_free++] = idx;
+	}
+}
+
+static void check_history(void)
+{
+	char source[16];
+
+	CHECK(aprs_rx_history_get_stats()->num_entries == m_model_size);
+
+	for(size_t i = 0; i < m_model_size; i++) {
+		const aprs_rx_history_entry_t *entry = aprs_rx_history_get(i);
+
+		aprs_rx_history_get_string(entry, APRS_RX_HISTORY_SOURCE, source, sizeof(source));
+
+		if(strcmp(source, m_model[i].call) != 0 || entry->rx_timestamp != m_model[i].timestamp) {
+			fprintf(stderr, "entry %zu: %s/%llu, expected %s/%llu\n", i, source,
+					(unsigned long long)entry->rx_timestamp,
+					m_model[i].call, (unsigned long long)m_model[i].timestamp);
+			m_failed++;
+			return;
+		}
+	}
+}
+
+static void test_random(uint32_t num_stations)
+{
+	aprs_frame_t frame;
+	aprs_rx_raw_data_t raw = {0};
+	uint16_t protected_index = APRS_RX_HISTORY_SIZE;
+	const aprs_rx_history_stats_t *stats = aprs_rx_history_get_stats();
+
+	aprs_init();
+	memset(m_model, 0, sizeof(m_model));
+	m_model_size = 0;
+	m_model_order = 0;
+	m_model_num_free = 0;
+
+	for(uint64_t t = 1; t <= 20000; t++) {
+		uint32_t station = rng() % num_stations;
+		bool has_position = (rng() % 8) != 0;
+		uint32_t evictions = stats->arena_evictions;
+		uint16_t op_protected_index = protected_index;
+
+		raw.data_len = rng() % 200;
+		memset(raw.data, '#', raw.data_len);
+
+		memset(&frame, 0, sizeof(frame));
+		// some names cannot be packed and are indexed by their string
+		snprintf(frame.source, sizeof(frame.source), (station % 5) ? "DL%uXY-%u" : "dl%uxy-%u",
+				(station / 16) % 100, station % 16);
+		frame.lat = has_position ? 49.0f : 0.0f;
+		frame.lon = has_position ? 8.0f : 0.0f;
+
+		uint16_t expected;
+
+		if(rng() % 4 == 0) {
+			// duplicate: signal update only
+			expected = APRS_RX_HISTORY_SIZE;
+
+			for(size_t i = 0; i < m_model_size; i++) {
+				if(strcmp(m_model[i].call, frame.source) == 0) {
+					m_model[i].timestamp = t;
+					m_model[i].order = ++m_model_order;
+					expected = i;
+				}
+			}
+
+			CHECK(aprs_rx_history_update_signal(frame.source, &raw, t) == expected);
+		} else {
+			expected = model_insert(frame.source, has_position, t, protected_index);
+			uint16_t idx = aprs_rx_history_insert(&frame, &raw, t, protected_index);
+
+			CHECK(idx == expected);
+
+			// sometimes the display shows the new entry, long enough
+			// for it to become the oldest one
+			if(rng() % 256 == 0) {
+				protected_index = (rng() % 2) ? idx : APRS_RX_HISTORY_SIZE;
+			}
+		}
+
+		model_arena_events(stats->arena_evictions - evictions, op_protected_index, expected);
+
+		if(t % 97 == 0) {
+			check_history();
+		}
+
+		if(m_failed) {
+			return;
+		}
+	}
+
+	check_history();
+}
+
+/* The protected entry is never replaced, even if it is the oldest one, and its
+ * frame stays available. */
+static void test_protected(void)
+{
+	aprs_frame_t frame;
+	aprs_rx_raw_data_t raw = {0};
+	char source[16];
+
+	aprs_init();
+	memset(&frame, 0, sizeof(frame));
+	frame.lat = 49.0f;
+	frame.lon = 8.0f;
+
+	for(int i = 0; i < APRS_RX_HISTORY_SIZE; i++) {
+		snprintf(frame.source, sizeof(frame.source), "DB%d", i);
+		CHECK(aprs_rx_history_insert(&frame, &raw, 100 + i, APRS_RX_HISTORY_SIZE) == i);
+	}
+
+	for(int i = 0; i < 3 * APRS_RX_HISTORY_SIZE; i++) {
+		snprintf(frame.source, sizeof(frame.source), "DC%d", i);
+		CHECK(aprs_rx_history_insert(&frame, &raw, 1000 + i, 0) != 0);
+	}
+
+	aprs_rx_history_get_string(aprs_rx_history_get(0), APRS_RX_HISTORY_SOURCE, source, sizeof(source));
+	CHECK(strcmp(source, "DB0") == 0);
+
+	// long frames: the arena is the limit and is compacted
+	raw.data_len = 200;
+	memset(raw.data, '#', raw.data_len);
+
+	for(int i = 0; i < 3 * APRS_RX_HISTORY_SIZE; i++) {
+		snprintf(frame.source, sizeof(frame.source), "DD%d", i);
+		CHECK(aprs_rx_history_insert(&frame, &raw, 3000 + i, 0) != 0);
+	}
+
+	CHECK(aprs_rx_history_get_stats()->arena_evictions > 0);
+	CHECK(aprs_rx_history_get_stats()->arena_compactions > 0);
+	aprs_rx_history_get_string(aprs_rx_history_get(0), APRS_RX_HISTORY_SOURCE, source, sizeof(source));
+	CHECK(strcmp(source, "DB0") == 0);
+	CHECK(aprs_rx_history_get(0)->rx_timestamp == 100);
+
+	// the protection does not prevent updates of the protected call
+	strcpy(frame.source, "DB0");
+	CHECK(aprs_rx_history_insert(&frame, &raw, 5000, 0) == 0);
+	CHECK(aprs_rx_history_get(0)->rx_timestamp == 5000);
+}
+
+/* Positions in all quadrants are stored and get a distance, only 0.0N 0.0E
+ * means "no position". */
+static void test_position_signs(void)
+{
+	static const float positions[][2] = {
+		{ 49.0f,   8.0f},
+		{ 49.0f,  -8.0f},
+		{-33.9f,  18.4f},
+		{-33.9f, -70.6f},
+		{  0.0f,  32.5f},
+		{ 51.5f,   0.0f},
+	};
+	aprs_frame_t frame;
+	aprs_rx_raw_data_t raw = {0};
+
+	aprs_init();
+	aprs_rx_history_set_reference(49.0f, 8.0f);
+	memset(&frame, 0, sizeof(frame));
+
+	for(int i = 0; i < 6; i++) {
+		snprintf(frame.source, sizeof(frame.source), "DB%d", i);
+		frame.lat = positions[i][0];
+		frame.lon = positions[i][1];
+
+		uint16_t idx = aprs_rx_history_insert(&frame, &raw, 100 + i, APRS_RX_HISTORY_SIZE);
+
+		CHECK(idx == i);
+		CHECK(aprs_rx_history_get(idx)->distance >= 0.0f);
+	}
+
+	// a new station without position is discarded
+	strcpy(frame.source, "DB6");
+	frame.lat = 0.0f;
+	frame.lon = 0.0f;
+	CHECK(aprs_rx_history_insert(&frame, &raw, 200, APRS_RX_HISTORY_SIZE) == 6);
+	CHECK(aprs_rx_history_get_stats()->num_entries == 6);
+}
+
+/* A frame without position from an unknown station is discarded, whatever the
+ * decoded frame contained before it was parsed. */
+static void test_no_position_frames(void)
+{
+	static const char *frames[] = {
+		"DB1>APLT00,WIDE1-1:>status text",
+		"DB2>APLT00::DB0      :message{1",
+		"DB3>APLT00:T#001,100,200,300,400,500,00000000",
+	};
+	aprs_frame_t decoded;
+	aprs_rx_raw_data_t raw = {0};
+
+	aprs_init();
+
+	for(int i = 0; i < 3; i++) {
+		raw.data[0] = '<';
+		raw.data[1] = 0xFF;
+		raw.data[2] = 0x01;
+		raw.data_len = 3 + strlen(frames[i]);
+		memcpy(raw.data + 3, frames[i], raw.data_len - 3);
+
+		// garbage from the stack
+		memset(&decoded, 0xA5, sizeof(decoded));
+		CHECK(aprs_parse_frame(raw.data, raw.data_len, &decoded));
+		CHECK(decoded.lat == 0.0f && decoded.lon == 0.0f);
+		CHECK(aprs_rx_history_insert(&decoded, &raw, 100 + i, APRS_RX_HISTORY_SIZE) == 0);
+
+		// the position of the previously decoded frame
+		decoded.lat = 49.0f;
+		decoded.lon = 8.0f;
+		CHECK(aprs_parse_frame(raw.data, raw.data_len, &decoded));
+		CHECK(aprs_rx_history_insert(&decoded, &raw, 200 + i, APRS_RX_HISTORY_SIZE) == 0);
+	}
+
+	CHECK(aprs_rx_history_get_stats()->num_entries == 0);
+}
+
+#define ARENA_STATIONS  (4 * APRS_RX_HISTORY_SIZE)
+
+/* Last frame inserted for each station of the arena test. */
+typedef struct {
+	aprs_rx_raw_data_t raw;
+	aprs_frame_t       decoded;
+	uint64_t           timestamp;
+	bool               stored;
+	bool               protected; // since the last update, may be kept longer
+} arena_model_t;
+
+static arena_model_t m_arena_model[ARENA_STATIONS];
+
+static bool same_frame(const aprs_frame_t *a, const aprs_frame_t *b)
+{
+	return strcmp(a->source, b->source) == 0
+		&& strcmp(a->dest, b->dest) == 0
+		&& strcmp(a->via, b->via) == 0
+		&& strcmp(a->comment, b->comment) == 0
+		&& a->source_call == b->source_call
+		&& a->lat == b->lat && a->lon == b->lon && a->alt == b->alt
+		&& a->speed == b->speed && a->course == b->course && a->range == b->range
+		&& a->table == b->table && a->symbol == b->symbol
+		&& memcmp(&a->telemetry, &b->telemetry, sizeof(a->telemetry)) == 0;
+}
+
+/* Every stored station must have its last frame. Stations that were replaced
+ * must be older than all remaining ones, except those that were protected. */
+static void check_arena(bool check_frames)
+{
+	static bool present[ARENA_STATIONS];
+	const aprs_rx_history_stats_t *stats = aprs_rx_history_get_stats();
+	uint64_t oldest = UINT64_MAX;
+
+	memset(present, 0, sizeof(present));
+	CHECK(stats->arena_used <= APRS_RX_HISTORY_ARENA_SIZE);
+
+	for(uint16_t i = 0; i < stats->num_entries; i++) {
+		const aprs_rx_history_entry_t *entry = aprs_rx_history_get(i);
+		char source[16];
+		unsigned station;
+
+		if(entry->rx_timestamp == 0) {
+			continue;
+		}
+
+		aprs_rx_history_get_string(entry, APRS_RX_HISTORY_SOURCE, source, sizeof(source));
+
+		if(sscanf(source, "%*[A-Za-z]%u", &station) != 1 || station >= ARENA_STATIONS
+				|| !m_arena_model[station].stored) {
+			fprintf(stderr, "entry %u: unexpected source '%s'\n", i, source);
+			m_failed++;
+			return;
+		}
+
+		const arena_model_t *model = &m_arena_model[station];
+
+		if(check_frames) {
+			aprs_frame_t frame;
+			const uint8_t *data;
+			size_t len;
+
+			aprs_rx_history_get_frame(entry, &frame);
+			data = aprs_rx_history_get_data(entry, &len);
+
+			if(!same_frame(&frame, &model->decoded) || len != model->raw.data_len
+					|| memcmp(data, model->raw.data, len) != 0 || entry->rssi != model->raw.rssi) {
+				fprintf(stderr, "entry %u: %s does not match its last frame\n", i, source);
+				m_failed++;
+				return;
+			}
+		}
+
+		if(entry->rx_timestamp != model->timestamp) {
+			fprintf(stderr, "entry %u: %s has the wrong timestamp\n", i, source);
+			m_failed++;
+			return;
+		}
+
+		if(!model->protected && entry->rx_timestamp < oldest) {
+			oldest = entry->rx_timestamp;
+		}
+
+		present[station] = true;
+	}
+
+	for(uint32_t station = 0; station < ARENA_STATIONS; station++) {
+		arena_model_t *model = &m_arena_model[station];
+
+		if(model->stored && !present[station]) {
+			if(model->timestamp > oldest) {
+				fprintf(stderr, "station %u replaced, but a station updated before it is kept\n", station);
+				m_failed++;
+			}
+
+			model->stored = false;
+		}
+	}
+}
+
+static void make_arena_frame(uint32_t station, aprs_rx_raw_data_t *raw)
+{
+	static const char *paths[] = {"WIDE1-1", "DB0ABC*,WIDE1*", "DB0XYZ*,DB0ABC*,WIDE2*", ""};
+	char comment[64];
+	char text[200];
+	size_t comment_len = rng() % 48;
+
+	for(size_t i = 0; i < comment_len; i++) {
+		comment[i] = 'a' + rng() % 26;
+	}
+
+	comment[comment_len] = '\0';
+
+	if(rng() % 4 == 0) {
+		// base-91 telemetry, removed from the decoded comment
+		strcat(comment, " |ss11|");
+	}
+
+	const char *path = paths[rng() % 4];
+
+	// some names cannot be packed
+	snprintf(text, sizeof(text), "%s%u>APLT00%s%s:!49%02u.%02uN/008%02u.%02uE>%03u/%03u%s",
+			(station % 7) ? "DL" : "dl", station, *path ? "," : "", path,
+			rng() % 60, rng() % 100, rng() % 60, rng() % 100, 1 + rng() % 360, rng() % 100, comment);
+
+	raw->data[0] = '<';
+	raw->data[1] = 0xFF;
+	raw->data[2] = 0x01;
+	strcpy((char*)raw->data + 3, text);
+	raw->data_len = strlen(text) + 3;
+	raw->rssi = -(float)(rng() % 130);
+	raw->snr = 0.0f;
+	raw->signalRssi = 0.0f;
+}
+
+static void test_arena(void)
+{
+	const aprs_rx_history_stats_t *stats = aprs_rx_history_get_stats();
+	uint16_t protected_index = APRS_RX_HISTORY_SIZE;
+
+	aprs_init();
+	memset(m_arena_model, 0, sizeof(m_arena_model));
+
+	for(uint64_t t = 1; t <= 20000; t++) {
+		// a few busy stations and many others
+		uint32_t station = (rng() & 1) ? rng() % 16 : rng() % ARENA_STATIONS;
+		arena_model_t *model = &m_arena_model[station];
+		aprs_rx_raw_data_t raw;
+		aprs_frame_t decoded;
+
+		if(model->stored && rng() % 4 == 0) {
+			// duplicate: keeps the station young
+			raw.rssi = -(float)(rng() % 130);
+
+			CHECK(aprs_rx_history_update_signal(model->decoded.source, &raw, t) != APRS_RX_HISTORY_SIZE);
+			model->timestamp = t;
+			model->raw.rssi = raw.rssi;
+			model->protected = false;
+		} else {
+			make_arena_frame(station, &raw);
+
+			if(!aprs_parse_frame(raw.data, raw.data_len, &decoded)) {
+				fprintf(stderr, "cannot parse %s: %s\n", (char*)raw.data + 3, aprs_get_parser_error());
+				m_failed++;
+				return;
+			}
+
+			uint16_t idx = aprs_rx_history_insert(&decoded, &raw, t, protected_index);
+
+			CHECK(idx < APRS_RX_HISTORY_SIZE);
+
+			model->raw = raw;
+			model->decoded = decoded;
+			model->timestamp = t;
+			model->stored = true;
+			model->protected = false;
+
+			if(rng() % 16 == 0) {
+				protected_index = (rng() % 2) ? idx : APRS_RX_HISTORY_SIZE;
+				model->protected = (protected_index == idx);
+			}
+		}
+
+		check_arena(t % 101 == 0);
+
+		if(m_failed) {
+			return;
+		}
+	}
+
+	check_arena(true);
+
+	// the arena was the limit
+	CHECK(stats->arena_evictions > 0);
+}
+
+/* Check the sorted orders against the entries. The cached distances may be
+ * off by the distance the reference moved since the last recalculation. */
+static void check_sorted(float ref_lat, float ref_lon)
+{
+	static uint16_t sorted[APRS_RX_HISTORY_SIZE];
+	static bool seen[APRS_RX_HISTORY_SIZE];
+	uint16_t num_stations = 0;
+
+	for(uint16_t i = 0; i < aprs_rx_history_get_stats()->num_entries; i++) {
+		const aprs_rx_history_entry_t *entry = aprs_rx_history_get(i);
+
+		if(entry->rx_timestamp == 0) {
+			continue;
+		}
+
+		num_stations++;
+
+		float distance = great_circle_distance_m(ref_lat, ref_lon, entry->lat, entry->lon);
+
+		if(fabsf(entry->distance - distance) > APRS_RX_HISTORY_REFERENCE_UPDATE_M + 1.0f) {
+			fprintf(stderr, "entry %u: distance %.0f m, expected %.0f m\n", i, entry->distance, distance);
+			m_failed++;
+			return;
+		}
+	}
+
+	CHECK(aprs_rx_history_get_stats()->num_stations == num_stations);
+
+	for(aprs_rx_history_order_t order = 0; order < APRS_RX_HISTORY_NUM_ORDERS; order++) {
+		uint16_t n = 0;
+		uint16_t got;
+
+		// read in pages like the display
+		while((got = aprs_rx_history_get_sorted(order, n, sorted + n, 5)) > 0) {
+			n += got;
+		}
+
+		CHECK(n == num_stations);
+		memset(seen, 0, sizeof(seen));
+
+		for(uint16_t i = 0; i < n; i++) {
+			const aprs_rx_history_entry_t *entry = aprs_rx_history_get(sorted[i]);
+
+			CHECK(entry->rx_timestamp != 0 && !seen[sorted[i]]);
+			CHECK(aprs_rx_history_get_position(order, sorted[i]) == i);
+			seen[sorted[i]] = true;
+
+			if(i == 0) {
+				continue;
+			}
+
+			const aprs_rx_history_entry_t *prev = aprs_rx_history_get(sorted[i - 1]);
+
+			switch(order) {
+				case APRS_RX_HISTORY_BY_TIME:
+					CHECK(prev->rx_timestamp >= entry->rx_timestamp);
+					break;
+
+				case APRS_RX_HISTORY_BY_DISTANCE:
+					CHECK(prev->distance <= entry->distance);
+					break;
+
+				default:
+					CHECK(prev->rssi >= entry->rssi);
+					break;
+			}
+		}
+
+		if(m_failed) {
+			fprintf(stderr, "order %d is wrong\n", order);
+			return;
+		}
+	}
+}
+
+static void test_sorted(void)
+{
+	aprs_frame_t frame;
+	aprs_rx_raw_data_t raw = {0};
+	float ref_lat = 49.0f;
+	float ref_lon = 8.0f;
+
+	aprs_init();
+
+	// no reference yet: distances are unknown
+	memset(&frame, 0, sizeof(frame));
+	strcpy(frame.source, "DL1ABC");
+	frame.lat = 49.1f;
+	frame.lon = 8.1f;
+	aprs_rx_history_insert(&frame, &raw, 1, APRS_RX_HISTORY_SIZE);
+	CHECK(aprs_rx_history_get(0)->distance < 0.0f);
+
+	aprs_rx_history_set_reference(ref_lat, ref_lon);
+
+	for(uint64_t t = 2; t <= 20000; t++) {
+		uint32_t station = rng() % (APRS_RX_HISTORY_SIZE * 2);
+
+		raw.data_len = rng() % 200;
+		memset(raw.data, '#', raw.data_len);
+		raw.rssi = -(float)(rng() % 130);
+
+		if(rng() % 4 == 0) {
+			snprintf(frame.source, sizeof(frame.source), "DL%uXY", station);
+			aprs_rx_history_update_signal(frame.source, &raw, t);
+		} else {
+			memset(&frame, 0, sizeof(frame));
+			snprintf(frame.source, sizeof(frame.source), "DL%uXY", station);
+			// positions on a coarse grid, so some distances are equal
+			frame.lat = 48.5f + (float)(rng() % 100) * 0.01f;
+			frame.lon = 7.5f + (float)(station % 10) * 0.01f;
+			aprs_rx_history_insert(&frame, &raw, t, APRS_RX_HISTORY_SIZE);
+		}
+
+		// walking, and now and then a jump
+		if(t % 10 == 0) {
+			ref_lat += (rng() % 64 == 0) ? 0.1f : 0.0001f;
+			aprs_rx_history_set_reference(ref_lat, ref_lon);
+		}
+
+		if(t % 89 == 0) {
+			check_sorted(ref_lat, ref_lon);
+		}
+
+		if(m_failed) {
+			return;
+		}
+	}
+
+	check_sorted(ref_lat, ref_lon);
+}
+
+int main(void)
+{
+	test_random(APRS_RX_HISTORY_SIZE / 2);
+	test_random(APRS_RX_HISTORY_SIZE * 4);
+	test_random(500);
+	CHECK(aprs_rx_history_get_stats()->arena_evictions > 0);
+	test_protected();
+	test_position_signs();
+	test_no_position_frames();
+	test_arena();
+	test_sorted();
+
+	if(m_failed) {
+		fprintf(stderr, "test_aprs_history: %d checks failed.\n", m_failed);
+		return 1;
+	}
+
+	printf("test_aprs_history: all checks passed.\n");
+	return 0;
+}
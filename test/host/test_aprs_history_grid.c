@@ -0,0 +1,272 @@
+/*
+ * Host-side test for the spatial index of the RX history.
+ *
+ * Stations are placed in clusters, including clusters at the antimeridian,
+ * at the zero meridian, at the equator and close to the north pole, and move
+ * between updates. Nearest-N and radius queries at random positions are
+ * compared with a brute-force search over all entries, which uses the same
+ * distance function, so the distances must be identical.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "aprs.h"
+#include "utils.h"
+
+static int m_failed;
+
+#define CHECK(cond) do { \
+	if(!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		m_failed++; \
+	} \
+} while(0)
+
+#define NUM_STATIONS  (APRS_RX_HISTORY_SIZE * 2)
+#define MAX_RESULTS   32
+
+static const struct {
+	float lat;
+	float lon;
+} m_clusters[] = {
+	{ 49.72f,   11.05f},
+	{ 49.45f,   11.08f},
+	{ 52.52f,   13.40f},
+	{ 51.48f,   -0.01f},   // zero meridian
+	{-17.80f,  179.98f},   // antimeridian
+	{-17.80f, -179.98f},
+	{  0.02f,   32.50f},   // equator
+	{ 89.95f,   40.00f},   // north pole
+	{-33.90f,   18.42f},
+};
+
+#define NUM_CLUSTERS  (sizeof(m_clusters) / sizeof(m_clusters[0]))
+
+uint64_t time_base_get(void)
+{
+	return 0;
+}
+
+static uint32_t m_rng_state = 0x12345678;
+
+static uint32_t rng(void)
+{
+	// xorshift32
+	m_rng_state ^= m_rng_state << 13;
+	m_rng_state ^= m_rng_state >> 17;
+	m_rng_state ^= m_rng_state << 5;
+	return m_rng_state;
+}
+
+/* Random offset in degrees, up to about max_km. */
+static float offset(float max_km)
+{
+	return ((float)(rng() % 20001) - 10000.0f) * 1e-4f * max_km / 111.0f;
+}
+
+static float wrap_lon(float lon)
+{
+	return (lon > 180.0f) ? lon - 360.0f : (lon < -180.0f) ? lon + 360.0f : lon;
+}
+
+static void random_position(float max_km, float *lat, float *lon)
+{
+	uint32_t cluster = rng() % NUM_CLUSTERS;
+
+	*lat = m_clusters[cluster].lat + offset(max_km);
+	*lon = wrap_lon(m_clusters[cluster].lon + offset(max_km));
+
+	*lat = (*lat > 90.0f) ? 180.0f - *lat : *lat;
+}
+
+/* Brute force: all stations with their distances, sorted by distance. */
+typedef struct {
+	uint16_t idx;
+	float    distance;
+} oracle_t;
+
+static oracle_t m_oracle[APRS_RX_HISTORY_SIZE];
+
+static int compare_oracle(const void *a, const void *b)
+{
+	float da = ((const oracle_t*)a)->distance;
+	float db = ((const oracle_t*)b)->distance;
+
+	return (da > db) - (da < db);
+}
+
+static uint16_t oracle(float lat, float lon)
+{
+	uint16_t n = 0;
+
+	for(uint16_t i = 0; i < aprs_rx_history_get_stats()->num_entries; i++) {
+		const aprs_rx_history_entry_t *entry = aprs_rx_history_get(i);
+
+		if(entry->rx_timestamp != 0) {
+			m_oracle[n].idx = i;
+			m_oracle[n].distance = great_circle_distance_m(lat, lon, entry->lat, entry->lon);
+			n++;
+		}
+	}
+
+	qsort(m_oracle, n, sizeof(m_oracle[0]), compare_oracle);
+	return n;
+}
+
+static void check_nearest(float lat, float lon, uint16_t count)
+{
+	uint16_t idx[MAX_RESULTS];
+	float distance[MAX_RESULTS];
+	uint16_t num_stations = oracle(lat, lon);
+	uint16_t expected = (count < num_stations) ? count : num_stations;
+	uint16_t found = aprs_rx_history_find_nearest(lat, lon, idx, distance, count);
+
+	CHECK(found == expected);
+
+	for(uint16_t i = 0; i < found && i < expected; i++) {
+		const aprs_rx_history_entry_t *entry = aprs_rx_history_get(idx[i]);
+
+		// equal distances may come in any order
+		if(distance[i] != m_oracle[i].distance || entry->rx_timestamp == 0
+				|| great_circle_distance_m(lat, lon, entry->lat, entry->lon) != distance[i]) {
+			fprintf(stderr, "nearest %u at %.4f %.4f: #%u is %.1f m, expected %.1f m\n",
+					count, lat, lon, i, distance[i], m_oracle[i].distance);
+			m_failed++;
+			return;
+		}
+	}
+}
+
+static void check_within(float lat, float lon, float radius_m)
+{
+	uint16_t idx[MAX_RESULTS];
+	float distance[MAX_RESULTS];
+	static bool in_result[APRS_RX_HISTORY_SIZE];
+	uint16_t num_stations = oracle(lat, lon);
+	uint16_t expected = 0;
+
+	while(expected < num_stations && m_oracle[expected].distance <= radius_m) {
+		expected++;
+	}
+
+	uint16_t found = aprs_rx_history_find_within(lat, lon, radius_m, idx, distance, MAX_RESULTS);
+
+	if(found != expected) {
+		fprintf(stderr, "within %.0f m of %.4f %.4f: %u stations, expected %u\n",
+				radius_m, lat, lon, found, expected);
+		m_failed++;
+		return;
+	}
+
+	if(found > MAX_RESULTS) {
+		// the first ones found are returned, check without the distances
+		CHECK(aprs_rx_history_find_within(lat, lon, radius_m, idx, NULL, MAX_RESULTS) == found);
+		found = MAX_RESULTS;
+	}
+
+	memset(in_result, 0, sizeof(in_result));
+
+	for(uint16_t i = 0; i < found; i++) {
+		const aprs_rx_history_entry_t *entry = aprs_rx_history_get(idx[i]);
+
+		CHECK(!in_result[idx[i]] && entry->rx_timestamp != 0);
+		CHECK(great_circle_distance_m(lat, lon, entry->lat, entry->lon) <= radius_m);
+		in_result[idx[i]] = true;
+	}
+
+	// if all fit, they must be exactly those of the brute force search
+	if(expected <= MAX_RESULTS) {
+		for(uint16_t i = 0; i < expected; i++) {
+			CHECK(in_result[m_oracle[i].idx]);
+		}
+	}
+}
+
+static void run_queries(void)
+{
+	for(int i = 0; i < 20 && !m_failed; i++) {
+		float lat, lon;
+
+		random_position(200.0f, &lat, &lon);
+
+		check_nearest(lat, lon, 1 + rng() % MAX_RESULTS);
+
+		// mostly local searches, sometimes across the clusters
+		static const float radius_km[] = {0.5f, 2.0f, 10.0f, 30.0f, 100.0f, 3000.0f};
+		check_within(lat, lon, radius_km[rng() % 6] * 1000.0f);
+	}
+}
+
+static void test_random(void)
+{
+	aprs_frame_t frame;
+	aprs_rx_raw_data_t raw = {0};
+
+	aprs_init();
+
+	// an empty history
+	check_nearest(49.0f, 11.0f, 5);
+	check_within(49.0f, 11.0f, 10000.0f);
+
+	for(uint64_t t = 1; t <= 20000 && !m_failed; t++) {
+		uint32_t station = rng() % NUM_STATIONS;
+
+		memset(&frame, 0, sizeof(frame));
+		snprintf(frame.source, sizeof(frame.source), "DL%uXY", station);
+		raw.data_len = rng() % 200;
+		memset(raw.data, '#', raw.data_len);
+
+		if(rng() % 8 != 0) {
+			random_position((rng() % 4 == 0) ? 50.0f : 5.0f, &frame.lat, &frame.lon);
+		}
+
+		aprs_rx_history_insert(&frame, &raw, t, APRS_RX_HISTORY_SIZE);
+
+		if(t % 500 == 0) {
+			run_queries();
+		}
+	}
+
+	run_queries();
+}
+
+/* Stations exactly on cell borders and at the same position. */
+static void test_borders(void)
+{
+	aprs_frame_t frame;
+	aprs_rx_raw_data_t raw = {0};
+
+	aprs_init();
+
+	for(uint32_t i = 0; i < 64; i++) {
+		memset(&frame, 0, sizeof(frame));
+		snprintf(frame.source, sizeof(frame.source), "DB%uAB", i);
+		frame.lat = 49.0f + (float)(i % 4) * 0.1f;
+		frame.lon = (i % 8 < 4) ? 10.0f + (float)(i / 8) * 0.1f : 180.0f - (float)(i / 8) * 0.1f;
+		aprs_rx_history_insert(&frame, &raw, i + 1, APRS_RX_HISTORY_SIZE);
+	}
+
+	for(uint32_t i = 0; i < 200 && !m_failed; i++) {
+		float lat = 49.0f + (float)(rng() % 5) * 0.1f;
+		float lon = (i % 2) ? 10.0f + (float)(rng() % 8) * 0.1f : -180.0f + (float)(rng() % 8) * 0.1f;
+
+		check_nearest(lat, lon, 1 + rng() % MAX_RESULTS);
+		check_within(lat, lon, (float)(rng() % 40) * 1000.0f);
+	}
+}
+
+int main(void)
+{
+	test_random();
+	test_borders();
+
+	if(m_failed) {
+		fprintf(stderr, "test_aprs_history_grid: %d checks failed.\n", m_failed);
+		return 1;
+	}
+
+	printf("test_aprs_history_grid: all checks passed.\n");
+	return 0;
+}
@@ -0,0 +1,429 @@
+/*
+ * Host-side test for the persistent RX history.
+ *
+ * The store runs on a fake NOR flash (aprs_history_flash_fake.c). A reboot is
+ * simulated by clearing the history with aprs_init() and restoring it with
+ * aprs_history_store_init().
+ *
+ * - restore: after a flush, the restored history equals the one before.
+ * - wear: a long run with many stations must erase all pages evenly and keep
+ *   the latest state of every station in the history. The flash traffic and
+ *   the restore time of the full log are reported.
+ * - power cut: the power is cut at random points of writes and erases. The
+ *   restored stations must have a state that was actually received, the store
+ *   must never write to flash that is not erased, and after more traffic and a
+ *   flush, a restore must be complete again.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "aprs.h"
+#include "aprs_history_store.h"
+#include "aprs_history_flash_fake.h"
+
+static int m_failed;
+
+#define CHECK(cond) do { \
+	if(!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		m_failed++; \
+	} \
+} while(0)
+
+#define NUM_STATIONS  400
+#define MAX_FRAMES    200000
+
+/* State of a station in the history, as it should be restored. */
+typedef struct {
+	uint32_t station;
+	uint64_t rx_timestamp;
+	float    lat, lon, alt;
+	float    rssi, snr, signal_rssi;
+	char     table, symbol;
+	size_t   data_len;
+	uint8_t  data[256];
+} station_state_t;
+
+// state after each received frame, by timestamp (for the power cut test)
+static station_state_t m_states[4096];
+
+// latest state of each station
+static station_state_t m_latest[NUM_STATIONS];
+static bool            m_has_latest[NUM_STATIONS];
+
+static station_state_t m_snapshot[NUM_STATIONS];
+static bool            m_in_snapshot[NUM_STATIONS];
+
+static uint64_t m_time_ms;
+static uint64_t m_rx_timestamp;
+
+uint64_t time_base_get(void)
+{
+	return m_time_ms;
+}
+
+static double now_s(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint32_t m_rng_state = 0x12345678;
+
+static uint32_t rng(void)
+{
+	// xorshift32
+	m_rng_state ^= m_rng_state << 13;
+	m_rng_state ^= m_rng_state >> 17;
+	m_rng_state ^= m_rng_state << 5;
+	return m_rng_state;
+}
+
+static bool get_state(const aprs_rx_history_entry_t *entry, station_state_t *state)
+{
+	char source[16];
+	const uint8_t *data;
+
+	aprs_rx_history_get_string(entry, APRS_RX_HISTORY_SOURCE, source, sizeof(source));
+
+	if(sscanf(source, "%*[A-Za-z]%u", &state->station) != 1 || state->station >= NUM_STATIONS) {
+		fprintf(stderr, "unexpected source '%s'\n", source);
+		m_failed++;
+		return false;
+	}
+
+	state->rx_timestamp = entry->rx_timestamp;
+	state->lat = entry->lat;
+	state->lon = entry->lon;
+	state->alt = entry->alt;
+	state->rssi = entry->rssi;
+	state->snr = entry->snr;
+	state->signal_rssi = entry->signalRssi;
+	state->table = entry->table;
+	state->symbol = entry->symbol;
+
+	data = aprs_rx_history_get_data(entry, &state->data_len);
+	memcpy(state->data, data, state->data_len);
+	return true;
+}
+
+static bool same_state(const station_state_t *a, const station_state_t *b)
+{
+	return a->station == b->station
+		&& a->rx_timestamp == b->rx_timestamp
+		&& a->lat == b->lat && a->lon == b->lon && a->alt == b->alt
+		&& a->rssi == b->rssi && a->snr == b->snr && a->signal_rssi == b->signal_rssi
+		&& a->table == b->table && a->symbol == b->symbol
+		&& a->data_len == b->data_len && memcmp(a->data, b->data, a->data_len) == 0;
+}
+
+/* Receive a frame from a station. Some frames have no position, then the
+ * station keeps its previous one. Signal values are multiples of 0.25 dB like
+ * those of the SX1262. */
+static void receive(uint32_t station)
+{
+	char text[200];
+	char comment[48];
+	size_t comment_len = rng() % 40;
+	aprs_rx_raw_data_t raw;
+	aprs_frame_t frame;
+
+	for(size_t i = 0; i < comment_len; i++) {
+		comment[i] = 'a' + rng() % 26;
+	}
+
+	comment[comment_len] = '\0';
+
+	// some names cannot be packed
+	const char *prefix = (station % 7) ? "DL" : "dl";
+
+	if(rng() % 8 == 0) {
+		snprintf(text, sizeof(text), "%s%u>APLT00,WIDE1-1:>%s", prefix, station, comment);
+	} else {
+		snprintf(text, sizeof(text), "%s%u>APLT00,WIDE1-1:!49%02u.%02uN/008%02u.%02uE>%s",
+				prefix, station, rng() % 60, rng() % 100, rng() % 60, rng() % 100, comment);
+	}
+
+	raw.data[0] = '<';
+	raw.data[1] = 0xFF;
+	raw.data[2] = 0x01;
+	strcpy((char*)raw.data + 3, text);
+	raw.data_len = strlen(text) + 3;
+	raw.rssi = -(float)(rng() % 520) / 4.0f;
+	raw.snr = (float)((int)(rng() % 120) - 80) / 4.0f;
+	raw.signalRssi = -(float)(rng() % 520) / 4.0f;
+
+	m_rx_timestamp++;
+	m_time_ms += 10000;
+
+	if(!aprs_parse_frame(raw.data, raw.data_len, &frame)) {
+		fprintf(stderr, "cannot parse %s: %s\n", text, aprs_get_parser_error());
+		m_failed++;
+		return;
+	}
+
+	uint16_t idx = aprs_rx_history_insert(&frame, &raw, m_rx_timestamp, APRS_RX_HISTORY_SIZE);
+
+	aprs_history_store_add(idx);
+
+	const aprs_rx_history_entry_t *entry = aprs_rx_history_get(idx);
+
+	if(entry && entry->rx_timestamp == m_rx_timestamp) {
+		m_has_latest[station] = get_state(entry, &m_latest[station]);
+	}
+
+	if(m_rx_timestamp < sizeof(m_states) / sizeof(m_states[0])) {
+		// positionless frames of unknown stations are not stored
+		if(entry && entry->rx_timestamp == m_rx_timestamp) {
+			get_state(entry, &m_states[m_rx_timestamp]);
+		} else {
+			m_states[m_rx_timestamp].rx_timestamp = 0;
+		}
+	}
+}
+
+static void flush(void)
+{
+	aprs_history_store_flush();
+
+	while(aprs_history_store_is_busy()) {
+		aprs_history_store_loop();
+	}
+}
+
+static void take_snapshot(void)
+{
+	memset(m_in_snapshot, 0, sizeof(m_in_snapshot));
+
+	for(uint16_t i = 0; i < aprs_rx_history_get_stats()->num_entries; i++) {
+		const aprs_rx_history_entry_t *entry = aprs_rx_history_get(i);
+		station_state_t state;
+
+		if(entry->rx_timestamp != 0 && get_state(entry, &state)) {
+			m_snapshot[state.station] = state;
+			m_in_snapshot[state.station] = true;
+		}
+	}
+}
+
+/* The history must contain the stations of the snapshot, each with the same
+ * state. Stations that were dropped from the history before may be restored
+ * too, with a state that was received. */
+static void check_snapshot(const char *name)
+{
+	static bool seen[NUM_STATIONS];
+
+	memset(seen, 0, sizeof(seen));
+
+	for(uint16_t i = 0; i < aprs_rx_history_get_stats()->num_entries; i++) {
+		const aprs_rx_history_entry_t *entry = aprs_rx_history_get(i);
+		station_state_t state;
+
+		if(entry->rx_timestamp == 0 || !get_state(entry, &state)) {
+			continue;
+		}
+
+		bool valid;
+
+		if(m_in_snapshot[state.station]) {
+			valid = same_state(&state, &m_snapshot[state.station]);
+		} else {
+			// after a power cut, the state received last may be lost
+			valid = (m_has_latest[state.station] && same_state(&state, &m_latest[state.station]))
+				|| (state.rx_timestamp < sizeof(m_states) / sizeof(m_states[0])
+					&& same_state(&state, &m_states[state.rx_timestamp]));
+		}
+
+		if(!valid) {
+			fprintf(stderr, "%s: station %u restored with a wrong state\n", name, state.station);
+			m_failed++;
+			return;
+		}
+
+		seen[state.station] = true;
+	}
+
+	for(uint32_t station = 0; station < NUM_STATIONS; station++) {
+		if(m_in_snapshot[station] && !seen[station]) {
+			fprintf(stderr, "%s: station %u not restored\n", name, station);
+			m_failed++;
+			return;
+		}
+	}
+}
+
+static void reboot(void)
+{
+	flash_fake_power_on();
+	aprs_init();
+	CHECK(aprs_history_store_init() == NRF_SUCCESS);
+}
+
+static void start_empty(void)
+{
+	flash_fake_reset();
+	m_rx_timestamp = 0;
+	memset(m_has_latest, 0, sizeof(m_has_latest));
+	reboot();
+}
+
+static void test_restore(void)
+{
+	start_empty();
+
+	for(int i = 0; i < 2000; i++) {
+		receive(rng() % 100);
+		aprs_history_store_loop();
+	}
+
+	flush();
+	take_snapshot();
+	reboot();
+
+	check_snapshot("restore");
+	CHECK(aprs_history_store_get_stats()->records_restored > 0);
+	CHECK(aprs_history_store_get_stats()->records_corrupt == 0);
+	CHECK(flash_fake_overwrites() == 0);
+}
+
+static void test_wear(void)
+{
+	const uint32_t num_frames = MAX_FRAMES;
+	uint32_t min_erase = UINT32_MAX, max_erase = 0;
+
+	start_empty();
+
+	for(uint32_t i = 0; i < num_frames; i++) {
+		// a few busy stations and many others
+		receive((rng() & 1) ? rng() % 16 : rng() % NUM_STATIONS);
+		aprs_history_store_loop();
+	}
+
+	flush();
+
+	const aprs_history_store_stats_t *stats = aprs_history_store_get_stats();
+
+	for(uint8_t page = 0; page < APRS_HISTORY_FLASH_PAGES; page++) {
+		uint32_t count = flash_fake_erase_count(page);
+
+		min_erase = (count < min_erase) ? count : min_erase;
+		max_erase = (count > max_erase) ? count : max_erase;
+	}
+
+	// pages are used in turn
+	CHECK(max_erase - min_erase <= 1);
+	CHECK(stats->records_dropped == 0);
+	CHECK(flash_fake_overwrites() == 0);
+
+	double hours = num_frames * 10.0 / 3600.0;
+
+	printf("wear: %u frames (one per 10 s), %u records (%u relocated) in %u flash writes, %.1f B/frame\n",
+			num_frames, stats->records_written, stats->records_relocated, stats->flash_writes,
+			(double)stats->bytes_written / num_frames);
+	printf("      %u pages erased in %.0f h, %u..%u erases per page -> %.0f years to 10000 erases\n",
+			stats->pages_erased, hours, min_erase, max_erase,
+			10000.0 * hours / max_erase / (24 * 365));
+
+	take_snapshot();
+
+	double t0 = now_s();
+	reboot();
+	double restore_us = (now_s() - t0) * 1e6;
+
+	printf("      restore: %u records in %.0f us, %u stations\n",
+			aprs_history_store_get_stats()->records_restored, restore_us,
+			aprs_rx_history_get_stats()->num_entries);
+
+	check_snapshot("wear");
+	CHECK(aprs_history_store_get_stats()->records_corrupt == 0);
+}
+
+/* Every restored station must have a state that was received. */
+static void check_received_states(void)
+{
+	for(uint16_t i = 0; i < aprs_rx_history_get_stats()->num_entries; i++) {
+		const aprs_rx_history_entry_t *entry = aprs_rx_history_get(i);
+		station_state_t state;
+
+		if(entry->rx_timestamp == 0 || !get_state(entry, &state)) {
+			continue;
+		}
+
+		if(state.rx_timestamp >= sizeof(m_states) / sizeof(m_states[0])
+				|| !same_state(&state, &m_states[state.rx_timestamp])) {
+			fprintf(stderr, "power cut: station %u restored with a state never received\n",
+					state.station);
+			m_failed++;
+			return;
+		}
+	}
+}
+
+static void test_power_cut(void)
+{
+	uint32_t corrupt = 0;
+
+	for(int iteration = 0; iteration < 300 && !m_failed; iteration++) {
+		start_empty();
+
+		// fill the log, so pages are also relocated and erased
+		for(int i = 0; i < 1500; i++) {
+			receive(rng() % 200);
+			aprs_history_store_loop();
+		}
+
+		flash_fake_power_cut_after(rng() % 16384);
+
+		for(int i = 0; i < 1000 && !flash_fake_power_lost(); i++) {
+			receive(rng() % 200);
+
+			if(rng() % 32 == 0) {
+				aprs_history_store_flush();
+			}
+
+			aprs_history_store_loop();
+		}
+
+		while(!flash_fake_power_lost() && aprs_history_store_is_busy()) {
+			aprs_history_store_loop();
+		}
+
+		reboot();
+		check_received_states();
+		corrupt += aprs_history_store_get_stats()->records_corrupt;
+
+		// the store continues after the reset
+		for(int i = 0; i < 500; i++) {
+			receive(rng() % 200);
+			aprs_history_store_loop();
+		}
+
+		flush();
+		take_snapshot();
+		reboot();
+		check_snapshot("power cut");
+
+		CHECK(flash_fake_overwrites() == 0);
+	}
+
+	printf("power cut: 300 resets, %u records found corrupt\n", corrupt);
+}
+
+int main(void)
+{
+	test_restore();
+	test_wear();
+	test_power_cut();
+
+	if(m_failed) {
+		fprintf(stderr, "test_aprs_history_store: %d checks failed.\n", m_failed);
+		return 1;
+	}
+
+	printf("test_aprs_history_store: all checks passed.\n");
+	return 0;
+}
@@ -0,0 +1,247 @@
+/*
+ * Host-side test for the Mic-E position format: encoding against known
+ * vectors, decoding of received frames and encode/decode round trips.
+ *
+ * Also prints the frame length and time on air of a typical beacon in the
+ * readable, compressed and Mic-E formats.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "aprs.h"
+#include "lora_toa.h"
+
+static int m_failed;
+
+#define CHECK(cond) do { \
+	if(!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		m_failed++; \
+	} \
+} while(0)
+
+#define KNOTS  0.514444f
+
+uint64_t time_base_get(void)
+{
+	return 0;
+}
+
+static void setup(uint32_t flags, const char *comment)
+{
+	aprs_init();
+	aprs_set_source("DL9SAU-12");
+	aprs_set_dest("APLT00");
+	aprs_set_icon('/', 'j');
+	aprs_set_comment(comment);
+	aprs_set_config_flags(flags);
+}
+
+static size_t build(uint8_t *frame)
+{
+	aprs_args_t args = {
+		.frame_id = 42,
+		.vbat_millivolt = 3987,
+	};
+
+	return aprs_build_frame(frame, &args, PACKET_TYPE_POSITION);
+}
+
+static bool parse(const char *text, aprs_frame_t *result)
+{
+	uint8_t frame[APRS_MAX_FRAME_LEN];
+
+	frame[0] = '<';
+	frame[1] = 0xFF;
+	frame[2] = 0x01;
+	strcpy((char*)frame + 3, text);
+
+	memset(result, 0, sizeof(*result));
+	return aprs_parse_frame(frame, strlen(text) + 3, result);
+}
+
+/* Destination example from the APRS specification (33°25.64'N, West, no
+ * longitude offset, message M3), with 12°07.74'W, 20 knots, course 251°. */
+static void test_encode_spec_vector(void)
+{
+	uint8_t frame[APRS_MAX_FRAME_LEN];
+
+	setup(APRS_FLAG_MIC_E, "");
+	aprs_set_mic_e_message(APRS_MIC_E_RETURNING);
+	aprs_update_pos_time(33.0f + 25.645f / 60.0f, -(12.0f + 7.745f / 60.0f), 0.0f, 0);
+	aprs_update_speed_course(20 * KNOTS, 251.0f, true);
+
+	size_t len = build(frame);
+
+	CHECK(len == 3 + strlen("DL9SAU-12>S32U6T:`(_fn\"Oj/"));
+	CHECK(strcmp((char*)frame + 3, "DL9SAU-12>S32U6T:`(_fn\"Oj/") == 0);
+}
+
+static void test_encode_longitude_offset(void)
+{
+	uint8_t frame[APRS_MAX_FRAME_LEN];
+
+	// same as above, but 112°W: offset flag set, degrees - 100 + 28
+	setup(APRS_FLAG_MIC_E, "");
+	aprs_set_mic_e_message(APRS_MIC_E_RETURNING);
+	aprs_update_pos_time(33.0f + 25.645f / 60.0f, -(112.0f + 7.745f / 60.0f), 0.0f, 0);
+	aprs_update_speed_course(20 * KNOTS, 251.0f, true);
+
+	build(frame);
+	CHECK(strcmp((char*)frame + 3, "DL9SAU-12>S32UVT:`(_fn\"Oj/") == 0);
+}
+
+static void test_encode_ranges(void)
+{
+	uint8_t frame[APRS_MAX_FRAME_LEN];
+
+	// south/east, longitude >= 100°, no speed/course, altitude, path
+	setup(APRS_FLAG_MIC_E | APRS_FLAG_ADD_ALTITUDE, "");
+	aprs_add_path("WIDE1-1");
+	aprs_update_pos_time(-(33.0f + 51.505f / 60.0f), 151.0f + 12.555f / 60.0f, 61.0f, 0);
+
+	build(frame);
+	CHECK(memcmp(frame + 3, "DL9SAU-12>SSU1U0,WIDE1-1:`O(Sl \x1cj/\"4T}", 38) == 0);
+	CHECK(frame[3 + 38] == '\0');
+
+	// longitude < 10°: offset flag, degrees + 118; minutes < 10: + 88
+	setup(APRS_FLAG_MIC_E, "");
+	aprs_update_pos_time(48.0f + 0.005f / 60.0f, 8.0f + 5.005f / 60.0f, 0.0f, 0);
+	build(frame);
+	CHECK(strncmp((char*)frame + 3, "DL9SAU-12>TXPPP0:`~]", 20) == 0);
+
+	// longitude 100..109°: offset flag, degrees + 8
+	setup(APRS_FLAG_MIC_E, "");
+	aprs_update_pos_time(1.0f, -(105.0f + 30.005f / 60.0f), 0.0f, 0);
+	build(frame);
+	CHECK(strncmp((char*)frame + 3, "DL9SAU-12>PQPPPP:`q:", 20) == 0);
+}
+
+static void test_decode(void)
+{
+	aprs_frame_t result;
+
+	// the spec vector with a radio type byte, altitude and comment
+	CHECK(parse("N0CALL>S32U6T,WIDE1-1:`(_fn\"Oj/]\"4T}Test", &result));
+	CHECK(strcmp(result.source, "N0CALL") == 0);
+	CHECK(fabsf(result.lat - (33.0f + 25.64f / 60.0f)) < 1e-5f);
+	CHECK(fabsf(result.lon + (12.0f + 7.74f / 60.0f)) < 1e-5f);
+	CHECK(fabsf(result.speed - 20 * KNOTS) < 1e-3f);
+	CHECK(result.course == 251);
+	CHECK(result.table == '/');
+	CHECK(result.symbol == 'j');
+	CHECK(fabsf(result.alt - 61.0f) < 1e-3f);
+	CHECK(strcmp(result.comment, "Test") == 0);
+
+	// old Mic-E data type, destination with SSID
+	CHECK(parse("N0CALL>S32U6T-2:'(_fn\"Oj/", &result));
+	CHECK(fabsf(result.lat - (33.0f + 25.64f / 60.0f)) < 1e-5f);
+
+	// invalid destination or too short information field
+	CHECK(!parse("N0CALL>APRS:`(_fn\"Oj/", &result));
+	CHECK(!parse("N0CALL>S32U6T:`(_fn", &result));
+	CHECK(!parse("N0CALL>S32U6T:`\x05_fn\"Oj/", &result));
+}
+
+static void test_round_trip(void)
+{
+	static const float lats[] = {0.0f, 12.3456f, -45.6789f, 89.9f, -0.5f};
+	static const float lons[] = {0.0f, 5.4321f, 45.678f, -99.9f, 104.25f, -123.4567f, 179.99f};
+	static const struct { float speed_kt; float course; } motions[] = {
+		{0, 0}, {1, 1}, {9, 99}, {19, 360}, {25, 180}, {123, 359}, {799, 270},
+	};
+
+	uint8_t frame[APRS_MAX_FRAME_LEN];
+	aprs_frame_t result;
+
+	for(size_t i = 0; i < sizeof(lats) / sizeof(lats[0]); i++) {
+		for(size_t j = 0; j < sizeof(lons) / sizeof(lons[0]); j++) {
+			for(size_t k = 0; k < sizeof(motions) / sizeof(motions[0]); k++) {
+				setup(APRS_FLAG_MIC_E | APRS_FLAG_ADD_ALTITUDE | APRS_FLAG_ADD_DAO | APRS_FLAG_ADD_FRAME_COUNTER, "hello");
+				aprs_update_pos_time(lats[i], lons[j], 100.0f * k - 50.0f, 0);
+				aprs_update_speed_course(motions[k].speed_kt * KNOTS, motions[k].course, true);
+
+				size_t len = build(frame);
+				CHECK(len > 0);
+				CHECK(aprs_parse_frame(frame, len, &result));
+
+				// DAO adds a third digit to the hundredths of minutes
+				CHECK(fabsf(result.lat - lats[i]) < 0.0011f / 60.0f);
+				CHECK(fabsf(result.lon - lons[j]) < 0.0011f / 60.0f);
+				CHECK(fabsf(result.alt - (100.0f * k - 50.0f)) < 0.51f);
+				CHECK(fabsf(result.speed - motions[k].speed_kt * KNOTS) < 1e-3f);
+
+				if(motions[k].course == 0) {
+					CHECK(result.course == 360); // a valid course is never 0
+				} else {
+					CHECK(result.course == (uint16_t)motions[k].course);
+				}
+
+				CHECK(result.table == '/');
+				CHECK(result.symbol == 'j');
+				CHECK(strstr(result.comment, "#42") != NULL);
+			}
+		}
+	}
+
+	// unknown speed and course
+	setup(APRS_FLAG_MIC_E, "");
+	aprs_update_pos_time(10.0f, 10.0f, 0.0f, 0);
+	aprs_update_speed_course(12.0f, 90.0f, false);
+	CHECK(aprs_parse_frame(frame, build(frame), &result));
+	CHECK(result.speed == 0.0f);
+	CHECK(result.course == 0);
+}
+
+static void test_airtime(void)
+{
+	static const struct {
+		const char *name;
+		uint32_t    flags;
+	} formats[] = {
+		{"readable",   0},
+		{"compressed", APRS_FLAG_COMPRESS_LOCATION},
+		{"Mic-E",      APRS_FLAG_MIC_E},
+	};
+
+	uint8_t frame[APRS_MAX_FRAME_LEN];
+	size_t lens[3];
+
+	printf("format      length  time on air  (altitude + frame counter, path WIDE1-1)\n");
+
+	for(size_t i = 0; i < 3; i++) {
+		setup(formats[i].flags | APRS_FLAG_ADD_ALTITUDE | APRS_FLAG_ADD_FRAME_COUNTER, "");
+		aprs_add_path("WIDE1-1");
+		aprs_update_pos_time(48.137154f, 11.576124f, 519.3f, 0);
+		aprs_update_speed_course(5.0f, 123.0f, true);
+
+		lens[i] = build(frame);
+
+		printf("%-10s  %4zu B   %6u ms\n", formats[i].name, lens[i],
+				lora_toa_ms(&LORA_MODULATION_APRS, lens[i]));
+	}
+
+	CHECK(lens[2] < lens[1]);
+	CHECK(lens[1] < lens[0]);
+	CHECK(lora_toa_ms(&LORA_MODULATION_APRS, lens[2]) < lora_toa_ms(&LORA_MODULATION_APRS, lens[0]));
+}
+
+int main(void)
+{
+	test_encode_spec_vector();
+	test_encode_longitude_offset();
+	test_encode_ranges();
+	test_decode();
+	test_round_trip();
+	test_airtime();
+
+	if(m_failed) {
+		fprintf(stderr, "test_aprs_mic_e: %d checks failed.\n", m_failed);
+		return 1;
+	}
+
+	printf("test_aprs_mic_e: all checks passed.\n");
+	return 0;
+}
@@ -0,0 +1,275 @@
+/*
+ * Host-side test for the base-91 comment telemetry: encoding, definition
+ * messages, decoding of received frames and encode/decode round trips.
+ *
+ * Also prints the frame length and time on air of the readable encoding
+ * (position report plus weather report) and the telemetry encoding.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "aprs.h"
+#include "lora_toa.h"
+
+static int m_failed;
+
+#define CHECK(cond) do { \
+	if(!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		m_failed++; \
+	} \
+} while(0)
+
+uint64_t time_base_get(void)
+{
+	return 0;
+}
+
+static void setup(uint32_t flags)
+{
+	aprs_init();
+	aprs_set_source("DL9SAU-12");
+	aprs_set_dest("APLT00");
+	aprs_add_path("WIDE1-1");
+	aprs_set_icon('/', '[');
+	aprs_set_comment("");
+	aprs_set_config_flags(flags);
+	aprs_update_pos_time(48.137154f, 11.576124f, 519.3f, 1700000000);
+}
+
+static void init_args(aprs_args_t *args, bool env)
+{
+	memset(args, 0, sizeof(*args));
+
+	args->frame_id = 42;
+	args->vbat_millivolt = 3987;
+	args->transmit_env_data = env;
+	args->temperature_celsius = 21.4f;
+	args->humidity_rH = 48.6f;
+	args->pressure_hPa = 1013.2f;
+}
+
+static bool parse(const char *text, aprs_frame_t *result)
+{
+	uint8_t frame[APRS_MAX_FRAME_LEN];
+
+	frame[0] = '<';
+	frame[1] = 0xFF;
+	frame[2] = 0x01;
+	strcpy((char*)frame + 3, text);
+
+	memset(result, 0, sizeof(*result));
+	return aprs_parse_frame(frame, strlen(text) + 3, result);
+}
+
+static void test_encode(void)
+{
+	uint8_t frame[APRS_MAX_FRAME_LEN];
+	aprs_args_t args;
+
+	// battery voltage only: 42 = "!K", 3987 mV = 43 * 91 + 74 = "Lk"
+	setup(APRS_FLAG_TELEMETRY | APRS_FLAG_ADD_FRAME_COUNTER | APRS_FLAG_ADD_VBAT);
+	init_args(&args, false);
+	aprs_build_frame(frame, &args, PACKET_TYPE_POSITION);
+	CHECK(strcmp((char*)frame + 3, "DL9SAU-12>APLT00,WIDE1-1:!4808.22N/01134.56E[|!KLk|") == 0);
+
+	// with weather data: 714 = "(n", 486 = "&@", 7132 = "oC"
+	setup(APRS_FLAG_TELEMETRY | APRS_FLAG_ADD_WEATHER);
+	init_args(&args, true);
+	aprs_build_frame(frame, &args, PACKET_TYPE_POSITION);
+	CHECK(strcmp((char*)frame + 3, "DL9SAU-12>APLT00,WIDE1-1:!4808.22N/01134.56E[|!KLk(n&@oC|") == 0);
+
+	// no separate weather report in telemetry mode
+	CHECK(aprs_build_frame(frame, &args, PACKET_TYPE_WX) == 0);
+
+	// separated from other fields by a space, values are clamped
+	setup(APRS_FLAG_TELEMETRY | APRS_FLAG_ADD_WEATHER | APRS_FLAG_ADD_ALTITUDE);
+	init_args(&args, true);
+	args.frame_id = 8281 + 1;
+	args.vbat_millivolt = 9000;
+	args.temperature_celsius = -60.0f;
+	aprs_build_frame(frame, &args, PACKET_TYPE_POSITION);
+	CHECK(strstr((char*)frame, "/A=001703 |!\"{{!!&@oC|") != NULL);
+}
+
+static void test_definitions(void)
+{
+	uint8_t frame[APRS_MAX_FRAME_LEN];
+	aprs_args_t args;
+
+	init_args(&args, false);
+
+	setup(APRS_FLAG_TELEMETRY | APRS_FLAG_ADD_WEATHER);
+	aprs_build_frame(frame, &args, PACKET_TYPE_TLM_PARM);
+	CHECK(strcmp((char*)frame + 3, "DL9SAU-12>APLT00,WIDE1-1::DL9SAU-12:PARM.Vbat,Temp,Humidity,Pressure") == 0);
+	aprs_build_frame(frame, &args, PACKET_TYPE_TLM_UNIT);
+	CHECK(strcmp((char*)frame + 3, "DL9SAU-12>APLT00,WIDE1-1::DL9SAU-12:UNIT.V,degC,%,hPa") == 0);
+	aprs_build_frame(frame, &args, PACKET_TYPE_TLM_EQNS);
+	CHECK(strcmp((char*)frame + 3, "DL9SAU-12>APLT00,WIDE1-1::DL9SAU-12:EQNS.0,0.001,0,0,0.1,-50,0,0.1,0,0,0.1,300") == 0);
+
+	// without weather, only A1 is defined; the addressee is padded to 9 characters
+	setup(APRS_FLAG_TELEMETRY);
+	aprs_set_source("DL9SAU");
+	aprs_build_frame(frame, &args, PACKET_TYPE_TLM_PARM);
+	CHECK(strcmp((char*)frame + 3, "DL9SAU>APLT00,WIDE1-1::DL9SAU   :PARM.Vbat") == 0);
+	aprs_build_frame(frame, &args, PACKET_TYPE_TLM_EQNS);
+	CHECK(strcmp((char*)frame + 3, "DL9SAU>APLT00,WIDE1-1::DL9SAU   :EQNS.0,0.001,0") == 0);
+
+	// a call longer than the addressee field cannot be addressed
+	aprs_set_source("DL9SAU-12X");
+	CHECK(aprs_build_frame(frame, &args, PACKET_TYPE_TLM_PARM) == 0);
+	CHECK(aprs_build_frame(frame, &args, PACKET_TYPE_TLM_UNIT) == 0);
+	CHECK(aprs_build_frame(frame, &args, PACKET_TYPE_TLM_EQNS) == 0);
+
+	// position reports still carry the telemetry
+	aprs_build_frame(frame, &args, PACKET_TYPE_POSITION);
+	CHECK(strstr((char*)frame + 3, "DL9SAU-12X>APLT00,WIDE1-1:!") == (char*)frame + 3);
+	CHECK(strstr((char*)frame, "|!KLk|") != NULL);
+}
+
+static void test_decode(void)
+{
+	aprs_frame_t result;
+
+	// sequence, five analog channels and the digital channel
+	CHECK(parse("N0CALL>APRS:!4808.22N/01134.56E[Comment |ss1122334455#!|", &result));
+	CHECK(strcmp(result.comment, "Comment") == 0);
+	CHECK(result.telemetry.seq == ('s' - '!') * 92);
+	CHECK(result.telemetry.n_analog == 5);
+	CHECK(result.telemetry.analog[0] == ('1' - '!') * 92);
+	CHECK(result.telemetry.analog[4] == ('5' - '!') * 92);
+	CHECK(result.telemetry.has_digital);
+	CHECK(result.telemetry.digital == 2 * 91);
+
+	// block in the middle of the comment, one channel
+	CHECK(parse("N0CALL>APRS:!4808.22N/01134.56E[abc |!KLk| def", &result));
+	CHECK(strcmp(result.comment, "abc def") == 0);
+	CHECK(result.telemetry.seq == 42);
+	CHECK(result.telemetry.n_analog == 1);
+	CHECK(result.telemetry.analog[0] == 3987);
+	CHECK(!result.telemetry.has_digital);
+
+	// invalid blocks are kept in the comment
+	static const char *invalid[] = {
+		"N0CALL>APRS:!4808.22N/01134.56E[|!K|",           // no channel
+		"N0CALL>APRS:!4808.22N/01134.56E[|!KLkL|",        // odd length
+		"N0CALL>APRS:!4808.22N/01134.56E[|!KLk !!|",      // invalid character
+		"N0CALL>APRS:!4808.22N/01134.56E[|!KLk",          // not terminated
+		"N0CALL>APRS:!4808.22N/01134.56E[|!!!!!!!!!!!!!!!!|", // too long
+	};
+
+	for(size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+		CHECK(parse(invalid[i], &result));
+		CHECK(result.telemetry.n_analog == 0);
+		CHECK(strchr(result.comment, '|') != NULL);
+	}
+
+	// a bar in front of the block
+	CHECK(parse("N0CALL>APRS:!4808.22N/01134.56E[a|b |!KLk|", &result));
+	CHECK(result.telemetry.n_analog == 1);
+	CHECK(strcmp(result.comment, "a|b") == 0);
+
+	// no telemetry
+	CHECK(parse("N0CALL>APRS:!4808.22N/01134.56E[", &result));
+	CHECK(result.telemetry.n_analog == 0);
+}
+
+static void test_round_trip(void)
+{
+	static const uint32_t flag_sets[] = {
+		APRS_FLAG_TELEMETRY,
+		APRS_FLAG_TELEMETRY | APRS_FLAG_COMPRESS_LOCATION,
+		APRS_FLAG_TELEMETRY | APRS_FLAG_MIC_E | APRS_FLAG_ADD_ALTITUDE,
+		APRS_FLAG_TELEMETRY | APRS_FLAG_ADD_DAO | APRS_FLAG_ADD_ALTITUDE,
+	};
+
+	uint8_t frame[APRS_MAX_FRAME_LEN];
+	aprs_frame_t result;
+	aprs_args_t args;
+
+	for(size_t f = 0; f < sizeof(flag_sets) / sizeof(flag_sets[0]); f++) {
+		for(uint32_t i = 0; i < 200; i++) {
+			setup(flag_sets[f] | APRS_FLAG_ADD_WEATHER);
+			aprs_set_comment("hello");
+			init_args(&args, true);
+
+			args.frame_id = i * 997;
+			args.vbat_millivolt = 3000 + i * 7;
+			args.temperature_celsius = -40.0f + i * 0.43f;
+			args.humidity_rH = i * 0.5f;
+			args.pressure_hPa = 850.0f + i * 1.37f;
+
+			size_t len = aprs_build_frame(frame, &args, PACKET_TYPE_POSITION);
+			CHECK(aprs_parse_frame(frame, len, &result));
+
+			// apply the EQNS scaling
+			const aprs_telemetry_t *tlm = &result.telemetry;
+
+			CHECK(tlm->n_analog == 4);
+			CHECK(tlm->seq == args.frame_id % 8281);
+			CHECK(tlm->analog[0] == args.vbat_millivolt);
+			CHECK(fabsf(tlm->analog[1] * 0.1f - 50.0f - args.temperature_celsius) <= 0.051f);
+			CHECK(fabsf(tlm->analog[2] * 0.1f - args.humidity_rH) <= 0.051f);
+			CHECK(fabsf(tlm->analog[3] * 0.1f + 300.0f - args.pressure_hPa) <= 0.051f);
+			// the telemetry is removed from the comment
+			CHECK(strchr(result.comment, '|') == NULL);
+		}
+	}
+}
+
+static void test_byte_count(void)
+{
+	uint8_t frame[APRS_MAX_FRAME_LEN];
+	aprs_args_t args;
+	size_t pos_len, wx_len, tlm_len;
+
+	// readable: frame counter and Vbat in the position, separate weather report
+	setup(APRS_FLAG_ADD_FRAME_COUNTER | APRS_FLAG_ADD_VBAT | APRS_FLAG_ADD_WEATHER);
+	init_args(&args, true);
+	pos_len = aprs_build_frame(frame, &args, PACKET_TYPE_POSITION);
+	wx_len = aprs_build_frame(frame, &args, PACKET_TYPE_WX);
+
+	// telemetry: all values in the position report
+	setup(APRS_FLAG_TELEMETRY | APRS_FLAG_ADD_WEATHER);
+	init_args(&args, true);
+	tlm_len = aprs_build_frame(frame, &args, PACKET_TYPE_POSITION);
+
+	printf("readable:  position %3zu B %5u ms + weather %3zu B %5u ms\n",
+			pos_len, lora_toa_ms(&LORA_MODULATION_APRS, pos_len),
+			wx_len, lora_toa_ms(&LORA_MODULATION_APRS, wx_len));
+	printf("telemetry: position %3zu B %5u ms\n",
+			tlm_len, lora_toa_ms(&LORA_MODULATION_APRS, tlm_len));
+
+	CHECK(tlm_len < pos_len + wx_len);
+	CHECK(lora_toa_ms(&LORA_MODULATION_APRS, tlm_len) < lora_toa_ms(&LORA_MODULATION_APRS, pos_len) + lora_toa_ms(&LORA_MODULATION_APRS, wx_len));
+
+	// without weather data, the telemetry is not longer than "#42 3.98V"
+	setup(APRS_FLAG_ADD_FRAME_COUNTER | APRS_FLAG_ADD_VBAT);
+	init_args(&args, false);
+	pos_len = aprs_build_frame(frame, &args, PACKET_TYPE_POSITION);
+
+	setup(APRS_FLAG_TELEMETRY);
+	tlm_len = aprs_build_frame(frame, &args, PACKET_TYPE_POSITION);
+
+	printf("frame counter + Vbat: readable %zu B, telemetry %zu B\n", pos_len, tlm_len);
+	CHECK(tlm_len < pos_len);
+}
+
+int main(void)
+{
+	test_encode();
+	test_definitions();
+	test_decode();
+	test_round_trip();
+	test_byte_count();
+
+	if(m_failed) {
+		fprintf(stderr, "test_aprs_telemetry: %d checks failed.\n", m_failed);
+		return 1;
+	}
+
+	printf("test_aprs_telemetry: all checks passed.\n");
+	return 0;
+}
@@ -0,0 +1,337 @@
+/*
+ * Host-side test for the tracks of the stations in the RX history.
+ *
+ * Random tracks, including jumps around the globe, crossings of the
+ * antimeridian and positions close to the poles, are compared with the points
+ * that were added, rounded to the 1e-5° resolution of the delta encoding. The
+ * pool is filled beyond its size to check that the least recently updated
+ * tracks are dropped, and speed and course are compared with the distance
+ * and direction of the added points.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "aprs.h"
+#include "aprs_track.h"
+#include "utils.h"
+
+static int m_failed;
+
+#define CHECK(cond) do { \
+	if(!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		m_failed++; \
+	} \
+} while(0)
+
+uint64_t time_base_get(void)
+{
+	return 0;
+}
+
+static uint32_t m_rng_state = 0x12345678;
+
+static uint32_t rng(void)
+{
+	// xorshift32
+	m_rng_state ^= m_rng_state << 13;
+	m_rng_state ^= m_rng_state >> 17;
+	m_rng_state ^= m_rng_state << 5;
+	return m_rng_state;
+}
+
+/* Random value from -max to max. */
+static float rnd(float max)
+{
+	return ((float)(rng() % 20001) - 10000.0f) * 1e-4f * max;
+}
+
+static float wrap_lon(float lon)
+{
+	return (lon >= 180.0f) ? lon - 360.0f : (lon < -180.0f) ? lon + 360.0f : lon;
+}
+
+/* Position in units of 1e-5°, longitudes from -180° to below 180°. */
+static int32_t units(float deg)
+{
+	return (int32_t)lround((double)deg * 1e5);
+}
+
+static int32_t lon_units(float lon)
+{
+	int32_t u = units(lon);
+
+	return (u >= 18000000) ? u - 36000000 : u;
+}
+
+/* The points added to one station, newest first. */
+static aprs_track_point_t m_expected[APRS_TRACK_MAX_POINTS];
+static uint16_t m_num_expected;
+
+static void expect_point(uint64_t timestamp, float lat, float lon)
+{
+	if(m_num_expected < APRS_TRACK_MAX_POINTS) {
+		m_num_expected++;
+	}
+
+	memmove(m_expected + 1, m_expected, (m_num_expected - 1) * sizeof(m_expected[0]));
+
+	m_expected[0].timestamp = timestamp;
+	m_expected[0].lat = lat;
+	m_expected[0].lon = lon;
+}
+
+static void check_track(uint16_t idx)
+{
+	aprs_track_point_t points[APRS_TRACK_MAX_POINTS + 1];
+	uint16_t n = aprs_track_get(idx, points, APRS_TRACK_MAX_POINTS + 1);
+
+	CHECK(n == m_num_expected);
+
+	for(uint16_t i = 0; i < n && i < m_num_expected; i++) {
+		if(points[i].timestamp != m_expected[i].timestamp
+				|| units(points[i].lat) != units(m_expected[i].lat)
+				|| lon_units(points[i].lon) != lon_units(m_expected[i].lon)) {
+			fprintf(stderr, "point %u: %llu %.5f %.5f, expected %llu %.5f %.5f\n", i,
+					(unsigned long long)points[i].timestamp, points[i].lat, points[i].lon,
+					(unsigned long long)m_expected[i].timestamp, m_expected[i].lat, m_expected[i].lon);
+			m_failed++;
+			return;
+		}
+	}
+
+	// fewer points requested
+	if(n > 2) {
+		CHECK(aprs_track_get(idx, points, 2) == 2);
+		CHECK(points[1].timestamp == m_expected[1].timestamp);
+	}
+}
+
+/* One station moving in steps of random size, also across the antimeridian
+ * and close to the poles. */
+static void test_encoding(void)
+{
+	static const float max_step[] = {0.0f, 0.0003f, 0.01f, 0.5f, 20.0f, 180.0f};
+	float lat = 0.0f, lon = 0.0f;
+	uint64_t timestamp = 1700000000;
+
+	aprs_track_init();
+	m_num_expected = 0;
+
+	CHECK(aprs_track_get(7, m_expected, APRS_TRACK_MAX_POINTS) == 0);
+
+	for(int i = 0; i < 20000 && !m_failed; i++) {
+		if(i % 1000 == 0) {
+			// start from a corner of the map
+			static const float start[][2] = {
+				{49.72f, 11.05f}, {-17.8f, 179.999f}, {89.999f, 0.0f}, {-89.999f, -179.99f},
+				{0.0f, -180.0f}, {51.48f, -0.00001f}};
+
+			lat = start[(i / 1000) % 6][0];
+			lon = start[(i / 1000) % 6][1];
+		} else {
+			float step = max_step[rng() % 6];
+
+			lat += rnd(step);
+			lon = wrap_lon(lon + rnd(step));
+			lat = (lat > 90.0f) ? 90.0f : (lat < -90.0f) ? -90.0f : lat;
+		}
+
+		// mostly regular beacons, sometimes long gaps or the same second
+		timestamp += (rng() % 8 == 0) ? rng() % 100000 : (rng() % 4 == 0) ? 0 : 60;
+
+		aprs_track_add(7, lat, lon, timestamp);
+		expect_point(timestamp, lat, lon);
+		check_track(7);
+	}
+
+	CHECK(aprs_track_get_stats()->num_tracks == 1);
+	CHECK(aprs_track_get_stats()->num_points == APRS_TRACK_MAX_POINTS);
+
+	// time going backwards starts a new track
+	aprs_track_add(7, 10.0f, 20.0f, timestamp - 1);
+	m_num_expected = 0;
+	expect_point(timestamp - 1, 10.0f, 20.0f);
+	check_track(7);
+
+	aprs_track_remove(7);
+	CHECK(aprs_track_get(7, m_expected, APRS_TRACK_MAX_POINTS) == 0);
+	CHECK(aprs_track_get_stats()->num_tracks == 0);
+	CHECK(aprs_track_get_stats()->pool_used == 0);
+}
+
+static void test_motion(void)
+{
+	float speed, course;
+	float lat = 49.0f, lon = 11.0f;
+
+	aprs_track_init();
+
+	aprs_track_add(1, lat, lon, 1000);
+	CHECK(!aprs_track_get_motion(1, &speed, &course));
+
+	// 20 m/s to the north-east, with points rounded to 1e-5°
+	for(int i = 1; i <= 20; i++) {
+		float next_lat = lat + 1200.0f / 111195.0f * 0.7071f;
+		float next_lon = lon + 1200.0f / (111195.0f * cosf(lat * 3.14159265f / 180.0f)) * 0.7071f;
+
+		aprs_track_add(1, next_lat, next_lon, 1000 + i * 60);
+
+		float distance = great_circle_distance_m(lat, lon, next_lat, next_lon);
+
+		CHECK(aprs_track_get_motion(1, &speed, &course));
+		CHECK(fabsf(speed - distance / 60.0f) < 0.05f);
+		CHECK(fabsf(speed - 20.0f) < 0.1f);
+		CHECK(fabsf(course - direction_angle(lat, lon, next_lat, next_lon)) < 0.1f);
+		CHECK(fabsf(course - 45.0f) < 0.5f);
+
+		lat = next_lat;
+		lon = next_lon;
+	}
+
+	// steps of 850 m and 60 s take 5 bytes
+	CHECK(aprs_track_get_stats()->pool_used < 7 * APRS_TRACK_MAX_POINTS);
+
+	printf("motion: %u points of a car at 20 m/s with a beacon every 60 s in %u bytes\n",
+			aprs_track_get_stats()->num_points, aprs_track_get_stats()->pool_used);
+
+	// a second report at the same time keeps the motion
+	aprs_track_add(1, lat, lon, 1000 + 20 * 60);
+	CHECK(aprs_track_get_motion(1, &speed, &course) && fabsf(speed - 20.0f) < 0.1f && course > 0.0f);
+
+	// parked: no course
+	aprs_track_add(1, lat + 0.00005f, lon, 1000 + 21 * 60);
+	CHECK(aprs_track_get_motion(1, &speed, &course) && speed < 0.2f && course < 0.0f);
+
+	// heading west across the antimeridian
+	aprs_track_add(2, -17.8f, -179.999f, 1000);
+	aprs_track_add(2, -17.8f, 179.995f, 1100);
+	CHECK(aprs_track_get_motion(2, &speed, &course));
+	CHECK(fabsf(speed - 6.0f * 1.0598f) < 0.1f);
+	CHECK(fabsf(course - 270.0f) < 0.5f);
+
+	// too long ago for a speed
+	aprs_track_add(2, -17.7f, 179.995f, 1100 + APRS_TRACK_MAX_INTERVAL_S + 1);
+	CHECK(!aprs_track_get_motion(2, &speed, &course));
+
+	CHECK(!aprs_track_get_motion(3, &speed, &course));
+	CHECK(!aprs_track_get_motion(APRS_RX_HISTORY_SIZE, &speed, &course));
+}
+
+/* Fill the pool with more tracks than it holds. The least recently updated
+ * tracks must be dropped, the others must be complete. */
+static void test_pool(void)
+{
+	static uint64_t last_update[APRS_RX_HISTORY_SIZE];
+	const aprs_track_stats_t *stats = aprs_track_get_stats();
+	aprs_track_point_t points[APRS_TRACK_MAX_POINTS];
+	uint64_t timestamp = 1700000000;
+
+	aprs_track_init();
+	memset(last_update, 0, sizeof(last_update));
+
+	for(int i = 0; i < 50000 && !m_failed; i++) {
+		// some stations are updated more often
+		uint16_t idx = (rng() % 2) ? rng() % 16 : rng() % APRS_RX_HISTORY_SIZE;
+
+		timestamp += rng() % 30;
+
+		aprs_track_add(idx, 49.0f + rnd(1.0f), 11.0f + rnd(1.0f), timestamp);
+		last_update[idx] = timestamp;
+
+		if(rng() % 100 == 0) {
+			idx = rng() % APRS_RX_HISTORY_SIZE;
+			aprs_track_remove(idx);
+			last_update[idx] = 0;
+		}
+
+		CHECK(stats->pool_used <= APRS_TRACK_POOL_SIZE);
+	}
+
+	// tracks are dropped in the order of their last update
+	uint64_t newest_dropped = 0;
+	uint64_t oldest_kept = UINT64_MAX;
+	uint32_t num_tracks = 0, num_points = 0;
+
+	for(uint16_t idx = 0; idx < APRS_RX_HISTORY_SIZE; idx++) {
+		uint16_t n = aprs_track_get(idx, points, APRS_TRACK_MAX_POINTS);
+
+		if(n == 0 && last_update[idx] > newest_dropped) {
+			newest_dropped = last_update[idx];
+		} else if(n > 0) {
+			CHECK(points[0].timestamp == last_update[idx]);
+			oldest_kept = (last_update[idx] < oldest_kept) ? last_update[idx] : oldest_kept;
+			num_tracks++;
+			num_points += n;
+		}
+	}
+
+	CHECK(newest_dropped <= oldest_kept);
+	CHECK(stats->evictions > 0 && stats->compactions > 0);
+	CHECK(stats->num_tracks == num_tracks && stats->num_points == num_points);
+	CHECK(stats->pool_used > APRS_TRACK_POOL_SIZE * 3 / 4);
+
+	printf("pool: %u tracks with %u points in %u bytes, %.1f B/point including the headers\n",
+			stats->num_tracks, stats->num_points, stats->pool_used,
+			(float)stats->pool_used / stats->num_points);
+}
+
+/* Tracks are maintained by the RX history. */
+static void test_history(void)
+{
+	aprs_frame_t frame;
+	aprs_rx_raw_data_t raw = {0};
+	aprs_track_point_t points[APRS_TRACK_MAX_POINTS];
+
+	aprs_init();
+
+	memset(&frame, 0, sizeof(frame));
+	strcpy(frame.source, "DL1ABC-9");
+	frame.lat = 49.5f;
+	frame.lon = -11.0f;
+
+	uint16_t idx = aprs_rx_history_insert(&frame, &raw, 1000, APRS_RX_HISTORY_SIZE);
+
+	frame.lat = 49.51f;
+	CHECK(aprs_rx_history_insert(&frame, &raw, 1060, APRS_RX_HISTORY_SIZE) == idx);
+
+	// a frame without position does not add a point
+	frame.lat = 0.0f;
+	frame.lon = 0.0f;
+	CHECK(aprs_rx_history_insert(&frame, &raw, 1120, APRS_RX_HISTORY_SIZE) == idx);
+
+	CHECK(aprs_track_get(idx, points, APRS_TRACK_MAX_POINTS) == 2);
+	CHECK(points[0].timestamp == 1060 && fabsf(points[0].lat - 49.51f) < 1e-5f);
+	CHECK(points[1].timestamp == 1000 && fabsf(points[1].lon + 11.0f) < 1e-5f);
+
+	// the station is replaced, so is its track
+	for(uint32_t i = 0; i < APRS_RX_HISTORY_SIZE; i++) {
+		snprintf(frame.source, sizeof(frame.source), "DB%uAB", i);
+		frame.lat = 49.0f;
+		frame.lon = 11.0f;
+		aprs_rx_history_insert(&frame, &raw, 2000 + i, APRS_RX_HISTORY_SIZE);
+	}
+
+	CHECK(aprs_rx_history_get(idx)->source_call != aprs_call_pack("DL1ABC-9"));
+	CHECK(aprs_track_get(idx, points, APRS_TRACK_MAX_POINTS) == 1);
+	CHECK(points[0].timestamp == aprs_rx_history_get(idx)->rx_timestamp);
+}
+
+int main(void)
+{
+	test_encoding();
+	test_motion();
+	test_pool();
+	test_history();
+
+	if(m_failed) {
+		fprintf(stderr, "test_aprs_track: %d checks failed.\n", m_failed);
+		return 1;
+	}
+
+	printf("test_aprs_track: all checks passed.\n");
+	return 0;
+}
@@ -0,0 +1,355 @@
+/*
+ * Host-side test for the CASIC binary protocol decoder.
+ *
+ * The binary corpus is generated from the NMEA corpus (see gen_casic_corpus.c),
+ * so both streams are replayed the same way as gps_loop() processes them and
+ * the reported epochs must contain the same data.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "nmea_rx.h"
+#include "nmea.h"
+#include "casic_rx.h"
+#include "casic.h"
+#include "gps_epoch.h"
+
+#define MAX_STREAM_SIZE  65536
+#define MAX_EPOCHS       256
+
+static int m_failed;
+
+#define CHECK(cond) do { \
+	if(!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		m_failed++; \
+	} \
+} while(0)
+
+typedef struct {
+	nmea_data_t data;
+	gps_epoch_t epoch;
+
+	nmea_data_t events[MAX_EPOCHS];
+	size_t      num_events;
+
+	uint32_t    checksum_errors;
+} replay_t;
+
+static replay_t m_nmea;
+static replay_t m_casic;
+
+static void add_event(replay_t *r)
+{
+	if(r->num_events < MAX_EPOCHS) {
+		r->events[r->num_events] = r->data;
+	}
+	r->num_events++;
+}
+
+static void cb_sentence(const nmea_sentence_t *sentence)
+{
+	if(gps_epoch_begin_sentence(&m_nmea.epoch, sentence)) {
+		add_event(&m_nmea);
+	}
+
+	if(nmea_parse_sentence(sentence, NULL, &m_nmea.data) == NRF_SUCCESS) {
+		gps_epoch_end_sentence(&m_nmea.epoch);
+	}
+}
+
+static void cb_frame(const casic_frame_t *frame)
+{
+	if(!frame->valid) {
+		m_casic.checksum_errors++;
+		return;
+	}
+
+	if(gps_epoch_begin_frame(&m_casic.epoch, frame)) {
+		add_event(&m_casic);
+	}
+
+	if(casic_parse_frame(frame, NULL, &m_casic.data) == NRF_SUCCESS) {
+		gps_epoch_end_sentence(&m_casic.epoch);
+	}
+}
+
+static void replay_init(replay_t *r)
+{
+	memset(r, 0, sizeof(*r));
+	gps_epoch_init(&r->epoch);
+}
+
+static void replay_nmea(const uint8_t *data, size_t len)
+{
+	nmea_rx_t rx;
+
+	replay_init(&m_nmea);
+	nmea_rx_init(&rx, cb_sentence);
+	nmea_rx_feed(&rx, data, len);
+}
+
+static casic_rx_t m_rx;
+
+static void replay_casic(const uint8_t *data, size_t len, size_t chunk_size)
+{
+	replay_init(&m_casic);
+	casic_rx_init(&m_rx, cb_frame);
+
+	for(size_t pos = 0; pos < len; pos += chunk_size) {
+		size_t n = (len - pos < chunk_size) ? len - pos : chunk_size;
+		casic_rx_feed(&m_rx, data + pos, n);
+	}
+}
+
+static void test_build_frame(void)
+{
+	uint8_t buf[32];
+
+	// CFG-MSG enabling NAV-PV at every fix
+	static const uint8_t expected[] = {
+		0xBA, 0xCE, 0x04, 0x00, 0x06, 0x01,
+		0x01, 0x03, 0x01, 0x00,
+		0x05, 0x03, 0x07, 0x01};
+
+	CHECK(casic_build_cfg_msg(buf, sizeof(buf), CASIC_CLASS_NAV, CASIC_ID_NAV_PV, 1) == sizeof(expected));
+	CHECK(memcmp(buf, expected, sizeof(expected)) == 0);
+
+	// buffer too small, invalid payload length
+	CHECK(casic_build_cfg_msg(buf, 13, CASIC_CLASS_NAV, CASIC_ID_NAV_PV, 1) == 0);
+	CHECK(casic_build_frame(buf, sizeof(buf), CASIC_CLASS_NAV, CASIC_ID_NAV_PV, buf, 3) == 0);
+
+	// decode it again
+	casic_frame_t frame;
+	size_t consumed;
+
+	casic_frame_init(&frame);
+	CHECK(casic_frame_append(&frame, expected, sizeof(expected), &consumed) == CASIC_FRAME_COMPLETE);
+	CHECK(consumed == sizeof(expected));
+	CHECK(frame.valid);
+	CHECK(frame.cls == CASIC_CLASS_CFG && frame.id == CASIC_ID_CFG_MSG && frame.len == 4);
+}
+
+/* NAV-GPSINFO assembled by hand from the documented layout, with a different
+ * value in every field of the satellite blocks, so the fields cannot be
+ * confused with their neighbours (the corpus is generated with the same
+ * offsets as the decoder and cannot detect that). */
+static void test_satinfo_layout(void)
+{
+	static const uint8_t gpsinfo[] = {
+		0xBA, 0xCE, 0x20, 0x00, 0x01, 0x20,
+		0x40, 0xE2, 0x01, 0x00,   // runTime 123456 ms
+		0x02, 0x01, 0x00, 0x00,   // numViewSv 2, numFixSv 1, system, res
+		// chn 0, svid 5, flags, quI 7, cn0 42, elev 35, azim 275, prRes 0.5
+		0x00, 0x05, 0x0D, 0x07, 0x2A, 0x23, 0x13, 0x01, 0x00, 0x00, 0x00, 0x3F,
+		// chn 1, svid 13, flags, quI 1, cn0 0 (not tracked), elev 10, azim 46, prRes 0
+		0x01, 0x0D, 0x01, 0x01, 0x00, 0x0A, 0x2E, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x8D, 0x22, 0x52, 0x68};
+
+	casic_frame_t frame;
+	nmea_data_t data;
+	size_t consumed;
+
+	memset(&data, 0, sizeof(data));
+	casic_frame_init(&frame);
+	CHECK(casic_frame_append(&frame, gpsinfo, sizeof(gpsinfo), &consumed) == CASIC_FRAME_COMPLETE);
+	CHECK(frame.valid);
+	CHECK(casic_parse_frame(&frame, NULL, &data) == NRF_SUCCESS);
+
+	CHECK(data.sat_info_count_gps == 2);
+	CHECK(data.sat_info_gps[0].sat_id == 5 && data.sat_info_gps[0].snr == 42);
+	CHECK(data.sat_info_gps[1].sat_id == 13 && data.sat_info_gps[1].snr == -1);
+}
+
+/* NAV-BDSINFO with more satellites than are stored: the frame is received
+ * completely, the checksum covers the whole payload and the leading
+ * satellites are decoded. */
+static void test_satinfo_long(void)
+{
+	enum { NUM_SV = 40 };
+	static const size_t chunk_sizes[] = {1, 7, 32, 1024};
+	uint8_t payload[8 + 12 * NUM_SV];
+	uint8_t buf[CASIC_FRAME_OVERHEAD + sizeof(payload)];
+
+	memset(payload, 0, sizeof(payload));
+	payload[4] = NUM_SV;
+
+	for(uint8_t i = 0; i < NUM_SV; i++) {
+		payload[8 + 12 * i + 1] = 100 + i; // svid
+		payload[8 + 12 * i + 4] = 20 + i;  // cn0
+	}
+
+	size_t frame_len = casic_build_frame(buf, sizeof(buf), CASIC_CLASS_NAV, CASIC_ID_NAV_BDSINFO,
+			payload, sizeof(payload));
+
+	CHECK(frame_len == sizeof(buf));
+
+	for(size_t c = 0; c < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]); c++) {
+		casic_frame_t frame;
+		nmea_data_t data;
+		casic_frame_status_t status = CASIC_FRAME_INCOMPLETE;
+		size_t pos = 0;
+
+		memset(&data, 0, sizeof(data));
+		casic_frame_init(&frame);
+
+		while(pos < frame_len && status == CASIC_FRAME_INCOMPLETE) {
+			size_t n = (frame_len - pos < chunk_sizes[c]) ? frame_len - pos : chunk_sizes[c];
+			size_t consumed;
+
+			status = casic_frame_append(&frame, buf + pos, n, &consumed);
+			pos += consumed;
+		}
+
+		CHECK(status == CASIC_FRAME_COMPLETE && pos == frame_len);
+		CHECK(frame.valid && frame.len == sizeof(payload));
+		CHECK(casic_parse_frame(&frame, NULL, &data) == NRF_SUCCESS);
+
+		CHECK(data.sat_info_count_beidou == CASIC_MAX_SAT_INFO);
+		CHECK(data.sat_info_beidou[0].sat_id == 100 && data.sat_info_beidou[0].snr == 20);
+		CHECK(data.sat_info_beidou[CASIC_MAX_SAT_INFO - 1].sat_id == 100 + CASIC_MAX_SAT_INFO - 1);
+	}
+
+	// a corrupted byte in the part that is not stored is still detected
+	casic_frame_t frame;
+	size_t consumed;
+
+	buf[frame_len - 8] ^= 0x10;
+	casic_frame_init(&frame);
+	CHECK(casic_frame_append(&frame, buf, frame_len, &consumed) == CASIC_FRAME_COMPLETE);
+	CHECK(!frame.valid);
+}
+
+static void test_compare(const uint8_t *nmea, size_t nmea_len, const uint8_t *bin, size_t bin_len)
+{
+	replay_nmea(nmea, nmea_len);
+
+	static const size_t chunk_sizes[] = {1, 7, 32, 65536};
+
+	for(size_t c = 0; c < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]); c++) {
+		replay_casic(bin, bin_len, chunk_sizes[c]);
+
+		CHECK(m_casic.checksum_errors == 0);
+		CHECK(m_rx.frames_dropped == 0);
+		CHECK(m_casic.num_events == m_nmea.num_events);
+		CHECK(m_casic.num_events == 9);
+
+		for(size_t i = 0; i < m_casic.num_events && i < MAX_EPOCHS; i++) {
+			const nmea_data_t *n = &m_nmea.events[i];
+			const nmea_data_t *b = &m_casic.events[i];
+
+			CHECK(b->pos_valid == n->pos_valid);
+			CHECK(b->lat_e7 == n->lat_e7);
+			CHECK(b->lon_e7 == n->lon_e7);
+			CHECK(fabsf(b->altitude - n->altitude) < 0.01f);
+			CHECK(b->speed_heading_valid == n->speed_heading_valid);
+			CHECK(fabsf(b->speed - n->speed) < 0.001f);
+			CHECK(fabsf(b->heading - n->heading) < 0.001f);
+			CHECK(fabsf(b->hdop - n->hdop) < 0.001f);
+			CHECK(b->datetime_valid == n->datetime_valid);
+			CHECK(b->datetime.date_y == n->datetime.date_y);
+			CHECK(b->datetime.date_m == n->datetime.date_m);
+			CHECK(b->datetime.date_d == n->datetime.date_d);
+			CHECK(b->datetime.time_h == n->datetime.time_h);
+			CHECK(b->datetime.time_m == n->datetime.time_m);
+			CHECK(b->datetime.time_s == n->datetime.time_s);
+			CHECK(b->sat_info_count_gps == n->sat_info_count_gps);
+			CHECK(b->sat_info_count_glonass == n->sat_info_count_glonass);
+			CHECK(memcmp(b->sat_info_gps, n->sat_info_gps,
+						n->sat_info_count_gps * sizeof(nmea_sat_info_t)) == 0);
+
+			CHECK(b->fix_info[0].sys_id == NMEA_SYS_ID_GPS);
+			CHECK(b->fix_info[0].sats_used == n->fix_info[0].sats_used);
+			CHECK(b->fix_info[0].fix_type == n->fix_info[0].fix_type);
+		}
+	}
+
+	printf("  %zu epochs: %zu bytes NMEA, %zu bytes CASIC binary.\n",
+			m_casic.num_events, nmea_len, bin_len);
+}
+
+static void test_corrupted(const uint8_t *bin, size_t bin_len)
+{
+	static uint8_t stream[MAX_STREAM_SIZE];
+	static const char text[] = "$GNTXT,01,01,01,NOISE*00\r\n\xBA\x00";
+
+	// NMEA text and a false sync byte before the binary data are skipped
+	memcpy(stream, text, sizeof(text) - 1);
+	memcpy(stream + sizeof(text) - 1, bin, bin_len);
+
+	replay_casic(stream, bin_len + sizeof(text) - 1, 32);
+	CHECK(m_casic.num_events == 9);
+	CHECK(m_casic.checksum_errors == 0);
+
+	// a flipped payload bit is detected by the checksum
+	memcpy(stream, bin, bin_len);
+	stream[20] ^= 0x01;
+
+	replay_casic(stream, bin_len, 32);
+	CHECK(m_casic.checksum_errors == 1);
+	CHECK(m_casic.num_events == 9);
+
+	// an invalid length is dropped and the decoder resynchronizes
+	memcpy(stream, bin, bin_len);
+	stream[2] = 0xFF;
+
+	replay_casic(stream, bin_len, 32);
+	CHECK(m_rx.frames_dropped == 1);
+	CHECK(m_casic.num_events == 9);
+
+	// a truncated payload is rejected by the parser
+	casic_frame_t frame;
+	uint8_t buf[32];
+	size_t consumed;
+	size_t len = casic_build_frame(buf, sizeof(buf), CASIC_CLASS_NAV, CASIC_ID_NAV_PV, buf, 8);
+
+	casic_frame_init(&frame);
+	CHECK(casic_frame_append(&frame, buf, len, &consumed) == CASIC_FRAME_COMPLETE);
+	CHECK(frame.valid);
+	CHECK(casic_parse_frame(&frame, NULL, &m_casic.data) == NRF_ERROR_INVALID_DATA);
+}
+
+static size_t read_file(const char *filename, uint8_t *buf, size_t buf_len)
+{
+	FILE *f = fopen(filename, "rb");
+	if(!f) {
+		perror(filename);
+		exit(2);
+	}
+
+	size_t len = fread(buf, 1, buf_len, f);
+	fclose(f);
+
+	return len;
+}
+
+int main(int argc, char **argv)
+{
+	static uint8_t nmea[MAX_STREAM_SIZE];
+	static uint8_t bin[MAX_STREAM_SIZE];
+
+	if(argc < 3) {
+		fprintf(stderr, "usage: %s <recorded nmea stream> <casic binary stream>\n", argv[0]);
+		return 2;
+	}
+
+	size_t nmea_len = read_file(argv[1], nmea, sizeof(nmea));
+	size_t bin_len = read_file(argv[2], bin, sizeof(bin));
+
+	test_build_frame();
+	test_satinfo_layout();
+	test_satinfo_long();
+	test_compare(nmea, nmea_len, bin, bin_len);
+	test_corrupted(bin, bin_len);
+
+	if(m_failed) {
+		fprintf(stderr, "%d checks failed.\n", m_failed);
+		return 1;
+	}
+
+	printf("test_casic: all checks passed.\n");
+	return 0;
+}
@@ -0,0 +1,163 @@
+/*
+ * Host-side test for the epoch assembler.
+ *
+ * A recorded NMEA stream is replayed the same way as gps_loop() processes it.
+ * Exactly one event must be generated per epoch, and the reported data must
+ * belong to a single fix (i.e. position, speed and time from the same epoch).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "nmea_rx.h"
+#include "nmea.h"
+#include "gps_epoch.h"
+
+#define MAX_STREAM_SIZE  65536
+#define MAX_EPOCHS       256
+
+static int m_failed;
+
+#define CHECK(cond) do { \
+	if(!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		m_failed++; \
+	} \
+} while(0)
+
+static nmea_data_t m_nmea_data;
+static gps_epoch_t m_epoch;
+
+static nmea_data_t m_events[MAX_EPOCHS];
+static size_t      m_num_events;
+
+static size_t      m_num_position_updates;
+
+static void cb_sentence(const nmea_sentence_t *sentence)
+{
+	if(gps_epoch_begin_sentence(&m_epoch, sentence)) {
+		if(m_num_events < MAX_EPOCHS) {
+			m_events[m_num_events] = m_nmea_data;
+		}
+		m_num_events++;
+	}
+
+	bool position_updated = false;
+	if(nmea_parse_sentence(sentence, &position_updated, &m_nmea_data) == NRF_SUCCESS) {
+		gps_epoch_end_sentence(&m_epoch);
+	}
+
+	if(position_updated) {
+		m_num_position_updates++;
+	}
+}
+
+static void replay(const uint8_t *data, size_t len)
+{
+	nmea_rx_t rx;
+
+	memset(&m_nmea_data, 0, sizeof(m_nmea_data));
+	gps_epoch_init(&m_epoch);
+
+	m_num_events = 0;
+	m_num_position_updates = 0;
+
+	nmea_rx_init(&rx, cb_sentence);
+	nmea_rx_feed(&rx, data, len);
+}
+
+static void test_recorded_stream(const uint8_t *stream, size_t stream_len)
+{
+	replay(stream, stream_len);
+
+	// the recording contains 10 epochs. The last one is reported when the
+	// next epoch begins, which is not part of the recording.
+	CHECK(m_num_events == 9);
+	CHECK(m_epoch.epochs_completed == 9);
+
+	printf("  %zu epochs reported, previously %zu position updates.\n",
+			m_num_events, m_num_position_updates);
+
+	for(size_t i = 0; i < m_num_events && i < MAX_EPOCHS; i++) {
+		const nmea_data_t *d = &m_events[i];
+
+		// see the generator of the recording: epoch i has time 12:34:(10+i)
+		// and a speed of (i%4).(i%10) knots.
+		float expected_speed = ((i % 4) + (i % 10) / 10.0f) * 0.5144444f;
+
+		CHECK(d->pos_valid);
+		CHECK(d->speed_heading_valid);
+		CHECK(d->datetime_valid);
+		CHECK(d->datetime.time_s == 10 + i);
+		CHECK(fabsf(d->speed - expected_speed) < 0.01f);
+		CHECK(fabsf(d->lat - 49.058353f) < 0.0001f);
+		CHECK(d->sat_info_count_gps == 10);
+		CHECK(d->sat_info_count_glonass == 3);
+	}
+}
+
+static void test_no_fix(void)
+{
+	static const char stream[] =
+		"$GNGGA,,,,,,0,00,25.5,,,,,,*64\r\n"
+		"$GNRMC,,V,,,,,,,,,,N,V*37\r\n"
+		"$GNGGA,,,,,,0,00,25.5,,,,,,*64\r\n"
+		"$GNRMC,,V,,,,,,,,,,N,V*37\r\n"
+		"$GNGGA,000001.000,,,,,0,00,25.5,,,,,,*7B\r\n"
+		"$GNRMC,000001.000,V,,,,,,,,,,N,V*28\r\n"
+		"$GNGGA,000002.000,,,,,0,00,25.5,,,,,,*78\r\n"
+		"$GNRMC,000002.000,V,,,,,,,,,,N,V*2B\r\n"
+		"$GNGGA,000003.000,,,,,0,00,25.5,,,,,,*79\r\n";
+
+	replay((const uint8_t*)stream, strlen(stream));
+
+	// sentences without time do not start an epoch
+	CHECK(m_num_events == 2);
+	CHECK(!m_events[0].pos_valid);
+}
+
+static void test_corrupted_time(void)
+{
+	static const char stream[] =
+		"$GNGGA,000001.000,,,,,0,00,25.5,,,,,,*7B\r\n"
+		"$GNRMC,000001.000,V,,,,,,,,,,N,V*28\r\n"
+		"$GNZDA,00x002.000,01,01,2026,00,00*00\r\n"   // garbage time
+		"$GNGGA,000002.000,,,,,0,00,25.5,,,,,,*78\r\n";
+
+	replay((const uint8_t*)stream, strlen(stream));
+
+	CHECK(m_num_events == 1);
+}
+
+int main(int argc, char **argv)
+{
+	static uint8_t stream[MAX_STREAM_SIZE];
+
+	if(argc < 2) {
+		fprintf(stderr, "usage: %s <recorded nmea stream>\n", argv[0]);
+		return 2;
+	}
+
+	FILE *f = fopen(argv[1], "rb");
+	if(!f) {
+		perror(argv[1]);
+		return 2;
+	}
+
+	size_t stream_len = fread(stream, 1, sizeof(stream), f);
+	fclose(f);
+
+	test_recorded_stream(stream, stream_len);
+	test_no_fix();
+	test_corrupted_time();
+
+	if(m_failed) {
+		fprintf(stderr, "%d checks failed.\n", m_failed);
+		return 1;
+	}
+
+	printf("test_gps_epoch: all checks passed.\n");
+	return 0;
+}
@@ -0,0 +1,292 @@
+/*
+ * Host-side test for the GNSS output profiles: command generation and the
+ * profile state machine.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "nmea.h"
+#include "casic.h"
+#include "gps_profile.h"
+
+static int m_failed;
+
+#define CHECK(cond) do { \
+	if(!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		m_failed++; \
+	} \
+} while(0)
+
+/**@brief Split the command buffer into lines and validate each of them.
+ * @returns The number of valid lines, or -1 if an invalid line was found.
+ */
+static int check_command_lines(const char *cmd, char lines[][GPS_PROFILE_CMD_MAX_LEN], int max_lines)
+{
+	int n = 0;
+	const char *start = cmd;
+	const char *end;
+
+	while((end = strchr(start, '\n')) != NULL) {
+		size_t len = end - start + 1;
+
+		if(n >= max_lines || len >= GPS_PROFILE_CMD_MAX_LEN) {
+			return -1;
+		}
+
+		memcpy(lines[n], start, len);
+		lines[n][len] = '\0';
+
+		if(!nmea_check_sentence(lines[n])) {
+			fprintf(stderr, "invalid command: %s", lines[n]);
+			return -1;
+		}
+
+		n++;
+		start = end + 1;
+	}
+
+	if(*start != '\0') {
+		return -1; // trailing data without line end
+	}
+
+	return n;
+}
+
+static void test_build_sentence(void)
+{
+	char buf[32];
+
+	// known commands from the CASIC documentation
+	CHECK(nmea_build_sentence(buf, sizeof(buf), "PCAS10,2") == 14);
+	CHECK(strcmp(buf, "$PCAS10,2*1E\r\n") == 0);
+
+	CHECK(nmea_build_sentence(buf, sizeof(buf), "PCAS02,1000") == 17);
+	CHECK(strcmp(buf, "$PCAS02,1000*2E\r\n") == 0);
+
+	// buffer too small: "$PCAS10,2*1E\r\n" needs 15 bytes including NUL
+	CHECK(nmea_build_sentence(buf, 14, "PCAS10,2") == 0);
+	CHECK(nmea_build_sentence(buf, 15, "PCAS10,2") == 14);
+}
+
+static void test_check_sentence(void)
+{
+	CHECK(nmea_check_sentence("$PCAS10,2*1E\r\n"));
+	CHECK(nmea_check_sentence("$PCAS10,2*1e\n"));
+	CHECK(nmea_check_sentence("$PCAS03,1,0,1,1,1,0,0,0,0,0,,,0,0,,,,0*32\r\n"));
+
+	CHECK(!nmea_check_sentence("$PCAS10,2*1F\r\n"));   // wrong checksum
+	CHECK(!nmea_check_sentence("$PCAS10,2\r\n"));      // no checksum
+	CHECK(!nmea_check_sentence("$PCAS10,2*1E"));       // no line end
+	CHECK(!nmea_check_sentence("PCAS10,2*1E\r\n"));    // no '$'
+	CHECK(!nmea_check_sentence("$PCAS10,2*1E\r\n$"));  // more than one sentence
+}
+
+static void test_profile_commands(void)
+{
+	char cmd[GPS_PROFILE_CMD_MAX_LEN];
+	char lines[4][GPS_PROFILE_CMD_MAX_LEN];
+
+	for(gps_profile_t p = 0; p < GPS_NUM_PROFILES; p++) {
+		size_t len = gps_profile_build_command(p, cmd, sizeof(cmd));
+
+		CHECK(len > 0);
+		CHECK(len == strlen(cmd));
+		CHECK(check_command_lines(cmd, lines, 4) == 2);
+		CHECK(strncmp(lines[0], "$PCAS02,1000*", 13) == 0);
+		CHECK(strncmp(lines[1], "$PCAS03,", 8) == 0);
+	}
+
+	// the status profile is the configuration used before profiles were introduced
+	gps_profile_build_command(GPS_PROFILE_STATUS, cmd, sizeof(cmd));
+	CHECK(check_command_lines(cmd, lines, 4) == 2);
+	CHECK(strcmp(lines[1], "$PCAS03,1,0,1,1,1,0,0,0,0,0,,,0,0,,,,0*32\r\n") == 0);
+
+	// tracker: GGA and RMC only
+	gps_profile_build_command(GPS_PROFILE_TRACKER, cmd, sizeof(cmd));
+	CHECK(check_command_lines(cmd, lines, 4) == 2);
+	CHECK(strncmp(lines[1], "$PCAS03,1,0,0,0,1,0,0,0,0,0,,,0,0,,,,0*", 39) == 0);
+
+	CHECK(gps_profile_reports_satellites(GPS_PROFILE_STATUS));
+	CHECK(!gps_profile_reports_satellites(GPS_PROFILE_TRACKER));
+	CHECK(!gps_profile_reports_satellites(GPS_PROFILE_WARMUP));
+
+	// invalid profile and short buffer
+	CHECK(gps_profile_build_command(GPS_PROFILE_NONE, cmd, sizeof(cmd)) == 0);
+	CHECK(gps_profile_build_command(GPS_PROFILE_STATUS, cmd, 30) == 0);
+}
+
+static void test_profile_commands_casic(void)
+{
+	uint8_t cmd[GPS_PROFILE_CMD_MAX_LEN];
+	size_t len = gps_profile_build_command_casic(GPS_PROFILE_TRACKER, cmd, sizeof(cmd));
+
+	CHECK(len > 0);
+
+	// two NMEA sentences: fix interval and all sentences disabled
+	const uint8_t *p = cmd;
+	for(int i = 0; i < 2; i++) {
+		const uint8_t *eol = memchr(p, '\n', cmd + len - p);
+		char line[GPS_PROFILE_CMD_MAX_LEN];
+
+		CHECK(eol != NULL);
+		if(!eol) {
+			return;
+		}
+
+		memcpy(line, p, eol - p + 1);
+		line[eol - p + 1] = '\0';
+		CHECK(nmea_check_sentence(line));
+
+		p = eol + 1;
+	}
+
+	// followed by CFG-MSG frames: PV and TIMEUTC enabled, the rest disabled
+	static const uint8_t expected[][3] = {
+		{CASIC_ID_NAV_PV, 1}, {CASIC_ID_NAV_TIMEUTC, 1}, {CASIC_ID_NAV_DOP, 0},
+		{CASIC_ID_NAV_GPSINFO, 0}, {CASIC_ID_NAV_BDSINFO, 0}, {CASIC_ID_NAV_GLNINFO, 0}};
+
+	for(size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+		casic_frame_t frame;
+		size_t consumed;
+
+		casic_frame_init(&frame);
+		CHECK(casic_frame_append(&frame, p, cmd + len - p, &consumed) == CASIC_FRAME_COMPLETE);
+		CHECK(frame.valid);
+		CHECK(frame.cls == CASIC_CLASS_CFG && frame.id == CASIC_ID_CFG_MSG);
+		CHECK(frame.payload[0] == CASIC_CLASS_NAV);
+		CHECK(frame.payload[1] == expected[i][0]);
+		CHECK(frame.payload[2] == expected[i][1]);
+
+		p += consumed;
+	}
+
+	CHECK(p == cmd + len);
+
+	CHECK(gps_profile_build_command_casic(GPS_PROFILE_NONE, cmd, sizeof(cmd)) == 0);
+	CHECK(gps_profile_build_command_casic(GPS_PROFILE_STATUS, cmd, 100) == 0);
+}
+
+static void test_select(void)
+{
+	CHECK(gps_profile_select(true,  true)  == GPS_PROFILE_STATUS);
+	CHECK(gps_profile_select(true,  false) == GPS_PROFILE_STATUS);
+	CHECK(gps_profile_select(false, true)  == GPS_PROFILE_TRACKER);
+	CHECK(gps_profile_select(false, false) == GPS_PROFILE_WARMUP);
+}
+
+static void test_fsm(void)
+{
+	gps_profile_fsm_t fsm;
+	gps_profile_t p;
+
+	gps_profile_fsm_init(&fsm, GPS_PROFILE_TRACKER);
+
+	// nothing is sent before the module is ready
+	gps_profile_fsm_power_on(&fsm);
+	CHECK(!gps_profile_fsm_poll(&fsm, &p));
+
+	gps_profile_fsm_module_ready(&fsm);
+	CHECK(gps_profile_fsm_poll(&fsm, &p));
+	CHECK(p == GPS_PROFILE_TRACKER);
+
+	// busy until the transmission is done
+	CHECK(!gps_profile_fsm_poll(&fsm, &p));
+	gps_profile_fsm_tx_done(&fsm);
+
+	// no change -> nothing to send
+	gps_profile_fsm_request(&fsm, GPS_PROFILE_TRACKER);
+	CHECK(!gps_profile_fsm_poll(&fsm, &p));
+
+	// switching to the status screen and back
+	gps_profile_fsm_request(&fsm, GPS_PROFILE_STATUS);
+	CHECK(gps_profile_fsm_poll(&fsm, &p));
+	CHECK(p == GPS_PROFILE_STATUS);
+
+	// requests during a transmission are sent afterwards; intermediate
+	// requests are skipped.
+	gps_profile_fsm_request(&fsm, GPS_PROFILE_WARMUP);
+	gps_profile_fsm_request(&fsm, GPS_PROFILE_TRACKER);
+	CHECK(!gps_profile_fsm_poll(&fsm, &p));
+	gps_profile_fsm_tx_done(&fsm);
+	CHECK(gps_profile_fsm_poll(&fsm, &p));
+	CHECK(p == GPS_PROFILE_TRACKER);
+
+	// a failed transmission is repeated
+	gps_profile_fsm_tx_failed(&fsm);
+	CHECK(gps_profile_fsm_poll(&fsm, &p));
+	CHECK(p == GPS_PROFILE_TRACKER);
+	gps_profile_fsm_tx_done(&fsm);
+	CHECK(!gps_profile_fsm_poll(&fsm, &p));
+
+	// invalid requests are ignored
+	gps_profile_fsm_request(&fsm, GPS_PROFILE_NONE);
+	CHECK(!gps_profile_fsm_poll(&fsm, &p));
+
+	// after a power cycle, the profile is sent again once the module is ready
+	gps_profile_fsm_power_on(&fsm);
+	CHECK(!gps_profile_fsm_poll(&fsm, &p));
+	gps_profile_fsm_module_ready(&fsm);
+	CHECK(gps_profile_fsm_poll(&fsm, &p));
+	CHECK(p == GPS_PROFILE_TRACKER);
+	gps_profile_fsm_tx_done(&fsm);
+
+	CHECK(fsm.switches == 5);
+}
+
+static void test_fsm_restart(void)
+{
+	gps_profile_fsm_t fsm;
+	gps_profile_t p;
+
+	gps_profile_fsm_init(&fsm, GPS_PROFILE_TRACKER);
+	gps_profile_fsm_power_on(&fsm);
+	gps_profile_fsm_module_ready(&fsm);
+
+	// a restart requested during a profile transmission waits for it
+	CHECK(gps_profile_fsm_poll(&fsm, &p));
+	gps_profile_fsm_request_restart(&fsm);
+	CHECK(!gps_profile_fsm_poll_restart(&fsm));
+	gps_profile_fsm_tx_done(&fsm);
+	CHECK(gps_profile_fsm_poll_restart(&fsm));
+	CHECK(!gps_profile_fsm_poll_restart(&fsm));
+
+	// no profile is sent while the restart command is transmitted
+	gps_profile_fsm_request(&fsm, GPS_PROFILE_STATUS);
+	CHECK(!gps_profile_fsm_poll(&fsm, &p));
+	gps_profile_fsm_tx_done(&fsm);
+	CHECK(gps_profile_fsm_poll(&fsm, &p));
+	CHECK(p == GPS_PROFILE_STATUS);
+	gps_profile_fsm_tx_done(&fsm);
+
+	// the profile is kept by the module, so it is not sent again
+	gps_profile_fsm_request_restart(&fsm);
+	CHECK(gps_profile_fsm_poll_restart(&fsm));
+	gps_profile_fsm_tx_done(&fsm);
+	CHECK(!gps_profile_fsm_poll(&fsm, &p));
+
+	// a pending restart is dropped by a power cycle
+	gps_profile_fsm_request_restart(&fsm);
+	gps_profile_fsm_power_on(&fsm);
+	CHECK(!gps_profile_fsm_poll_restart(&fsm));
+}
+
+int main(void)
+{
+	test_build_sentence();
+	test_check_sentence();
+	test_profile_commands();
+	test_profile_commands_casic();
+	test_select();
+	test_fsm();
+	test_fsm_restart();
+
+	if(m_failed) {
+		fprintf(stderr, "test_gps_profile: %d checks failed.\n", m_failed);
+		return 1;
+	}
+
+	printf("test_gps_profile: all checks passed.\n");
+	return 0;
+}
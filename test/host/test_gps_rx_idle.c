@@ -0,0 +1,302 @@
+/*
+ * Host-side timing simulation of the GNSS UART reception.
+ *
+ * A recorded NMEA stream is sent at 9600 baud in one burst per second, with
+ * short random pauses between the sentences. The simulation models the two
+ * DMA buffers of GPS_RX_CHUNK_SIZE bytes, the RXDRDY byte counter with its
+ * compare interrupt, the idle timer and the abort of a transfer, during which
+ * arriving bytes are lost. gps_rx_idle decides when to start the timer and
+ * when to abort, as in gps.c. Single bursts shorter than a buffer are
+ * simulated as well.
+ *
+ * All bytes must be delivered in order and within a bounded time, no transfer
+ * may be aborted while bytes arrive, and each burst may only cause one wakeup
+ * per full buffer plus a few to flush the last one.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gps_rx_idle.h"
+
+#define MAX_STREAM_SIZE  262144
+
+#define BYTE_TIME_US     1042   // 10 bits at 9600 baud
+#define RESTART_US        200   // from the abort until the reception runs again
+
+// the last byte of a burst is delivered within this time
+#define MAX_LATENCY_US   ((GPS_RX_CHUNK_TIMEOUT_MS + GPS_RX_IDLE_TIMEOUT_MS + 2) * 1000)
+
+static int m_failed;
+
+#define CHECK(cond) do { \
+	if(!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		m_failed++; \
+	} \
+} while(0)
+
+static uint32_t m_rng_state = 0x12345678;
+
+static uint32_t rng(void)
+{
+	// xorshift32
+	m_rng_state ^= m_rng_state << 13;
+	m_rng_state ^= m_rng_state >> 17;
+	m_rng_state ^= m_rng_state << 5;
+	return m_rng_state;
+}
+
+typedef struct {
+	gps_rx_idle_t idle;
+
+	uint32_t byte_count;         // RXDRDY counter
+	uint32_t compare;            // compare value of the counter, 0 if disabled
+	uint8_t  buffer[GPS_RX_CHUNK_SIZE];
+	size_t   fill;
+	uint64_t stopped_until;      // reception restarts after an abort
+	uint64_t timer_deadline;     // 0 if the idle timer is not running
+	uint64_t last_byte;          // arrival of the last received byte
+
+	uint8_t  out[MAX_STREAM_SIZE];
+	size_t   out_len;
+	uint64_t max_latency;
+
+	uint32_t wakeups;
+	uint32_t aborts;
+	uint32_t aborts_while_active;
+	uint32_t bytes_lost;
+} sim_t;
+
+static sim_t m_sim;
+
+static uint8_t  m_stream[MAX_STREAM_SIZE];
+static uint64_t m_arrival[MAX_STREAM_SIZE];
+
+/* Counter interrupt or late first byte, as in rx_activity(). */
+static void activity(sim_t *sim, uint64_t now)
+{
+	sim->compare = 0;
+	sim->timer_deadline = now + GPS_RX_CHUNK_TIMEOUT_MS * 1000;
+}
+
+/* As in rx_wait_for_activity(). */
+static void wait_for_activity(sim_t *sim, uint64_t now)
+{
+	sim->compare = gps_rx_idle_wake_count(&sim->idle);
+
+	if(gps_rx_idle_pending(&sim->idle, sim->byte_count)) {
+		activity(sim, now);
+	}
+}
+
+/* RX_DONE: the buffer is passed on, as in cb_uarte(). */
+static void transfer_done(sim_t *sim, uint64_t now)
+{
+	sim->wakeups++;
+
+	memcpy(sim->out + sim->out_len, sim->buffer, sim->fill);
+
+	for(size_t i = 0; i < sim->fill; i++) {
+		uint64_t latency = now - m_arrival[sim->out_len + i];
+
+		if(latency > sim->max_latency) {
+			sim->max_latency = latency;
+		}
+	}
+
+	sim->out_len += sim->fill;
+
+	if(gps_rx_idle_transfer_done(&sim->idle, sim->fill, sim->byte_count)) {
+		sim->timer_deadline = now + GPS_RX_CHUNK_TIMEOUT_MS * 1000;
+	} else {
+		wait_for_activity(sim, now);
+	}
+
+	sim->fill = 0;
+}
+
+/* Idle timer expired, as in cb_rx_idle_timer(). */
+static void timer_expired(sim_t *sim, uint64_t now, uint64_t next_byte)
+{
+	sim->wakeups++;
+	sim->timer_deadline = 0;
+
+	switch(gps_rx_idle_timeout(&sim->idle, sim->byte_count)) {
+		case GPS_RX_IDLE_WAIT:
+			wait_for_activity(sim, now);
+			break;
+
+		case GPS_RX_IDLE_RECHECK:
+			sim->timer_deadline = now + GPS_RX_IDLE_TIMEOUT_MS * 1000;
+			break;
+
+		case GPS_RX_IDLE_ABORT:
+			sim->aborts++;
+
+			// a byte was received just now or is about to arrive
+			if(now - sim->last_byte < BYTE_TIME_US || next_byte - now < RESTART_US + BYTE_TIME_US) {
+				sim->aborts_while_active++;
+			}
+
+			sim->stopped_until = now + RESTART_US;
+			transfer_done(sim, now);
+			break;
+	}
+}
+
+static void run_timers(sim_t *sim, uint64_t until, uint64_t next_byte)
+{
+	while(sim->timer_deadline != 0 && sim->timer_deadline <= until) {
+		timer_expired(sim, sim->timer_deadline, next_byte);
+	}
+}
+
+static void byte_received(sim_t *sim, uint64_t now, uint8_t c)
+{
+	if(now < sim->stopped_until) {
+		sim->bytes_lost++;
+		return;
+	}
+
+	sim->byte_count++;
+	sim->last_byte = now;
+
+	if(sim->compare != 0 && sim->byte_count == sim->compare) {
+		sim->wakeups++;
+		activity(sim, now);
+	}
+	sim->buffer[sim->fill++] = c;
+
+	if(sim->fill == GPS_RX_CHUNK_SIZE) {
+		transfer_done(sim, now);
+	}
+}
+
+/* Schedule the stream: a new burst every second, starting with each GGA
+ * sentence, and 0 to max_pause_us between the sentences of a burst. */
+static size_t schedule(const uint8_t *data, size_t len, uint32_t max_pause_us)
+{
+	uint64_t t = 1000000;
+	size_t num_bursts = 0;
+
+	for(size_t i = 0; i < len; i++) {
+		bool line_start = (data[i] == '$');
+
+		if(line_start && i + 6 <= len && memcmp(&data[i + 3], "GGA", 3) == 0) {
+			num_bursts++;
+			t = num_bursts * 1000000ULL;
+		} else if(line_start && max_pause_us > 0) {
+			t += rng() % max_pause_us;
+		}
+
+		m_stream[i] = data[i];
+		m_arrival[i] = t;
+		t += BYTE_TIME_US;
+	}
+
+	return num_bursts;
+}
+
+/* Run the scheduled stream through the simulation and check the result. */
+static void simulate(size_t len, size_t num_bursts)
+{
+	sim_t *sim = &m_sim;
+
+	memset(sim, 0, sizeof(*sim));
+	gps_rx_idle_init(&sim->idle);
+	wait_for_activity(sim, 0); // gps_power_on()
+
+	for(size_t i = 0; i < len; i++) {
+		run_timers(sim, m_arrival[i], m_arrival[i]);
+		byte_received(sim, m_arrival[i], m_stream[i]);
+	}
+
+	run_timers(sim, UINT64_MAX, UINT64_MAX);
+
+	CHECK(sim->bytes_lost == 0);
+	CHECK(sim->aborts_while_active == 0);
+	CHECK(sim->out_len == len && memcmp(sim->out, m_stream, len) == 0);
+	CHECK(sim->max_latency <= MAX_LATENCY_US);
+
+	// the counter interrupt, one wakeup per full buffer, at most two timer
+	// wakeups and the aborted transfer per burst
+	CHECK(sim->wakeups <= len / GPS_RX_CHUNK_SIZE + 4 * num_bursts);
+}
+
+static void test_stream(const uint8_t *data, size_t len, uint32_t max_pause_us)
+{
+	sim_t *sim = &m_sim;
+	size_t num_bursts = schedule(data, len, max_pause_us);
+
+	simulate(len, num_bursts);
+
+	printf("  pauses up to %4u us: %zu bytes in %zu bursts, %u wakeups (%u aborts), max. latency %llu ms\n",
+			max_pause_us, len, num_bursts, sim->wakeups, sim->aborts,
+			(unsigned long long)(sim->max_latency / 1000));
+}
+
+/* Single bursts of 1 to 2 buffers (e.g. a CASIC ACK or a lone sentence), each
+ * after a long pause. Those shorter than a buffer must be flushed as well. */
+static void test_short_bursts(void)
+{
+	sim_t *sim = &m_sim;
+	size_t len = 0;
+	size_t num_bursts = 0;
+
+	for(size_t burst_len = 1; burst_len <= 2 * GPS_RX_CHUNK_SIZE; burst_len++) {
+		num_bursts++;
+
+		for(size_t i = 0; i < burst_len; i++) {
+			m_stream[len] = rng();
+			m_arrival[len] = num_bursts * 1000000ULL + i * BYTE_TIME_US;
+			len++;
+		}
+	}
+
+	simulate(len, num_bursts);
+
+	printf("  short bursts: %zu bytes in %zu bursts, %u wakeups (%u aborts), max. latency %llu ms\n",
+			len, num_bursts, sim->wakeups, sim->aborts,
+			(unsigned long long)(sim->max_latency / 1000));
+}
+
+static size_t read_file(const char *path, uint8_t *buf, size_t size)
+{
+	FILE *f = fopen(path, "rb");
+
+	if(!f) {
+		perror(path);
+		exit(1);
+	}
+
+	size_t len = fread(buf, 1, size, f);
+	fclose(f);
+	return len;
+}
+
+int main(int argc, char **argv)
+{
+	static uint8_t stream[MAX_STREAM_SIZE];
+
+	if(argc != 2) {
+		fprintf(stderr, "usage: %s <nmea file>\n", argv[0]);
+		return 1;
+	}
+
+	size_t len = read_file(argv[1], stream, sizeof(stream));
+
+	test_stream(stream, len, 0);
+	test_stream(stream, len, 1000);
+	test_stream(stream, len, 2 * BYTE_TIME_US);
+	test_short_bursts();
+
+	if(m_failed) {
+		fprintf(stderr, "test_gps_rx_idle: %d checks failed.\n", m_failed);
+		return 1;
+	}
+
+	printf("test_gps_rx_idle: all checks passed.\n");
+	return 0;
+}
@@ -0,0 +1,262 @@
+/*
+ * Host-side test for the NMEA parser.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "nmea.h"
+
+static int m_failed;
+
+#define CHECK(cond) do { \
+	if(!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		m_failed++; \
+	} \
+} while(0)
+
+static ret_code_t parse(const char *sentence, bool *position_updated, nmea_data_t *data)
+{
+	char buf[128];
+
+	strcpy(buf, sentence);
+	return nmea_parse(buf, position_updated, data);
+}
+
+/**@brief Build a complete sentence including the checksum from the given body.
+ */
+static void build_sentence(char *buf, size_t buf_len, const char *body)
+{
+	uint8_t checksum = 0;
+
+	for(const char *p = body; *p; p++) {
+		checksum ^= (uint8_t)*p;
+	}
+
+	snprintf(buf, buf_len, "$%s*%02X\r\n", body, checksum);
+}
+
+/**@brief Reference: the float-based coordinate conversion used before the
+ * fixed-point parser.
+ */
+static float coord_to_float_reference(const char *token)
+{
+	const char *dot = strchr(token, '.');
+	size_t degrees_len = (dot - token) - 2;
+
+	float minutes = strtof(token + degrees_len, NULL);
+
+	char degstr[4];
+	strncpy(degstr, token, degrees_len);
+	degstr[degrees_len] = '\0';
+
+	return (float)strtol(degstr, NULL, 10) + minutes / 60.0f;
+}
+
+/**@brief Format a coordinate in NMEA format with the given number of decimals
+ * of the minutes.
+ */
+static void format_coord(char *buf, size_t buf_len, double deg, int deg_digits, int decimals)
+{
+	double absdeg = fabs(deg);
+	int d = (int)absdeg;
+	double minutes = (absdeg - d) * 60.0;
+
+	// avoid rounding up to 60.000
+	double max_minutes = 60.0 - pow(10.0, -decimals);
+	if(minutes > max_minutes) {
+		minutes = max_minutes;
+	}
+
+	snprintf(buf, buf_len, "%0*d%0*.*f", deg_digits, d, decimals + 3, decimals, minutes);
+}
+
+/**@brief Exact value of an NMEA coordinate string in 1e-7 degrees.
+ */
+static double coord_exact_e7(const char *token, int deg_digits)
+{
+	char degstr[4];
+	memcpy(degstr, token, deg_digits);
+	degstr[deg_digits] = '\0';
+
+	return (atof(degstr) + atof(token + deg_digits) / 60.0) * 1e7;
+}
+
+static void test_coordinate_roundtrip(void)
+{
+	nmea_data_t data;
+	memset(&data, 0, sizeof(data));
+
+	double max_err_fixed = 0.0, max_err_float = 0.0;
+
+	srand(42);
+
+	for(int i = 0; i < 100000; i++) {
+		char lat_str[16], lon_str[16], body[96], sentence[128];
+
+		double lat = ((double)rand() / RAND_MAX) * 179.9 - 89.95;
+		double lon = ((double)rand() / RAND_MAX) * 359.9 - 179.95;
+		int decimals = 4 + (i % 3); // 4 to 6 decimals of minutes
+
+		format_coord(lat_str, sizeof(lat_str), lat, 2, decimals);
+		format_coord(lon_str, sizeof(lon_str), lon, 3, decimals);
+
+		snprintf(body, sizeof(body), "GNGGA,123410.000,%s,%c,%s,%c,1,09,1.1,124.5,M,47.9,M,,",
+				lat_str, lat < 0 ? 'S' : 'N', lon_str, lon < 0 ? 'W' : 'E');
+		build_sentence(sentence, sizeof(sentence), body);
+
+		CHECK(parse(sentence, NULL, &data) == NRF_SUCCESS);
+		CHECK(data.pos_valid);
+
+		double lat_exact = coord_exact_e7(lat_str, 2) * (lat < 0 ? -1 : 1);
+		double lon_exact = coord_exact_e7(lon_str, 3) * (lon < 0 ? -1 : 1);
+
+		double err = fmax(fabs(data.lat_e7 - lat_exact), fabs(data.lon_e7 - lon_exact));
+		if(err > max_err_fixed) {
+			max_err_fixed = err;
+		}
+
+		err = fmax(fabs(coord_to_float_reference(lat_str) * 1e7 - fabs(lat_exact)),
+		           fabs(coord_to_float_reference(lon_str) * 1e7 - fabs(lon_exact)));
+		if(err > max_err_float) {
+			max_err_float = err;
+		}
+	}
+
+	printf("  max. coordinate error: fixed-point %.2f, float %.2f (units of 1e-7 deg)\n",
+			max_err_fixed, max_err_float);
+
+	// rounded to the nearest unit
+	CHECK(max_err_fixed <= 0.5 + 1e-6);
+}
+
+static void test_number_formats(void)
+{
+	nmea_data_t data;
+	memset(&data, 0, sizeof(data));
+
+	// negative altitude, DOPs without leading digit
+	CHECK(parse("$GNGGA,123410.000,0000.0000,S,00000.0000,W,1,09,1.1,-12.3,M,47.9,M,,*56\r\n", NULL, &data) == NRF_SUCCESS);
+	CHECK(data.pos_valid);
+	CHECK(data.lat_e7 == 0 && data.lon_e7 == 0);
+	CHECK(fabsf(data.altitude + 12.3f) < 0.001f);
+
+	CHECK(parse("$GNGSA,A,3,01,03,,,,,,,,,,,.95,0.5,10,1*15\r\n", NULL, &data) == NRF_SUCCESS);
+	CHECK(fabsf(data.pdop - 0.95f) < 0.001f);
+	CHECK(fabsf(data.hdop - 0.5f) < 0.001f);
+	CHECK(fabsf(data.vdop - 10.0f) < 0.001f);
+
+	// invalid coordinates
+	CHECK(parse("$GNGGA,123410.000,49x3.5012,N,00824.1139,E,1,09,1.1,124.5,M,47.9,M,,*02\r\n", NULL, &data) == NRF_SUCCESS);
+	CHECK(!data.pos_valid);
+
+	CHECK(parse("$GNGGA,123410.000,4963.5012,N,00824.1139,E,1,09,1.1,124.5,M,47.9,M,,*4C\r\n", NULL, &data) == NRF_SUCCESS);
+	CHECK(!data.pos_valid);
+
+	// no fix
+	CHECK(parse("$GNGGA,,,,,,0,00,25.5,,,,,,*64\r\n", NULL, &data) == NRF_SUCCESS);
+	CHECK(!data.pos_valid);
+}
+
+static void test_satellite_systems(void)
+{
+	nmea_data_t data;
+	memset(&data, 0, sizeof(data));
+
+	CHECK(parse("$GAGSV,1,1,02,03,45,120,33,05,30,200,,7*74\r\n", NULL, &data) == NRF_SUCCESS);
+	CHECK(data.sat_info_count_galileo == 2);
+	CHECK(data.sat_info_galileo[0].sat_id == 3);
+	CHECK(data.sat_info_galileo[0].snr == 33);
+	CHECK(data.sat_info_galileo[1].snr == -1);
+
+	// BeiDou is reported with both the old and the new talker ID
+	CHECK(parse("$BDGSV,1,1,03,06,45,120,30,09,30,200,28,16,10,010,,0*45\r\n", NULL, &data) == NRF_SUCCESS);
+	CHECK(data.sat_info_count_beidou == 3);
+	CHECK(data.sat_info_beidou[1].sat_id == 9);
+	CHECK(data.sat_info_beidou[1].snr == 28);
+
+	CHECK(parse("$GBGSV,1,1,01,21,45,120,30,0*44\r\n", NULL, &data) == NRF_SUCCESS);
+	CHECK(data.sat_info_count_beidou == 1);
+	CHECK(data.sat_info_beidou[0].sat_id == 21);
+
+	CHECK(parse("$GQGSV,1,1,01,02,80,100,40,0*5A\r\n", NULL, &data) == NRF_SUCCESS);
+	CHECK(data.sat_info_count_qzss == 1);
+	CHECK(data.sat_info_qzss[0].snr == 40);
+
+	// other systems are not affected
+	CHECK(data.sat_info_count_gps == 0);
+	CHECK(data.sat_info_count_glonass == 0);
+
+	// GSA with NMEA 4.1 system ID (3 = Galileo)
+	CHECK(parse("$GNGSA,A,3,01,03,,,,,,,,,,,2.0,1.0,1.7,3*34\r\n", NULL, &data) == NRF_SUCCESS);
+	CHECK(data.fix_info[0].sys_id == NMEA_SYS_ID_GALILEO);
+	CHECK(data.fix_info[0].sats_used == 2);
+	CHECK(data.fix_info[0].fix_type == NMEA_FIX_TYPE_3D);
+}
+
+static void test_speed_and_time(void)
+{
+	nmea_data_t data;
+	bool position_updated;
+
+	memset(&data, 0, sizeof(data));
+
+	// RMC is accepted from a single-system talker as well
+	CHECK(parse("$GPRMC,083559.00,A,4717.11437,N,00833.91522,E,0.004,77.52,091202,,,A*57\r\n", &position_updated, &data) == NRF_SUCCESS);
+	CHECK(position_updated);
+	CHECK(data.speed_heading_valid);
+	CHECK(fabsf(data.heading - 77.52f) < 0.001f);
+	CHECK(data.datetime_valid);
+	CHECK(data.datetime.date_y == 2002);
+	CHECK(data.datetime.time_h == 8 && data.datetime.time_m == 35 && data.datetime.time_s == 59);
+
+	CHECK(parse("$GNVTG,77.52,T,,M,10.0,N,18.5,K,A*19\r\n", &position_updated, &data) == NRF_SUCCESS);
+	CHECK(!position_updated);
+	CHECK(fabsf(data.speed - 5.144444f) < 0.001f);
+
+	// ZDA provides the full year
+	CHECK(parse("$GNZDA,201530.00,04,07,2026,00,00*78\r\n", NULL, &data) == NRF_SUCCESS);
+	CHECK(data.datetime_valid);
+	CHECK(data.datetime.date_y == 2026 && data.datetime.date_m == 7 && data.datetime.date_d == 4);
+	CHECK(data.datetime.time_h == 20 && data.datetime.time_m == 15 && data.datetime.time_s == 30);
+
+	// the module's default date before time is known is ignored
+	CHECK(parse("$GNZDA,000012.00,06,01,1980,00,00*7C\r\n", NULL, &data) == NRF_SUCCESS);
+	CHECK(data.datetime.date_y == 2026);
+}
+
+static void test_errors(void)
+{
+	nmea_data_t data;
+	memset(&data, 0, sizeof(data));
+
+	// broken checksum
+	CHECK(parse("$GQGSV,1,1,01,02,80,100,40,0*5B\r\n", NULL, &data) == NRF_ERROR_INVALID_DATA);
+	CHECK(data.sat_info_count_qzss == 0);
+
+	// no checksum
+	CHECK(parse("$GQGSV,1,1,01,02,80,100,40,0\r\n", NULL, &data) == NRF_ERROR_INVALID_DATA);
+
+	// proprietary sentences are ignored
+	CHECK(parse("$PCAS03,1,0,1,1,1,0,0,0,0,0,,,0,0,,,,0*32\r\n", NULL, &data) == NRF_SUCCESS);
+}
+
+int main(void)
+{
+	test_coordinate_roundtrip();
+	test_number_formats();
+	test_satellite_systems();
+	test_speed_and_time();
+	test_errors();
+
+	if(m_failed) {
+		fprintf(stderr, "%d checks failed.\n", m_failed);
+		return 1;
+	}
+
+	printf("test_nmea: all checks passed.\n");
+	return 0;
+}
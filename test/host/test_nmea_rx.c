@@ -0,0 +1,236 @@
+/*
+ * Host-side test for the NMEA line splitter.
+ *
+ * A recorded NMEA byte stream is fed through nmea_rx in chunks of random size
+ * (simulating DMA transfers that end at arbitrary positions) and the resulting
+ * lines are compared against the lines of the recording.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nmea_rx.h"
+
+#define MAX_STREAM_SIZE  65536
+#define MAX_LINES        1024
+
+static int m_failed;
+
+#define CHECK(cond) do { \
+	if(!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		m_failed++; \
+	} \
+} while(0)
+
+static char   m_lines[MAX_LINES][NMEA_MAX_SENTENCE_LEN + 2];
+static bool   m_valid[MAX_LINES];
+static size_t m_num_lines;
+
+/**@brief Restore the original line from an indexed sentence.
+ */
+static void sentence_to_line(const nmea_sentence_t *sentence, char *line)
+{
+	for(uint8_t i = 0; i < sentence->len; i++) {
+		char c = sentence->text[i];
+
+		if(c == '\0') {
+			c = (i + 1 == sentence->checksum_offset) ? '*' : ',';
+		}
+
+		line[i] = c;
+	}
+
+	strcpy(line + sentence->len, "\r\n");
+}
+
+static void cb_sentence(const nmea_sentence_t *sentence)
+{
+	if(m_num_lines < MAX_LINES) {
+		CHECK(sentence->text[sentence->len] == '\0');
+		sentence_to_line(sentence, m_lines[m_num_lines]);
+		m_valid[m_num_lines] = sentence->valid;
+	}
+
+	m_num_lines++;
+}
+
+static void feed_chunked(nmea_rx_t *rx, const uint8_t *data, size_t len, size_t max_chunk)
+{
+	size_t pos = 0;
+
+	while(pos < len) {
+		size_t chunk = 1 + (size_t)rand() % max_chunk;
+
+		if(chunk > len - pos) {
+			chunk = len - pos;
+		}
+
+		nmea_rx_feed(rx, data + pos, chunk);
+		pos += chunk;
+	}
+}
+
+static void test_recorded_stream(const uint8_t *stream, size_t stream_len)
+{
+	static const size_t max_chunks[] = {1, 7, 32, 64, 1000};
+
+	// count expected lines
+	size_t expected = 0;
+	for(size_t i = 0; i < stream_len; i++) {
+		if(stream[i] == '\n') {
+			expected++;
+		}
+	}
+
+	for(size_t k = 0; k < sizeof(max_chunks)/sizeof(max_chunks[0]); k++) {
+		nmea_rx_t rx;
+
+		m_num_lines = 0;
+		nmea_rx_init(&rx, cb_sentence);
+
+		feed_chunked(&rx, stream, stream_len, max_chunks[k]);
+
+		CHECK(m_num_lines == expected);
+		CHECK(rx.rx_lines == expected);
+		CHECK(rx.rx_bytes == stream_len);
+		CHECK(rx.lines_dropped == 0);
+
+		// compare the lines with the recording
+		const char *p = (const char*)stream;
+		for(size_t i = 0; i < m_num_lines && i < MAX_LINES; i++) {
+			const char *eol = strchr(p, '\n');
+			size_t len = (size_t)(eol - p + 1);
+
+			CHECK(strlen(m_lines[i]) == len);
+			CHECK(memcmp(m_lines[i], p, len) == 0);
+			CHECK(m_valid[i]);
+
+			p = eol + 1;
+		}
+	}
+}
+
+static void test_garbage_and_restart(void)
+{
+	nmea_rx_t rx;
+	const char *input =
+		"\x00\xff garbage\r\n"                  // ignored: no '$'
+		"$GNGGA,123410.000,4903.50"             // interrupted by the next '$'
+		"$GNRMC,1*00\r\n"
+		"$GNZDA,1*00\r\n";
+
+	m_num_lines = 0;
+	nmea_rx_init(&rx, cb_sentence);
+	nmea_rx_feed(&rx, (const uint8_t*)input, strlen(input + 1) + 1);
+
+	CHECK(m_num_lines == 2);
+	CHECK(strcmp(m_lines[0], "$GNRMC,1*00\r\n") == 0);
+	CHECK(strcmp(m_lines[1], "$GNZDA,1*00\r\n") == 0);
+	CHECK(!m_valid[0] && !m_valid[1]);
+	CHECK(rx.lines_dropped == 1);
+
+	// restart at the very beginning of a chunk
+	m_num_lines = 0;
+	nmea_rx_feed(&rx, (const uint8_t*)"$GNGGA,12", 9);
+	nmea_rx_feed(&rx, (const uint8_t*)"$GNGSA,A*00\r\n", 13);
+
+	CHECK(m_num_lines == 1);
+	CHECK(strcmp(m_lines[0], "$GNGSA,A*00\r\n") == 0);
+	CHECK(rx.lines_dropped == 2);
+}
+
+static void test_overflow(void)
+{
+	nmea_rx_t rx;
+	char longline[200];
+	char manyfields[80];
+
+	memset(longline, 'A', sizeof(longline));
+	longline[0] = '$';
+
+	m_num_lines = 0;
+	nmea_rx_init(&rx, cb_sentence);
+	nmea_rx_feed(&rx, (const uint8_t*)longline, sizeof(longline));
+	nmea_rx_feed(&rx, (const uint8_t*)"\r\n$GNZDA,1*00\r\n", 15);
+
+	CHECK(m_num_lines == 1);
+	CHECK(strcmp(m_lines[0], "$GNZDA,1*00\r\n") == 0);
+	CHECK(rx.lines_dropped == 1);
+
+	// a partial line is dropped on reset
+	nmea_rx_feed(&rx, (const uint8_t*)"$GNGGA", 6);
+	nmea_rx_reset(&rx);
+	nmea_rx_feed(&rx, (const uint8_t*)",1*00\r\n", 7);
+
+	CHECK(m_num_lines == 1);
+	CHECK(rx.lines_dropped == 2);
+
+	// too many fields for the index
+	memset(manyfields, ',', sizeof(manyfields));
+	memcpy(manyfields, "$GPGSV", 6);
+	memcpy(manyfields + sizeof(manyfields) - 5, "*00\r\n", 5);
+
+	m_num_lines = 0;
+	nmea_rx_feed(&rx, (const uint8_t*)manyfields, sizeof(manyfields));
+
+	CHECK(m_num_lines == 1);
+	CHECK(!m_valid[0]);
+}
+
+static void test_checksum(void)
+{
+	nmea_rx_t rx;
+	const char *input =
+		"$GNGGA,,,,,,0,00,25.5,,,,,,*64\r\n"
+		"$GNGGA,,,,,,0,00,25.5,,,,,,*65\r\n"   // wrong checksum
+		"$GNGGA,,,,,,0,00,25.5,,,,,,*6\r\n"    // incomplete checksum
+		"$GNGGA,,,,,,0,00,25.5,,,,,,\r\n"      // no checksum
+		"$GNGGA,,,,,,0,00,25.5,,,,,,*64\n";     // no carriage return
+
+	m_num_lines = 0;
+	nmea_rx_init(&rx, cb_sentence);
+	nmea_rx_feed(&rx, (const uint8_t*)input, strlen(input));
+
+	CHECK(m_num_lines == 5);
+	CHECK(m_valid[0]);
+	CHECK(!m_valid[1]);
+	CHECK(!m_valid[2]);
+	CHECK(!m_valid[3]);
+	CHECK(m_valid[4]);
+}
+
+int main(int argc, char **argv)
+{
+	static uint8_t stream[MAX_STREAM_SIZE];
+
+	if(argc < 2) {
+		fprintf(stderr, "usage: %s <recorded nmea stream>\n", argv[0]);
+		return 2;
+	}
+
+	FILE *f = fopen(argv[1], "rb");
+	if(!f) {
+		perror(argv[1]);
+		return 2;
+	}
+
+	size_t stream_len = fread(stream, 1, sizeof(stream), f);
+	fclose(f);
+
+	srand(1);
+
+	test_recorded_stream(stream, stream_len);
+	test_garbage_and_restart();
+	test_overflow();
+	test_checksum();
+
+	if(m_failed) {
+		fprintf(stderr, "%d checks failed.\n", m_failed);
+		return 1;
+	}
+
+	printf("test_nmea_rx: all checks passed.\n");
+	return 0;
+}
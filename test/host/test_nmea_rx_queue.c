@@ -0,0 +1,195 @@
+/*
+ * Host-side test for the NMEA line queue.
+ *
+ * A recorded NMEA stream is fed through the line splitter into the queue in
+ * DMA-sized chunks, while the consumer only drains the queue from time to time
+ * (simulating a main loop that is blocked by display updates). The loss rate
+ * is reported for different queue sizes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nmea_rx.h"
+
+#define MAX_STREAM_SIZE  65536
+#define MAX_SLOTS        128
+#define DMA_CHUNK_SIZE   32
+
+static int m_failed;
+
+#define CHECK(cond) do { \
+	if(!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		m_failed++; \
+	} \
+} while(0)
+
+static nmea_sentence_t m_slots[MAX_SLOTS];
+static nmea_rx_queue_t m_queue;
+
+static size_t m_consumed;
+static nmea_sentence_t m_last_sentence;
+
+static void cb_sentence(const nmea_sentence_t *sentence)
+{
+	nmea_rx_queue_push(&m_queue, sentence);
+}
+
+static void consume_all(void)
+{
+	nmea_sentence_t *sentence;
+
+	while((sentence = nmea_rx_queue_peek(&m_queue)) != NULL) {
+		CHECK(sentence->valid);
+		CHECK(sentence->text[0] == '$');
+
+		// sentences must come out in order; the recording has no duplicate
+		// lines directly following each other
+		CHECK(sentence->len != m_last_sentence.len
+				|| memcmp(sentence->text, m_last_sentence.text, sentence->len) != 0);
+		m_last_sentence = *sentence;
+
+		nmea_rx_queue_pop(&m_queue);
+		m_consumed++;
+	}
+}
+
+/**@brief Replay the stream and return the number of overrun lines.
+ *
+ * @param stall_chunks  The consumer runs only once every stall_chunks DMA chunks.
+ */
+static uint32_t replay(const uint8_t *stream, size_t stream_len, uint8_t num_slots,
+                       size_t stall_chunks, size_t expected_lines)
+{
+	nmea_rx_t rx;
+
+	nmea_rx_init(&rx, cb_sentence);
+	nmea_rx_queue_init(&m_queue, m_slots, num_slots);
+
+	m_consumed = 0;
+	m_last_sentence.len = 0;
+
+	size_t chunks = 0;
+
+	for(size_t pos = 0; pos < stream_len; pos += DMA_CHUNK_SIZE) {
+		size_t len = stream_len - pos;
+		if(len > DMA_CHUNK_SIZE) {
+			len = DMA_CHUNK_SIZE;
+		}
+
+		nmea_rx_feed(&rx, stream + pos, len);
+
+		if(++chunks % stall_chunks == 0) {
+			consume_all();
+		}
+	}
+
+	consume_all();
+
+	CHECK(m_queue.high_water_mark <= num_slots);
+	CHECK(m_consumed + m_queue.lines_overrun == expected_lines);
+	CHECK(nmea_rx_queue_count(&m_queue) == 0);
+
+	printf("  %3u slots, consumer every %3zu chunks: %4zu lines, %4u lost (%5.1f %%), high water mark %u\n",
+			num_slots, stall_chunks, expected_lines, m_queue.lines_overrun,
+			100.0 * m_queue.lines_overrun / expected_lines, m_queue.high_water_mark);
+
+	return m_queue.lines_overrun;
+}
+
+static void make_sentence(nmea_sentence_t *sentence, const char *line)
+{
+	size_t consumed;
+
+	nmea_sentence_init(sentence);
+	nmea_sentence_append(sentence, (const uint8_t*)line, strlen(line), &consumed);
+}
+
+static void test_wraparound(void)
+{
+	char line[16];
+	nmea_sentence_t sentence;
+
+	nmea_rx_queue_init(&m_queue, m_slots, 4);
+
+	// run the 8 bit indices through several wrap-arounds
+	for(int i = 0; i < 1000; i++) {
+		snprintf(line, sizeof(line), "$L%d\r\n", i);
+		make_sentence(&sentence, line);
+
+		CHECK(nmea_rx_queue_push(&m_queue, &sentence));
+		CHECK(nmea_rx_queue_count(&m_queue) == 1);
+
+		nmea_sentence_t *out = nmea_rx_queue_peek(&m_queue);
+		CHECK(out && out->len == sentence.len && strcmp(out->text, sentence.text) == 0);
+
+		nmea_rx_queue_pop(&m_queue);
+		CHECK(nmea_rx_queue_peek(&m_queue) == NULL);
+	}
+
+	// fill the queue completely
+	make_sentence(&sentence, "$X\r\n");
+
+	for(int i = 0; i < 4; i++) {
+		CHECK(nmea_rx_queue_push(&m_queue, &sentence));
+	}
+
+	CHECK(!nmea_rx_queue_push(&m_queue, &sentence));
+	CHECK(m_queue.lines_overrun == 1);
+	CHECK(m_queue.high_water_mark == 4);
+
+	nmea_rx_queue_flush(&m_queue);
+	CHECK(nmea_rx_queue_count(&m_queue) == 0);
+}
+
+int main(int argc, char **argv)
+{
+	static uint8_t stream[MAX_STREAM_SIZE];
+
+	if(argc < 2) {
+		fprintf(stderr, "usage: %s <recorded nmea stream>\n", argv[0]);
+		return 2;
+	}
+
+	FILE *f = fopen(argv[1], "rb");
+	if(!f) {
+		perror(argv[1]);
+		return 2;
+	}
+
+	size_t stream_len = fread(stream, 1, sizeof(stream), f);
+	fclose(f);
+
+	size_t expected_lines = 0;
+	for(size_t i = 0; i < stream_len; i++) {
+		if(stream[i] == '\n') {
+			expected_lines++;
+		}
+	}
+
+	test_wraparound();
+
+	// one epoch is about 20 chunks. Stall for one complete epoch.
+	printf("Replaying %s with a stalled consumer:\n", argv[1]);
+
+	uint32_t lost_2  = replay(stream, stream_len,  2, 20, expected_lines);
+	uint32_t lost_4  = replay(stream, stream_len,  4, 20, expected_lines);
+	uint32_t lost_16 = replay(stream, stream_len, 16, 20, expected_lines);
+
+	CHECK(lost_2 > 0);
+	CHECK(lost_4 <= lost_2);
+	CHECK(lost_16 == 0);
+
+	// a consumer that keeps up never loses anything, even with two slots
+	CHECK(replay(stream, stream_len, 2, 1, expected_lines) == 0);
+
+	if(m_failed) {
+		fprintf(stderr, "%d checks failed.\n", m_failed);
+		return 1;
+	}
+
+	printf("test_nmea_rx_queue: all checks passed.\n");
+	return 0;
+}
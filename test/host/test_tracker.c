@@ -0,0 +1,509 @@
+/*
+ * Host-side test for the SmartBeaconing of the tracker.
+ *
+ * NMEA streams (GGA + RMC at 1 Hz) are generated from lists of segments with
+ * constant speed and heading and replayed like bench_tracker does: the
+ * sentences are indexed, grouped into epochs by gps_epoch.c and each epoch is
+ * passed to tracker_run(). The times of the position reports are checked
+ * against the rates and turn thresholds of the parameters.
+ *
+ * Finally, a walk and a bike ride with a noisy GNSS heading and the recorded
+ * drive data/drive_1hz.nmea are replayed. For each, the position reports and
+ * their time on air at SF12 per hour are reported, also for the rules the
+ * tracker used before SmartBeaconing (at least 30 s apart, after 30 min, 2 km
+ * or a heading change of 30° above 1 m/s).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+
+#include "nmea.h"
+#include "gps_epoch.h"
+#include "lora.h"
+#include "lora_toa.h"
+#include "tracker.h"
+#include "utils.h"
+
+static int m_failed;
+
+#define CHECK(cond) do { \
+	if(!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		m_failed++; \
+	} \
+} while(0)
+
+#define MAX_BEACONS  4096
+#define MAX_LINE_LEN 128
+
+static uint64_t    m_now;
+
+static uint8_t     m_tx_buffer[LORA_TX_BUFFER_SIZE];
+static bool        m_tx_reserved;
+static uint8_t     m_tx_len;
+
+static nmea_data_t m_nmea_data;
+static gps_epoch_t m_epoch;
+
+/* Position reports of the current replay. */
+static uint64_t    m_beacons[MAX_BEACONS];
+static uint32_t    m_num_beacons;
+static uint32_t    m_airtime_ms;
+
+/* Position reports by the previous rules. */
+static struct {
+	uint64_t last_tx;
+	float    last_heading;
+	float    last_lat;
+	float    last_lon;
+	uint32_t count;
+} m_old;
+
+uint64_t time_base_get(void)
+{
+	return m_now;
+}
+
+uint8_t* lora_tx_reserve(void)
+{
+	if(m_tx_reserved) {
+		return NULL;
+	}
+
+	m_tx_reserved = true;
+	return m_tx_buffer;
+}
+
+ret_code_t lora_tx_commit(uint8_t length)
+{
+	if(!m_tx_reserved) {
+		return NRF_ERROR_INVALID_STATE;
+	}
+
+	m_tx_reserved = false;
+	m_tx_len = length;
+	return NRF_SUCCESS;
+}
+
+void lora_tx_cancel(void)
+{
+	m_tx_reserved = false;
+}
+
+static void cb_tracker(tracker_evt_t evt)
+{
+	(void)evt;
+}
+
+static uint32_t m_rng_state = 0x12345678;
+
+static uint32_t rng(void)
+{
+	// xorshift32
+	m_rng_state ^= m_rng_state << 13;
+	m_rng_state ^= m_rng_state >> 17;
+	m_rng_state ^= m_rng_state << 5;
+	return m_rng_state;
+}
+
+/* Random value from -max to max. */
+static float rnd(float max)
+{
+	return ((float)(rng() % 20001) - 10000.0f) * 1e-4f * max;
+}
+
+static float heading_delta(float a, float b)
+{
+	float delta = fabsf(a - b);
+
+	return (delta > 180.0f) ? 360.0f - delta : delta;
+}
+
+/* The rules of the tracker before SmartBeaconing. */
+static void run_old_rules(void)
+{
+	const nmea_data_t *data = &m_nmea_data;
+	bool do_tx;
+
+	if(!data->pos_valid || (m_old.last_tx && (m_now - m_old.last_tx) < 30000)) {
+		return;
+	}
+
+	do_tx = !m_old.last_tx || (m_now - m_old.last_tx) > 1800000;
+
+	if(data->speed_heading_valid && data->speed >= 1.0f
+			&& heading_delta(data->heading, m_old.last_heading) >= 30.0f) {
+		do_tx = true;
+	}
+
+	if(great_circle_distance_m(data->lat, data->lon, m_old.last_lat, m_old.last_lon) >= 2000.0f) {
+		do_tx = true;
+	}
+
+	if(do_tx) {
+		if(data->speed_heading_valid) {
+			m_old.last_heading = data->heading;
+		}
+
+		m_old.last_lat = data->lat;
+		m_old.last_lon = data->lon;
+		m_old.last_tx = m_now;
+		m_old.count++;
+	}
+}
+
+static void run_epoch(void)
+{
+	const nmea_datetime_t *dt = &m_nmea_data.datetime;
+	aprs_args_t args = {
+		.vbat_millivolt = 3900,
+	};
+	uint32_t tx_counter = tracker_get_tx_counter();
+
+	m_now = ((dt->time_h * 60 + dt->time_m) * 60 + dt->time_s) * 1000ULL;
+
+	tracker_run(&m_nmea_data, &args);
+
+	if(tracker_get_tx_counter() != tx_counter) {
+		if(m_num_beacons < MAX_BEACONS) {
+			m_beacons[m_num_beacons++] = m_now;
+		}
+
+		m_airtime_ms += lora_toa_ms(&LORA_MODULATION_APRS, m_tx_len);
+	}
+
+	run_old_rules();
+}
+
+static void replay_line(const char *line)
+{
+	nmea_sentence_t sentence;
+	size_t consumed;
+
+	nmea_sentence_init(&sentence);
+	nmea_sentence_append(&sentence, (const uint8_t*)line, strlen(line), &consumed);
+
+	if(gps_epoch_begin_sentence(&m_epoch, &sentence)) {
+		run_epoch();
+	}
+
+	if(nmea_parse_sentence(&sentence, NULL, &m_nmea_data) == NRF_SUCCESS) {
+		gps_epoch_end_sentence(&m_epoch);
+	}
+}
+
+/* Send a sentence, the checksum is appended. */
+static void replay_sentence(const char *fmt, ...)
+{
+	char line[MAX_LINE_LEN];
+	uint8_t checksum = 0;
+	va_list ap;
+
+	va_start(ap, fmt);
+	int len = vsnprintf(line, sizeof(line) - 6, fmt, ap);
+	va_end(ap);
+
+	for(int i = 1; i < len; i++) {
+		checksum ^= (uint8_t)line[i];
+	}
+
+	snprintf(line + len, 6, "*%02X\r\n", checksum);
+	replay_line(line);
+}
+
+static void reset_replay(void)
+{
+	tracker_force_tx();
+	tracker_reset_tx_counter();
+	gps_epoch_init(&m_epoch);
+
+	memset(&m_nmea_data, 0, sizeof(m_nmea_data));
+	memset(&m_old, 0, sizeof(m_old));
+	m_now = 0;
+	m_num_beacons = 0;
+	m_airtime_ms = 0;
+}
+
+/* A part of a trace with constant speed and heading. */
+typedef struct {
+	uint32_t duration_s;
+	float    speed_kmh;
+	float    heading;
+} segment_t;
+
+/* Replay the segments as a stream at 1 Hz, starting at 10:00:00 UTC.
+ *
+ * @returns  The duration in seconds.
+ */
+static uint32_t replay_segments(const segment_t *segments, size_t num_segments,
+		float heading_noise, float speed_noise)
+{
+	double lat = 49.0, lon = 8.4;
+	uint32_t t = 0;
+
+	reset_replay();
+
+	for(size_t i = 0; i < num_segments; i++) {
+		for(uint32_t s = 0; s < segments[i].duration_s; s++, t++) {
+			uint32_t tod = 10 * 3600 + t;
+			float speed_kmh = segments[i].speed_kmh;
+			float heading = segments[i].heading;
+
+			if(speed_kmh > 0.0f) {
+				speed_kmh += rnd(speed_noise);
+				heading = fmodf(heading + rnd(heading_noise) + 360.0f, 360.0f);
+			}
+
+			speed_kmh = (speed_kmh < 0.0f) ? 0.0f : speed_kmh;
+
+			char lat_str[16], lon_str[16];
+			int lat_deg = (int)lat, lon_deg = (int)lon;
+
+			snprintf(lat_str, sizeof(lat_str), "%02d%07.4f", lat_deg, (lat - lat_deg) * 60.0);
+			snprintf(lon_str, sizeof(lon_str), "%03d%07.4f", lon_deg, (lon - lon_deg) * 60.0);
+
+			replay_sentence("$GNGGA,%02u%02u%02u.000,%s,N,%s,E,1,09,1.1,124.5,M,47.9,M,,",
+					tod / 3600, tod / 60 % 60, tod % 60, lat_str, lon_str);
+			replay_sentence("$GNRMC,%02u%02u%02u.000,A,%s,N,%s,E,%.1f,%.1f,161026,,,A,V",
+					tod / 3600, tod / 60 % 60, tod % 60, lat_str, lon_str,
+					speed_kmh / 1.852f, heading);
+
+			double step_m = speed_kmh / 3.6;
+
+			lat += step_m * cos(heading * M_PI / 180.0) / 111195.0;
+			lon += step_m * sin(heading * M_PI / 180.0) / (111195.0 * cos(lat * M_PI / 180.0));
+		}
+	}
+
+	// the last epoch is completed by the next sentence
+	replay_sentence("$GNGGA,%02u%02u%02u.000,,,,,0,00,,,M,,M,,",
+			(10 * 3600 + t) / 3600, (10 * 3600 + t) / 60 % 60, (10 * 3600 + t) % 60);
+
+	return t;
+}
+
+static void test_params(void)
+{
+	tracker_smartbeacon_t params = *tracker_get_smartbeacon();
+
+	CHECK(params.slow_speed_kmh == TRACKER_SB_SLOW_SPEED_KMH);
+	CHECK(params.fast_rate_s == TRACKER_SB_FAST_RATE_S);
+	CHECK(tracker_set_smartbeacon(&params) == NRF_SUCCESS);
+
+	params.fast_speed_kmh = params.slow_speed_kmh;
+	CHECK(tracker_set_smartbeacon(&params) == NRF_ERROR_INVALID_PARAM);
+
+	params = *tracker_get_smartbeacon();
+	params.slow_rate_s = params.fast_rate_s - 1;
+	CHECK(tracker_set_smartbeacon(&params) == NRF_ERROR_INVALID_PARAM);
+
+	params = *tracker_get_smartbeacon();
+	params.fast_rate_s = 9;
+	CHECK(tracker_set_smartbeacon(&params) == NRF_ERROR_INVALID_PARAM);
+
+	params = *tracker_get_smartbeacon();
+	params.slow_speed_kmh = 0;
+	CHECK(tracker_set_smartbeacon(&params) == NRF_ERROR_INVALID_PARAM);
+
+	params = *tracker_get_smartbeacon();
+	params.min_turn_time_s = 4;
+	CHECK(tracker_set_smartbeacon(&params) == NRF_ERROR_INVALID_PARAM);
+
+	// rejected parameters are not applied
+	CHECK(tracker_get_smartbeacon()->min_turn_time_s == TRACKER_SB_MIN_TURN_TIME_S);
+
+	params.min_turn_time_s = 20;
+	CHECK(tracker_set_smartbeacon(&params) == NRF_SUCCESS);
+	CHECK(tracker_get_smartbeacon()->min_turn_time_s == 20);
+}
+
+/* Straight at constant speed: the reports must be the expected interval apart.
+ * WX reports block position reports for 20 s. */
+static void check_rate(float speed_kmh, uint32_t expected_s)
+{
+	segment_t segment = {3600, speed_kmh, 90.0f};
+
+	replay_segments(&segment, 1, 0.0f, 0.0f);
+
+	CHECK(m_num_beacons >= 2 && m_beacons[0] == (10 * 3600 + 1) * 1000ULL);
+
+	for(uint32_t i = 1; i < m_num_beacons; i++) {
+		uint64_t interval = m_beacons[i] - m_beacons[i - 1];
+
+		if(interval < expected_s * 1000ULL || interval > (expected_s + 21) * 1000ULL) {
+			fprintf(stderr, "%.0f km/h: report %u after %llu ms, expected %u s\n",
+					speed_kmh, i, (unsigned long long)interval, expected_s);
+			m_failed++;
+			return;
+		}
+	}
+}
+
+static void test_rates(void)
+{
+	const tracker_smartbeacon_t defaults = {
+		TRACKER_SB_SLOW_SPEED_KMH, TRACKER_SB_SLOW_RATE_S,
+		TRACKER_SB_FAST_SPEED_KMH, TRACKER_SB_FAST_RATE_S,
+		TRACKER_SB_MIN_TURN_ANGLE_DEG, TRACKER_SB_TURN_SLOPE, TRACKER_SB_MIN_TURN_TIME_S};
+
+	CHECK(tracker_set_smartbeacon(&defaults) == NRF_SUCCESS);
+
+	check_rate(0.0f, 1800);
+	check_rate(4.0f, 1800);
+	check_rate(30.0f, 180);   // 60 s * 90 km/h / 30 km/h
+	check_rate(45.0f, 120);
+	check_rate(90.0f, 60);
+	check_rate(130.0f, 60);
+
+	tracker_smartbeacon_t params = defaults;
+
+	params.slow_rate_s = 600;
+	params.fast_rate_s = 30;
+	params.fast_speed_kmh = 60;
+	CHECK(tracker_set_smartbeacon(&params) == NRF_SUCCESS);
+
+	check_rate(0.0f, 600);
+	check_rate(20.0f, 90);
+
+	CHECK(tracker_set_smartbeacon(&defaults) == NRF_SUCCESS);
+}
+
+static void check_beacons(const char *name, const uint32_t *expected_s, uint32_t count)
+{
+	bool ok = (m_num_beacons == count);
+
+	for(uint32_t i = 0; ok && i < count; i++) {
+		ok = (m_beacons[i] == (10 * 3600 + expected_s[i]) * 1000ULL);
+	}
+
+	if(!ok) {
+		fprintf(stderr, "%s: reports at", name);
+
+		for(uint32_t i = 0; i < m_num_beacons; i++) {
+			fprintf(stderr, " %llu", (unsigned long long)(m_beacons[i] / 1000 - 10 * 3600));
+		}
+
+		fprintf(stderr, " s, expected %u\n", count);
+		m_failed++;
+	}
+}
+
+static void test_turns(void)
+{
+	// at 30 km/h, the turn threshold is 28° + 240 / 30 = 36°
+	static const segment_t bike[] = {
+		{100, 30.0f,   0.0f},
+		{ 50, 30.0f,  30.0f},  // below the threshold
+		{ 10, 30.0f,  75.0f},  // 75° since the last report
+		{250, 30.0f, 120.0f},  // 45° again, but only 10 s later
+	};
+	static const uint32_t bike_beacons[] = {1, 150, 180, 360};
+
+	replay_segments(bike, 4, 0.0f, 0.0f);
+	check_beacons("bike", bike_beacons, 4);
+
+	// at 5.5 km/h, the threshold is 71.6°, below 5 km/h no turn counts
+	static const segment_t walk[] = {
+		{100, 5.5f,   0.0f},
+		{100, 5.5f,  60.0f},
+		{100, 5.5f,  90.0f},   // 90° since the last report
+		{100, 4.0f, 150.0f},
+		{100, 0.0f,  60.0f},
+	};
+	static const uint32_t walk_beacons[] = {1, 200};
+
+	replay_segments(walk, 5, 0.0f, 0.0f);
+	check_beacons("walk", walk_beacons, 2);
+}
+
+static void report(const char *name, uint32_t duration_s)
+{
+	float hours = duration_s / 3600.0f;
+	float airtime_per_report = m_num_beacons ? m_airtime_ms / 1000.0f / m_num_beacons : 0.0f;
+
+	// the previous rules are assumed to send reports of the same length
+	printf("%-5s %3.0f min: %5.1f reports/h (%5.1f s airtime/h), before: %5.1f reports/h (%5.1f s/h)\n",
+			name, duration_s / 60.0f,
+			m_num_beacons / hours, m_num_beacons * airtime_per_report / hours,
+			m_old.count / hours, m_old.count * airtime_per_report / hours);
+}
+
+static void test_replay(const char *drive_stream)
+{
+	// a walk through a town with a noisy heading, a break and a bus stop
+	static const segment_t walk[] = {
+		{420, 4.8f,  10.0f}, {300, 5.2f, 100.0f}, {240, 4.6f,  60.0f}, {180, 0.0f,  60.0f},
+		{600, 5.0f, 150.0f}, {300, 5.4f, 240.0f}, {600, 0.0f, 240.0f}, {420, 4.9f, 200.0f},
+		{240, 5.3f, 290.0f}, {300, 4.7f,   0.0f},
+	};
+	// a bike ride with traffic lights
+	static const segment_t bike[] = {
+		{300, 18.0f,  80.0f}, { 40,  0.0f,  80.0f}, {600, 24.0f, 170.0f}, {240, 20.0f, 120.0f},
+		{ 30,  0.0f, 120.0f}, {900, 26.0f,  90.0f}, {300, 15.0f,  20.0f}, { 60,  0.0f,  20.0f},
+		{600, 22.0f, 300.0f}, {530, 19.0f, 250.0f},
+	};
+	uint32_t duration;
+
+	duration = replay_segments(walk, sizeof(walk) / sizeof(walk[0]), 25.0f, 0.5f);
+	report("walk", duration);
+	CHECK(m_num_beacons < m_old.count);
+	CHECK(m_num_beacons >= 2);
+
+	duration = replay_segments(bike, sizeof(bike) / sizeof(bike[0]), 10.0f, 1.5f);
+	report("bike", duration);
+	CHECK(m_num_beacons >= 10 && m_num_beacons <= 30);
+
+	FILE *f = fopen(drive_stream, "r");
+	char line[MAX_LINE_LEN];
+
+	if(!f) {
+		perror(drive_stream);
+		m_failed++;
+		return;
+	}
+
+	reset_replay();
+
+	uint64_t first = 0;
+
+	while(fgets(line, sizeof(line), f)) {
+		replay_line(line);
+
+		if(!first && m_now) {
+			first = m_now;
+		}
+	}
+
+	fclose(f);
+
+	report("drive", (m_now - first) / 1000 + 1);
+	CHECK(m_num_beacons >= m_old.count);
+}
+
+int main(int argc, char **argv)
+{
+	aprs_init();
+	aprs_set_source("DL9SAU-12");
+	aprs_set_dest("APLT00");
+	aprs_set_icon('/', '>');
+	aprs_set_comment("host replay");
+	aprs_set_config_flags(APRS_FLAG_COMPRESS_LOCATION | APRS_FLAG_ADD_ALTITUDE);
+
+	tracker_init(cb_tracker);
+
+	test_params();
+	test_rates();
+	test_turns();
+	test_replay(argc > 1 ? argv[1] : "data/drive_1hz.nmea");
+
+	if(m_failed) {
+		fprintf(stderr, "test_tracker: %d checks failed.\n", m_failed);
+		return 1;
+	}
+
+	printf("test_tracker: all checks passed.\n");
+	return 0;
+}